@@ -30,6 +30,7 @@
 #include <boost/bind.hpp>
 
 #include <graphlab/scheduler/ischeduler.hpp>
+#include <graphlab/scheduler/vertex_ordering.hpp>
 #include <graphlab/scheduler/scheduler_factory.hpp>
 #include <graphlab/scheduler/get_message_priority.hpp>
 #include <graphlab/vertex_program/ivertex_program.hpp>
@@ -40,6 +41,7 @@
 #include <graphlab/options/graphlab_options.hpp>
 #include <graphlab/rpc/dc_dist_object.hpp>
 #include <graphlab/engine/distributed_chandy_misra.hpp>
+#include <graphlab/engine/distributed_graph_coloring.hpp>
 #include <graphlab/engine/message_array.hpp>
 
 #include <graphlab/util/tracepoint.hpp>
@@ -198,6 +200,13 @@ namespace graphlab {
    * model to factorized consistency where only individual gather/apply/scatter
    * calls are guaranteed to be locally consistent. Can produce massive
    * increases in throughput at a consistency penalty.
+   * \li \b consistency (default: factorized) One of "factorized",
+   * "locking" or "coloring". "locking" is equivalent to factorized=false
+   * and uses the distributed Chandy-Misra locks. "coloring" computes a
+   * greedy coloring of the graph when the engine starts (and again whenever
+   * the graph changes) and executes one color class at a time. Since
+   * adjacent vertices never share a color, no locks are needed. This
+   * is much faster than "locking" on graphs with few colors.
    * \li \b nfibers (default: 10000) Number of fibers to use
    * \li \b stacksize (default: 16384) Stacksize of each fiber.
    */
@@ -328,6 +337,21 @@ namespace graphlab {
     /// A pointer to the lock implementation
     distributed_chandy_misra<graph_type>* cmlocks;
 
+    typedef distributed_graph_coloring<graph_type> coloring_type;
+    typedef typename coloring_type::color_type color_type;
+
+    /// A pointer to the graph coloring. Only used with coloring consistency
+    coloring_type* coloring;
+
+    /**
+     * Vertices which have been signaled but do not belong to the
+     * color class currently being executed.
+     */
+    dense_bitset deferred;
+
+    /// The color class being executed. UNCOLORED between phases.
+    color_type current_color;
+
     /// Per vertex data locks
     std::vector<simple_spinlock> vertexlocks;
 
@@ -399,6 +423,9 @@ namespace graphlab {
     /// engine option. Sets to true if factorized consistency is used
     bool factorized_consistency;
 
+    /// engine option. Sets to true if coloring consistency is used
+    bool coloring_consistency;
+
     bool endgame_mode;
 
     /// Time when engine is started
@@ -447,6 +474,8 @@ namespace graphlab {
       stacksize = 16384;
       use_cache = false;
       factorized_consistency = true;
+      coloring_consistency = false;
+      current_color = coloring_type::UNCOLORED;
       track_task_time = false;
       timed_termination = (size_t)(-1);
       termination_reason = execution_status::UNSET;
@@ -454,6 +483,7 @@ namespace graphlab {
       init();
       total_completion_time.resize(fiber_control::get_instance().num_workers());
       init();
+      if (coloring_consistency) coloring->recolor();
       rmi.barrier();
     }
 
@@ -484,6 +514,25 @@ namespace graphlab {
           opts.get_engine_args().get_option("factorized", factorized_consistency);
           if (rmi.procid() == 0)
             logstream(LOG_EMPH) << "Engine Option: factorized = " << factorized_consistency << std::endl;
+        } else if (opt == "consistency") {
+          std::string consistency;
+          opts.get_engine_args().get_option("consistency", consistency);
+          if (consistency == "factorized") {
+            factorized_consistency = true;
+            coloring_consistency = false;
+          } else if (consistency == "locking") {
+            factorized_consistency = false;
+            coloring_consistency = false;
+          } else if (consistency == "coloring") {
+            // consistency is provided by the schedule. The
+            // lock subsystem is not needed.
+            factorized_consistency = true;
+            coloring_consistency = true;
+          } else {
+            logstream(LOG_FATAL) << "Unknown consistency model: " << consistency << std::endl;
+          }
+          if (rmi.procid() == 0)
+            logstream(LOG_EMPH) << "Engine Option: consistency = " << consistency << std::endl;
         } else if (opt == "nfibers") {
           opts.get_engine_args().get_option("nfibers", nfibers);
           if (rmi.procid() == 0)
@@ -526,6 +575,12 @@ namespace graphlab {
         cmlocks = NULL;
       }
 
+      if (coloring_consistency) {
+        coloring = new coloring_type(rmi.dc(), graph);
+      } else {
+        coloring = NULL;
+      }
+
       // construct the termination consensus object
       consensus = new fiber_async_consensus(rmi.dc(), nfibers);
     }
@@ -541,6 +596,10 @@ namespace graphlab {
       // deinitialize performs the reverse
       graph.finalize();
       scheduler_ptr->set_num_vertices(graph.num_local_vertices());
+      const std::string ordering = scheduler_ptr->get_ordering_request();
+      if (!ordering.empty()) {
+        scheduler_ptr->set_ordering(vertex_ordering::compute(graph, ordering));
+      }
       messages.resize(graph.num_local_vertices());
       vertexlocks.resize(graph.num_local_vertices());
       program_running.resize(graph.num_local_vertices());
@@ -553,15 +612,30 @@ namespace graphlab {
       if (!factorized_consistency) {
         cm_handles.resize(graph.num_local_vertices());
       }
+      if (coloring_consistency) {
+        deferred.resize(graph.num_local_vertices());
+      }
       rmi.barrier();
     }
 
+    /**
+     * \internal
+     * Recomputes the graph coloring if the graph has changed since it
+     * was last colored. Must be called on all machines simultaneously.
+     */
+    void update_coloring() {
+      if (coloring_consistency && coloring->is_stale()) {
+        init();
+        coloring->recolor();
+      }
+    }
 
 
   public:
     ~async_consistent_engine() {
       delete consensus;
       delete cmlocks;
+      delete coloring;
       delete scheduler_ptr;
     }
 
@@ -595,6 +669,20 @@ namespace graphlab {
 
   private:
 
+    /**
+     * \internal
+     * Places a local vertex on the scheduler. With coloring consistency,
+     * vertices outside of the current color class are deferred until
+     * their class is executed.
+     */
+    void schedule_local(lvid_type lvid, double priority) {
+      if (coloring_consistency && coloring->color(lvid) != current_color) {
+        deferred.set_bit(lvid);
+      } else {
+        scheduler_ptr->schedule(lvid, priority);
+      }
+    }
+
     /**
      * \internal
      * This is used to receive a message forwarded from another machine
@@ -605,7 +693,7 @@ namespace graphlab {
       const lvid_type local_vid = graph.local_vid(vid);
       double priority;
       messages.add(local_vid, message, &priority);
-      scheduler_ptr->schedule(local_vid, priority);
+      schedule_local(local_vid, priority);
       consensus->cancel();
     }
 
@@ -631,7 +719,7 @@ namespace graphlab {
           else {
             double priority;
             messages.add(vtx.local_id(), message, &priority);
-            scheduler_ptr->schedule(vtx.local_id(), priority);
+            schedule_local(vtx.local_id(), priority);
             consensus->cancel();
           }
         }
@@ -639,14 +727,14 @@ namespace graphlab {
 
           double priority;
           messages.add(vtx.local_id(), message, &priority);
-          scheduler_ptr->schedule(vtx.local_id(), priority);
+          schedule_local(vtx.local_id(), priority);
           consensus->cancel();
         }
       }
       else {
         double priority;
         messages.add(vtx.local_id(), message, &priority);
-        scheduler_ptr->schedule(vtx.local_id(), priority);
+        schedule_local(vtx.local_id(), priority);
         consensus->cancel();
       }
     } // end of schedule
@@ -742,6 +830,7 @@ namespace graphlab {
     void signal(vertex_id_type gvid,
                 const message_type& message = message_type()) {
       rmi.barrier();
+      update_coloring();
       internal_signal_gvid(gvid, message);
       rmi.barrier();
     }
@@ -753,20 +842,35 @@ namespace graphlab {
       signal_vset(vset, message, order);
     } // end of schedule all
 
+    void signal_changed(const message_type& message = message_type(),
+                        const std::string& order = "shuffle") {
+      signal_vset(graph.changed_vertices(), message, order);
+      graph.clear_changed_vertices();
+    } // end of signal changed
+
     void signal_vset(const vertex_set& vset,
                     const message_type& message = message_type(),
                     const std::string& order = "shuffle") {
       logstream(LOG_DEBUG) << rmi.procid() << ": Schedule All" << std::endl;
+      update_coloring();
       // allocate a vector with all the local owned vertices
       // and schedule all of them.
       std::vector<vertex_id_type> vtxs;
-      vtxs.reserve(graph.num_local_own_vertices());
-      for(lvid_type lvid = 0;
-          lvid < graph.get_local_graph().num_vertices();
-          ++lvid) {
-        if (graph.l_vertex(lvid).owner() == rmi.procid() &&
-            vset.l_contains(lvid)) {
-          vtxs.push_back(lvid);
+      if (!vset.lazy && vset.sparse) {
+        foreach(lvid_type lvid, vset.sparse_lvids) {
+          if (graph.l_vertex(lvid).owner() == rmi.procid()) {
+            vtxs.push_back(lvid);
+          }
+        }
+      } else {
+        vtxs.reserve(graph.num_local_own_vertices());
+        for(lvid_type lvid = 0;
+            lvid < graph.get_local_graph().num_vertices();
+            ++lvid) {
+          if (graph.l_vertex(lvid).owner() == rmi.procid() &&
+              vset.l_contains(lvid)) {
+            vtxs.push_back(lvid);
+          }
         }
       }
 
@@ -776,7 +880,7 @@ namespace graphlab {
       foreach(lvid_type lvid, vtxs) {
         double priority;
         messages.add(lvid, message, &priority);
-        scheduler_ptr->schedule(lvid, priority);
+        schedule_local(lvid, priority);
       }
       rmi.barrier();
     }
@@ -871,6 +975,23 @@ namespace graphlab {
     }
 
 
+    /**
+     * \internal
+     * Locks both endpoints of an edge. Not needed with coloring
+     * consistency since adjacent vertices never run at the same time.
+     */
+    inline void lock_edge(lvid_type a, lvid_type b) {
+      if (coloring_consistency) return;
+      vertexlocks[std::min(a,b)].lock();
+      vertexlocks[std::max(a,b)].lock();
+    }
+
+    inline void unlock_edge(lvid_type a, lvid_type b) {
+      if (coloring_consistency) return;
+      vertexlocks[a].unlock();
+      vertexlocks[b].unlock();
+    }
+
     conditional_gather_type perform_gather(vertex_id_type vid,
                                vertex_program_type& vprog_) {
       vertex_program_type vprog = vprog_;
@@ -891,11 +1012,9 @@ namespace graphlab {
         foreach(local_edge_type local_edge, local_vertex.in_edges()) {
           edge_type edge(local_edge);
           lvid_type a = edge.source().local_id(), b = edge.target().local_id();
-          vertexlocks[std::min(a,b)].lock();
-          vertexlocks[std::max(a,b)].lock();
+          lock_edge(a, b);
           accum += vprog.gather(context, vertex, edge);
-          vertexlocks[a].unlock();
-          vertexlocks[b].unlock();
+          unlock_edge(a, b);
         }
       } 
       // do out edges
@@ -903,11 +1022,9 @@ namespace graphlab {
         foreach(local_edge_type local_edge, local_vertex.out_edges()) {
           edge_type edge(local_edge);
           lvid_type a = edge.source().local_id(), b = edge.target().local_id();
-          vertexlocks[std::min(a,b)].lock();
-          vertexlocks[std::max(a,b)].lock();
+          lock_edge(a, b);
           accum += vprog.gather(context, vertex, edge);
-          vertexlocks[a].unlock();
-          vertexlocks[b].unlock();
+          unlock_edge(a, b);
         }
       } 
       if (use_cache) {
@@ -927,22 +1044,18 @@ namespace graphlab {
         foreach(local_edge_type local_edge, local_vertex.in_edges()) {
           edge_type edge(local_edge);
           lvid_type a = edge.source().local_id(), b = edge.target().local_id();
-          vertexlocks[std::min(a,b)].lock();
-          vertexlocks[std::max(a,b)].lock();
+          lock_edge(a, b);
           vprog.scatter(context, vertex, edge);
-          vertexlocks[a].unlock();
-          vertexlocks[b].unlock();
+          unlock_edge(a, b);
         }
       } 
       if(scatter_dir == OUT_EDGES || scatter_dir == ALL_EDGES) {
         foreach(local_edge_type local_edge, local_vertex.out_edges()) {
           edge_type edge(local_edge);
           lvid_type a = edge.source().local_id(), b = edge.target().local_id();
-          vertexlocks[std::min(a,b)].lock();
-          vertexlocks[std::max(a,b)].lock();
+          lock_edge(a, b);
           vprog.scatter(context, vertex, edge);
-          vertexlocks[a].unlock();
-          vertexlocks[b].unlock();
+          unlock_edge(a, b);
         }
       } 
 
@@ -958,9 +1071,13 @@ namespace graphlab {
                     const vertex_data_type& newdata) {
       vertex_program_type vprog = vprog_;
       lvid_type lvid = graph.local_vid(vid);
-      vertexlocks[lvid].lock();
-      graph.l_vertex(lvid).data() = newdata;
-      vertexlocks[lvid].unlock();
+      if (coloring_consistency) {
+        graph.l_vertex(lvid).data() = newdata;
+      } else {
+        vertexlocks[lvid].lock();
+        graph.l_vertex(lvid).data() = newdata;
+        vertexlocks[lvid].unlock();
+      }
       perform_scatter_local(lvid, vprog);
     }
 
@@ -992,7 +1109,7 @@ namespace graphlab {
       // someone left a next message for me
       // reschedule it at high priority
       if (hasnext.get(lvid)) {
-        scheduler_ptr->schedule(lvid, 10000.0);
+        schedule_local(lvid, 10000.0);
         consensus->cancel();
         hasnext.clear_bit(lvid);
       }
@@ -1079,9 +1196,13 @@ namespace graphlab {
      /**************************************************************************/
      /*                              apply phase                               */
      /**************************************************************************/
-     vertexlocks[lvid].lock();
-     vprog.apply(context, vertex, gather_result.value);      
-     vertexlocks[lvid].unlock();
+     if (coloring_consistency) {
+       vprog.apply(context, vertex, gather_result.value);
+     } else {
+       vertexlocks[lvid].lock();
+       vprog.apply(context, vertex, gather_result.value);      
+       vertexlocks[lvid].unlock();
+     }
 
 
      /**************************************************************************/
@@ -1106,7 +1227,8 @@ namespace graphlab {
                                        &async_consistent_engine::perform_scatter, 
                                        vid,
                                        vprog,
-                                       local_vertex.data()));
+                                       static_cast<const vertex_data_type&>(
+                                           local_vertex.data())));
      }
      perform_scatter_local(lvid, vprog);
      for(size_t i = 0;i < scatter_futures.size(); ++i) 
@@ -1192,6 +1314,89 @@ namespace graphlab {
       }
     } // end of thread start
 
+    /**
+     * \internal
+     * Launches the engine fibers and waits until the consensus
+     * determines that there is no more work.
+     */
+    void launch_threads_and_join() {
+      size_t effncpus = std::min(ncpus, fiber_control::get_instance().num_workers());
+      for (size_t i = 0; i < nfibers ; ++i) {
+        thrgroup.launch(boost::bind(&engine_type::thread_start, this, i), 
+                        i % effncpus);
+      }
+      thrgroup.join();
+    }
+
+    struct max_reducer {
+      void operator()(size_t& a, const size_t& b) const {
+        a = std::max(a, b);
+      }
+    };
+
+    struct vector_add_reducer {
+      void operator()(std::vector<size_t>& a, const std::vector<size_t>& b) const {
+        for (size_t i = 0;i < a.size(); ++i) a[i] += b[i];
+      }
+    };
+
+    /**
+     * \internal
+     * Executes the engine one color class at a time. Each phase moves
+     * the deferred vertices of one color onto the scheduler and runs the
+     * fibers until the consensus detects that the class is exhausted.
+     * Signals to other colors are deferred to later phases. Classes are
+     * visited round robin until no machine has any deferred vertices.
+     */
+    void run_color_phases() {
+      const color_type ncolors = coloring->num_colors();
+      color_type next_color = 0;
+      while(1) {
+        // count the deferred vertices in each class. The last entry
+        // is used to agree on a forced stop.
+        std::vector<size_t> pending(ncolors + 1, 0);
+        size_t lvid = 0;
+        bool has_deferred = deferred.first_bit(lvid);
+        while(has_deferred) {
+          ++pending[coloring->color(lvid)];
+          has_deferred = deferred.next_bit(lvid);
+        }
+        pending[ncolors] = force_stop;
+        rmi.all_reduce2(pending, vector_add_reducer());
+        if (pending[ncolors] > 0) break;
+
+        color_type offset = 0;
+        while(offset < ncolors && pending[(next_color + offset) % ncolors] == 0) {
+          ++offset;
+        }
+        if (offset == ncolors) break;
+        current_color = (next_color + offset) % ncolors;
+        next_color = current_color + 1;
+
+        // schedule the class
+        has_deferred = deferred.first_bit(lvid);
+        while(has_deferred) {
+          if (coloring->color(lvid) == current_color) {
+            deferred.clear_bit(lvid);
+            double priority = 0;
+            message_type msg;
+            if (messages.peek(lvid, msg)) {
+              priority = scheduler_impl::get_message_priority(msg);
+            }
+            scheduler_ptr->schedule(lvid, priority);
+          }
+          has_deferred = deferred.next_bit(lvid);
+        }
+
+        consensus->reset();
+        endgame_mode = false;
+        rmi.dc().set_fast_track_requests(false);
+        rmi.barrier();
+        launch_threads_and_join();
+        current_color = coloring_type::UNCOLORED;
+      }
+    }
+
 /**************************************************************************
  *                         Main engine start()                            *
  **************************************************************************/
@@ -1208,6 +1413,7 @@ namespace graphlab {
       * \return the reason for termination
       */
     execution_status::status_enum start() {
+      update_coloring();
       bool old_fasttrack = rmi.dc().set_fast_track_requests(false);
       logstream(LOG_INFO) << "Spawning " << nfibers << " threads" << std::endl;
       ASSERT_TRUE(scheduler_ptr != NULL);
@@ -1238,13 +1444,13 @@ namespace graphlab {
         logstream(LOG_INFO) << "Total Allocated Bytes: " << allocatedmem << std::endl;
       }
       thrgroup.set_stacksize(stacksize);
-        
-      size_t effncpus = std::min(ncpus, fiber_control::get_instance().num_workers());
-      for (size_t i = 0; i < nfibers ; ++i) {
-        thrgroup.launch(boost::bind(&engine_type::thread_start, this, i), 
-                        i % effncpus);
+      fiber_control::get_instance().reset_stack_usage();
+
+      if (coloring_consistency) {
+        run_color_phases();
+      } else {
+        launch_threads_and_join();
       }
-      thrgroup.join();
       aggregator.stop();
       // if termination reason was not changed, then it must be depletion
       if (termination_reason == execution_status::RUNNING) {
@@ -1266,6 +1472,12 @@ namespace graphlab {
       rmi.all_reduce(numadds);
       rmi.cout() << "Schedule Adds: " << numadds << std::endl;
 
+      size_t max_stack_usage =
+          fiber_control::get_instance().get_stack_statistics().max_stack_usage;
+      rmi.all_reduce2(max_stack_usage, max_reducer());
+      rmi.cout() << "Fiber Stack High-Water Mark: " << max_stack_usage
+                 << " of " << stacksize << " bytes" << std::endl;
+
       if (track_task_time) {
         double total_task_time = 0;
         for (size_t i = 0;i < total_completion_time.size(); ++i) {
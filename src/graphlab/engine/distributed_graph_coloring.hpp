@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_DISTRIBUTED_GRAPH_COLORING_HPP
+#define GRAPHLAB_DISTRIBUTED_GRAPH_COLORING_HPP
+#include <vector>
+#include <algorithm>
+#include <graphlab/rpc/dc_dist_object.hpp>
+#include <graphlab/rpc/buffered_exchange.hpp>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/util/integer_mix.hpp>
+#include <graphlab/util/timer.hpp>
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/macros_def.hpp>
+namespace graphlab {
+
+/**
+  * \internal
+  *
+  * Computes a distributed greedy vertex coloring of a finalized
+  * distributed_graph such that no two adjacent vertices share a color.
+  * Colors are stored for every local replica (master and mirrors) and are
+  * used by the async_consistent_engine to run one color class at a time
+  * without any locking.
+  *
+  * The coloring is computed using the Jones-Plassmann scheme:
+  * each vertex is given a pseudo-random priority derived from its
+  * vertex ID. In every round, an uncolored vertex whose uncolored neighbors
+  * all have lower priority picks the smallest color not used by any of its
+  * neighbors. Since the edges of a vertex are spread over its replicas,
+  * every mirror computes a partial result (blocked flag and neighbor colors)
+  * over its local edges and forwards it to the master, which assigns the
+  * color and pushes it back to the mirrors.
+  */
+template <typename GraphType>
+class distributed_graph_coloring {
+ public:
+  typedef typename GraphType::local_vertex_type local_vertex_type;
+  typedef typename GraphType::local_edge_type local_edge_type;
+  typedef typename GraphType::vertex_record vertex_record;
+
+  typedef typename GraphType::vertex_id_type vertex_id_type;
+  typedef typename GraphType::lvid_type lvid_type;
+
+  typedef uint32_t color_type;
+  /// The color of a vertex which has not been colored yet
+  static const color_type UNCOLORED = color_type(-1);
+
+ private:
+  typedef distributed_graph_coloring<GraphType> coloring_type;
+
+  /**
+   * The contribution of one replica to the coloring decision of a vertex.
+   */
+  struct partial_record {
+    vertex_id_type gvid;
+    bool blocked;
+    std::vector<color_type> used;
+    void save(oarchive& oarc) const {
+      oarc << gvid << blocked << used;
+    }
+    void load(iarchive& iarc) {
+      iarc >> gvid >> blocked >> used;
+    }
+  };
+
+  typedef std::pair<vertex_id_type, color_type> color_record;
+
+  struct max_color_reducer {
+    void operator()(color_type& a, const color_type& b) const {
+      a = std::max(a, b);
+    }
+  };
+
+  dc_dist_object<coloring_type> rmi;
+  GraphType& graph;
+
+  buffered_exchange<partial_record> partial_exchange;
+  buffered_exchange<color_record> color_exchange;
+
+  /// The color of each local vertex
+  std::vector<color_type> colors;
+  color_type ncolors;
+
+  /// Set if an uncolored neighbor with a higher priority exists
+  dense_bitset blocked;
+  /// The colors of all neighbors of each uncolored vertex
+  std::vector<std::vector<color_type> > used;
+
+  /// Size of the graph when the coloring was computed
+  size_t colored_nverts, colored_nedges;
+
+  static size_t priority(vertex_id_type vid) {
+    return integer_mix(vid ^ vertex_id_type(0x5bd1e995));
+  }
+
+  /// Returns true if vertex a must be colored before vertex b
+  static bool precedes(vertex_id_type a, vertex_id_type b) {
+    const size_t pa = priority(a), pb = priority(b);
+    return pa > pb || (pa == pb && a > b);
+  }
+
+  /**
+   * Scans the local edges of an uncolored vertex, filling in the
+   * blocked bit and the list of neighbor colors.
+   */
+  void scan_local_edges(lvid_type lvid) {
+    local_vertex_type lvertex(graph.l_vertex(lvid));
+    const vertex_id_type gvid = lvertex.global_id();
+    std::vector<color_type>& u = used[lvid];
+    u.clear();
+    foreach(local_edge_type edge, lvertex.in_edges()) {
+      const lvid_type other = edge.source().id();
+      if (other == lvid) continue;
+      if (colors[other] != UNCOLORED) u.push_back(colors[other]);
+      else if (precedes(edge.source().global_id(), gvid)) {
+        blocked.set_bit(lvid); u.clear(); return;
+      }
+    }
+    foreach(local_edge_type edge, lvertex.out_edges()) {
+      const lvid_type other = edge.target().id();
+      if (other == lvid) continue;
+      if (colors[other] != UNCOLORED) u.push_back(colors[other]);
+      else if (precedes(edge.target().global_id(), gvid)) {
+        blocked.set_bit(lvid); u.clear(); return;
+      }
+    }
+  }
+
+  /// Returns the smallest color not in the list. Destroys the list.
+  static color_type smallest_free_color(std::vector<color_type>& u) {
+    std::sort(u.begin(), u.end());
+    color_type c = 0;
+    for (size_t i = 0;i < u.size(); ++i) {
+      if (u[i] == c) ++c;
+      else if (u[i] > c) break;
+    }
+    return c;
+  }
+
+  /**
+   * Performs one Jones-Plassmann round. Returns the number of
+   * master vertices on this machine which remain uncolored.
+   */
+  size_t coloring_round() {
+    procid_t sending_proc;
+    const lvid_type nlocal = graph.num_local_vertices();
+    blocked.clear();
+
+    // each replica computes its partial over the local edges
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (lvid_type lvid = 0; lvid < nlocal; ++lvid) {
+      if (colors[lvid] != UNCOLORED) continue;
+      scan_local_edges(lvid);
+      const vertex_record& rec = graph.l_get_vertex_record(lvid);
+      if (rec.owner != rmi.procid()) {
+        partial_record partial;
+        partial.gvid = rec.gvid;
+        partial.blocked = blocked.get(lvid);
+        partial.used.swap(used[lvid]);
+#ifdef _OPENMP
+        partial_exchange.send(rec.owner, partial, omp_get_thread_num());
+#else
+        partial_exchange.send(rec.owner, partial);
+#endif
+      }
+    }
+    partial_exchange.flush();
+    typename buffered_exchange<partial_record>::buffer_type partial_buffer;
+    while(partial_exchange.recv(sending_proc, partial_buffer)) {
+      foreach(partial_record& partial, partial_buffer) {
+        const lvid_type lvid = graph.local_vid(partial.gvid);
+        if (partial.blocked) blocked.set_bit_unsync(lvid);
+        else used[lvid].insert(used[lvid].end(),
+                               partial.used.begin(), partial.used.end());
+      }
+      partial_buffer.clear();
+    }
+
+    // masters which are not blocked pick a color and tell their mirrors
+    size_t remaining = 0;
+    for (lvid_type lvid = 0; lvid < nlocal; ++lvid) {
+      const vertex_record& rec = graph.l_get_vertex_record(lvid);
+      if (rec.owner != rmi.procid() || colors[lvid] != UNCOLORED) continue;
+      if (blocked.get(lvid)) {
+        ++remaining;
+        used[lvid].clear();
+        continue;
+      }
+      const color_type c = smallest_free_color(used[lvid]);
+      std::vector<color_type>().swap(used[lvid]);
+      colors[lvid] = c;
+      foreach(procid_t mirror, rec.mirrors()) {
+        color_exchange.send(mirror, color_record(rec.gvid, c));
+      }
+    }
+    color_exchange.flush();
+    typename buffered_exchange<color_record>::buffer_type color_buffer;
+    while(color_exchange.recv(sending_proc, color_buffer)) {
+      foreach(const color_record& rec, color_buffer) {
+        colors[graph.local_vid(rec.first)] = rec.second;
+      }
+      color_buffer.clear();
+    }
+    return remaining;
+  }
+
+ public:
+  distributed_graph_coloring(distributed_control& dc, GraphType& graph):
+      rmi(dc, this), graph(graph),
+#ifdef _OPENMP
+      partial_exchange(dc, omp_get_max_threads()),
+#else
+      partial_exchange(dc),
+#endif
+      color_exchange(dc), ncolors(0),
+      colored_nverts(0), colored_nedges(0) {
+    rmi.barrier();
+  }
+
+  /**
+   * Returns true if the graph changed since the coloring was
+   * last computed (or if it was never computed). Only global counts
+   * are compared so that all machines agree on the result.
+   */
+  bool is_stale() const {
+    return colored_nverts != graph.num_vertices() ||
+           colored_nedges != graph.num_edges();
+  }
+
+  /**
+   * Recomputes the coloring. Must be called by all machines
+   * simultaneously on a finalized graph.
+   */
+  void recolor() {
+    timer ti;
+    const lvid_type nlocal = graph.num_local_vertices();
+    colors.assign(nlocal, UNCOLORED);
+    blocked.resize(nlocal);
+    used.clear(); used.resize(nlocal);
+
+    size_t rounds = 0;
+    while(1) {
+      size_t remaining = coloring_round();
+      ++rounds;
+      rmi.all_reduce(remaining);
+      if (remaining == 0) break;
+    }
+    used.clear();
+    blocked.resize(0);
+
+    ncolors = 0;
+    for (lvid_type lvid = 0; lvid < nlocal; ++lvid) {
+      ncolors = std::max(ncolors, color_type(colors[lvid] + 1));
+    }
+    rmi.all_reduce2(ncolors, max_color_reducer());
+    colored_nverts = graph.num_vertices();
+    colored_nedges = graph.num_edges();
+    if (rmi.procid() == 0) {
+      logstream(LOG_EMPH) << "Graph coloring: " << ncolors << " colors in "
+                          << rounds << " rounds ("
+                          << ti.current_time() << "s)" << std::endl;
+    }
+  }
+
+  /// Returns the color of a local vertex
+  inline color_type color(lvid_type lvid) const {
+    return colors[lvid];
+  }
+
+  /// Returns the number of colors used
+  color_type num_colors() const {
+    return ncolors;
+  }
+};
+
+template <typename GraphType>
+const typename distributed_graph_coloring<GraphType>::color_type
+distributed_graph_coloring<GraphType>::UNCOLORED;
+
+} // namespace graphlab
+
+#include <graphlab/macros_undef.hpp>
+
+#endif
@@ -341,6 +341,31 @@ namespace graphlab {
                              const message_type& message = message_type(),
                              const std::string& order = "shuffle") = 0;
 
+    /**
+     * \brief Signal the vertices changed by graph updates.
+     *
+     * Signals the vertices in graph_type::changed_vertices(): the vertices
+     * which were added, or which got new edges, data or replicas, in the
+     * finalize() calls of a dynamic graph since the previous
+     * signal_changed(). The set is then cleared. This allows a vertex
+     * program to resume from the result of a previous run after a batch of
+     * updates, instead of restarting from scratch:
+     *
+     * \code
+     * engine.signal_all();
+     * engine.start();
+     * // ... add edges ...
+     * graph.finalize();
+     * engine.signal_changed();
+     * engine.start();
+     * \endcode
+     *
+     * The first call signals all vertices. Must be invoked on all machines
+     * simultaneously.
+     */
+    virtual void signal_changed(const message_type& message = message_type(),
+                                const std::string& order = "shuffle") = 0;
+
 
      /** 
      * \brief Creates a vertex aggregator. Returns true on success.
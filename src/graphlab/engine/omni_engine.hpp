@@ -226,6 +226,10 @@ namespace graphlab {
                      const std::string& order = "shuffle") {
       engine_ptr->signal_vset(vset, message, order);
     }
+    void signal_changed(const message_type& message = message_type(),
+                        const std::string& order = "shuffle") {
+      engine_ptr->signal_changed(message, order);
+    }
 
 
     aggregator_type* get_aggregator() { return engine_ptr->get_aggregator(); }
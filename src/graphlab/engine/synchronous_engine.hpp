@@ -42,6 +42,7 @@
 
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/parallel/fiber_barrier.hpp>
+#include <graphlab/parallel/numa_tools.hpp>
 #include <graphlab/util/tracepoint.hpp>
 #include <graphlab/util/memory_info.hpp>
 
@@ -199,6 +200,11 @@ namespace graphlab {
    * for the snapshot. The path including folder and file prefix in
    * which the snapshots should be saved.
    *
+   * \li \b exchange_compression The compression of the vertex program,
+   * vertex data, gather and message exchanges between machines: "none",
+   * "lz", "delta" or "adaptive". See \ref exchange_compression_type.
+   * Defaults to "none".
+   *
    * \see graphlab::omni_engine
    * \see graphlab::async_consistent_engine
    * \see graphlab::semi_synchronous_engine
@@ -415,7 +421,7 @@ namespace graphlab {
      * \ref graphlab::synchronous_engine::gather_accum
      * and \ref graphlab::synchronous_engine::messages.
      */
-    std::vector<simple_spinlock> vlocks;
+    std::vector<simple_spinlock, numa_allocator<simple_spinlock> > vlocks;
 
 
     /**
@@ -433,12 +439,13 @@ namespace graphlab {
      * \brief The vertex programs associated with each vertex on this
      * machine.
      */
-    std::vector<vertex_program_type> vertex_programs;
+    std::vector<vertex_program_type,
+                numa_allocator<vertex_program_type> > vertex_programs;
 
     /**
      * \brief Vector of messages associated with each vertex.
      */
-    std::vector<message_type> messages;
+    std::vector<message_type, numa_allocator<message_type> > messages;
 
     /**
      * \brief Bit indicating whether a message is present for each vertex.
@@ -455,7 +462,7 @@ namespace graphlab {
      * once and therefore must be guarded by a vertex locks in
      * \ref graphlab::synchronous_engine::vlocks
      */
-    std::vector<gather_type>  gather_accum;
+    std::vector<gather_type, numa_allocator<gather_type> > gather_accum;
 
     /**
      * \brief Bit indicating if the gather has accumulator contains any
@@ -477,7 +484,7 @@ namespace graphlab {
      * Caching is done locally and therefore a high-degree vertex may
      * have multiple caches (one per machine).
      */
-    std::vector<gather_type>  gather_cache;
+    std::vector<gather_type, numa_allocator<gather_type> > gather_cache;
 
     /**
      * \brief A bit indicating if the local gather for that vertex is
@@ -511,9 +518,15 @@ namespace graphlab {
 
     /**
      * \brief The shared counter used coordinate operations between
-     * threads.
+     * threads. Threads are handed the blocks of their own NUMA node's
+     * lvid range first.
      */
-    atomic<size_t> shared_lvid_counter;
+    numa_block_counter shared_lvid_counter;
+
+    /**
+     * \brief The NUMA node of each thread.
+     */
+    std::vector<size_t> thread_numa_node;
 
 
     /**
@@ -656,6 +669,10 @@ namespace graphlab {
                     const message_type& message = message_type(),
                     const std::string& order = "shuffle");
 
+    // documentation inherited from iengine
+    void signal_changed(const message_type& message = message_type(),
+                        const std::string& order = "shuffle");
+
 
     // documentation inherited from iengine
     float elapsed_seconds() const;
@@ -794,7 +811,8 @@ namespace graphlab {
      */
     template<typename MemberFunction>
     void run_synchronous(MemberFunction member_fun) {
-      shared_lvid_counter = 0;
+      shared_lvid_counter.reset(graph.num_local_vertices(),
+                                8 * sizeof(size_t));
       if (ncpus <= 1) {
         INCREMENT_EVENT(EVENT_ACTIVE_CPUS, 1);
       }
@@ -1016,6 +1034,12 @@ namespace graphlab {
     // Process any additional options
     std::vector<std::string> keys = opts.get_engine_args().get_option_keys();
     per_thread_compute_time.resize(opts.get_ncpus());
+    // thread i is pinned to fiber worker i (see run_synchronous)
+    thread_numa_node.resize(opts.get_ncpus());
+    for (size_t i = 0; i < thread_numa_node.size(); ++i) {
+      fiber_control& fc = fiber_control::get_instance();
+      thread_numa_node[i] = fc.worker_numa_node(i % fc.num_workers());
+    }
     use_cache = false;
     foreach(std::string opt, keys) {
       if (opt == "max_iterations") {
@@ -1048,6 +1072,22 @@ namespace graphlab {
         if (rmi.procid() == 0)
           logstream(LOG_EMPH) << "Engine Option: sched_allv = "
             << sched_allv << std::endl;
+      } else if (opt == "exchange_compression") {
+        std::string compression_str;
+        opts.get_engine_args().get_option("exchange_compression",
+                                          compression_str);
+        exchange_compression_type compression;
+        if (!exchange_compression_from_string(compression_str, compression)) {
+          logstream(LOG_FATAL) << "Unknown exchange_compression: "
+                               << compression_str << std::endl;
+        }
+        vprog_exchange.set_compression(compression);
+        vdata_exchange.set_compression(compression);
+        gather_exchange.set_compression(compression);
+        message_exchange.set_compression(compression);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: exchange_compression = "
+            << compression_str << std::endl;
       } else {
         logstream(LOG_FATAL) << "Unexpected Engine Option: " << opt << std::endl;
       }
@@ -1085,6 +1125,9 @@ namespace graphlab {
   template<typename VertexProgram>
   void synchronous_engine<VertexProgram>:: resize() {
     memory_info::log_usage("Before Engine Initialization");
+    // The per vertex arrays use the numa_allocator. Large arrays are
+    // first touched by threads on the NUMA node owning each lvid range,
+    // matching the ranges handed out by shared_lvid_counter.
     // Allocate vertex locks and vertex programs
     vlocks.resize(graph.num_local_vertices());
     vertex_programs.resize(graph.num_local_vertices());
@@ -1162,12 +1205,29 @@ namespace graphlab {
              const message_type& message, const std::string& order) {
     if (vlocks.size() != graph.num_local_vertices())
       resize();
+    if (!vset.lazy && vset.sparse) {
+      // only visit the members of a small frontier
+      foreach(lvid_type lvid, vset.sparse_lvids) {
+        if(graph.l_is_master(lvid)) {
+          internal_signal(vertex_type(graph.l_vertex(lvid)), message);
+        }
+      }
+      return;
+    }
     for(lvid_type lvid = 0; lvid < graph.num_local_vertices(); ++lvid) {
       if(graph.l_is_master(lvid) && vset.l_contains(lvid)) {
         internal_signal(vertex_type(graph.l_vertex(lvid)), message);
       }
     }
-  } // end of signal all
+  } // end of signal vset
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  signal_changed(const message_type& message, const std::string& order) {
+    signal_vset(graph.changed_vertices(), message, order);
+    graph.clear_changed_vertices();
+  } // end of signal changed
 
 
   template<typename VertexProgram>
@@ -1356,23 +1416,30 @@ namespace graphlab {
        *      received messages.
        */
 
-      // Check termination condition  ---------------------------------------
-      size_t total_active_vertices = num_active_vertices;
-      rmi.all_reduce(total_active_vertices);
-      if (rmi.procid() == 0 && print_this_round)
-        logstream(LOG_EMPH)
-          << "\tActive vertices: " << total_active_vertices << std::endl;
-      if(total_active_vertices == 0 ) {
-        termination_reason = execution_status::TASK_DEPLETION;
-        break;
-      }
+      // Start the termination check -------------------------------------
+      // The count of active vertices is reduced while the gathers run.
+      // If no vertex is active anywhere, no gather has anything to do,
+      // except with sched_allv where every vertex gathers.
+      request_future<size_t> total_active_vertices =
+          rmi.iall_reduce(size_t(num_active_vertices));
 
 
       // Execute gather operations-------------------------------------------
       // Execute the gather operation for all vertices that are active
       // in this minor-step (active-minorstep bit set).
       // if (rmi.procid() == 0) std::cout << "Gathering..." << std::endl;
-      run_synchronous( &synchronous_engine::execute_gathers );
+      if (!sched_allv || total_active_vertices() > 0) {
+        run_synchronous( &synchronous_engine::execute_gathers );
+      }
+
+      // Check termination condition  ---------------------------------------
+      if (rmi.procid() == 0 && print_this_round)
+        logstream(LOG_EMPH)
+          << "\tActive vertices: " << total_active_vertices() << std::endl;
+      if(total_active_vertices() == 0 ) {
+        termination_reason = execution_status::TASK_DEPLETION;
+        break;
+      }
       // Clear the minor step bit since only super-step vertices
       // (only master vertices are required to participate in the
       // apply step)
@@ -1444,6 +1511,19 @@ namespace graphlab {
       }
       logstream(LOG_INFO) << std::endl;
     }
+    const size_t bytes_before = vprog_exchange.bytes_before_compression() +
+        vdata_exchange.bytes_before_compression() +
+        gather_exchange.bytes_before_compression() +
+        message_exchange.bytes_before_compression();
+    if (bytes_before > 0) {
+      const size_t bytes_after = vprog_exchange.bytes_after_compression() +
+          vdata_exchange.bytes_after_compression() +
+          gather_exchange.bytes_after_compression() +
+          message_exchange.bytes_after_compression();
+      logstream(LOG_INFO) << "Exchange compression: " << bytes_before
+                          << " bytes compressed to " << bytes_after
+                          << std::endl;
+    }
     rmi.full_barrier();
     // Stop the aggregator
     aggregator.stop();
@@ -1463,7 +1543,7 @@ namespace graphlab {
     while (1) {
       // increment by a word at a time
       lvid_type lvid_block_start =
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
+                  shared_lvid_counter.next(thread_numa_node[thread_id]);
       if (lvid_block_start >= graph.num_local_vertices()) break;
       // get the bit field from has_message
       size_t lvid_bit_block = has_message.containing_word(lvid_block_start);
@@ -1507,7 +1587,7 @@ namespace graphlab {
     while (1) {
       // increment by a word at a time
       lvid_type lvid_block_start =
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
+                  shared_lvid_counter.next(thread_numa_node[thread_id]);
       if (lvid_block_start >= graph.num_local_vertices()) break;
       // get the bit field from has_message
       size_t lvid_bit_block = has_message.containing_word(lvid_block_start);
@@ -1573,7 +1653,7 @@ namespace graphlab {
     while (1) {
       // increment by a word at a time
       lvid_type lvid_block_start =
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
+                  shared_lvid_counter.next(thread_numa_node[thread_id]);
       if (lvid_block_start >= graph.num_local_vertices()) break;
       // get the bit field from has_message
       size_t lvid_bit_block = active_minorstep.containing_word(lvid_block_start);
@@ -1675,7 +1755,7 @@ namespace graphlab {
     while (1) {
       // increment by a word at a time
       lvid_type lvid_block_start =
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
+                  shared_lvid_counter.next(thread_numa_node[thread_id]);
       if (lvid_block_start >= graph.num_local_vertices()) break;
       // get the bit field from has_message
       size_t lvid_bit_block = active_superstep.containing_word(lvid_block_start);
@@ -1744,7 +1824,7 @@ namespace graphlab {
     while (1) {
       // increment by a word at a time
       lvid_type lvid_block_start =
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
+                  shared_lvid_counter.next(thread_numa_node[thread_id]);
       if (lvid_block_start >= graph.num_local_vertices()) break;
       // get the bit field from has_message
       size_t lvid_bit_block = active_minorstep.containing_word(lvid_block_start);
@@ -30,6 +30,7 @@
 #include <boost/bind.hpp>
 
 #include <graphlab/scheduler/ischeduler.hpp>
+#include <graphlab/scheduler/vertex_ordering.hpp>
 #include <graphlab/scheduler/scheduler_factory.hpp>
 #include <graphlab/scheduler/get_message_priority.hpp>
 #include <graphlab/engine/iengine.hpp>
@@ -679,6 +680,10 @@ namespace warp {
       // deinitialize performs the reverse
       graph.finalize();
       scheduler_ptr->set_num_vertices(graph.num_local_vertices());
+      const std::string ordering = scheduler_ptr->get_ordering_request();
+      if (!ordering.empty()) {
+        scheduler_ptr->set_ordering(vertex_ordering::compute(graph, ordering));
+      }
       messages.resize(graph.num_local_vertices());
       vertexlocks.resize(graph.num_local_vertices());
       program_running.resize(graph.num_local_vertices());
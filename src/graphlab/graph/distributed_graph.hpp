@@ -86,9 +86,11 @@
 #include <graphlab/graph/graph_hash.hpp>
 
 #include <graphlab/util/hopscotch_map.hpp>
+#include <graphlab/util/direct_index_map.hpp>
 
 #include <graphlab/util/fs_util.hpp>
 #include <graphlab/util/hdfs.hpp>
+#include <graphlab/util/mmap_snapshot.hpp>
 
 
 #include <graphlab/graph/builtin_parsers.hpp>
@@ -394,6 +396,15 @@ namespace graphlab {
 #endif
     typedef graphlab::distributed_graph<VertexData, EdgeData> graph_type;
 
+    /**
+     * The type returned by vertex_type::data(): vertex_data_type&, unless
+     * vertex_data_layout is specialized for the vertex data type
+     */
+    typedef typename local_graph_type::vertex_data_reference
+        vertex_data_reference;
+    typedef typename local_graph_type::vertex_data_const_reference
+        vertex_data_const_reference;
+
     typedef std::vector<simple_spinlock> lock_manager_type;
 
     friend class distributed_ingress_base<VertexData, EdgeData>;
@@ -456,12 +467,12 @@ namespace graphlab {
       }
 
       /// \brief Returns a constant reference to the data on the vertex
-      const vertex_data_type& data() const {
+      vertex_data_const_reference data() const {
         return graph_ref.get_local_graph().vertex_data(lvid);
       }
 
       /// \brief Returns a mutable reference to the data on the vertex
-      vertex_data_type& data() {
+      vertex_data_reference data() {
         return graph_ref.get_local_graph().vertex_data(lvid);
       }
 
@@ -612,6 +623,18 @@ namespace graphlab {
      *                Defaults to 50,000. Increasing this number will
      *                decrease partitioning time with a penalty to partitioning
      *                quality.
+     * \li \c exchange_compression The compression of the vertex and edge
+     *                exchanges during ingress: "none", "lz", "delta" or
+     *                "adaptive". Defaults to "none".
+     * \li \c compress_adjacency Store the local adjacency lists delta and
+     *                varint encoded, see
+     *                local_graph::set_compressed_adjacency(). Defaults to 0.
+     * \li \c dynamic Allow vertices and edges to be added after finalize().
+     *                The next finalize() only processes the changes, see
+     *                local_graph::set_dynamic(). Defaults to 0.
+     * \li \c dense_vid_index Look up vertex ids in an array instead of
+     *                the hash map when the ids on a machine are dense
+     *                enough, see local_vid(). Defaults to 1.
      *
      * \param [in] dc Distributed controller to associate with
      * \param [in] opts A graphlab::graphlab_options object specifying engine
@@ -620,7 +643,7 @@ namespace graphlab {
      */
     distributed_graph(distributed_control& dc,
                       const graphlab_options& opts = graphlab_options()) :
-      rpc(dc, this), finalized(false), vid2lvid(),
+      rpc(dc, this), finalized(false), vid2lvid(), use_vid_index(true),
       nverts(0), nedges(0), local_own_nverts(0), nreplicas(0),
       ingress_ptr(NULL), 
 #ifdef _OPENMP
@@ -628,7 +651,7 @@ namespace graphlab {
 #else
       vertex_exchange(dc), 
 #endif
-      vset_exchange(dc), parallel_ingress(true) {
+      vset_exchange(dc), parallel_ingress(true), changed_vset(true) {
       rpc.barrier();
       set_options(opts);
     }
@@ -646,6 +669,7 @@ namespace graphlab {
       size_t bufsize = 50000;
       bool usehash = false;
       bool userecent = false;
+      exchange_compression_type compression = EXCHANGE_COMPRESSION_NONE;
       std::string ingress_method = "";
       std::vector<std::string> keys = opts.get_graph_args().get_option_keys();
       foreach(std::string opt, keys) {
@@ -659,6 +683,37 @@ namespace graphlab {
           if (!parallel_ingress && rpc.procid() == 0)
             logstream(LOG_EMPH) << "Disable parallel ingress. Graph will be streamed through one node."
               << std::endl;
+        } else if (opt == "exchange_compression") {
+          std::string compression_str;
+          opts.get_graph_args().get_option("exchange_compression",
+                                           compression_str);
+          if (!exchange_compression_from_string(compression_str, compression)) {
+            logstream(LOG_FATAL) << "Unknown exchange_compression: "
+                                 << compression_str << std::endl;
+          }
+          if (rpc.procid() == 0)
+            logstream(LOG_EMPH) << "Graph Option: exchange_compression = "
+              << compression_str << std::endl;
+        } else if (opt == "compress_adjacency") {
+          bool compress_adjacency = false;
+          opts.get_graph_args().get_option("compress_adjacency",
+                                           compress_adjacency);
+          local_graph.set_compressed_adjacency(compress_adjacency);
+          if (rpc.procid() == 0)
+            logstream(LOG_EMPH) << "Graph Option: compress_adjacency = "
+              << compress_adjacency << std::endl;
+        } else if (opt == "dynamic") {
+          bool dynamic = false;
+          opts.get_graph_args().get_option("dynamic", dynamic);
+          local_graph.set_dynamic(dynamic);
+          if (rpc.procid() == 0)
+            logstream(LOG_EMPH) << "Graph Option: dynamic = "
+              << dynamic << std::endl;
+        } else if (opt == "dense_vid_index") {
+          opts.get_graph_args().get_option("dense_vid_index", use_vid_index);
+          if (rpc.procid() == 0)
+            logstream(LOG_EMPH) << "Graph Option: dense_vid_index = "
+              << use_vid_index << std::endl;
         }
         /**
          * These options below are deprecated.
@@ -683,6 +738,7 @@ namespace graphlab {
         }
     }
       set_ingress_method(ingress_method, bufsize, usehash, userecent);
+      ingress_ptr->set_exchange_compression(compression);
     }
 
   public:
@@ -700,17 +756,21 @@ namespace graphlab {
      *
      * Finalize is used to complete graph ingress by resolving vertex
      * ownship and completing local data structures. Once a graph is finalized
-     * its structure may not be modified. Repeated calls to finalize() do
-     * nothing.
+     * its structure may not be modified, unless the graph is dynamic (see
+     * the "dynamic" graph option). Repeated calls to finalize() do nothing,
+     * and on a dynamic graph they only process the vertices and edges added
+     * since the previous call.
      */
     void finalize() {
-#ifndef USE_DYNAMIC_LOCAL_GRAPH
-      if (finalized) return;
-#endif
+      if (finalized && !is_dynamic()) return;
       ASSERT_NE(ingress_ptr, NULL);
       logstream(LOG_INFO) << "Distributed graph: enter finalize" << std::endl;
+      // the ingress adds vertices to vid2lvid only
+      vid_index.clear();
       ingress_ptr->finalize();
       lock_manager.resize(num_local_vertices());
+      rebuild_vid_index();
+      rebuild_master_lvids();
       rpc.barrier(); 
 
       finalized = true;
@@ -721,6 +781,21 @@ namespace graphlab {
       return finalized;
     }
 
+    /**
+     * \brief Returns the vertices changed since clear_changed_vertices():
+     * the vertices added by finalize(), and the existing vertices which
+     * got new edges, new data or new replicas. All vertices are changed
+     * after the first finalize(). See iengine::signal_changed().
+     */
+    const vertex_set& changed_vertices() const {
+      return changed_vset;
+    }
+
+    /// \brief Empties changed_vertices().
+    void clear_changed_vertices() {
+      changed_vset = empty_set();
+    }
+
     /** \brief Get the number of vertices */
     size_t num_vertices() const { return nverts; }
 
@@ -818,16 +893,16 @@ namespace graphlab {
      */
     bool add_vertex(const vertex_id_type& vid,
                     const VertexData& vdata = VertexData() ) {
-#ifndef USE_DYNAMIC_LOCAL_GRAPH
       if(finalized) {
-        logstream(LOG_FATAL)
-          << "\n\tAttempting to add a vertex to a finalized graph."
-          << "\n\tVertices cannot be added to a graph after finalization."
-          << std::endl;
+        if (!is_dynamic()) {
+          logstream(LOG_FATAL)
+            << "\n\tAttempting to add a vertex to a finalized graph."
+            << "\n\tVertices cannot be added to a graph after finalization."
+            << "\n\tSet the graph option dynamic=1 to allow it."
+            << std::endl;
+        }
+        finalized = false;
       }
-#else
-      finalized = false;
-#endif
       if(vid == vertex_id_type(-1)) {
         logstream(LOG_ERROR)
           << "\n\tAdding a vertex with id -1 is not allowed."
@@ -860,16 +935,16 @@ namespace graphlab {
     bool add_edge(vertex_id_type source, vertex_id_type target,
                   const EdgeData& edata = EdgeData()) {
 
-#ifndef USE_DYNAMIC_LOCAL_GRAPH
       if(finalized) {
-        logstream(LOG_FATAL)
-          << "\n\tAttempting to add an edge to a finalized graph."
-          << "\n\tEdges cannot be added to a graph after finalization."
-          << std::endl;
+        if (!is_dynamic()) {
+          logstream(LOG_FATAL)
+            << "\n\tAttempting to add an edge to a finalized graph."
+            << "\n\tEdges cannot be added to a graph after finalization."
+            << "\n\tSet the graph option dynamic=1 to allow it."
+            << std::endl;
+        }
+        finalized = false;
       }
-#else 
-      finalized = false;
-#endif
       if(source == vertex_id_type(-1)) {
         logstream(LOG_ERROR)
           << "\n\tThe source vertex with id vertex_id_type(-1)\n"
@@ -903,16 +978,16 @@ namespace graphlab {
 
     bool add_edge_and_partid(vertex_id_type source, vertex_id_type target,size_t partid,
                   const EdgeData& edata = EdgeData()) {
-#ifndef USE_DYNAMIC_LOCAL_GRAPH
       if(finalized) {
-        logstream(LOG_FATAL)
-          << "\n\tAttempting to add an edge to a finalized graph."
-          << "\n\tEdges cannot be added to a graph after finalization."
-          << std::endl;
+        if (!is_dynamic()) {
+          logstream(LOG_FATAL)
+            << "\n\tAttempting to add an edge to a finalized graph."
+            << "\n\tEdges cannot be added to a graph after finalization."
+            << "\n\tSet the graph option dynamic=1 to allow it."
+            << std::endl;
+        }
+        finalized = false;
       }
-#else 
-      finalized = false;
-#endif
       if(source == vertex_id_type(-1)) {
         logstream(LOG_ERROR)
           << "\n\tThe source vertex with id vertex_id_type(-1)\n"
@@ -1018,51 +1093,59 @@ namespace graphlab {
       }
 
       rpc.barrier();
-      bool global_result_set = false;
-      ReductionType global_result = ReductionType();
-#ifdef _OPENMP
-#pragma omp parallel
-#endif
-      {
-        bool result_set = false;
-        ReductionType result = ReductionType();
-#ifdef _OPENMP
-        #pragma omp for
-#endif
-        for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
-          if (lvid2record[i].owner == rpc.procid() &&
-              vset.l_contains((lvid_type)i)) {
-            if (!result_set) {
-              const vertex_type vtx(l_vertex(i));
-              result = mapfunction(vtx);
-              result_set = true;
-            }
-            else if (result_set){
-              const vertex_type vtx(l_vertex(i));
-              const ReductionType tmp = mapfunction(vtx);
-              result += tmp;
-            }
-          }
-        }
-#ifdef _OPENMP
-        #pragma omp critical
-#endif
-        {
-          if (result_set) {
-            if (!global_result_set) {
-              global_result = result;
-              global_result_set = true;
-            }
-            else {
-              global_result += result;
-            }
-          }
-        }
+      std::vector<conditional_addition_wrapper<ReductionType> >
+        partial(omp_get_max_threads());
+      visit_owned_vertices(vset,
+          mapper<ReductionType, MapFunctionType>(mapfunction), partial);
+      rpc.all_reduce(partial[0]);
+      return partial[0].value;
+    } // end of map_reduce_vertices
+
+   /**
+    * \brief Performs several map-reduce operations on each vertex of the
+    * graph in a single pass.
+    *
+    * Returns the same results as calling map_reduce_vertices() once for
+    * every map function, but each vertex is only read once and the results
+    * of all the machines are combined in a single all_reduce. For instance,
+    * to count the words and the documents of a topic model at once:
+    * \code
+    * std::vector<size_t (*)(const graph_type::vertex_type&)> counters;
+    * counters.push_back(is_word);
+    * counters.push_back(is_doc);
+    * std::vector<size_t> counts = graph.map_reduce_vertices<size_t>(counters);
+    * \endcode
+    * Map functions of different types can be stored as
+    * boost::function<ReductionType(const vertex_type&)>.
+    * Like map_reduce_vertices(), it must be called on all machines
+    * simultaneously.
+    *
+    * \param mapfunctions The map functions. Entry j of the result is the sum
+    *                     of mapfunctions[j] over the vertices.
+    * \param vset The set of vertices to map reduce over. Optional. Defaults to
+    *             complete_set()
+    */
+    template <typename ReductionType, typename MapFunctionType>
+    std::vector<ReductionType>
+    map_reduce_vertices(const std::vector<MapFunctionType>& mapfunctions,
+                        const vertex_set& vset = complete_set()) {
+      BOOST_CONCEPT_ASSERT((graphlab::Serializable<ReductionType>));
+      BOOST_CONCEPT_ASSERT((graphlab::OpPlusEq<ReductionType>));
+      if(!finalized) {
+        logstream(LOG_FATAL)
+          << "\n\tAttempting to run graph.map_reduce_vertices(...) "
+          << "\n\tbefore calling graph.finalize()."
+          << std::endl;
       }
-      conditional_addition_wrapper<ReductionType>
-        wrapper(global_result, global_result_set);
-      rpc.all_reduce(wrapper);
-      return wrapper.value;
+
+      rpc.barrier();
+      std::vector<multi_reduction<ReductionType> >
+        partial(omp_get_max_threads(),
+                multi_reduction<ReductionType>(mapfunctions.size()));
+      visit_owned_vertices(vset,
+          multi_mapper<ReductionType, MapFunctionType>(mapfunctions), partial);
+      rpc.all_reduce(partial[0]);
+      return partial[0].results();
     } // end of map_reduce_vertices
 
    /**
@@ -1146,69 +1229,50 @@ namespace graphlab {
       }
 
       rpc.barrier();
-      bool global_result_set = false;
-      ReductionType global_result = ReductionType();
-#ifdef _OPENMP
-#pragma omp parallel
-#endif
-      {
-        bool result_set = false;
-        ReductionType result = ReductionType();
-#ifdef _OPENMP
-        #pragma omp for
-#endif
-        for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
-          if (vset.l_contains((lvid_type)i)) {
-            if (edir == IN_EDGES || edir == ALL_EDGES) {
-              foreach(const local_edge_type& e, l_vertex(i).in_edges()) {
-                if (!result_set) {
-                  edge_type edge(e);
-                  result = mapfunction(edge);
-                  result_set = true;
-                }
-                else if (result_set){
-                  edge_type edge(e);
-                  const ReductionType tmp = mapfunction(edge);
-                  result += tmp;
-                }
-              }
-            }
-            if (edir == OUT_EDGES || edir == ALL_EDGES) {
-              foreach(const local_edge_type& e, l_vertex(i).out_edges()) {
-                if (!result_set) {
-                  edge_type edge(e);
-                  result = mapfunction(edge);
-                  result_set = true;
-                }
-                else if (result_set){
-                  edge_type edge(e);
-                  const ReductionType tmp = mapfunction(edge);
-                  result += tmp;
-                }
-              }
-            }
-          }
-        }
-#ifdef _OPENMP
-        #pragma omp critical
-#endif
-        {
-          if (result_set) {
-            if (!global_result_set) {
-              global_result = result;
-              global_result_set = true;
-            }
-            else {
-              global_result += result;
-            }
-          }
-        }
+      std::vector<conditional_addition_wrapper<ReductionType> >
+        partial(omp_get_max_threads());
+      visit_edges(vset, edir,
+          mapper<ReductionType, MapFunctionType>(mapfunction), partial);
+      rpc.all_reduce(partial[0]);
+      return partial[0].value;
+   } // end of map_reduce_edges
+
+   /**
+    * \brief Performs several map-reduce operations on each edge of the
+    * graph in a single pass.
+    *
+    * Returns the same results as calling map_reduce_edges() once for every
+    * map function, with one pass over the edges and a single all_reduce.
+    * See the map_reduce_vertices() overload taking several map functions.
+    *
+    * \param mapfunctions The map functions. Entry j of the result is the sum
+    *                     of mapfunctions[j] over the edges.
+    * \param vset A set of vertices. Combines with edir to identify the set
+    *             of edges, as in map_reduce_edges().
+    * \param edir An edge direction. Optional. Defaults to IN_EDGES.
+    */
+    template <typename ReductionType, typename MapFunctionType>
+    std::vector<ReductionType>
+    map_reduce_edges(const std::vector<MapFunctionType>& mapfunctions,
+                     const vertex_set& vset = complete_set(),
+                     edge_dir_type edir = IN_EDGES) {
+      BOOST_CONCEPT_ASSERT((graphlab::Serializable<ReductionType>));
+      BOOST_CONCEPT_ASSERT((graphlab::OpPlusEq<ReductionType>));
+      if(!finalized) {
+        logstream(LOG_FATAL)
+          << "\n\tAttempting to run graph.map_reduce_edges(...)"
+          << "\n\tbefore calling graph.finalize()."
+          << std::endl;
       }
 
-      conditional_addition_wrapper<ReductionType>
-        wrapper(global_result, global_result_set);
-      rpc.all_reduce(wrapper);
-      return wrapper.value;
+      rpc.barrier();
+      std::vector<multi_reduction<ReductionType> >
+        partial(omp_get_max_threads(),
+                multi_reduction<ReductionType>(mapfunctions.size()));
+      visit_edges(vset, edir,
+          multi_mapper<ReductionType, MapFunctionType>(mapfunctions), partial);
+      rpc.all_reduce(partial[0]);
+      return partial[0].results();
    } // end of map_reduce_edges
 
 
@@ -1294,40 +1358,13 @@ namespace graphlab {
       }
 
       rpc.barrier();
-      bool global_result_set = false;
-      ReductionType global_result = ReductionType();
-#ifdef _OPENMP
-#pragma omp parallel
-#endif
-      {
-        ReductionType result = ReductionType();
-#ifdef _OPENMP
-        #pragma omp for
-#endif
-        for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
-          if (lvid2record[i].owner == rpc.procid() &&
-              vset.l_contains((lvid_type)i)) {
-            const vertex_type vtx(l_vertex(i));
-            foldfunction(vtx, result);
-          }
-        }
-#ifdef _OPENMP
-        #pragma omp critical
-#endif
-        {
-          if (!global_result_set) {
-            global_result = result;
-            global_result_set = true;
-          }
-          else {
-            global_result += result;
-          }
-        }
-      }
-      conditional_addition_wrapper<ReductionType>
-        wrapper(global_result, global_result_set);
-      rpc.all_reduce(wrapper);
-      return wrapper.value;
+      std::vector<conditional_addition_wrapper<ReductionType> >
+        partial(omp_get_max_threads(),
+                conditional_addition_wrapper<ReductionType>(ReductionType()));
+      visit_owned_vertices(vset,
+          folder<ReductionType, VertexFoldType>(foldfunction), partial);
+      rpc.all_reduce(partial[0]);
+      return partial[0].value;
     } 
 
 
@@ -1413,50 +1450,13 @@ namespace graphlab {
       }
 
       rpc.barrier();
-      bool global_result_set = false;
-      ReductionType global_result = ReductionType();
-#ifdef _OPENMP
-#pragma omp parallel
-#endif
-      {
-        ReductionType result = ReductionType();
-#ifdef _OPENMP
-        #pragma omp for
-#endif
-        for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
-          if (vset.l_contains((lvid_type)i)) {
-            if (edir == IN_EDGES || edir == ALL_EDGES) {
-              foreach(const local_edge_type& e, l_vertex(i).in_edges()) {
-                  edge_type edge(e);
-                  foldfunction(edge, result);
-              }
-            }
-            if (edir == OUT_EDGES || edir == ALL_EDGES) {
-              foreach(const local_edge_type& e, l_vertex(i).out_edges()) {
-                edge_type edge(e);
-                foldfunction(edge, result);
-              }
-            }
-          }
-        }
-#ifdef _OPENMP
-        #pragma omp critical
-#endif
-        {
-          if (!global_result_set) {
-            global_result = result;
-            global_result_set = true;
-          }
-          else {
-            global_result += result;
-          }
-        }
-      }
-
-      conditional_addition_wrapper<ReductionType>
-        wrapper(global_result, global_result_set);
-      rpc.all_reduce(wrapper);
-      return wrapper.value;
+      std::vector<conditional_addition_wrapper<ReductionType> >
+        partial(omp_get_max_threads(),
+                conditional_addition_wrapper<ReductionType>(ReductionType()));
+      visit_edges(vset, edir,
+          folder<ReductionType, FoldFunctionType>(foldfunction), partial);
+      rpc.all_reduce(partial[0]);
+      return partial[0].value;
    } // end of map_reduce_edges
 
 
@@ -1701,6 +1701,8 @@ namespace graphlab {
           >> vid2lvid
           >> lvid2record
           >> local_graph;
+      rebuild_vid_index();
+      rebuild_master_lvids();
       finalized = true;
       // check the graph condition
     } // end of load
@@ -1732,8 +1734,11 @@ namespace graphlab {
         vrec.clear();
       lvid2record.clear();
       vid2lvid.clear();
+      vid_index.clear();
+      std::vector<lvid_type>().swap(master_lvids);
       local_graph.clear();
       finalized=false;
+      changed_vset = complete_set();
       nverts = nedges = local_own_nverts = nreplicas = 0;
     }
 
@@ -1743,59 +1748,84 @@ namespace graphlab {
      *  simultaneously on all machines.
      *
      * This function loads a sequence of files numbered
-     * \li [prefix].0.gz
-     * \li [prefix].1.gz
-     * \li [prefix].2.gz
+     * \li [prefix]0.bin
+     * \li [prefix]1.bin
+     * \li [prefix]2.bin
      * \li etc.
      *
-     * These files must be previously saved using save_binary(), and
-     * must be saved <b>using the same number of machines</b>.
+     * These files must be previously saved using save_binary().
      * This function uses the graphlab serialization system, so
      * the user must ensure that the vertex data and edge data
      * serialization formats have not changed since the graph was saved.
      *
+     * If the graph was saved by a different number of machines, the saved
+     * partitions are distributed over the machines and their vertices and
+     * edges are added to this graph, which is then finalized. This is much
+     * faster than parsing the original input again. The repartition
+     * argument selects how the edges are placed:
+     * \li "partition": saved partition k is assigned whole to machine
+     *     k % numprocs(), which preserves the locality of the saved
+     *     partitioning. Best when loading on fewer machines.
+     * \li "ingress": the edges are placed by the ingress method of this
+     *     graph, as if they were loaded from text. Needed to balance the
+     *     graph when loading on more machines.
+     * \li "auto" (the default): "partition" if the graph was saved by more
+     *     machines than are loading it, "ingress" otherwise.
+     *
+     * The number of saved partitions is the number of consecutive files
+     * [prefix]0.bin, [prefix]1.bin, ... which exist, so stale files from
+     * an earlier save with more machines must be removed.
+     *
      * A graph loaded using load_binary() is already finalized and
      * structure modifications are not permitted after loading.
      *
+     * Files saved with the "mmap" format are recognized automatically:
+     * they are mapped into memory and their sections are copied into the
+     * graph with all threads, without decompression.
+     *
      * Return true on success and false on failure if the file cannot be loaded.
      */
-    bool load_binary(const std::string& prefix) {
+    bool load_binary(const std::string& prefix,
+                     const std::string& repartition = "auto") {
       rpc.full_barrier();
-      std::string fname = prefix + tostr(rpc.procid()) + ".bin";
+      if (repartition != "auto" && repartition != "partition" &&
+          repartition != "ingress") {
+        logstream(LOG_ERROR) << "Unknown repartition method " << repartition
+                             << ". Expecting auto, partition or ingress."
+                             << std::endl;
+        return false;
+      }
+      size_t nsaved = 0;
+      if (rpc.procid() == 0) nsaved = count_binary_files(prefix);
+      rpc.broadcast(nsaved, rpc.procid() == 0);
+      if (nsaved > 0 && nsaved != rpc.numprocs()) {
+        return load_binary_repartition(prefix, nsaved, repartition);
+      }
 
+      std::string fname = prefix + tostr(rpc.procid()) + ".bin";
       logstream(LOG_INFO) << "Load graph from " << fname << std::endl;
-      if(boost::starts_with(fname, "hdfs://")) {
-        graphlab::hdfs hdfs;
-        graphlab::hdfs::fstream in_file(hdfs, fname);
-        boost::iostreams::filtering_stream<boost::iostreams::input> fin;
-        fin.push(boost::iostreams::gzip_decompressor());
-        fin.push(in_file);
-
-        if(!fin.good()) {
-          logstream(LOG_ERROR) << "\n\tError opening file: " << fname << std::endl;
-          return false;
-        }
-        iarchive iarc(fin);
-        iarc >> *this;
-        fin.pop();
-        fin.pop();
-        in_file.close();
-      } else {
-        std::ifstream in_file(fname.c_str(),
-                              std::ios_base::in | std::ios_base::binary);
-        if(!in_file.good()) {
-          logstream(LOG_ERROR) << "\n\tError opening file: " << fname << std::endl;
-          return false;
-        }
-        boost::iostreams::filtering_stream<boost::iostreams::input> fin;
-        fin.push(boost::iostreams::gzip_decompressor());
-        fin.push(in_file);
-        iarchive iarc(fin);
-        iarc >> *this;
-        fin.pop();
-        fin.pop();
-        in_file.close();
+      binary_partition part;
+      part.local_graph.set_compressed_adjacency(
+          local_graph.compressed_adjacency());
+      part.local_graph.set_dynamic(local_graph.is_dynamic());
+      if (!read_binary_partition(fname, part)) return false;
+      if (part.numprocs != 0 && part.numprocs != rpc.numprocs()) {
+        logstream(LOG_ERROR) << fname << " was saved by " << part.numprocs
+                             << " machines" << std::endl;
+        return false;
       }
+      clear();
+      nverts = part.nverts;
+      nedges = part.nedges;
+      local_own_nverts = part.local_own_nverts;
+      nreplicas = part.nreplicas;
+      vid2lvid.swap(part.vid2lvid);
+      lvid2record.swap(part.lvid2record);
+      local_graph.swap(part.local_graph);
+      lock_manager.resize(num_local_vertices());
+      rebuild_vid_index();
+      rebuild_master_lvids();
+      finalized = true;
       logstream(LOG_INFO) << "Finish loading graph from " << fname << std::endl;
       rpc.full_barrier();
       return true;
@@ -1821,16 +1851,36 @@ namespace graphlab {
      * If the graph is not alreasy finalized before save_binary() is called,
      * this function will finalize the graph.
      *
-     * Returns true on success, and false if the graph cannot be loaded from
+     * \param prefix The prefix of the files
+     * \param format "gzip" (the default) serializes and compresses the
+     * graph. "mmap" writes an uncompressed snapshot whose arrays are
+     * page aligned, so that load_binary() can map it and copy POD vertex
+     * and edge data without deserialization. "mmap" is not supported on
+     * HDFS.
+     *
+     * Returns true on success, and false if the graph cannot be saved to
      * the specified file.
      */
-    bool save_binary(const std::string& prefix) {
+    bool save_binary(const std::string& prefix,
+                     const std::string& format = "gzip") {
       rpc.full_barrier();
       finalize();
       timer savetime;  savetime.start();
       std::string fname = prefix + tostr(rpc.procid()) + ".bin";
       logstream(LOG_INFO) << "Save graph to " << fname << std::endl;
-      if(boost::starts_with(fname, "hdfs://")) {
+      if (format != "gzip" && format != "mmap") {
+        logstream(LOG_ERROR) << "Unknown graph format " << format
+                             << ". Expecting gzip or mmap." << std::endl;
+        return false;
+      }
+      if (format == "mmap") {
+        if (boost::starts_with(fname, "hdfs://")) {
+          logstream(LOG_ERROR) << "The mmap format cannot be saved to HDFS"
+                               << std::endl;
+          return false;
+        }
+        if (!save_snapshot(fname)) return false;
+      } else if(boost::starts_with(fname, "hdfs://")) {
         graphlab::hdfs hdfs;
         graphlab::hdfs::fstream out_file(hdfs, fname, true);
         boost::iostreams::filtering_stream<boost::iostreams::output> fout;
@@ -1869,6 +1919,177 @@ namespace graphlab {
     } // end of save
 
 
+  private:
+    struct binary_partition;
+
+    /**
+     * \internal
+     * Writes this machine's part of the graph in the mmap snapshot format.
+     * vid2lvid is not written: it is rebuilt from lvid2record on load.
+     */
+    bool save_snapshot(const std::string& fname) const {
+      mmap_snapshot_writer writer;
+      if (!writer.open(fname)) return false;
+      std::vector<size_t> header;
+      header.push_back(nverts);
+      header.push_back(nedges);
+      header.push_back(local_own_nverts);
+      header.push_back(nreplicas);
+      header.push_back(rpc.numprocs());
+      header.push_back(sizeof(vertex_record));
+      save_snapshot_vector(writer, "graph", header);
+      // vertex_record only holds scalars and a fixed size bitset
+      writer.write("lvid2record",
+                   lvid2record.empty() ? NULL : &lvid2record[0],
+                   lvid2record.size() * sizeof(vertex_record),
+                   sizeof(vertex_record));
+      local_graph.save_snapshot(writer, "local_graph");
+      return writer.close();
+    } // end of save_snapshot
+
+
+    /**
+     * \internal
+     * Reads one file written by save_binary(), in either format.
+     */
+    bool read_binary_partition(const std::string& fname,
+                               binary_partition& part) {
+      if(!boost::starts_with(fname, "hdfs://") &&
+         mmap_snapshot_reader::is_snapshot(fname)) {
+        return part.load_snapshot(fname);
+      } else if(boost::starts_with(fname, "hdfs://")) {
+        graphlab::hdfs hdfs;
+        graphlab::hdfs::fstream in_file(hdfs, fname);
+        boost::iostreams::filtering_stream<boost::iostreams::input> fin;
+        fin.push(boost::iostreams::gzip_decompressor());
+        fin.push(in_file);
+
+        if(!fin.good()) {
+          logstream(LOG_ERROR) << "\n\tError opening file: " << fname << std::endl;
+          return false;
+        }
+        iarchive iarc(fin);
+        iarc >> part;
+        fin.pop();
+        fin.pop();
+        in_file.close();
+      } else {
+        std::ifstream in_file(fname.c_str(),
+                              std::ios_base::in | std::ios_base::binary);
+        if(!in_file.good()) {
+          logstream(LOG_ERROR) << "\n\tError opening file: " << fname << std::endl;
+          return false;
+        }
+        boost::iostreams::filtering_stream<boost::iostreams::input> fin;
+        fin.push(boost::iostreams::gzip_decompressor());
+        fin.push(in_file);
+        iarchive iarc(fin);
+        iarc >> part;
+        fin.pop();
+        fin.pop();
+        in_file.close();
+      }
+      return true;
+    } // end of read_binary_partition
+
+
+    /**
+     * \internal
+     * Returns the number of consecutive files [prefix]0.bin,
+     * [prefix]1.bin, ... which exist.
+     */
+    size_t count_binary_files(const std::string& prefix) {
+      std::vector<std::string> files;
+      std::string search_prefix;
+      if (boost::starts_with(prefix, "hdfs://")) {
+        if (!hdfs::has_hadoop()) return 0;
+        const size_t slash = prefix.rfind('/');
+        search_prefix = prefix.substr(slash + 1);
+        files = hdfs::get_hdfs().list_files(prefix.substr(0, slash + 1));
+      } else {
+        boost::filesystem::path path(prefix);
+        std::string directory_name;
+        if (boost::filesystem::is_directory(path)) {
+          directory_name = path.native();
+        } else {
+          directory_name = path.parent_path().native();
+          search_prefix = path.filename().native();
+          directory_name = (directory_name.empty() ? "." : directory_name);
+        }
+        fs_util::list_files_with_prefix(directory_name, search_prefix, files);
+      }
+      std::set<std::string> names;
+      foreach(const std::string& file, files) {
+        names.insert(file.substr(file.rfind('/') + 1));
+      }
+      size_t count = 0;
+      while (names.count(search_prefix + tostr(count) + ".bin")) ++count;
+      return count;
+    } // end of count_binary_files
+
+
+    /**
+     * \internal
+     * Loads nsaved partitions saved by a different number of machines.
+     * Machine i reads the partitions k with k % numprocs() == i and adds
+     * the vertices they own and all their edges to the graph.
+     */
+    bool load_binary_repartition(const std::string& prefix, size_t nsaved,
+                                 std::string repartition) {
+      // whole partitions keep the edges of a vertex together, but leave
+      // machines empty when there are fewer partitions than machines
+      if (repartition == "auto") {
+        repartition = nsaved > rpc.numprocs() ? "partition" : "ingress";
+      }
+      if (rpc.procid() == 0) {
+        logstream(LOG_EMPH) << "Loading a graph saved by " << nsaved
+                            << " machines on " << rpc.numprocs()
+                            << " machines. Repartition: " << repartition
+                            << std::endl;
+      }
+      timer loadtime; loadtime.start();
+      clear();
+      const bool whole_partition = (repartition == "partition");
+      for (size_t k = rpc.procid(); k < nsaved; k += rpc.numprocs()) {
+        const std::string fname = prefix + tostr(k) + ".bin";
+        logstream(LOG_INFO) << "Load graph partition from " << fname << std::endl;
+        binary_partition part;
+        if (!read_binary_partition(fname, part)) {
+          logstream(LOG_FATAL) << "\n\tError loading file: " << fname << std::endl;
+        }
+        const procid_t target_proc = k % rpc.numprocs();
+        const std::vector<vertex_record>& records = part.lvid2record;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (size_t lvid = 0; lvid < records.size(); ++lvid) {
+          if (records[lvid].owner == procid_t(k)) {
+            add_vertex(records[lvid].gvid, part.local_graph.vertex_data(lvid));
+          }
+          foreach(typename local_graph_type::edge_type e,
+                  part.local_graph.out_edges(lvid)) {
+            const vertex_id_type target = records[e.target().id()].gvid;
+            if (whole_partition) {
+              ingress_ptr->add_edge_to_proc(target_proc, records[lvid].gvid,
+                                            target, e.data());
+            } else {
+              add_edge(records[lvid].gvid, target, e.data());
+            }
+          }
+        }
+      }
+      finalize();
+      if (rpc.procid() == 0) {
+        logstream(LOG_EMPH) << "Finished repartitioning binary graph: "
+                            << loadtime.current_time() << std::endl;
+      }
+      rpc.full_barrier();
+      return true;
+    } // end of load_binary_repartition
+
+  public:
+
+
     /**
      * \brief Saves the graph to the filesystem using a provided Writer object.
      * Like \ref save(const std::string& prefix, writer writer, bool gzip, bool save_vertex, bool save_edge, size_t files_per_machine) "save()"
@@ -2512,23 +2733,36 @@ namespace graphlab {
      return vertex_set(true);
    }
 
-   ///
+   /**
+    * \brief Returns the set of vertices adjacent to the vertices of cur
+    * along the edges of direction edir.
+    *
+    * If cur is sparse, the result is built as a list and the cost is
+    * proportional to the number of edges of the members of cur.
+    */
    vertex_set neighbors(const vertex_set& cur,
                         edge_dir_type edir) {
      // foreach master bit which is set, set its corresponding mirror
      // synchronize master to mirrors
      vertex_set ret(empty_set());
-     ret.make_explicit(*this);
-
-     foreach(size_t lvid, cur.get_lvid_bitset(*this)) {
-       if (edir == IN_EDGES || edir == ALL_EDGES) {
-         foreach(local_edge_type e, l_vertex(lvid).in_edges()) {
-           ret.set_lvid_unsync(e.source().id());
-         }
+     if (!cur.lazy && cur.sparse) {
+       std::vector<lvid_type> lvids;
+       foreach(lvid_type lvid, cur.sparse_lvids) {
+         add_neighbors(lvid, edir, lvids);
        }
-       if (edir == OUT_EDGES || edir == ALL_EDGES) {
-         foreach(local_edge_type e, l_vertex(lvid).out_edges()) {
-           ret.set_lvid_unsync(e.target().id());
+       ret.assign_lvids(lvids, num_local_vertices());
+     } else {
+       ret.make_explicit(*this);
+       foreach(size_t lvid, cur.get_lvid_bitset(*this)) {
+         if (edir == IN_EDGES || edir == ALL_EDGES) {
+           foreach(local_edge_type e, l_vertex(lvid).in_edges()) {
+             ret.set_lvid_unsync(e.source().id());
+           }
+         }
+         if (edir == OUT_EDGES || edir == ALL_EDGES) {
+           foreach(local_edge_type e, l_vertex(lvid).out_edges()) {
+             ret.set_lvid_unsync(e.target().id());
+           }
          }
        }
      }
@@ -2612,9 +2846,15 @@ namespace graphlab {
     */
    size_t vertex_set_size(const vertex_set& vset) {
      size_t count = 0;
-     for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
-        count += (lvid2record[i].owner == rpc.procid() &&
-                  vset.l_contains((lvid_type)i));
+     if (!vset.lazy && vset.sparse) {
+       foreach(lvid_type lvid, vset.sparse_lvids) {
+         count += (lvid2record[lvid].owner == rpc.procid());
+       }
+     } else {
+       for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
+          count += (lvid2record[i].owner == rpc.procid() &&
+                    vset.l_contains((lvid_type)i));
+       }
      }
      rpc.all_reduce(count);
      return count;
@@ -2630,7 +2870,7 @@ namespace graphlab {
    bool vertex_set_empty(const vertex_set& vset) {
      if (vset.lazy) return !vset.is_complete_set;
 
-     size_t count = vset.get_lvid_bitset(*this).empty();
+     size_t count = vset.l_empty();
      rpc.all_reduce(count);
      return count == rpc.numprocs();
    }
@@ -2725,8 +2965,10 @@ namespace graphlab {
     size_t num_local_own_vertices() const { return local_own_nverts; }
 
     /** \internal
-     *\brief Convert a global vid to a local vid */
+     *\brief Convert a global vid to a local vid. Dense vertex ids are
+     * looked up in vid_index, without hashing. */
     lvid_type local_vid (const vertex_id_type vid) const {
+      if (vid_index.enabled()) return vid_index.find(vid);
       // typename boost::unordered_map<vertex_id_type, lvid_type>::
       //   const_iterator iter = vid2lvid.find(vid);
       typename hopscotch_map_type::const_iterator iter = vid2lvid.find(vid);
@@ -2746,6 +2988,7 @@ namespace graphlab {
      * of the vertex ID.
      */
     bool contains_vertex(const vertex_id_type vid) const {
+      if (vid_index.enabled()) return vid_index.find(vid) != vid_index_type::NONE;
       return vid2lvid.find(vid) != vid2lvid.end();
     }
     /**
@@ -2811,6 +3054,11 @@ namespace graphlab {
      * \brief Returns the internal vertex record of a given global vertex ID
      */
     const vertex_record& get_vertex_record(vertex_id_type vid) const {
+      if (vid_index.enabled()) {
+        const lvid_type lvid = vid_index.find(vid);
+        ASSERT_NE(lvid, vid_index_type::NONE);
+        return lvid2record[lvid];
+      }
       // typename boost::unordered_map<vertex_id_type, lvid_type>::
       //   const_iterator iter = vid2lvid.find(vid);
       typename hopscotch_map_type::const_iterator iter = vid2lvid.find(vid);
@@ -2881,6 +3129,25 @@ namespace graphlab {
       return local_graph;
     }
 
+    /**
+     * \brief Returns the array of one field of the local vertices, indexed
+     * by local vertex id. Only available if the vertex data is stored as a
+     * struct of arrays, see vertex_data_layout.
+     *
+     * \code
+     * double* rank = graph.local_vertex_column(&pagerank_vertex::rank);
+     * for (size_t i = 0; i < graph.num_local_vertices(); ++i) rank[i] *= 0.85;
+     * \endcode
+     */
+    template <typename T, typename Owner>
+    T* local_vertex_column(T Owner::*field) {
+      return local_graph.vertex_column(field);
+    }
+
+    template <typename T, typename Owner>
+    const T* local_vertex_column(T Owner::*field) const {
+      return local_graph.vertex_column(field);
+    }
 
 
 
@@ -2961,12 +3228,12 @@ namespace graphlab {
       }
 
       /// \brief Returns a reference to the data on the local vertex
-      const vertex_data_type& data() const {
+      vertex_data_const_reference data() const {
         return graph_ref.get_local_graph().vertex_data(lvid);
       }
 
       /// \brief Returns a reference to the data on the local vertex
-      vertex_data_type& data() {
+      vertex_data_reference data() {
         return graph_ref.get_local_graph().vertex_data(lvid);
       }
 
@@ -3196,6 +3463,93 @@ namespace graphlab {
 
     hopscotch_map_type vid2lvid;
 
+    /**
+     * A copy of vid2lvid without hashing, used by local_vid() when the
+     * vertex ids on this machine are dense. Rebuilt after every change of
+     * vid2lvid, and empty while the ingress changes it.
+     */
+    typedef direct_index_map<vertex_id_type, lvid_type> vid_index_type;
+    vid_index_type vid_index;
+
+    /** Command option to disable vid_index */
+    bool use_vid_index;
+
+    /// The global vid of a local vertex, for vid_index_type::build()
+    struct record_gvid {
+      const std::vector<vertex_record>& records;
+      record_gvid(const std::vector<vertex_record>& records)
+          : records(records) { }
+      vertex_id_type operator()(size_t lvid) const {
+        return records[lvid].gvid;
+      }
+    };
+
+    void rebuild_vid_index() {
+      vid_index.clear();
+      if (!use_vid_index) return;
+      vid_index.build(lvid2record.size(), record_gvid(lvid2record));
+      logstream(LOG_INFO) << "Vertex id index: "
+                          << (vid_index.layout() == vid_index_type::DIRECT ?
+                              "direct" :
+                              vid_index.layout() == vid_index_type::PAGED ?
+                              "paged" : "hash map")
+                          << std::endl;
+    }
+
+    /**
+     * \internal
+     * One machine's part of a graph as saved by save_binary(). The layout
+     * of load() matches distributed_graph::load().
+     */
+    struct binary_partition {
+      size_t nverts, nedges, local_own_nverts, nreplicas;
+      /// The number of machines which saved the graph, 0 if unknown
+      size_t numprocs;
+      hopscotch_map_type vid2lvid;
+      std::vector<vertex_record> lvid2record;
+      local_graph_type local_graph;
+
+      binary_partition() : nverts(0), nedges(0), local_own_nverts(0),
+                           nreplicas(0), numprocs(0) { }
+
+      void load(iarchive& arc) {
+        arc >> nverts
+            >> nedges
+            >> local_own_nverts
+            >> nreplicas
+            >> vid2lvid
+            >> lvid2record
+            >> local_graph;
+      }
+
+      /// Reads a file written by distributed_graph::save_snapshot()
+      bool load_snapshot(const std::string& fname) {
+        mmap_snapshot_reader reader;
+        if (!reader.open(fname)) return false;
+        std::vector<size_t> header;
+        load_snapshot_vector(reader, "graph", header);
+        if (header.size() != 6 || header[5] != sizeof(vertex_record)) {
+          logstream(LOG_ERROR) << fname << " was saved by an incompatible build"
+                               << std::endl;
+          return false;
+        }
+        nverts = header[0];
+        nedges = header[1];
+        local_own_nverts = header[2];
+        nreplicas = header[3];
+        numprocs = header[4];
+        const mmap_snapshot_section& records = reader.section("lvid2record");
+        ASSERT_EQ(records.element_size, sizeof(vertex_record));
+        lvid2record.resize(records.length / sizeof(vertex_record));
+        if (!lvid2record.empty()) reader.copy(records, &lvid2record[0]);
+        for (lvid_type lvid = 0;lvid < lvid2record.size(); ++lvid) {
+          vid2lvid[lvid2record[lvid].gvid] = lvid;
+        }
+        local_graph.load_snapshot(reader, "local_graph");
+        return true;
+      }
+    }; // end of binary_partition
+
 
     /** The global number of vertices and edges */
     size_t nverts, nedges;
@@ -3218,6 +3572,219 @@ namespace graphlab {
     /** Command option to disable parallel ingress. Used for simulating single node ingress */
     bool parallel_ingress;
 
+    /** See changed_vertices() */
+    vertex_set changed_vset;
+
+    /**
+     * \internal
+     * Adds vset, which is consistent between masters and mirrors, to
+     * changed_vertices(). Called by the ingress at the end of finalize().
+     */
+    void add_changed_vertices(const vertex_set& vset) {
+      vertex_set added = vset;
+      added.resize(num_local_vertices());
+      changed_vset.resize(num_local_vertices());
+      changed_vset |= added;
+    }
+
+    /// Appends the local neighbors of lvid along edir to lvids
+    void add_neighbors(lvid_type lvid, edge_dir_type edir,
+                       std::vector<lvid_type>& lvids) {
+      if (edir == IN_EDGES || edir == ALL_EDGES) {
+        foreach(local_edge_type e, l_vertex(lvid).in_edges()) {
+          lvids.push_back(e.source().id());
+        }
+      }
+      if (edir == OUT_EDGES || edir == ALL_EDGES) {
+        foreach(local_edge_type e, l_vertex(lvid).out_edges()) {
+          lvids.push_back(e.target().id());
+        }
+      }
+    }
+
+    /** The local vertices owned by this machine, in increasing order */
+    std::vector<lvid_type> master_lvids;
+
+    void rebuild_master_lvids() {
+      std::vector<lvid_type> lvids;
+      lvids.reserve(local_own_nverts);
+      for (lvid_type lvid = 0;lvid < lvid2record.size(); ++lvid) {
+        if (lvid2record[lvid].owner == rpc.procid()) lvids.push_back(lvid);
+      }
+      master_lvids.swap(lvids);
+    }
+
+    /**
+     * Returns the owned vertices of vset: either master_lvids, or the owned
+     * members of a sparse vset copied to buffer. Sets filter if the
+     * returned vertices must still be tested with vset.l_contains().
+     */
+    const std::vector<lvid_type>& owned_lvids(const vertex_set& vset,
+                                              std::vector<lvid_type>& buffer,
+                                              bool& filter) const {
+      filter = false;
+      if (vset.lazy) return vset.is_complete_set ? master_lvids : buffer;
+      if (!vset.sparse) {
+        filter = true;
+        return master_lvids;
+      }
+      foreach(lvid_type lvid, vset.sparse_lvids) {
+        if (lvid2record[lvid].owner == rpc.procid()) buffer.push_back(lvid);
+      }
+      return buffer;
+    }
+
+    /**
+     * Calls visitor(vertex, result) on every owned vertex of vset, with one
+     * result per thread, and sums the results of the threads in partial[0].
+     * partial must have omp_get_max_threads() initial results.
+     */
+    template <typename PartialType, typename VisitorType>
+    void visit_owned_vertices(const vertex_set& vset,
+                              const VisitorType& visitor,
+                              std::vector<PartialType>& partial) {
+      std::vector<lvid_type> buffer;
+      bool filter = false;
+      const std::vector<lvid_type>& lvids = owned_lvids(vset, buffer, filter);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+      {
+        // accumulate on the stack to keep the threads off each other's lines
+        PartialType result = partial[omp_get_thread_num()];
+#ifdef _OPENMP
+        #pragma omp for
+#endif
+        for (int i = 0; i < (int)lvids.size(); ++i) {
+          const lvid_type lvid = lvids[i];
+          if (filter && !vset.l_contains(lvid)) continue;
+          const vertex_type vtx(l_vertex(lvid));
+          visitor(vtx, result);
+        }
+        partial[omp_get_thread_num()] = result;
+      }
+      tree_reduce(partial);
+    }
+
+    /**
+     * Calls visitor(edge, result) on the edges of direction edir of every
+     * vertex of vset. See visit_owned_vertices().
+     */
+    template <typename PartialType, typename VisitorType>
+    void visit_edges(const vertex_set& vset, edge_dir_type edir,
+                     const VisitorType& visitor,
+                     std::vector<PartialType>& partial) {
+      const bool sparse = !vset.lazy && vset.sparse;
+      const size_t nvisit = sparse ? vset.sparse_lvids.size() :
+                                     local_graph.num_vertices();
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+      {
+        PartialType result = partial[omp_get_thread_num()];
+#ifdef _OPENMP
+        #pragma omp for
+#endif
+        for (int i = 0; i < (int)nvisit; ++i) {
+          const lvid_type lvid = sparse ? vset.sparse_lvids[i] : lvid_type(i);
+          if (!sparse && !vset.l_contains(lvid)) continue;
+          if (edir == IN_EDGES || edir == ALL_EDGES) {
+            foreach(const local_edge_type& e, l_vertex(lvid).in_edges()) {
+              edge_type edge(e);
+              visitor(edge, result);
+            }
+          }
+          if (edir == OUT_EDGES || edir == ALL_EDGES) {
+            foreach(const local_edge_type& e, l_vertex(lvid).out_edges()) {
+              edge_type edge(e);
+              visitor(edge, result);
+            }
+          }
+        }
+        partial[omp_get_thread_num()] = result;
+      }
+      tree_reduce(partial);
+    }
+
+    /**
+     * Sums partial[1], partial[2] ... into partial[0] by adding pairs of
+     * results in log2(n) rounds. The additions of a round run in parallel.
+     */
+    template <typename T>
+    static void tree_reduce(std::vector<T>& partial) {
+      for (size_t stride = 1;stride < partial.size(); stride *= 2) {
+        const int nleft = (int)(partial.size() - stride);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (int i = 0; i < nleft; i += 2 * (int)stride) {
+          partial[i] += partial[i + stride];
+        }
+      }
+    }
+
+    /// Adds the result of a map function to a partial result
+    template <typename ReductionType, typename MapFunctionType>
+    struct mapper {
+      MapFunctionType& mapfunction;
+      mapper(MapFunctionType& mapfunction) : mapfunction(mapfunction) { }
+      template <typename T>
+      void operator()(T& x,
+                      conditional_addition_wrapper<ReductionType>& result) const {
+        result += mapfunction(x);
+      }
+    };
+
+    /// The partial results of several map functions
+    template <typename ReductionType>
+    struct multi_reduction {
+      std::vector<conditional_addition_wrapper<ReductionType> > values;
+      multi_reduction() { }
+      explicit multi_reduction(size_t n) : values(n) { }
+      multi_reduction& operator+=(const multi_reduction& other) {
+        ASSERT_EQ(values.size(), other.values.size());
+        for (size_t j = 0;j < values.size(); ++j) values[j] += other.values[j];
+        return *this;
+      }
+      std::vector<ReductionType> results() const {
+        std::vector<ReductionType> ret;
+        ret.reserve(values.size());
+        for (size_t j = 0;j < values.size(); ++j) {
+          ret.push_back(values[j].value);
+        }
+        return ret;
+      }
+      void save(oarchive& oarc) const { oarc << values; }
+      void load(iarchive& iarc) { iarc >> values; }
+    };
+
+    /// Adds the results of several map functions to partial results
+    template <typename ReductionType, typename MapFunctionType>
+    struct multi_mapper {
+      const std::vector<MapFunctionType>& mapfunctions;
+      multi_mapper(const std::vector<MapFunctionType>& mapfunctions)
+          : mapfunctions(mapfunctions) { }
+      template <typename T>
+      void operator()(T& x,
+                      multi_reduction<ReductionType>& result) const {
+        for (size_t j = 0;j < mapfunctions.size(); ++j) {
+          result.values[j] += mapfunctions[j](x);
+        }
+      }
+    };
+
+    /// Calls a fold function on a partial result
+    template <typename ReductionType, typename FoldFunctionType>
+    struct folder {
+      FoldFunctionType& foldfunction;
+      folder(FoldFunctionType& foldfunction) : foldfunction(foldfunction) { }
+      template <typename T>
+      void operator()(T& x,
+                      conditional_addition_wrapper<ReductionType>& result) const {
+        foldfunction(x, result.value);
+      }
+    };
+
 
     lock_manager_type lock_manager;
 
@@ -53,12 +53,14 @@
 #include <graphlab/util/generics/counting_sort.hpp>
 #include <graphlab/util/generics/dynamic_csr_storage.hpp>
 #include <graphlab/parallel/atomic.hpp>
+#include <graphlab/parallel/numa_tools.hpp>
 
 #include <graphlab/logger/logger.hpp>
 #include <graphlab/logger/assertions.hpp>
 
 #include <graphlab/serialization/iarchive.hpp>
 #include <graphlab/serialization/oarchive.hpp>
+#include <graphlab/util/mmap_snapshot.hpp>
 
 #include <graphlab/util/random.hpp>
 #include <graphlab/macros_def.hpp>
@@ -72,6 +74,10 @@ namespace graphlab {
     /** The type of the vertex data stored in the local_graph. */
     typedef VertexData vertex_data_type;
 
+    /** The vertex data is always an array of VertexData */
+    typedef VertexData& vertex_data_reference;
+    typedef const VertexData& vertex_data_const_reference;
+
     /** The type of the edge data stored in the local_graph. */
     typedef EdgeData edge_data_type;
 
@@ -110,6 +116,32 @@ namespace graphlab {
       return true;
     }
 
+    /**
+     * \brief This graph is always dynamic. See local_graph::set_dynamic().
+     */
+    void set_dynamic(bool d) {
+      if (!d) {
+        logstream(LOG_WARNING) << "The dynamic local graph can not be made "
+                               << "static" << std::endl;
+      }
+    }
+
+    /**
+     * \brief Compressed adjacency lists are not supported by the dynamic
+     * graph, which must stay open to new edges. See
+     * local_graph::set_compressed_adjacency().
+     */
+    void set_compressed_adjacency(bool compress) {
+      if (compress) {
+        logstream(LOG_WARNING) << "compress_adjacency is ignored by the "
+                               << "dynamic graph" << std::endl;
+      }
+    }
+
+    bool compressed_adjacency() const {
+      return false;
+    }
+
     /**
      * \brief Resets the local_graph state.
      */
@@ -332,6 +364,9 @@ namespace graphlab {
       }
       ASSERT_EQ(_csr_storage.num_values(), _csc_storage.num_values());
       ASSERT_EQ(_csr_storage.num_values(), edges.size());
+      // Move the data of each NUMA node's range of vertices to that node.
+      // The block storage of the adjacency is not partitioned.
+      numa::distribute(vertices);
 
 #ifdef DEBUG_GRAPH
       logstream(LOG_DEBUG) << "End of finalize." << std::endl;
@@ -365,6 +400,27 @@ namespace graphlab {
           << _csc_storage;
     } // end of save
 
+    /**
+     * \brief Writes the local_graph to a snapshot. The block linked
+     * storage is not contiguous, so the graph is serialized into a single
+     * section.
+     */
+    void save_snapshot(mmap_snapshot_writer& writer,
+                       const std::string& name) const {
+      oarchive oarc;
+      oarc << *this;
+      writer.write(name, oarc.buf, oarc.off, 0);
+      free(oarc.buf);
+    } // end of save_snapshot
+
+    /** \brief Reads a local_graph written by save_snapshot() */
+    void load_snapshot(const mmap_snapshot_reader& reader,
+                       const std::string& name) {
+      const mmap_snapshot_section& sec = reader.section(name);
+      iarchive iarc(reader.data(sec), sec.length);
+      iarc >> *this;
+    } // end of load_snapshot
+
     /** swap two graphs */
     void swap(dynamic_local_graph& other) {
       std::swap(vertices, other.vertices);
@@ -337,6 +337,8 @@ namespace graphlab {
       void graph_gather_apply<Graph,GatherType>::exec(const vertex_set& vset) {
         if (vset.lazy && !vset.is_complete_set)
           return;
+        // the workers read the set a word of the bitset at a time
+        vset.make_dense();
 
         gather_accum.clear();
         // Allocate vertex locks and vertex programs
@@ -24,6 +24,7 @@
 
 #include <graphlab/graph/distributed_graph.hpp>
 #include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/graph/vertex_data_layout.hpp>
 #include <graphlab/graph/graph_hash.hpp>
 #include <graphlab/graph/ingress/ingress_edge_decision.hpp>
 #include <graphlab/graph/graph_gather_apply.hpp>
@@ -127,6 +128,15 @@ namespace graphlab {
 
     virtual ~distributed_ingress_base() { }
 
+    /**
+     * \brief Sets the compression of the vertex and edge exchanges.
+     * See \ref exchange_compression_type.
+     */
+    void set_exchange_compression(exchange_compression_type compression) {
+      vertex_exchange.set_compression(compression);
+      edge_exchange.set_compression(compression);
+    }
+
     /** \brief Add an edge to the ingress object. */
     virtual void add_edge(vertex_id_type source, vertex_id_type target,
                           const EdgeData& edata) {
@@ -140,6 +150,20 @@ namespace graphlab {
 #endif
     } // end of add edge
 
+    /**
+     * \brief Add an edge to the ingress object and assign it to the
+     * given machine, bypassing the edge placement of the ingress method.
+     */
+    void add_edge_to_proc(procid_t proc, vertex_id_type source,
+                          vertex_id_type target, const EdgeData& edata) {
+      const edge_buffer_record record(source, target, edata);
+#ifdef _OPENMP
+      edge_exchange.send(proc, record, omp_get_thread_num());
+#else
+      edge_exchange.send(proc, record);
+#endif
+    } // end of add edge to proc
+
     virtual void add_edge_and_partid (vertex_id_type source, vertex_id_type target,size_t partid,
                           const EdgeData& edata) {
       const procid_t owning_proc = 
@@ -195,17 +219,13 @@ namespace graphlab {
 
       rpc.full_barrier();
 
-      bool first_time_finalize = false;
       /**
-       * Fast pass for first time finalization. 
+       * Fast pass for first time finalization: every vertex is new and
+       * needs its record synchronized.
        */
-      if (graph.is_dynamic()) {
-        size_t nverts = graph.num_local_vertices();
-        rpc.all_reduce(nverts);
-        first_time_finalize = (nverts == 0);
-      } else {
-        first_time_finalize = false;
-      }
+      size_t prev_nverts = graph.num_local_vertices();
+      rpc.all_reduce(prev_nverts);
+      const bool first_time_finalize = (prev_nverts == 0);
 
 
       if (rpc.procid() == 0) {
@@ -246,6 +266,13 @@ namespace graphlab {
       /*                                                                        */
       /**************************************************************************/
       edge_exchange.flush(); vertex_exchange.flush();     
+      if (edge_exchange.bytes_before_compression() > 0) {
+        logstream(LOG_INFO) << "Edge exchange compression: "
+                            << edge_exchange.bytes_before_compression()
+                            << " bytes compressed to "
+                            << edge_exchange.bytes_after_compression()
+                            << std::endl;
+      }
 
       /**
        * Fast pass for redundant finalization with no graph changes. 
@@ -353,7 +380,8 @@ namespace graphlab {
               updated_lvids.set_bit(lvid);
             }
             if (vertex_combine_strategy && lvid < graph.num_local_vertices()) {
-              vertex_combine_strategy(graph.l_vertex(lvid).data(), rec.vdata);
+              update_vertex_data(graph.l_vertex(lvid).data(),
+                                 vertex_combine_strategy, rec.vdata);
             } else {
               graph.local_graph.add_vertex(lvid, rec.vdata);
             }
@@ -422,7 +450,7 @@ namespace graphlab {
 #pragma omp parallel
 #endif
         {
-          typename buffered_exchange<vertex_id_type>::buffer_type buffer;
+          array_ref<vertex_id_type> buffer;
           procid_t recvid;
           while(vid_buffer.recv(recvid, buffer)) {
             foreach(const vertex_id_type vid, buffer) {
@@ -472,7 +500,13 @@ namespace graphlab {
         if (graph.vid2lvid.size() == 0) {
           graph.vid2lvid.swap(vid2lvid_buffer);
         } else {
-          graph.vid2lvid.rehash(graph.vid2lvid.size() + vid2lvid_buffer.size());
+          // grow geometrically, so that a sequence of small batches does
+          // not rehash the whole map every time
+          const size_t needed = graph.vid2lvid.size() + vid2lvid_buffer.size();
+          if (needed > graph.vid2lvid.capacity()) {
+            graph.vid2lvid.rehash(std::max(needed,
+                                           2 * graph.vid2lvid.capacity()));
+          }
           foreach (const typename vid2lvid_map_type::value_type& pair, vid2lvid_buffer) {
             graph.vid2lvid.insert(pair);
           }
@@ -493,9 +527,10 @@ namespace graphlab {
         // Fast pass for first time finalize;
         vertex_set changed_vset(true);
 
-        // Compute the vertices that needs synchronization 
+        // Compute the vertices that needs synchronization: the new ones
+        // and the existing ones which got edges, data or mirrors
         if (!first_time_finalize) {
-          vertex_set changed_vset = vertex_set(false);
+          changed_vset = vertex_set(false);
           changed_vset.make_explicit(graph);
           updated_lvids.resize(graph.num_local_vertices());
           for (lvid_type i = lvid_start; i <  graph.num_local_vertices(); ++i) {
@@ -513,6 +548,7 @@ namespace graphlab {
                              boost::bind(&distributed_ingress_base::finalize_gather, this, _1, _2), 
                              boost::bind(&distributed_ingress_base::finalize_apply, this, _1, _2, _3));
         vrecord_sync_gas.exec(changed_vset);
+        graph.add_changed_vertices(changed_vset);
 
         if(rpc.procid() == 0)       
           memory_info::log_usage("Finished synchronizing vertex (meta)data");
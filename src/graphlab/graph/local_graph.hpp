@@ -47,24 +47,86 @@
 
 #include <graphlab/graph/graph_basic_types.hpp>
 #include <graphlab/graph/local_edge_buffer.hpp>
+#include <graphlab/graph/vertex_data_layout.hpp>
 #include <graphlab/util/random.hpp>
 #include <graphlab/util/generics/shuffle.hpp>
 #include <graphlab/util/generics/counting_sort.hpp>
 #include <graphlab/util/generics/vector_zip.hpp>
 #include <graphlab/util/generics/csr_storage.hpp>
+#include <graphlab/util/generics/delta_varint_csr.hpp>
+#include <graphlab/util/generics/dynamic_csr_storage.hpp>
 #include <graphlab/parallel/atomic.hpp>
+#include <graphlab/parallel/numa_tools.hpp>
 
 #include <graphlab/logger/logger.hpp>
 #include <graphlab/logger/assertions.hpp>
 
 #include <graphlab/serialization/iarchive.hpp>
 #include <graphlab/serialization/oarchive.hpp>
+#include <graphlab/util/mmap_snapshot.hpp>
 
 #include <graphlab/util/random.hpp>
+#include <graphlab/util/empty.hpp>
 #include <graphlab/macros_def.hpp>
 
 namespace graphlab { 
 
+  /// \cond GRAPHLAB_INTERNAL
+  namespace local_graph_impl {
+    /**
+     * The values stored in the CSC of a local_graph: the source of each in
+     * edge and its edge id.
+     */
+    template <typename EdgeData>
+    struct csc_traits {
+      typedef std::pair<lvid_type, edge_id_type> value_type;
+      static const bool has_edge_id = true;
+      /// Number of integers in a value
+      static const size_t width = 2;
+      static lvid_type source(const value_type& v) { return v.first; }
+      static edge_id_type edge_id(const value_type& v) { return v.second; }
+      static void set_edge_id(value_type& v, edge_id_type eid) {
+        v.second = eid;
+      }
+      static value_type make(lvid_type source, edge_id_type eid) {
+        return value_type(source, eid);
+      }
+      /// Builds the CSC values from the sources and the edge ids
+      static void zip(std::vector<lvid_type>& sources,
+                      std::vector<edge_id_type>& eids,
+                      std::vector<value_type>& values) {
+        vector_zip(sources, eids).swap(values);
+      }
+    };
+
+    /**
+     * Without edge data the CSC only stores the sources: the id of an in
+     * edge is only needed by edge_type::id(), which finds it in the
+     * (sorted) out edges of the source.
+     */
+    template <>
+    struct csc_traits<graphlab::empty> {
+      typedef lvid_type value_type;
+      static const bool has_edge_id = false;
+      static const size_t width = 1;
+      static lvid_type source(const value_type& v) { return v; }
+      static edge_id_type edge_id(const value_type& v) {
+        return edge_id_type(-1);
+      }
+      static void set_edge_id(value_type& v, edge_id_type eid) { }
+      static value_type make(lvid_type source, edge_id_type eid) {
+        return source;
+      }
+      static void zip(std::vector<lvid_type>& sources,
+                      std::vector<edge_id_type>& eids,
+                      std::vector<value_type>& values) {
+        values.swap(sources);
+        std::vector<edge_id_type>().swap(eids);
+      }
+    };
+  } // namespace local_graph_impl
+  /// \endcond
+
   template<typename VertexData, typename EdgeData>
   class local_graph {
   public:
@@ -72,6 +134,15 @@ namespace graphlab {
     /** The type of the vertex data stored in the local_graph. */
     typedef VertexData vertex_data_type;
 
+    /**
+     * The type returned by vertex_data(): VertexData&, or a proxy if the
+     * vertex data is stored as a struct of arrays. See vertex_data_layout.
+     */
+    typedef typename vertex_data_layout<VertexData>::reference
+        vertex_data_reference;
+    typedef typename vertex_data_layout<VertexData>::const_reference
+        vertex_data_const_reference;
+
     /** The type of the edge data stored in the local_graph. */
     typedef EdgeData edge_data_type;
 
@@ -95,11 +166,11 @@ namespace graphlab {
        vertex_type(local_graph& lgraph_ref, lvid_type vid):lgraph_ref(lgraph_ref),vid(vid) { }
 
        /// \brief Returns a constant reference to the data on the vertex.
-       const vertex_data_type& data() const {
+       vertex_data_const_reference data() const {
          return lgraph_ref.vertex_data(vid);
        }
        /// \brief Returns a reference to the data on the vertex.
-       vertex_data_type& data() {
+       vertex_data_reference data() {
          return lgraph_ref.vertex_data(vid);
        }
        /// \brief Returns the number of in edges of the vertex.
@@ -136,11 +207,11 @@ namespace graphlab {
 
       /// \brief Returns a constant reference to the data on the edge.
       const edge_data_type& data() const {
-        return lgraph_ref.edge_data(_eid);
+        return lgraph_ref.edge_data(id());
       }
       /// \brief Returns a reference to the data on the edge.
       edge_data_type& data() {
-        return lgraph_ref.edge_data(_eid);
+        return lgraph_ref.edge_data(id());
       }
       /// \brief Returns the source vertex of the edge.
       vertex_type source() const {
@@ -150,8 +221,15 @@ namespace graphlab {
       vertex_type target() const {
         return vertex_type(lgraph_ref, _target);
       }
-      /// \brief Returns the internal ID of this edge
-      edge_id_type id() const { return _eid; }
+      /**
+       * \brief Returns the internal ID of this edge. In edges of graphs
+       * without edge data are created without it, and it is looked up in
+       * the out edges of the source.
+       */
+      edge_id_type id() const {
+        return _eid != NO_EDGE_ID ? _eid :
+            lgraph_ref.find_edge_id(_source, _target);
+      }
 
      private:
       local_graph& lgraph_ref;
@@ -165,17 +243,95 @@ namespace graphlab {
     // CONSTRUCTORS ============================================================>
     
     /** Create an empty local_graph. */
-    local_graph() : finalized(false) { }
+    local_graph() : finalized(false), compressed(false), dynamic(false) { }
 
     /** Create a local_graph with nverts vertices. */
     local_graph(size_t nverts) :
       vertices(nverts),
-      finalized(false) { }
+      finalized(false), compressed(false), dynamic(false) { }
 
     // METHODS =================================================================>
     
-    static bool is_dynamic() {
-      return false;
+    /** \brief True if edges can be added after finalize(). */
+    bool is_dynamic() const {
+      return dynamic;
+    }
+
+    /**
+     * \brief Allows edges to be added after finalize().
+     *
+     * A dynamic graph keeps its adjacency lists in blocked linked lists
+     * (see dynamic_csr_storage) instead of flat arrays. Edges added after
+     * finalize() are buffered as usual, and the next finalize() sorts only
+     * the new edges and inserts them into the lists of their endpoints:
+     * it costs O(B log B) for a batch of B edges, independently of the size
+     * of the graph. The ids of the existing edges do not change. Scans of
+     * the lists are somewhat slower than on a static graph, and in_edges()
+     * and out_edges() only support forward iteration.
+     *
+     * Compressed adjacency is disabled while the graph is dynamic. If the
+     * graph is already finalized, the lists are converted immediately. The
+     * option is kept by clear().
+     */
+    void set_dynamic(bool d) {
+      if (d == dynamic) return;
+      if (d && compressed) {
+        logstream(LOG_WARNING) << "Compressed adjacency is not supported by "
+                               << "dynamic graphs and is disabled"
+                               << std::endl;
+        set_compressed_adjacency(false);
+      }
+      if (finalized) {
+        if (d) {
+          static_to_dynamic();
+        } else {
+          // the buffered edges would otherwise be dropped
+          finalize_dynamic();
+          std::vector<EdgeData> sorted_edges;
+          dynamic_to_static(sorted_edges, _csr_storage, _csc_storage);
+          edges.swap(sorted_edges);
+          _dcsr.clear();
+          _dcsc.clear();
+        }
+      }
+      dynamic = d;
+    }
+
+    /**
+     * \brief Selects the representation of the adjacency lists.
+     *
+     * When enabled, the neighbor lists are delta and varint encoded (see
+     * delta_varint_csr) and decoded on the fly by in_edges() and
+     * out_edges(). A typical graph then takes 2 to 4 bytes per edge in each
+     * direction instead of 4 + 12. The out edges of each vertex are sorted
+     * by target and the in edges by source.
+     *
+     * Takes effect on finalize(). If the graph is already finalized, the
+     * lists are converted immediately, which changes the edge ids.
+     * The option is kept by clear().
+     */
+    void set_compressed_adjacency(bool compress) {
+      if (compress == compressed) return;
+      if (compress && dynamic) {
+        logstream(LOG_WARNING) << "Compressed adjacency is not supported by "
+                               << "dynamic graphs" << std::endl;
+        return;
+      }
+      if (finalized) {
+        if (compress) {
+          compress_storage();
+        } else {
+          decompress_storage(_csr_storage, _csc_storage);
+          _ccsr.clear();
+          _ccsc.clear();
+        }
+      }
+      compressed = compress;
+    }
+
+    /** \brief True if the adjacency lists are compressed. */
+    bool compressed_adjacency() const {
+      return compressed;
     }
 
     /**
@@ -187,7 +343,11 @@ namespace graphlab {
       edges.clear();
       _csc_storage.clear();
       _csr_storage.clear();
-      std::vector<VertexData>().swap(vertices);
+      _ccsr.clear();
+      _ccsc.clear();
+      _dcsr.clear();
+      _dcsc.clear();
+      vertex_storage_type().swap(vertices);
       std::vector<EdgeData>().swap(edges);
       edge_buffer.clear();
     }
@@ -199,8 +359,15 @@ namespace graphlab {
      * fail if there are any duplicate edges.
      * Detail implementation depends on the type of graph_storage.
      * This is also automatically invoked by the engine at start.
+     *
+     * On a dynamic graph (see set_dynamic()), finalize() merges the edges
+     * added since the previous call into the adjacency lists.
      */
     void finalize() {   
+      if (dynamic) {
+        finalize_dynamic();
+        return;
+      }
       if(finalized) return;
       graphlab::timer mytimer; mytimer.start();
 #ifdef DEBUG_GRAPH
@@ -249,6 +416,11 @@ namespace graphlab {
           }
         }
       }
+      if (!csc_traits::has_edge_id) {
+        // Without edge data the out edges can be reordered freely: sort
+        // them by target so that find_edge_id() can binary search.
+        sort_lists(edge_buffer.target_arr, src_counting_prefix_sum);
+      }
 #ifdef DEBUG_GRAPH
       logstream(LOG_DEBUG) << "Graph2 finalize: Sort by dest id" << std::endl;
 #endif
@@ -263,14 +435,29 @@ namespace graphlab {
       // inplace_shuffle(edge_buffer.source_arr, permute);
       // counting_sort(edge_buffer.target_arr, permute);
 
+      std::vector<csc_value_type> csc_value;
+      csc_traits::zip(edge_buffer.source_arr, permute, csc_value);
+      if (!csc_traits::has_edge_id) {
+        // sequential in edge scans
+        sort_lists(csc_value, dest_counting_prefix_sum);
+      }
+      // The arrays were filled by a single thread. Move the adjacency of
+      // each NUMA node's range of vertices to that node.
+      numa::distribute(vertices);
+      numa::distribute(edge_buffer.data, src_counting_prefix_sum,
+                       vertices.size());
+      numa::distribute(edge_buffer.target_arr, src_counting_prefix_sum,
+                       vertices.size());
+      numa::distribute(csc_value, dest_counting_prefix_sum, vertices.size());
+
       // warp into csr csc storage.
       _csr_storage.wrap(src_counting_prefix_sum, edge_buffer.target_arr);
-      std::vector<std::pair<lvid_type, edge_id_type> > csc_value = vector_zip(edge_buffer.source_arr, permute);
       //ASSERT_EQ(csc_value.size(), edge_buffer.size());
       _csc_storage.wrap(dest_counting_prefix_sum, csc_value); 
       edges.swap(edge_buffer.data);
       ASSERT_EQ(_csr_storage.num_values(), _csc_storage.num_values());
       ASSERT_EQ(_csr_storage.num_values(), edges.size());
+      if (compressed) compress_storage();
 #ifdef DEBGU_GRAPH
       logstream(LOG_DEBUG) << "End of finalize." << std::endl;
 #endif
@@ -328,11 +515,12 @@ namespace graphlab {
     }
     /**
      * \brief Creates an edge connecting vertex source to vertex target.  Any
-     * existing data will be cleared. Should not be called after finalization.
+     * existing data will be cleared. Should not be called after finalization,
+     * unless the graph is dynamic.
      */
     edge_id_type add_edge(lvid_type source, lvid_type target, 
                           const EdgeData& edata = EdgeData()) {
-      if (finalized) {
+      if (finalized && !dynamic) {
         logstream(LOG_FATAL)
           << "Attempting add edge to a finalized local_graph." << std::endl;
         ASSERT_MSG(false, "Add edge to a finalized local_graph.");
@@ -363,7 +551,7 @@ namespace graphlab {
                    const std::vector<EdgeData>& edata_arr) {
       ASSERT_TRUE((src_arr.size() == dst_arr.size())
                   && (src_arr.size() == edata_arr.size()));
-      if (finalized) {
+      if (finalized && !dynamic) {
         logstream(LOG_FATAL)
           << "Attempting add edges to a finalized local_graph." << std::endl;
       }
@@ -406,18 +594,35 @@ namespace graphlab {
     }
 
     /** \brief Returns a reference to the data stored on the vertex v. */
-    VertexData& vertex_data(lvid_type v) {
+    vertex_data_reference vertex_data(lvid_type v) {
       ASSERT_LT(v, vertices.size());
       return vertices[v];
     } // end of data(v)
 
     /** \brief Returns a constant reference to the data stored on the vertex v. */
-    const VertexData& vertex_data(lvid_type v) const {
+    vertex_data_const_reference vertex_data(lvid_type v) const {
       ASSERT_LT(v, vertices.size());
       return vertices[v];
     } // end of data(v)
 
-    /** \brief Load the local_graph from an archive */
+    /**
+     * \brief Returns the array of one field of the vertex data, if it is
+     * stored as a struct of arrays (see vertex_data_layout).
+     */
+    template <typename T, typename Owner>
+    T* vertex_column(T Owner::*field) {
+      return vertices.column(field);
+    }
+
+    template <typename T, typename Owner>
+    const T* vertex_column(T Owner::*field) const {
+      return vertices.column(field);
+    }
+
+    /**
+     * \brief Load the local_graph from an archive. The adjacency lists are
+     * compressed if compressed_adjacency() is set.
+     */
     void load(iarchive& arc) {
       clear();    
       // read the vertices
@@ -426,10 +631,33 @@ namespace graphlab {
           >> _csr_storage
           >> _csc_storage
           >> finalized;
+      if (finalized) {
+        if (dynamic) static_to_dynamic();
+        else if (compressed) compress_storage();
+      }
     } // end of load
 
-    /** \brief Save the local_graph to an archive */
+    /**
+     * \brief Save the local_graph to an archive. Compressed and dynamic
+     * adjacency lists are written in the static format, so that the archive
+     * does not depend on the options.
+     */
     void save(oarchive& arc) const {
+      if (dynamic) {
+        std::vector<EdgeData> sorted_edges;
+        csr_type csr;
+        csc_type csc;
+        dynamic_to_static(sorted_edges, csr, csc);
+        arc << vertices << sorted_edges << csr << csc << finalized;
+        return;
+      }
+      if (compressed) {
+        csr_type csr;
+        csc_type csc;
+        decompress_storage(csr, csc);
+        arc << vertices << edges << csr << csc << finalized;
+        return;
+      }
       // Write the number of edges and vertices
       arc << vertices
           << edges
@@ -437,15 +665,78 @@ namespace graphlab {
           << _csc_storage
           << finalized;
     } // end of save
-    
+
+    /**
+     * \brief Writes the local_graph to a snapshot as the sections
+     * name.vertices, name.edges, and name.csr.* and name.csc.* (or
+     * name.ccsr.* and name.ccsc.* if the adjacency is compressed). Vertex
+     * and edge data which are POD are written as is, so that
+     * load_snapshot() copies them straight from the mapped file. Dynamic
+     * graphs are written in the static format.
+     */
+    void save_snapshot(mmap_snapshot_writer& writer,
+                       const std::string& name) const {
+      save_snapshot_vector(writer, name + ".vertices", vertices);
+      if (dynamic) {
+        std::vector<EdgeData> sorted_edges;
+        csr_type csr;
+        csc_type csc;
+        dynamic_to_static(sorted_edges, csr, csc);
+        save_snapshot_vector(writer, name + ".edges", sorted_edges);
+        csr.save_snapshot(writer, name + ".csr");
+        csc.save_snapshot(writer, name + ".csc");
+        return;
+      }
+      save_snapshot_vector(writer, name + ".edges", edges);
+      if (compressed) {
+        _ccsr.save_snapshot(writer, name + ".ccsr");
+        _ccsc.save_snapshot(writer, name + ".ccsc");
+      } else {
+        _csr_storage.save_snapshot(writer, name + ".csr");
+        _csc_storage.save_snapshot(writer, name + ".csc");
+      }
+    } // end of save_snapshot
+
+    /**
+     * \brief Reads a local_graph written by save_snapshot(). The adjacency
+     * lists are converted if the snapshot was written with a different
+     * compressed_adjacency() setting, or if the graph is dynamic.
+     */
+    void load_snapshot(const mmap_snapshot_reader& reader,
+                       const std::string& name) {
+      const bool compress = compressed;
+      const bool dyn = dynamic;
+      clear();
+      dynamic = false;
+      load_snapshot_vector(reader, name + ".vertices", vertices);
+      load_snapshot_vector(reader, name + ".edges", edges);
+      compressed = reader.find(name + ".ccsr.index") != NULL;
+      if (compressed) {
+        _ccsr.load_snapshot(reader, name + ".ccsr");
+        _ccsc.load_snapshot(reader, name + ".ccsc");
+      } else {
+        _csr_storage.load_snapshot(reader, name + ".csr");
+        _csc_storage.load_snapshot(reader, name + ".csc");
+      }
+      finalized = true;
+      if (dyn) set_dynamic(true);
+      else set_compressed_adjacency(compress);
+    } // end of load_snapshot
+
     /** swap two graphs */
     void swap(local_graph& other) {
       finalized = other.finalized;
-      std::swap(vertices, other.vertices);
+      vertices.swap(other.vertices);
       std::swap(edges, other.edges);
       std::swap(_csr_storage, other._csr_storage);
       std::swap(_csc_storage, other._csc_storage);
+      _ccsr.swap(other._ccsr);
+      _ccsc.swap(other._ccsc);
+      _dcsr.swap(other._dcsr);
+      _dcsc.swap(other._dcsc);
       std::swap(finalized, other.finalized);
+      std::swap(compressed, other.compressed);
+      std::swap(dynamic, other.dynamic);
     } // end of swap
 
 
@@ -502,6 +793,8 @@ namespace graphlab {
      * \brief Returns the number of in edges of the vertex with the given id. */
     size_t num_in_edges(const lvid_type v) const {
       ASSERT_TRUE(finalized);
+      if (dynamic) return _dcsc.end(v) - _dcsc.begin(v);
+      if (compressed) return _ccsc.num_values(v);
       return (_csc_storage.end(v) - _csc_storage.begin(v));
     }
 
@@ -510,6 +803,8 @@ namespace graphlab {
      * \brief Returns the number of in edges of the vertex with the given id. */
     size_t num_out_edges(const lvid_type v) const {
       ASSERT_TRUE(finalized);
+      if (dynamic) return _dcsr.end(v) - _dcsr.begin(v);
+      if (compressed) return _ccsr.num_values(v);
       return (_csr_storage.end(v) - _csr_storage.begin(v));
     }
 
@@ -517,6 +812,18 @@ namespace graphlab {
      * \internal
      * \brief Returns a list of in edges of the vertex with the given id. */
     edge_list_type in_edges(lvid_type v) {
+      if (dynamic) {
+        return boost::make_iterator_range(
+            edge_iterator(*this, DCSC, _dcsc.begin(v), v),
+            edge_iterator(*this, DCSC, _dcsc.end(v), v));
+      }
+      if (compressed) {
+        return boost::make_iterator_range(
+            edge_iterator(*this, CCSC, ccsr_type::const_iterator(),
+                          _ccsc.begin(v), v),
+            edge_iterator(*this, CCSC, ccsr_type::const_iterator(),
+                          _ccsc.end(v), v));
+      }
       edge_iterator begin = edge_iterator(*this, _csc_storage.begin(v), v);
       edge_iterator end = edge_iterator(*this, _csc_storage.end(v), v);
       return boost::make_iterator_range(begin, end);
@@ -526,6 +833,18 @@ namespace graphlab {
      * \internal
      * \brief Returns a list of out edges of the vertex with the given id. */
     edge_list_type out_edges(lvid_type v) {
+      if (dynamic) {
+        return boost::make_iterator_range(
+            edge_iterator(*this, DCSR, _dcsr.begin(v), v),
+            edge_iterator(*this, DCSR, _dcsr.end(v), v));
+      }
+      if (compressed) {
+        return boost::make_iterator_range(
+            edge_iterator(*this, CCSR, _ccsr.begin(v),
+                          typename ccsc_type::const_iterator(), v),
+            edge_iterator(*this, CCSR, _ccsr.end(v),
+                          typename ccsc_type::const_iterator(), v));
+      }
 
       csr_type::iterator base_begin = _csr_storage.begin(v);
       csr_type::iterator base_end = _csr_storage.end(v);
@@ -564,6 +883,29 @@ namespace graphlab {
       return edges[eid]; 
     }
 
+    /**
+     * \internal
+     * \brief Returns the id of the edge from source to target. Used for
+     * the in edges of graphs without edge data, whose out edges are
+     * sorted by target.
+     */
+    edge_id_type find_edge_id(lvid_type source, lvid_type target) const {
+      if (compressed) {
+        for (ccsr_type::const_iterator it = _ccsr.begin(source);
+             it != _ccsr.end(source) && (*it).v[0] <= target; ++it) {
+          if ((*it).v[0] == target) return it.position();
+        }
+      } else {
+        csr_type::const_iterator begin = _csr_storage.begin(source);
+        csr_type::const_iterator end = _csr_storage.end(source);
+        csr_type::const_iterator it = std::lower_bound(begin, end, target);
+        if (it != end && *it == target) return it - _csr_storage.begin(0);
+      }
+      logstream(LOG_FATAL) << "No edge " << source << " -> " << target
+                           << std::endl;
+      return NO_EDGE_ID;
+    }
+
     /** 
      * \internal
      * \brief Returns the estimated memory footprint of the local_graph. */
@@ -572,6 +914,8 @@ namespace graphlab {
         sizeof(VertexData) * vertices.capacity();
       size_t elist_size = _csr_storage.estimate_sizeof() 
           + _csc_storage.estimate_sizeof()
+          + _ccsr.estimate_sizeof() + _ccsc.estimate_sizeof()
+          + _dcsr.estimate_sizeof() + _dcsc.estimate_sizeof()
           + sizeof(edges) + sizeof(EdgeData)*edges.capacity();
       size_t ebuffer_size = edge_buffer.estimate_sizeof();
       // std::cerr << "local_graph: tmplist size: " << (double)elist_size/(1024*1024)
@@ -604,14 +948,37 @@ namespace graphlab {
      * CSR/CSC storage types
      */
     typedef csr_storage<lvid_type, edge_id_type> csr_type;
-    typedef csr_storage<std::pair<lvid_type, edge_id_type>, edge_id_type> csc_type; 
+    typedef local_graph_impl::csc_traits<EdgeData> csc_traits;
+    typedef typename csc_traits::value_type csc_value_type;
+    typedef csr_storage<csc_value_type, edge_id_type> csc_type;
 
     typedef boost::tuple<csr_type::iterator,
                          boost::counting_iterator<edge_id_type>
                          > csr_iterator_tuple;
 
     typedef boost::zip_iterator<csr_iterator_tuple> csr_edge_iterator;
-    typedef csc_type::iterator csc_edge_iterator;
+    typedef typename csc_type::iterator csc_edge_iterator;
+
+    /**
+     * \internal
+     * Compressed CSR/CSC storage types. The id of an out edge is its
+     * position in the CSR, the CSC stores (source, edge id) pairs.
+     */
+    typedef delta_varint_csr<1, edge_id_type> ccsr_type;
+    typedef delta_varint_csr<csc_traits::width, edge_id_type> ccsc_type;
+
+    /**
+     * \internal
+     * Dynamic CSR/CSC storage types. Both store (neighbor, edge id) pairs:
+     * the ids of existing edges do not change when edges are inserted.
+     */
+    typedef std::pair<lvid_type, edge_id_type> dynamic_value_type;
+    typedef dynamic_csr_storage<dynamic_value_type, edge_id_type> dcsr_type;
+
+    /** The id of the in edges of graphs without edge data */
+    static const edge_id_type NO_EDGE_ID = edge_id_type(-1);
+
+    enum list_type {CSR, CSC, CCSR, CCSC, DCSR, DCSC};
 
     class edge_iterator : 
         public boost::iterator_facade <
@@ -622,10 +989,23 @@ namespace graphlab {
          public:
            edge_iterator(local_graph& lgraph_ref, 
                          csc_edge_iterator iter, lvid_type sourceid) 
-               : lgraph_ref(lgraph_ref), _type(CSC), csc_iter(iter), vid(sourceid) {}
+               : lgraph_ref(lgraph_ref), _type(CSC), csc_iter(iter),
+                 dcsr_iter(NULL, 0), vid(sourceid) {}
            edge_iterator(local_graph& lgraph_ref,
                          csr_edge_iterator iter, lvid_type destid) 
-               : lgraph_ref(lgraph_ref), _type(CSR), csr_iter(iter), vid(destid) {}
+               : lgraph_ref(lgraph_ref), _type(CSR), csr_iter(iter),
+                 dcsr_iter(NULL, 0), vid(destid) {}
+           // ccsr_type and ccsc_type are the same type without edge data
+           edge_iterator(local_graph& lgraph_ref, list_type type,
+                         ccsr_type::const_iterator ccsr_iter,
+                         typename ccsc_type::const_iterator ccsc_iter,
+                         lvid_type vid)
+               : lgraph_ref(lgraph_ref), _type(type), ccsr_iter(ccsr_iter),
+                 ccsc_iter(ccsc_iter), dcsr_iter(NULL, 0), vid(vid) {}
+           edge_iterator(local_graph& lgraph_ref, list_type type,
+                         dcsr_type::iterator iter, lvid_type vid)
+               : lgraph_ref(lgraph_ref), _type(type), dcsr_iter(iter),
+                 vid(vid) {}
 
          private:
            friend class boost::iterator_core_access;
@@ -634,6 +1014,9 @@ namespace graphlab {
              switch (_type) {
               case CSC: ++csc_iter; break;
               case CSR: ++csr_iter; break;
+              case CCSR: ++ccsr_iter; break;
+              case CCSC: ++ccsc_iter; break;
+              case DCSR: case DCSC: ++dcsr_iter; break;
               default: return;
              }
            }
@@ -643,6 +1026,9 @@ namespace graphlab {
              switch (_type) {
               case CSC: return csc_iter == other.csc_iter;
               case CSR: return csr_iter == other.csr_iter;
+              case CCSR: return ccsr_iter == other.ccsr_iter;
+              case CCSC: return ccsc_iter == other.ccsc_iter;
+              case DCSR: case DCSC: return dcsr_iter == other.dcsr_iter;
               default: return true;
              }
            }
@@ -653,6 +1039,13 @@ namespace graphlab {
              switch (_type) {
               case CSC: --csc_iter; break;
               case CSR: --csr_iter; break;
+              case CCSR: --ccsr_iter; break;
+              case CCSC: --ccsc_iter; break;
+              case DCSR: case DCSC:
+                logstream(LOG_FATAL) << "The edge lists of a dynamic graph "
+                                     << "can not be iterated backwards"
+                                     << std::endl;
+                break;
               default: return;
              }
            }
@@ -660,6 +1053,9 @@ namespace graphlab {
              switch (_type) {
               case CSC: csc_iter+=n; break;
               case CSR: csr_iter+=n; break;
+              case CCSR: ccsr_iter+=n; break;
+              case CCSC: ccsc_iter+=n; break;
+              case DCSR: case DCSC: dcsr_iter+=n; break;
               default: return;
              }
            } 
@@ -667,6 +1063,9 @@ namespace graphlab {
              switch (_type) {
               case CSC: return other.csc_iter - csc_iter;
               case CSR: return other.csr_iter - csr_iter;
+              case CCSR: return other.ccsr_iter - ccsr_iter;
+              case CCSC: return other.ccsc_iter - ccsc_iter;
+              case DCSR: case DCSC: return other.dcsr_iter - dcsr_iter;
               default: return 0;
              }
            }
@@ -676,7 +1075,8 @@ namespace graphlab {
               case CSC: {
                 typename csc_edge_iterator::reference val
                     = *csc_iter;
-                return edge_type(lgraph_ref, val.first, vid, val.second);
+                return edge_type(lgraph_ref, csc_traits::source(val), vid,
+                                 csc_traits::edge_id(val));
               }
               case CSR: {
                 typename csr_edge_iterator::reference val
@@ -686,31 +1086,358 @@ namespace graphlab {
                                  val.template get<0>(),
                                  val.template get<1>());
               }
+              case CCSR: {
+                return edge_type(lgraph_ref, vid, (*ccsr_iter).v[0],
+                                 ccsr_iter.position());
+              }
+              case CCSC: {
+                typename ccsc_type::value_type val = *ccsc_iter;
+                return edge_type(lgraph_ref, val.v[0], vid,
+                                 csc_traits::has_edge_id ?
+                                 edge_id_type(val.v[csc_traits::width - 1]) :
+                                 NO_EDGE_ID);
+              }
+              case DCSR: {
+                const dynamic_value_type& val = *dcsr_iter;
+                return edge_type(lgraph_ref, vid, val.first, val.second);
+              }
+              case DCSC: {
+                const dynamic_value_type& val = *dcsr_iter;
+                return edge_type(lgraph_ref, val.first, vid, val.second);
+              }
               default: return edge_type(lgraph_ref, -1, -1, -1);
              }
            }
-           enum list_type {CSR, CSC}; 
            local_graph& lgraph_ref;
            const list_type _type;
            csc_edge_iterator csc_iter;
            csr_edge_iterator csr_iter;
+           ccsr_type::const_iterator ccsr_iter;
+           typename ccsc_type::const_iterator ccsc_iter;
+           dcsr_type::iterator dcsr_iter;
            const lvid_type vid;
         }; // end of edge_iterator
 
 
+    /** \internal Component j of value i of the CSR, for ccsr_type::init */
+    struct csr_value_getter {
+      const std::vector<lvid_type>& targets;
+      csr_value_getter(const std::vector<lvid_type>& targets)
+          : targets(targets) { }
+      uint64_t operator()(size_t i, size_t j) const { return targets[i]; }
+    };
+
+    /** \internal Component j of value i of the CSC, for ccsc_type::init */
+    struct csc_value_getter {
+      const std::vector<csc_value_type>& values;
+      csc_value_getter(const std::vector<csc_value_type>& values)
+          : values(values) { }
+      uint64_t operator()(size_t i, size_t j) const {
+        return j == 0 ? csc_traits::source(values[i])
+                      : csc_traits::edge_id(values[i]);
+      }
+    };
+
+    /** \internal Sorts the values of each key of a CSR layout */
+    template <typename T>
+    static void sort_lists(std::vector<T>& values,
+                           const std::vector<edge_id_type>& index) {
+      const ssize_t nkeys = index.size();
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t k = 0; k < nkeys; ++k) {
+        const size_t end = k + 1 < nkeys ? index[k + 1] : values.size();
+        std::sort(values.begin() + index[k], values.begin() + end);
+      }
+    }
+
+    /**
+     * \internal
+     * Moves the finalized CSR and CSC storage into _ccsr and _ccsc. The out
+     * edges of each vertex are sorted by target, permuting the edge data
+     * so that an edge id is still the position of the edge in the CSR,
+     * and the in edges are sorted by source.
+     */
+    void compress_storage() {
+      graphlab::timer mytimer; mytimer.start();
+      std::vector<edge_id_type> csr_index, csc_index;
+      std::vector<lvid_type> targets;
+      std::vector<csc_value_type> csc_values;
+      _csr_storage.unwrap(csr_index, targets);
+      _csc_storage.unwrap(csc_index, csc_values);
+      const size_t nedges = targets.size();
+
+      // permute[new eid] = old eid
+      std::vector<edge_id_type> permute(nedges);
+      const ssize_t ncsr_keys = csr_index.size();
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t v = 0; v < ncsr_keys; ++v) {
+        const size_t begin = csr_index[v];
+        const size_t end = v + 1 < ncsr_keys ? csr_index[v + 1] : nedges;
+        std::vector<std::pair<lvid_type, edge_id_type> > list(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+          list[i - begin] = std::make_pair(targets[i], edge_id_type(i));
+        }
+        std::sort(list.begin(), list.end());
+        for (size_t i = begin; i < end; ++i) {
+          targets[i] = list[i - begin].first;
+          permute[i] = list[i - begin].second;
+        }
+      }
+      if (csc_traits::has_edge_id) {
+        std::vector<edge_id_type> new_eid(nedges);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (ssize_t i = 0; i < ssize_t(nedges); ++i) new_eid[permute[i]] = i;
+        inplace_shuffle(edges.begin(), edges.end(), permute);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (ssize_t i = 0; i < ssize_t(nedges); ++i) {
+          csc_traits::set_edge_id(csc_values[i],
+                                  new_eid[csc_traits::edge_id(csc_values[i])]);
+        }
+      }
+      std::vector<edge_id_type>().swap(permute);
+      sort_lists(csc_values, csc_index);
+
+      _ccsr.init(csr_index, nedges, csr_value_getter(targets));
+      _ccsc.init(csc_index, nedges, csc_value_getter(csc_values));
+      logstream(LOG_INFO) << "Adjacency compressed to "
+                          << _ccsr.num_bytes() + _ccsc.num_bytes()
+                          << " bytes in " << mytimer.current_time()
+                          << " secs" << std::endl;
+    } // end of compress_storage
+
+    /** \internal Decodes _ccsr and _ccsc into csr and csc */
+    void decompress_storage(csr_type& csr, csc_type& csc) const {
+      const size_t nedges = _ccsr.num_values();
+      std::vector<edge_id_type> csr_index = _ccsr.get_index();
+      std::vector<edge_id_type> csc_index = _ccsc.get_index();
+      std::vector<lvid_type> targets(nedges);
+      std::vector<csc_value_type> csc_values(nedges);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t v = 0; v < ssize_t(csr_index.size()); ++v) {
+        for (ccsr_type::const_iterator it = _ccsr.begin(v);
+             it != _ccsr.end(v); ++it) {
+          targets[it.position()] = (*it).v[0];
+        }
+      }
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t v = 0; v < ssize_t(csc_index.size()); ++v) {
+        for (typename ccsc_type::const_iterator it = _ccsc.begin(v);
+             it != _ccsc.end(v); ++it) {
+          typename ccsc_type::value_type val = *it;
+          csc_values[it.position()] =
+              csc_traits::make(val.v[0], val.v[csc_traits::width - 1]);
+        }
+      }
+      csr.wrap(csr_index, targets);
+      csc.wrap(csc_index, csc_values);
+    } // end of decompress_storage
+
+    /** \internal Orders edge buffer indices by one of the endpoint arrays */
+    struct endpoint_less {
+      const std::vector<lvid_type>& endpoints;
+      endpoint_less(const std::vector<lvid_type>& endpoints)
+          : endpoints(endpoints) { }
+      bool operator()(edge_id_type a, edge_id_type b) const {
+        return endpoints[a] < endpoints[b];
+      }
+    };
+
+    /**
+     * \internal
+     * Merges the edge buffer into _dcsr and _dcsc. Only the new edges are
+     * sorted, so the cost does not depend on the size of the graph. The new
+     * edges get the ids following the existing ones.
+     */
+    void finalize_dynamic() {
+      if (finalized && edge_buffer.size() == 0) return;
+      graphlab::timer mytimer; mytimer.start();
+      const size_t nnew = edge_buffer.size();
+      const edge_id_type begin_eid = edges.size();
+      std::vector<edge_id_type> order(nnew);
+      for (size_t i = 0; i < nnew; ++i) order[i] = i;
+      std::sort(order.begin(), order.end(),
+                endpoint_less(edge_buffer.source_arr));
+      insert_dynamic(_dcsr, edge_buffer.source_arr, edge_buffer.target_arr,
+                     order, begin_eid);
+      std::sort(order.begin(), order.end(),
+                endpoint_less(edge_buffer.target_arr));
+      insert_dynamic(_dcsc, edge_buffer.target_arr, edge_buffer.source_arr,
+                     order, begin_eid);
+      edges.insert(edges.end(), edge_buffer.data.begin(),
+                   edge_buffer.data.end());
+      edge_buffer.clear();
+      ASSERT_EQ(_dcsr.num_values(), edges.size());
+      ASSERT_EQ(_dcsc.num_values(), edges.size());
+      logstream(LOG_INFO) << nnew << " edges inserted in "
+                          << mytimer.current_time() << " secs" << std::endl;
+      finalized = true;
+    } // end of finalize_dynamic
+
+    /**
+     * \internal
+     * Inserts the edges order[0..n) (sorted by key) into storage. The values
+     * are the (neighbor, edge id) pairs, the edge id of buffer entry i
+     * being begin_eid + i.
+     */
+    static void insert_dynamic(dcsr_type& storage,
+                               const std::vector<lvid_type>& keys,
+                               const std::vector<lvid_type>& neighbors,
+                               const std::vector<edge_id_type>& order,
+                               edge_id_type begin_eid) {
+      const size_t n = order.size();
+      std::vector<dynamic_value_type> values(n);
+      for (size_t i = 0; i < n; ++i) {
+        values[i] = dynamic_value_type(neighbors[order[i]],
+                                       begin_eid + order[i]);
+      }
+      if (storage.num_keys() == 0) {
+        // first batch: lay out all lists at once
+        std::vector<edge_id_type> index(n > 0 ? keys[order[n - 1]] + 1 : 0);
+        size_t i = 0;
+        for (size_t k = 0; k < index.size(); ++k) {
+          while (i < n && keys[order[i]] < k) ++i;
+          index[k] = i;
+        }
+        storage.wrap(index, values);
+        return;
+      }
+      size_t begin = 0;
+      while (begin < n) {
+        const lvid_type key = keys[order[begin]];
+        size_t end = begin + 1;
+        while (end < n && keys[order[end]] == key) ++end;
+        storage.insert(key, values.begin() + begin, values.begin() + end);
+        storage.repack(key);
+        begin = end;
+      }
+    } // end of insert_dynamic
+
+    /**
+     * \internal
+     * Moves the finalized CSR and CSC storage into _dcsr and _dcsc. The
+     * edge ids do not change.
+     */
+    void static_to_dynamic() {
+      const size_t nedges = edges.size();
+      std::vector<edge_id_type> csr_index, csc_index;
+      std::vector<lvid_type> targets;
+      std::vector<csc_value_type> csc_values;
+      // the ids of in edges without edge data are looked up in the CSR,
+      // so the CSC is converted first
+      std::vector<dynamic_value_type> in_values(nedges);
+      const ssize_t ncsc_keys = _csc_storage.num_keys();
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t v = 0; v < ncsc_keys; ++v) {
+        for (typename csc_type::iterator it = _csc_storage.begin(v);
+             it != _csc_storage.end(v); ++it) {
+          const lvid_type source = csc_traits::source(*it);
+          in_values[it - _csc_storage.begin(0)] = dynamic_value_type(
+              source, csc_traits::has_edge_id ? csc_traits::edge_id(*it)
+                                              : find_edge_id(source, v));
+        }
+      }
+      _csc_storage.unwrap(csc_index, csc_values);
+      std::vector<csc_value_type>().swap(csc_values);
+      _csr_storage.unwrap(csr_index, targets);
+      std::vector<dynamic_value_type> out_values(nedges);
+      for (size_t i = 0; i < nedges; ++i) {
+        out_values[i] = dynamic_value_type(targets[i], edge_id_type(i));
+      }
+      std::vector<lvid_type>().swap(targets);
+      _dcsr.wrap(csr_index, out_values);
+      _dcsc.wrap(csc_index, in_values);
+    } // end of static_to_dynamic
+
+    /**
+     * \internal
+     * Builds the static CSR and CSC storage of a dynamic graph. The out
+     * edges of each vertex are sorted by target and the edge data is
+     * permuted so that the edge id is the position in the CSR.
+     */
+    void dynamic_to_static(std::vector<EdgeData>& out_edges,
+                           csr_type& csr, csc_type& csc) const {
+      const size_t nedges = edges.size();
+      std::vector<edge_id_type> new_eid(nedges);
+      std::vector<edge_id_type> csr_index(_dcsr.num_keys());
+      std::vector<lvid_type> targets(nedges);
+      std::vector<EdgeData> sorted_edges(nedges);
+      std::vector<dynamic_value_type> list;
+      size_t pos = 0;
+      for (size_t v = 0; v < csr_index.size(); ++v) {
+        csr_index[v] = pos;
+        // the block list iterators only move forwards
+        list.clear();
+        for (typename dcsr_type::const_iterator it = _dcsr.begin(v);
+             it != _dcsr.end(v); ++it) {
+          list.push_back(*it);
+        }
+        std::sort(list.begin(), list.end());
+        for (size_t i = 0; i < list.size(); ++i, ++pos) {
+          targets[pos] = list[i].first;
+          new_eid[list[i].second] = pos;
+          sorted_edges[pos] = edges[list[i].second];
+        }
+      }
+      ASSERT_EQ(pos, nedges);
+      std::vector<edge_id_type> csc_index(_dcsc.num_keys());
+      std::vector<csc_value_type> csc_values(nedges);
+      pos = 0;
+      for (size_t v = 0; v < csc_index.size(); ++v) {
+        csc_index[v] = pos;
+        for (typename dcsr_type::const_iterator it = _dcsc.begin(v);
+             it != _dcsc.end(v); ++it, ++pos) {
+          csc_values[pos] = csc_traits::make(it->first, new_eid[it->second]);
+        }
+      }
+      sort_lists(csc_values, csc_index);
+      csr.wrap(csr_index, targets);
+      csc.wrap(csc_index, csc_values);
+      out_edges.swap(sorted_edges);
+    } // end of dynamic_to_static
+
+
     /**************************************************************************/
     /*                                                                        */
     /*                          PRIVATE DATA MEMBERS                          */
     /*                                                                        */
     /**************************************************************************/
-    /** The vertex data is simply a vector of vertex data */
-    std::vector<VertexData> vertices;
+    /**
+     * The vertex data, a vector of vertex data unless vertex_data_layout
+     * is specialized for VertexData
+     */
+    typedef typename vertex_data_layout<VertexData>::storage_type
+        vertex_storage_type;
+    vertex_storage_type vertices;
 
     /** Stores the edge data and edge relationships. */
     csr_type _csr_storage;
     csc_type _csc_storage;
     std::vector<EdgeData> edges;
 
+    /** The compressed adjacency, used instead of the CSR and CSC storage
+        if compressed is set. */
+    ccsr_type _ccsr;
+    ccsc_type _ccsc;
+
+    /** The adjacency of dynamic graphs, used instead of the CSR and CSC
+        storage if dynamic is set. */
+    dcsr_type _dcsr;
+    dcsr_type _dcsc;
+
     /** The edge data is a vector of edges where each edge stores its
         source, destination, and data. Used for temporary storage. The
         data is transferred into CSR+CSC representation in
@@ -722,6 +1449,12 @@ namespace graphlab {
         performance. */
     bool finalized;
 
+    /** See set_compressed_adjacency() */
+    bool compressed;
+
+    /** See set_dynamic() */
+    bool dynamic;
+
 
     /**************************************************************************/
     /*                                                                        */
@@ -731,6 +1464,9 @@ namespace graphlab {
     friend class local_graph_test; 
   }; // End of class local_graph
 
+  template<typename VertexData, typename EdgeData>
+  const edge_id_type local_graph<VertexData, EdgeData>::NO_EDGE_ID;
+
 
   template<typename VertexData, typename EdgeData>
   std::ostream& operator<<(std::ostream& out,
@@ -0,0 +1,487 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+#ifndef GRAPHLAB_GRAPH_VERTEX_DATA_LAYOUT_HPP
+#define GRAPHLAB_GRAPH_VERTEX_DATA_LAYOUT_HPP
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_pod.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/serialization/iarchive.hpp>
+#include <graphlab/serialization/oarchive.hpp>
+#include <graphlab/parallel/numa_tools.hpp>
+#include <graphlab/util/mmap_snapshot.hpp>
+
+namespace graphlab {
+
+  /**
+   * \ingroup graph
+   * Selects how local_graph stores the vertex data. By default the vertex
+   * data is an array of VertexData (array of structs), and vertex.data()
+   * returns a VertexData&.
+   *
+   * Vertex data types made of plain fields can be stored as a struct of
+   * arrays instead, by specializing vertex_data_layout on the type and
+   * deriving from soa_layout. The specialization lists the fields:
+   * \code
+   * struct pagerank_vertex {
+   *   double rank;
+   *   double delta;
+   *   uint32_t nout;
+   *   pagerank_vertex() : rank(1), delta(0), nout(0) { }
+   * };
+   *
+   * namespace graphlab {
+   *   template <>
+   *   struct vertex_data_layout<pagerank_vertex>
+   *       : public soa_layout<pagerank_vertex> {
+   *     static void register_fields(soa_field_list<pagerank_vertex>& fields) {
+   *       fields.add(&pagerank_vertex::rank);
+   *       fields.add(&pagerank_vertex::delta);
+   *       fields.add(&pagerank_vertex::nout);
+   *     }
+   *   };
+   * }
+   * \endcode
+   * Each field is then stored in its own cache line aligned array, so a
+   * gather or map_reduce_vertices() reading one field only loads that
+   * field, and loops over distributed_graph::local_vertex_column() can be
+   * vectorized.
+   *
+   * With this layout vertex.data() returns a soa_vertex_reference, which
+   * converts to and from a VertexData, and whose get() returns a
+   * reference to one field:
+   * \code
+   * double rank = vertex.data().get(&pagerank_vertex::rank);
+   * vertex.data().get(&pagerank_vertex::delta) = 0;
+   * \endcode
+   * The struct of arrays layout is supported by local_graph, not by
+   * dynamic_local_graph.
+   */
+  template <typename VertexData>
+  struct vertex_data_layout {
+    typedef std::vector<VertexData> storage_type;
+    typedef VertexData& reference;
+    typedef const VertexData& const_reference;
+  };
+
+
+  template <typename VertexData> class soa_vertex_storage;
+  template <typename VertexData> class soa_vertex_reference;
+  template <typename VertexData> class soa_vertex_const_reference;
+
+  /// The base class of struct of arrays vertex_data_layout specializations
+  template <typename VertexData>
+  struct soa_layout {
+    typedef soa_vertex_storage<VertexData> storage_type;
+    typedef soa_vertex_reference<VertexData> reference;
+    typedef soa_vertex_const_reference<VertexData> const_reference;
+  };
+
+
+  /**
+   * \internal
+   * The byte offset of a field in VertexData.
+   */
+  template <typename VertexData, typename T>
+  inline size_t soa_field_offset(T VertexData::*field) {
+    // any suitably aligned address will do, no object is accessed
+    const char* base = reinterpret_cast<const char*>(64);
+    return reinterpret_cast<const char*>(
+        &(reinterpret_cast<const VertexData*>(base)->*field)) - base;
+  }
+
+  /**
+   * The fields of a struct of arrays vertex type, filled by
+   * vertex_data_layout<VertexData>::register_fields(). Every field of
+   * VertexData must be added: fields which are not are reset to their
+   * default value whenever a VertexData is stored.
+   */
+  template <typename VertexData>
+  class soa_field_list {
+   public:
+    struct field {
+      size_t offset;
+      size_t size;
+    };
+
+    template <typename T>
+    void add(T VertexData::*member) {
+      // fields are copied with memcpy
+      BOOST_STATIC_ASSERT(boost::is_pod<T>::value);
+      field f;
+      f.offset = soa_field_offset(member);
+      f.size = sizeof(T);
+      for (size_t i = 0;i < fields.size(); ++i) {
+        ASSERT_MSG(f.offset + f.size <= fields[i].offset ||
+                   fields[i].offset + fields[i].size <= f.offset,
+                   "Field at offset %d added twice", (int)f.offset);
+      }
+      fields.push_back(f);
+    }
+
+    std::vector<field> fields;
+  };
+
+
+  /**
+   * \ingroup graph
+   * The vertex data of a struct of arrays vertex_data_layout: one array
+   * per field, aligned to SOA_ALIGNMENT bytes. The interface follows the
+   * part of std::vector used by local_graph, but operator[] returns a
+   * soa_vertex_reference.
+   */
+  template <typename VertexData>
+  class soa_vertex_storage {
+   public:
+    typedef VertexData value_type;
+    typedef soa_vertex_reference<VertexData> reference;
+    typedef soa_vertex_const_reference<VertexData> const_reference;
+
+    static const size_t SOA_ALIGNMENT = 64;
+
+    soa_vertex_storage() : nelem(0), cap(0) {
+      init_fields();
+    }
+
+    soa_vertex_storage(const soa_vertex_storage& other) : nelem(0), cap(0) {
+      init_fields();
+      *this = other;
+    }
+
+    soa_vertex_storage& operator=(const soa_vertex_storage& other) {
+      if (this == &other) return *this;
+      clear();
+      reserve(other.nelem);
+      for (size_t f = 0;f < fields.size(); ++f) {
+        if (other.nelem > 0) {
+          memcpy(columns[f], other.columns[f], other.nelem * fields[f].size);
+        }
+      }
+      nelem = other.nelem;
+      return *this;
+    }
+
+    ~soa_vertex_storage() {
+      clear();
+    }
+
+    inline size_t size() const { return nelem; }
+    inline size_t capacity() const { return cap; }
+    inline bool empty() const { return nelem == 0; }
+
+    inline reference operator[](size_t i) {
+      return reference(*this, i);
+    }
+
+    inline const_reference operator[](size_t i) const {
+      return const_reference(*this, i);
+    }
+
+    /// Assembles element i
+    VertexData get(size_t i) const {
+      VertexData value;
+      char* dest = reinterpret_cast<char*>(&value);
+      for (size_t f = 0;f < fields.size(); ++f) {
+        memcpy(dest + fields[f].offset, columns[f] + i * fields[f].size,
+               fields[f].size);
+      }
+      return value;
+    }
+
+    /// Scatters value into the fields of element i
+    void set(size_t i, const VertexData& value) {
+      const char* src = reinterpret_cast<const char*>(&value);
+      for (size_t f = 0;f < fields.size(); ++f) {
+        memcpy(columns[f] + i * fields[f].size, src + fields[f].offset,
+               fields[f].size);
+      }
+    }
+
+    /// The array of one field: column(field)[i] is field of element i
+    template <typename T>
+    inline T* column(T VertexData::*field) {
+      return reinterpret_cast<T*>(column_at_offset[soa_field_offset(field)]);
+    }
+
+    template <typename T>
+    inline const T* column(T VertexData::*field) const {
+      return reinterpret_cast<const T*>(
+          column_at_offset[soa_field_offset(field)]);
+    }
+
+    void reserve(size_t n) {
+      if (n <= cap) return;
+      for (size_t f = 0;f < fields.size(); ++f) {
+        char* column = allocate(n * fields[f].size);
+        if (nelem > 0) memcpy(column, columns[f], nelem * fields[f].size);
+        free(columns[f]);
+        columns[f] = column;
+        column_at_offset[fields[f].offset] = column;
+      }
+      cap = n;
+    }
+
+    void resize(size_t n, const VertexData& value = VertexData()) {
+      if (n > cap) reserve(std::max(n, 2 * cap));
+      for (size_t i = nelem;i < n; ++i) set(i, value);
+      nelem = n;
+    }
+
+    /// Releases all memory, unlike std::vector::clear()
+    void clear() {
+      for (size_t f = 0;f < fields.size(); ++f) {
+        free(columns[f]);
+        columns[f] = NULL;
+        column_at_offset[fields[f].offset] = NULL;
+      }
+      nelem = cap = 0;
+    }
+
+    void swap(soa_vertex_storage& other) {
+      // both have the same fields
+      columns.swap(other.columns);
+      column_at_offset.swap(other.column_at_offset);
+      std::swap(nelem, other.nelem);
+      std::swap(cap, other.cap);
+    }
+
+    /// Places the pages of every field on the NUMA nodes of their vertices
+    void distribute() {
+      for (size_t f = 0;f < fields.size(); ++f) {
+        if (nelem > 0) numa::distribute(columns[f], nelem, fields[f].size);
+      }
+    }
+
+    /// Saves the fields one after the other
+    void save(oarchive& oarc) const {
+      oarc << nelem;
+      for (size_t f = 0;f < fields.size(); ++f) {
+        oarc << fields[f].size;
+        if (nelem > 0) oarc.write(columns[f], nelem * fields[f].size);
+      }
+    }
+
+    void load(iarchive& iarc) {
+      clear();
+      size_t n = 0;
+      iarc >> n;
+      reserve(n);
+      for (size_t f = 0;f < fields.size(); ++f) {
+        size_t size = 0;
+        iarc >> size;
+        ASSERT_EQ(size, fields[f].size);
+        if (n > 0) iarc.read(columns[f], n * size);
+      }
+      nelem = n;
+    }
+
+    /// Writes one section per field, name.0, name.1 ...
+    void save_snapshot(mmap_snapshot_writer& writer,
+                       const std::string& name) const {
+      for (size_t f = 0;f < fields.size(); ++f) {
+        writer.write(section_name(name, f), columns[f],
+                     nelem * fields[f].size, fields[f].size);
+      }
+    }
+
+    void load_snapshot(const mmap_snapshot_reader& reader,
+                       const std::string& name) {
+      clear();
+      for (size_t f = 0;f < fields.size(); ++f) {
+        const mmap_snapshot_section& sec = reader.section(section_name(name, f));
+        ASSERT_EQ(sec.element_size, fields[f].size);
+        const size_t n = sec.length / fields[f].size;
+        if (f == 0) reserve(n);
+        else ASSERT_EQ(n, nelem);
+        if (n > 0) reader.copy(sec, columns[f]);
+        nelem = n;
+      }
+    }
+
+   private:
+    typedef typename soa_field_list<VertexData>::field field_type;
+    std::vector<field_type> fields;
+    std::vector<char*> columns;
+    /// The column of the field at every byte offset, NULL if none
+    std::vector<char*> column_at_offset;
+    size_t nelem;
+    size_t cap;
+
+    void init_fields() {
+      soa_field_list<VertexData> list;
+      vertex_data_layout<VertexData>::register_fields(list);
+      ASSERT_GT(list.fields.size(), 0);
+      fields = list.fields;
+      columns.resize(fields.size(), NULL);
+      column_at_offset.resize(sizeof(VertexData), NULL);
+    }
+
+    static char* allocate(size_t bytes) {
+      void* ptr = NULL;
+      if (posix_memalign(&ptr, SOA_ALIGNMENT, std::max<size_t>(bytes, 1)) != 0) {
+        logstream(LOG_FATAL) << "Unable to allocate " << bytes
+                             << " bytes of vertex data" << std::endl;
+      }
+      return reinterpret_cast<char*>(ptr);
+    }
+
+    static std::string section_name(const std::string& name, size_t f) {
+      char buf[32];
+      sprintf(buf, ".%u", (unsigned)f);
+      return name + buf;
+    }
+  }; // end of soa_vertex_storage
+
+  template <typename VertexData>
+  const size_t soa_vertex_storage<VertexData>::SOA_ALIGNMENT;
+
+
+  /**
+   * \ingroup graph
+   * The data of a vertex stored by soa_vertex_storage. Converts to and
+   * from VertexData, and get() accesses one field in place.
+   */
+  template <typename VertexData>
+  class soa_vertex_reference {
+   public:
+    soa_vertex_reference(soa_vertex_storage<VertexData>& storage, size_t index)
+        : storage(&storage), index(index) { }
+
+    operator VertexData() const {
+      return storage->get(index);
+    }
+
+    /// Stores value in this vertex
+    soa_vertex_reference& operator=(const VertexData& value) {
+      storage->set(index, value);
+      return *this;
+    }
+
+    /// Copies the data of another vertex, like VertexData::operator=
+    soa_vertex_reference& operator=(const soa_vertex_reference& other) {
+      storage->set(index, other.storage->get(other.index));
+      return *this;
+    }
+
+    /// A reference to one field of this vertex
+    template <typename T>
+    T& get(T VertexData::*field) const {
+      return storage->column(field)[index];
+    }
+
+    void save(oarchive& oarc) const {
+      oarc << storage->get(index);
+    }
+
+    void load(iarchive& iarc) {
+      VertexData value;
+      iarc >> value;
+      storage->set(index, value);
+    }
+
+   private:
+    friend class soa_vertex_const_reference<VertexData>;
+    soa_vertex_storage<VertexData>* storage;
+    size_t index;
+  };
+
+  /// The constant counterpart of soa_vertex_reference
+  template <typename VertexData>
+  class soa_vertex_const_reference {
+   public:
+    soa_vertex_const_reference(const soa_vertex_storage<VertexData>& storage,
+                               size_t index)
+        : storage(&storage), index(index) { }
+
+    soa_vertex_const_reference(const soa_vertex_reference<VertexData>& ref)
+        : storage(ref.storage), index(ref.index) { }
+
+    operator VertexData() const {
+      return storage->get(index);
+    }
+
+    template <typename T>
+    const T& get(T VertexData::*field) const {
+      return storage->column(field)[index];
+    }
+
+    void save(oarchive& oarc) const {
+      oarc << storage->get(index);
+    }
+
+   private:
+    const soa_vertex_storage<VertexData>* storage;
+    size_t index;
+  };
+
+
+  /**
+   * \internal
+   * Calls fn(data, arg) on the data of a vertex, for functions which take a
+   * VertexData&. Through a soa_vertex_reference the data is copied out and
+   * stored back.
+   */
+  template <typename VertexData, typename Fn, typename Arg>
+  void update_vertex_data(VertexData& data, const Fn& fn, const Arg& arg) {
+    fn(data, arg);
+  }
+
+  template <typename VertexData, typename Fn, typename Arg>
+  void update_vertex_data(soa_vertex_reference<VertexData> data,
+                          const Fn& fn, const Arg& arg) {
+    VertexData value = data;
+    fn(value, arg);
+    data = value;
+  }
+
+
+  /// Writes the fields of a soa_vertex_storage as sections
+  template <typename VertexData>
+  void save_snapshot_vector(mmap_snapshot_writer& writer,
+                            const std::string& name,
+                            const soa_vertex_storage<VertexData>& storage) {
+    storage.save_snapshot(writer, name);
+  }
+
+  template <typename VertexData>
+  void load_snapshot_vector(const mmap_snapshot_reader& reader,
+                            const std::string& name,
+                            soa_vertex_storage<VertexData>& storage) {
+    storage.load_snapshot(reader, name);
+  }
+
+  namespace numa {
+    template <typename VertexData>
+    void distribute(soa_vertex_storage<VertexData>& storage) {
+      storage.distribute();
+    }
+  } // namespace numa
+
+} // end of graphlab
+#endif
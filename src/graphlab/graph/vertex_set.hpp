@@ -25,6 +25,9 @@
 #ifndef GRAPHLAB_GRAPH_VERTEX_SET_HPP
 #define GRAPHLAB_GRAPH_VERTEX_SET_HPP
 
+#include <vector>
+#include <algorithm>
+#include <iterator>
 #include <graphlab/util/dense_bitset.hpp>
 #include <graphlab/graph/graph_basic_types.hpp>
 #include <graphlab/rpc/buffered_exchange.hpp>
@@ -64,6 +67,14 @@ namespace graphlab {
  * \endcode
  * For more details see \ref distributed_graph::select()
  *
+ * Internally a set is stored as a bitset over the local vertices, or as a
+ * sorted list of local vertex ids when it has few members, and is converted
+ * between the two as it grows or shrinks. Sets built by
+ * \ref distributed_graph::neighbors() from a small frontier, and the
+ * synchronization of such sets between machines, therefore cost time
+ * proportional to the size of the frontier rather than to the size of the
+ * graph.
+ *
  * The size of the vertex set can only be queried through the graph using
  * \ref distributed_graph::vertex_set_size();
  *
@@ -71,7 +82,7 @@ namespace graphlab {
 class vertex_set {
   public:
     /**
-     * Used only if \ref lazy is false.
+     * Used only if \ref lazy and \ref sparse are false.
      * If \ref lazy is false, this must be the same size as the graph's
      * graphlab::distributed_graph::num_local_vertices().
      * The invariant is that the bit value of each mirror vertex must be the
@@ -79,6 +90,18 @@ class vertex_set {
      */
     mutable dense_bitset localvset;
 
+    /**
+     * Used only if \ref sparse is set: the sorted local ids of the members.
+     * The same invariant as for \ref localvset holds.
+     */
+    mutable std::vector<lvid_type> sparse_lvids;
+
+    /**
+     * Used only if \ref sparse is set: the number of local vertices, which
+     * is the size of the bitset when the set is made dense again.
+     */
+    mutable size_t sparse_size;
+
     /**
      * Used only if \ref lazy is set.
      * If is_complete_set is true, this set describes the set of all vertices.
@@ -92,6 +115,23 @@ class vertex_set {
      */
     mutable bool lazy;
 
+    /**
+     * If set (and \ref lazy is not), the localvset is empty and not used.
+     * Instead, \ref sparse_lvids lists the members.
+     * The synchronization functions switch between the two representations
+     * according to the number of members, see choose_representation().
+     */
+    mutable bool sparse;
+
+    /**
+     * A set with fewer than 1 / SPARSE_DENSITY of the local vertices as
+     * members is converted to a list, and a list with more than
+     * 1 / DENSE_DENSITY of the local vertices back to a bitset.
+     * A list entry takes as much memory as 32 bits of the bitset.
+     */
+    static const size_t SPARSE_DENSITY = 64;
+    static const size_t DENSE_DENSITY = 16;
+
 
     /**
      * \internal
@@ -100,6 +140,7 @@ class vertex_set {
     template <typename DGraphType>
     const dense_bitset& get_lvid_bitset(const DGraphType& dgraph) const {
       if (lazy) make_explicit(dgraph);
+      make_dense();
       return localvset;
     }
 
@@ -113,6 +154,7 @@ class vertex_set {
      */
     inline void set_lvid_unsync(lvid_type lvid) {
       ASSERT_FALSE(lazy);
+      make_dense();
       localvset.set_bit_unsync(lvid);
     }
 
@@ -120,12 +162,13 @@ class vertex_set {
     /**
      * \internal
      * Sets a bit in the bitset with local threading
-     * synchronization. vertex set must be made explicit. This call does not
-     * perform remote synchronization and addititional distributed
+     * synchronization. vertex set must be made explicit and dense. This call
+     * does not perform remote synchronization and addititional distributed
      * synchronization calls must be made to restore datastructure invariants.
      */
     inline void set_lvid(lvid_type lvid) {
       ASSERT_FALSE(lazy);
+      ASSERT_FALSE(sparse);
       localvset.set_bit(lvid);
     }
 
@@ -145,13 +188,95 @@ class vertex_set {
           localvset.clear();
         }
         lazy = false;
+        sparse = false;
       }
     }
 
+    /**
+     * \internal
+     * Converts the member list of a sparse set back to the bitset.
+     */
+    void make_dense() const {
+      if (lazy || !sparse) return;
+      localvset.resize(sparse_size);
+      localvset.clear();
+      foreach(lvid_type lvid, sparse_lvids) localvset.set_bit_unsync(lvid);
+      std::vector<lvid_type>().swap(sparse_lvids);
+      sparse = false;
+    }
+
+    /**
+     * \internal
+     * Converts the bitset of a dense set to a member list.
+     */
+    void make_sparse() const {
+      if (lazy || sparse) return;
+      std::vector<lvid_type> lvids;
+      lvids.reserve(localvset.popcount());
+      foreach(size_t lvid, localvset) lvids.push_back(lvid);
+      sparse_lvids.swap(lvids);
+      sparse_size = localvset.size();
+      localvset.resize(0);
+      sparse = true;
+    }
+
+    /**
+     * \internal
+     * Picks the representation matching the number of members.
+     */
+    void choose_representation() const {
+      if (lazy) return;
+      if (sparse) {
+        if (sparse_lvids.size() * DENSE_DENSITY > sparse_size) make_dense();
+      } else if (localvset.popcount() * SPARSE_DENSITY < localvset.size()) {
+        make_sparse();
+      }
+    }
+
+    /**
+     * \internal
+     * Replaces the contents of the set by the local vertices in lvids,
+     * which may be unsorted and contain duplicates. num_local_vertices is the
+     * number of local vertices of the graph.
+     */
+    void assign_lvids(std::vector<lvid_type>& lvids, size_t num_local_vertices) {
+      std::sort(lvids.begin(), lvids.end());
+      lvids.erase(std::unique(lvids.begin(), lvids.end()), lvids.end());
+      sparse_lvids.swap(lvids);
+      sparse_size = num_local_vertices;
+      localvset.resize(0);
+      lazy = false;
+      sparse = true;
+      choose_representation();
+    }
+
+    /**
+     * \internal
+     * Extends the set to num_local_vertices local vertices after vertices
+     * were added to the graph. The new vertices are not members.
+     */
+    void resize(size_t num_local_vertices) {
+      if (lazy) return;
+      if (sparse) sparse_size = num_local_vertices;
+      else localvset.resize(num_local_vertices);
+    }
+
+    /**
+     * \internal
+     * Returns true if no local vertex is in the set.
+     */
+    inline bool l_empty() const {
+      if (lazy) return !is_complete_set;
+      if (sparse) return sparse_lvids.empty();
+      return localvset.empty();
+    }
+
     /**
      * \internal
      * Copies the master state to each mirror.
      * Restores the datastructure invariants.
+     * Only the members are visited and sent, so a sparse set costs time
+     * proportional to its size.
      */
     template <typename DGraphType>
     void synchronize_master_to_mirrors(DGraphType& dgraph,
@@ -160,31 +285,40 @@ class vertex_set {
         make_explicit(dgraph);
         return;
       }
-      foreach(size_t lvid, localvset) {
-        typename DGraphType::local_vertex_type lvtx = dgraph.l_vertex(lvid);
-        if (lvtx.owned()) {
-          // send to mirrors
-          vertex_id_type gvid = lvtx.global_id();
-          foreach(size_t proc, lvtx.mirrors()) {
-            exchange.send(proc, gvid);
+      if (sparse) {
+        // keep the masters and send them to their mirrors
+        size_t nkept = 0;
+        for (size_t i = 0;i < sparse_lvids.size(); ++i) {
+          const lvid_type lvid = sparse_lvids[i];
+          typename DGraphType::local_vertex_type lvtx = dgraph.l_vertex(lvid);
+          if (lvtx.owned()) {
+            sparse_lvids[nkept++] = lvid;
+            vertex_id_type gvid = lvtx.global_id();
+            foreach(size_t proc, lvtx.mirrors()) {
+              exchange.send(proc, gvid);
+            }
           }
         }
-        else {
-          localvset.clear_bit_unsync(lvid);
+        sparse_lvids.resize(nkept);
+      } else {
+        foreach(size_t lvid, localvset) {
+          typename DGraphType::local_vertex_type lvtx = dgraph.l_vertex(lvid);
+          if (lvtx.owned()) {
+            // send to mirrors
+            vertex_id_type gvid = lvtx.global_id();
+            foreach(size_t proc, lvtx.mirrors()) {
+              exchange.send(proc, gvid);
+            }
+          }
+          else {
+            localvset.clear_bit_unsync(lvid);
+          }
         }
       }
       exchange.flush();
-
-      typename buffered_exchange<vertex_id_type>::buffer_type recv_buffer;
-      procid_t sending_proc;
-
-      while(exchange.recv(sending_proc, recv_buffer)) {
-        foreach(vertex_id_type gvid, recv_buffer) {
-          localvset.set_bit_unsync(dgraph.vertex(gvid).local_id());
-        }
-        recv_buffer.clear();
-      }
+      receive_lvids(dgraph, exchange);
       exchange.barrier();
+      choose_representation();
     }
 
 
@@ -199,26 +333,55 @@ class vertex_set {
         make_explicit(dgraph);
         return;
       }
-      foreach(size_t lvid, localvset) {
-        typename DGraphType::local_vertex_type lvtx = dgraph.l_vertex(lvid);
-        if (!lvtx.owned()) {
-          // send to master
-          vertex_id_type gvid = lvtx.global_id();
-          exchange.send(lvtx.owner(), gvid);
+      if (sparse) {
+        foreach(lvid_type lvid, sparse_lvids) {
+          typename DGraphType::local_vertex_type lvtx = dgraph.l_vertex(lvid);
+          if (!lvtx.owned()) {
+            exchange.send(lvtx.owner(), lvtx.global_id());
+          }
+        }
+      } else {
+        foreach(size_t lvid, localvset) {
+          typename DGraphType::local_vertex_type lvtx = dgraph.l_vertex(lvid);
+          if (!lvtx.owned()) {
+            // send to master
+            vertex_id_type gvid = lvtx.global_id();
+            exchange.send(lvtx.owner(), gvid);
+          }
         }
       }
       exchange.flush();
+      receive_lvids(dgraph, exchange);
+      exchange.barrier();
+      choose_representation();
+    }
 
-      typename buffered_exchange<vertex_id_type>::buffer_type recv_buffer;
+    /**
+     * \internal
+     * Adds the vertices received by the exchange to the set.
+     */
+    template <typename DGraphType>
+    void receive_lvids(DGraphType& dgraph,
+                       buffered_exchange<vertex_id_type>& exchange) {
+      array_ref<vertex_id_type> recv_buffer;
       procid_t sending_proc;
-
+      const size_t nsent = sparse ? sparse_lvids.size() : 0;
       while(exchange.recv(sending_proc, recv_buffer)) {
         foreach(vertex_id_type gvid, recv_buffer) {
-          localvset.set_bit_unsync(dgraph.vertex(gvid).local_id());
+          const lvid_type lvid = dgraph.vertex(gvid).local_id();
+          if (sparse) sparse_lvids.push_back(lvid);
+          else localvset.set_bit_unsync(lvid);
         }
-        recv_buffer.clear();
       }
-      exchange.barrier();
+      if (sparse && sparse_lvids.size() > nsent) {
+        // the kept members are sorted, the received ones are not
+        std::sort(sparse_lvids.begin() + nsent, sparse_lvids.end());
+        std::inplace_merge(sparse_lvids.begin(), sparse_lvids.begin() + nsent,
+                           sparse_lvids.end());
+        sparse_lvids.erase(std::unique(sparse_lvids.begin(),
+                                       sparse_lvids.end()),
+                           sparse_lvids.end());
+      }
     }
 
     template <typename VertexType, typename EdgeType>
@@ -226,26 +389,35 @@ class vertex_set {
 
   public:
     /// default constructor which constructs an empty set.
-    vertex_set():is_complete_set(false), lazy(true){}
+    vertex_set():sparse_size(0), is_complete_set(false), lazy(true),
+                 sparse(false){}
 
 
     /** Constructs a completely empty, or a completely full vertex set
      * \param complete If set to true, creates a set of all vertices.
      *                 If set to false, creates an empty set.
      */
-    explicit vertex_set(bool complete):is_complete_set(complete),lazy(true){}
+    explicit vertex_set(bool complete):sparse_size(0),
+                                       is_complete_set(complete),lazy(true),
+                                       sparse(false){}
 
     /// copy constructor
     inline vertex_set(const vertex_set& other):
         localvset(other.localvset),
+        sparse_lvids(other.sparse_lvids),
+        sparse_size(other.sparse_size),
         is_complete_set(other.is_complete_set),
-        lazy(other.lazy) {}
+        lazy(other.lazy),
+        sparse(other.sparse) {}
 
     /// copyable
     inline vertex_set& operator=(const vertex_set& other) {
       localvset = other.localvset;
+      sparse_lvids = other.sparse_lvids;
+      sparse_size = other.sparse_size;
       is_complete_set = other.is_complete_set;
       lazy = other.lazy;
+      sparse = other.sparse;
       return *this;
     }
 
@@ -255,6 +427,10 @@ class vertex_set {
      */
     inline bool l_contains(lvid_type lvid) const {
       if (lazy) return is_complete_set;
+      if (sparse) {
+        return std::binary_search(sparse_lvids.begin(), sparse_lvids.end(),
+                                  lvid);
+      }
       if (lvid < localvset.size()) {
         return localvset.get(lvid);
       }
@@ -337,6 +513,20 @@ class vertex_set {
         if (other.is_complete_set) /* no op */;
         else (*this) = vertex_set(false);
       }
+      else if (sparse) {
+        filter_lvids(other, true);
+      }
+      else if (other.sparse) {
+        // the intersection is at most as large as the sparse operand
+        std::vector<lvid_type> lvids;
+        foreach(lvid_type lvid, other.sparse_lvids) {
+          if (localvset.get(lvid)) lvids.push_back(lvid);
+        }
+        sparse_lvids.swap(lvids);
+        sparse_size = localvset.size();
+        localvset.resize(0);
+        sparse = true;
+      }
       else {
         localvset &= other.localvset;
       }
@@ -362,7 +552,22 @@ class vertex_set {
         if (other.is_complete_set) (*this) = vertex_set(true);
         else /* no op */;
       }
+      else if (sparse && other.sparse) {
+        std::vector<lvid_type> lvids;
+        lvids.reserve(sparse_lvids.size() + other.sparse_lvids.size());
+        std::set_union(sparse_lvids.begin(), sparse_lvids.end(),
+                       other.sparse_lvids.begin(), other.sparse_lvids.end(),
+                       std::back_inserter(lvids));
+        sparse_lvids.swap(lvids);
+        choose_representation();
+      }
+      else if (other.sparse) {
+        foreach(lvid_type lvid, other.sparse_lvids) {
+          localvset.set_bit_unsync(lvid);
+        }
+      }
       else {
+        make_dense();
         localvset |= other.localvset;
       }
       return *this;
@@ -392,6 +597,14 @@ class vertex_set {
         if (other.is_complete_set) (*this) = vertex_set(false);
         else /* no op */;
       }
+      else if (sparse) {
+        filter_lvids(other, false);
+      }
+      else if (other.sparse) {
+        foreach(lvid_type lvid, other.sparse_lvids) {
+          localvset.clear_bit_unsync(lvid);
+        }
+      }
       else {
         localvset -= other.localvset;
       }
@@ -425,10 +638,26 @@ class vertex_set {
         is_complete_set = !is_complete_set;
       }
       else {
+        make_dense();
         localvset.invert();
       }
     }
 
+  private:
+    /**
+     * Keeps the members of a sparse set which are (keep = true) or are not
+     * (keep = false) in other.
+     */
+    void filter_lvids(const vertex_set& other, bool keep) {
+      size_t nkept = 0;
+      for (size_t i = 0;i < sparse_lvids.size(); ++i) {
+        if (other.l_contains(sparse_lvids[i]) == keep) {
+          sparse_lvids[nkept++] = sparse_lvids[i];
+        }
+      }
+      sparse_lvids.resize(nkept);
+    }
+
 
 };
 
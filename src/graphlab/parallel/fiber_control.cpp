@@ -21,6 +21,7 @@
  */
 
 
+#include <unistd.h>
 #include <boost/bind.hpp>
 #include <graphlab/util/random.hpp>
 #include <graphlab/parallel/fiber_control.hpp>
@@ -35,6 +36,7 @@ bool fiber_control::instance_created = false;
 size_t fiber_control::instance_construct_params_nworkers = 0;
 size_t fiber_control::instance_construct_params_affinity_base = 0;
 pthread_key_t fiber_control::tlskey;
+struct sigaction fiber_control::prev_segv_action;
 
 fiber_control::affinity_type fiber_control::all_affinity() {
   affinity_type ret;
@@ -52,6 +54,13 @@ fiber_control::fiber_control(size_t nworkers,
   if (!tls_created) {
     pthread_key_create(&tlskey, fiber_control::tls_deleter);
     tls_created = true;
+    // catch overflows into the stack guard pages. The handler runs
+    // on the alternate signal stack of the worker.
+    struct sigaction act;
+    act.sa_sigaction = fiber_control::segv_handler;
+    act.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&act.sa_mask);
+    sigaction(SIGSEGV, &act, &prev_segv_action);
   }
 
   // set up the queues.
@@ -67,7 +76,7 @@ fiber_control::fiber_control(size_t nworkers,
   // launch the workers
   for (size_t i = 0;i < nworkers; ++i) {
     workers.launch(boost::bind(&fiber_control::worker_init, this, i), 
-                   affinity_base + i);
+                   numa::worker_cpu(i, nworkers, affinity_base));
   }
 }
 
@@ -89,6 +98,21 @@ fiber_control::~fiber_control() {
 }
 
 
+void fiber_control::segv_handler(int sig, siginfo_t* info, void* ucontext) {
+  tls* t = get_tls_ptr();
+  if (t != NULL && t->cur_fiber != NULL &&
+      t->parent->stack_pool.in_guard_page(t->cur_fiber->stack, info->si_addr)) {
+    const char msg[] = "Fiber stack overflow. "
+                       "Increase the stack size of the fiber.\n";
+    if (write(STDERR_FILENO, msg, sizeof(msg) - 1)) { }
+    signal(SIGSEGV, SIG_DFL);
+  } else {
+    sigaction(SIGSEGV, &prev_segv_action, NULL);
+  }
+  // returning retries the faulting instruction under
+  // the restored handler
+}
+
 void fiber_control::tls_deleter(void* f) {
   fiber_control::tls* t = (fiber_control::tls*)(f);
   delete t;
@@ -211,6 +235,14 @@ void fiber_control::worker_init(size_t workerid) {
   t->workerid = workerid;
   t->parent = this;
 
+  // alternate signal stack for the guard page handler, since the
+  // faulting stack cannot be used.
+  stack_t altstack;
+  altstack.ss_size = 65536;
+  altstack.ss_sp = malloc(altstack.ss_size);
+  altstack.ss_flags = 0;
+  sigaltstack(&altstack, NULL);
+
   schedule[workerid].waiting = true;
   schedule[workerid].active_lock.lock();
   while(!stop_workers) {
@@ -237,6 +269,10 @@ void fiber_control::worker_init(size_t workerid) {
     }
   }
   schedule[workerid].active_lock.unlock();
+
+  altstack.ss_flags = SS_DISABLE;
+  sigaltstack(&altstack, NULL);
+  free(altstack.ss_sp);
 }
 
 struct trampoline_args {
@@ -272,7 +308,8 @@ size_t fiber_control::launch(boost::function<void(void)> fn,
   // allocate a stack
   fiber* fib = new fiber;
   fib->parent = this;
-  fib->stack = malloc(stacksize);
+  fib->stack = stack_pool.allocate(stacksize);
+  fib->stacksize = stacksize;
   fib->id = fiber_id_counter.inc();
   foreach(size_t b, affinity) {
     if (b < nworkers) fib->affinity_array.push_back((unsigned char)b);
@@ -404,7 +441,7 @@ void fiber_control::reschedule_fiber(size_t workerid, fiber* fib) {
   } else if (fib->terminate) {
     fib->lock.unlock();
     // previous fiber is dead. destroy it
-    free(fib->stack);
+    stack_pool.release(fib->stack, fib->stacksize);
     //VALGRIND_STACK_DEREGISTER(fib->stack);
     // delete the fiber local storage if any
     if (fib->fls && flsdeleter) flsdeleter(fib->fls);
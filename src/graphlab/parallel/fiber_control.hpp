@@ -26,6 +26,7 @@
 
 #include <stdint.h>
 #include <cstdlib>
+#include <signal.h>
 #include <boost/context/all.hpp>
 #include <boost/function.hpp>
 #include <boost/lockfree/queue.hpp>
@@ -33,6 +34,8 @@
 #include <graphlab/util/inplace_lf_queue2.hpp>
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/parallel/atomic.hpp>
+#include <graphlab/parallel/fiber_stack_pool.hpp>
+#include <graphlab/parallel/numa_tools.hpp>
 namespace graphlab {
 
 /**
@@ -48,7 +51,8 @@ class fiber_control {
     simple_spinlock lock;
     fiber_control* parent;
     boost::context::fcontext_t* context;
-    void* stack;
+    char* stack;      // lowest usable address of the stack
+    size_t stacksize; // page rounded size of the stack
     size_t id;
     affinity_type affinity;
     std::vector<unsigned char> affinity_array;
@@ -87,6 +91,9 @@ class fiber_control {
 
   bool stop_workers;
 
+  /// Recycles fiber stacks and provides the guard pages
+  fiber_stack_pool stack_pool;
+
   // The scheduler is a simple queue. One for each worker
   struct thread_schedule {
     thread_schedule():waiting(false) { }
@@ -146,6 +153,11 @@ class fiber_control {
 
   size_t pick_fiber_worker(fiber* fib);
 
+  /// The SIGSEGV handler installed before the fiber handler
+  static struct sigaction prev_segv_action;
+  /// Reports faults on the stack guard page of the active fiber
+  static void segv_handler(int sig, siginfo_t* info, void* ucontext);
+
   // delete copy constructor
   fiber_control(fiber_control&) {};
   
@@ -178,6 +190,15 @@ class fiber_control {
     return nworkers;
   }
 
+  /**
+   * Returns the NUMA node the worker is pinned to.
+   * See numa::worker_cpu()
+   */
+  size_t worker_numa_node(size_t workerid) const {
+    return numa::node_of_cpu(numa::worker_cpu(workerid, nworkers,
+                                              affinity_base));
+  }
+
   /**
    * Returns the number of threads that have yet to join
    */
@@ -191,6 +212,23 @@ class fiber_control {
   inline size_t total_threads_created() {
     return fiber_id_counter.value;
   }
+
+  /**
+   * Returns statistics about the fiber stacks. In particular,
+   * max_stack_usage is the largest amount of stack used by any fiber
+   * which terminated since the last call to reset_stack_usage().
+   */
+  inline fiber_stack_pool::statistics get_stack_statistics() {
+    return stack_pool.get_statistics();
+  }
+
+  /**
+   * Resets the stack usage high-water mark returned by
+   * get_stack_statistics().
+   */
+  inline void reset_stack_usage() {
+    stack_pool.reset_max_stack_usage();
+  }
   /**
    * Sets the TLS deletion function. The deletion function will be called
    * on every non-NULL TLS value.
@@ -261,7 +299,10 @@ class fiber_control {
    *                 based on the number of cores the system has.
    * \param affinity_base First worker will have CPU affinity equal to 
    *                      affinity_base. Second will be affinity_base + 1, etc.
-   *                      Defaults to 0.
+   *                      Defaults to 0. On NUMA machines, the workers
+   *                      are instead spread across the nodes
+   *                      (see numa::worker_cpu()) and affinity_base is an
+   *                      offset within each node.
    */
   static void instance_set_parameters(size_t nworkers,
                                       size_t affinity_base);
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <graphlab/parallel/fiber_stack_pool.hpp>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/macros_def.hpp>
+
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+namespace graphlab {
+
+fiber_stack_pool::fiber_stack_pool()
+    : pagesize(sysconf(_SC_PAGESIZE)),
+      max_cached_stacks(16384),
+      large_threshold(256 * 1024),
+      track_usage(true) { }
+
+fiber_stack_pool::~fiber_stack_pool() {
+  typedef std::map<size_t, std::vector<char*> >::value_type list_type;
+  foreach(list_type& list, free_stacks) {
+    foreach(char* stack, list.second) {
+      munmap(stack - pagesize, list.first + pagesize);
+    }
+  }
+}
+
+char* fiber_stack_pool::allocate(size_t& stacksize) {
+  stacksize = std::max(stacksize, pagesize);
+  stacksize = (stacksize + pagesize - 1) / pagesize * pagesize;
+  lock.lock();
+  std::map<size_t, std::vector<char*> >::iterator iter =
+      free_stacks.find(stacksize);
+  if (iter != free_stacks.end() && !iter->second.empty()) {
+    char* stack = iter->second.back();
+    iter->second.pop_back();
+    --stats.stacks_cached;
+    ++stats.stacks_reused;
+    lock.unlock();
+    return stack;
+  }
+  ++stats.stacks_mapped;
+  lock.unlock();
+
+  // map the stack together with the guard page below it.
+  void* base = mmap(NULL, stacksize + pagesize, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base == MAP_FAILED) {
+    logstream(LOG_FATAL) << "Unable to map a fiber stack of "
+                         << stacksize << " bytes" << std::endl;
+  }
+  // mprotect splits the mapping and may fail if we run out of
+  // memory maps (vm.max_map_count). The stack is still usable.
+  if (mprotect(base, pagesize, PROT_NONE) != 0) {
+    lock.lock();
+    if (stats.stacks_unguarded++ == 0) {
+      logstream(LOG_WARNING) << "Unable to install fiber stack guard pages. "
+                             << "Stack overflows will not be detected."
+                             << std::endl;
+    }
+    lock.unlock();
+  }
+  return (char*)base + pagesize;
+}
+
+size_t fiber_stack_pool::resident_usage(char* stack, size_t stacksize) const {
+  const size_t npages = stacksize / pagesize;
+  unsigned char small_vec[64];
+  std::vector<unsigned char> large_vec;
+  unsigned char* vec = small_vec;
+  if (npages > 64) {
+    large_vec.resize(npages);
+    vec = &(large_vec[0]);
+  }
+  if (mincore(stack, stacksize, vec) != 0) return 0;
+  // the stack grows down. The lowest resident page is the deepest
+  // point the stack ever reached.
+  for (size_t i = 0;i < npages; ++i) {
+    if (vec[i] & 1) return (npages - i) * pagesize;
+  }
+  return 0;
+}
+
+void fiber_stack_pool::release(char* stack, size_t stacksize) {
+  size_t usage = 0;
+  if (track_usage) usage = resident_usage(stack, stacksize);
+
+  if (stacksize > large_threshold) {
+    // return all but the topmost page to the OS. They will be
+    // lazily committed again on the next use.
+    madvise(stack, stacksize - pagesize, MADV_DONTNEED);
+  }
+
+  lock.lock();
+  stats.max_stack_usage = std::max(stats.max_stack_usage, usage);
+  if (stats.stacks_cached < max_cached_stacks) {
+    free_stacks[stacksize].push_back(stack);
+    ++stats.stacks_cached;
+    lock.unlock();
+  } else {
+    lock.unlock();
+    munmap(stack - pagesize, stacksize + pagesize);
+  }
+}
+
+fiber_stack_pool::statistics fiber_stack_pool::get_statistics() {
+  lock.lock();
+  statistics ret = stats;
+  lock.unlock();
+  return ret;
+}
+
+void fiber_stack_pool::reset_max_stack_usage() {
+  lock.lock();
+  stats.max_stack_usage = 0;
+  lock.unlock();
+}
+
+} // namespace graphlab
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_FIBER_STACK_POOL_HPP
+#define GRAPHLAB_FIBER_STACK_POOL_HPP
+#include <cstddef>
+#include <map>
+#include <vector>
+#include <graphlab/parallel/pthread_tools.hpp>
+namespace graphlab {
+
+/**
+ * Allocates and recycles fiber stacks.
+ *
+ * Every stack is its own anonymous mmap region, so pages are only
+ * committed when the fiber actually touches them, and large stacks cost
+ * only address space. The lowest page of every stack is a PROT_NONE guard
+ * page: a fiber which overflows its stack faults immediately instead of
+ * silently corrupting the neighboring allocation.
+ *
+ * Released stacks are kept on a free list (keyed by size) and handed
+ * out again on the next allocation, avoiding the mmap/mprotect
+ * system calls on fiber launch. Released stacks larger than
+ * large_stack_threshold() have their pages returned to the OS
+ * (except for the topmost page) before being cached.
+ *
+ * The pool optionally tracks the stack usage high-water mark by looking
+ * up the resident pages of a stack when it is released.
+ */
+class fiber_stack_pool {
+ public:
+  struct statistics {
+    /// Number of stacks mapped from the OS
+    size_t stacks_mapped;
+    /// Number of allocations satisfied from the free list
+    size_t stacks_reused;
+    /// Number of stacks currently on the free list
+    size_t stacks_cached;
+    /// Number of stacks for which the guard page could not be installed
+    size_t stacks_unguarded;
+    /// Largest stack usage (in bytes) observed since the last reset
+    size_t max_stack_usage;
+    statistics(): stacks_mapped(0), stacks_reused(0), stacks_cached(0),
+                  stacks_unguarded(0), max_stack_usage(0) { }
+  };
+
+ private:
+  simple_spinlock lock;
+  std::map<size_t, std::vector<char*> > free_stacks;
+  statistics stats;
+  size_t pagesize;
+  size_t max_cached_stacks;
+  size_t large_threshold;
+  bool track_usage;
+
+  // not copyable
+  fiber_stack_pool(const fiber_stack_pool&);
+  void operator=(const fiber_stack_pool&);
+
+  /// Returns the number of bytes of the stack which have been touched
+  size_t resident_usage(char* stack, size_t stacksize) const;
+
+ public:
+  fiber_stack_pool();
+
+  /// Unmaps all cached stacks
+  ~fiber_stack_pool();
+
+  /**
+   * Returns a stack of at least stacksize bytes. stacksize is
+   * rounded up to a multiple of the page size, and the rounded size is
+   * returned. The returned pointer is the lowest usable address of
+   * the stack. The stack grows down from stack + stacksize.
+   */
+  char* allocate(size_t& stacksize);
+
+  /**
+   * Returns a stack obtained by allocate() to the pool.
+   * stacksize must be the rounded size returned by allocate().
+   */
+  void release(char* stack, size_t stacksize);
+
+  /**
+   * Returns true if addr falls in the guard page of the stack
+   * beginning at stack.
+   */
+  bool in_guard_page(const char* stack, const void* addr) const {
+    return (const char*)addr < stack && (const char*)addr >= stack - pagesize;
+  }
+
+  /// Returns a copy of the pool statistics
+  statistics get_statistics();
+
+  /// Resets the stack usage high-water mark
+  void reset_max_stack_usage();
+
+  /// Enables or disables stack usage tracking. Defaults to enabled.
+  void set_track_usage(bool track) { track_usage = track; }
+
+  /**
+   * Sets the maximum number of stacks on the free list.
+   * Stacks released beyond this limit are unmapped. Defaults to 16384.
+   */
+  void set_max_cached_stacks(size_t n) { max_cached_stacks = n; }
+
+  /// Returns the size above which cached stacks are decommitted
+  size_t large_stack_threshold() const { return large_threshold; }
+};
+
+} // namespace graphlab
+#endif
@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <boost/bind.hpp>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#include <graphlab/parallel/numa_tools.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/logger/assertions.hpp>
+
+namespace graphlab {
+namespace numa {
+
+namespace {
+
+struct topology {
+  /// The OS node id of each node
+  std::vector<size_t> node_ids;
+  /// The CPUs of each node
+  std::vector<std::vector<size_t> > cpus;
+  /// The node of each CPU
+  std::vector<size_t> cpu_node;
+  /// Number of CPUs before each node. Has num_nodes() + 1 entries.
+  std::vector<size_t> cpu_prefix;
+
+  /// Parses a sysfs list such as "0-3,8-11"
+  static std::vector<size_t> parse_list(const std::string& str) {
+    std::vector<size_t> ret;
+    const char* c = str.c_str();
+    while(*c) {
+      char* end;
+      size_t lo = strtoul(c, &end, 10);
+      if (end == c) break;
+      size_t hi = lo;
+      c = end;
+      if (*c == '-') {
+        hi = strtoul(c + 1, &end, 10);
+        c = end;
+      }
+      for (size_t i = lo; i <= hi; ++i) ret.push_back(i);
+      if (*c == ',') ++c;
+      else break;
+    }
+    return ret;
+  }
+
+  static bool read_line(const std::string& fname, std::string& line) {
+    std::ifstream fin(fname.c_str());
+    return fin.good() && std::getline(fin, line);
+  }
+
+  topology() {
+#ifdef __linux__
+    std::string line;
+    if (read_line("/sys/devices/system/node/online", line)) {
+      std::vector<size_t> online = parse_list(line);
+      for (size_t i = 0;i < online.size(); ++i) {
+        char fname[128];
+        sprintf(fname, "/sys/devices/system/node/node%lu/cpulist",
+                (unsigned long)online[i]);
+        if (!read_line(fname, line)) continue;
+        std::vector<size_t> c = parse_list(line);
+        if (c.empty()) continue;
+        node_ids.push_back(online[i]);
+        cpus.push_back(c);
+      }
+    }
+#endif
+    if (cpus.size() <= 1) {
+      // single node: all CPUs in order
+      node_ids.assign(1, 0);
+      cpus.assign(1, std::vector<size_t>());
+      for (size_t i = 0;i < thread::cpu_count(); ++i) cpus[0].push_back(i);
+    }
+    cpu_prefix.push_back(0);
+    for (size_t i = 0;i < cpus.size(); ++i) {
+      cpu_prefix.push_back(cpu_prefix.back() + cpus[i].size());
+      for (size_t j = 0;j < cpus[i].size(); ++j) {
+        if (cpus[i][j] >= cpu_node.size()) cpu_node.resize(cpus[i][j] + 1, 0);
+        cpu_node[cpus[i][j]] = i;
+      }
+    }
+  }
+};
+
+const topology& get_topology() {
+  static topology topo;
+  return topo;
+}
+
+size_t pagesize() {
+  static size_t ps = sysconf(_SC_PAGESIZE);
+  return ps;
+}
+
+/**
+ * Returns the [begin, end) byte range of the array owned by a node.
+ * Boundaries are rounded down to pages.
+ */
+void node_byte_range(char* ptr, size_t nbytes, size_t node,
+                     size_t elem_begin, size_t elem_end, size_t elemsize,
+                     char*& begin, char*& end) {
+  const size_t ps = pagesize();
+  const size_t base = size_t(ptr);
+  size_t b = base + elem_begin * elemsize;
+  size_t e = base + elem_end * elemsize;
+  b = (node == 0) ? base / ps * ps : b / ps * ps;
+  e = (node + 1 == num_nodes()) ? (base + nbytes + ps - 1) / ps * ps
+                                : e / ps * ps;
+  begin = (char*)b;
+  end = (char*)(std::max(b, e));
+}
+
+void touch_pages(char* begin, char* end) {
+  const size_t ps = pagesize();
+  for (char* c = begin; c < end; c += ps) *(volatile char*)c = 0;
+}
+
+} // anonymous namespace
+
+
+size_t num_nodes() {
+  return get_topology().cpus.size();
+}
+
+size_t node_of_cpu(size_t cpu) {
+  const topology& topo = get_topology();
+  return cpu < topo.cpu_node.size() ? topo.cpu_node[cpu] : 0;
+}
+
+const std::vector<size_t>& node_cpus(size_t node) {
+  return get_topology().cpus[node];
+}
+
+size_t worker_cpu(size_t worker, size_t nworkers, size_t affinity_base) {
+  const topology& topo = get_topology();
+  if (topo.cpus.size() <= 1) return affinity_base + worker;
+  const size_t ncpus = topo.cpu_prefix.back();
+  if (nworkers >= ncpus) {
+    // at least one worker per CPU. Walk the CPUs node by node.
+    size_t c = (affinity_base + worker) % ncpus;
+    size_t node = std::upper_bound(topo.cpu_prefix.begin(),
+                                   topo.cpu_prefix.end(), c)
+        - topo.cpu_prefix.begin() - 1;
+    return topo.cpus[node][c - topo.cpu_prefix[node]];
+  }
+  // node i gets workers [nworkers * prefix[i] / ncpus,
+  //                      nworkers * prefix[i + 1] / ncpus)
+  size_t node = 0;
+  while (node + 1 < topo.cpus.size() &&
+         worker >= nworkers * topo.cpu_prefix[node + 1] / ncpus) ++node;
+  const size_t local = worker - nworkers * topo.cpu_prefix[node] / ncpus;
+  const std::vector<size_t>& c = topo.cpus[node];
+  return c[(affinity_base + local) % c.size()];
+}
+
+size_t node_range_begin(size_t node, size_t n, size_t align) {
+  const topology& topo = get_topology();
+  if (node == 0) return 0;
+  if (node >= topo.cpus.size()) return n;
+  double frac = double(topo.cpu_prefix[node]) / topo.cpu_prefix.back();
+  size_t b = size_t(frac * n);
+  b = (b + align - 1) / align * align;
+  return std::min(b, n);
+}
+
+void* alloc_partitioned(size_t nelem, size_t elemsize) {
+  const size_t nbytes = nelem * elemsize;
+  void* ptr = mmap(NULL, nbytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED) throw std::bad_alloc();
+  const size_t nnodes = num_nodes();
+  if (nnodes <= 1) return ptr;
+  // touch the pages of every node range from a thread on the node.
+  // The fresh mapping guarantees the pages have not been touched before.
+  thread_group group;
+  for (size_t i = 0;i < nnodes; ++i) {
+    char *begin, *end;
+    node_byte_range((char*)ptr, nbytes, i,
+                    node_range_begin(i, nelem), node_range_begin(i + 1, nelem),
+                    elemsize, begin, end);
+    if (begin >= end) continue;
+    group.launch(boost::bind(touch_pages, begin, end), node_cpus(i)[0]);
+  }
+  group.join();
+  return ptr;
+}
+
+void free_partitioned(void* ptr, size_t nelem, size_t elemsize) {
+  munmap(ptr, nelem * elemsize);
+}
+
+void distribute(void* ptr, size_t nelem, size_t elemsize,
+                const size_t* offsets, size_t nkeys) {
+  const size_t nnodes = num_nodes();
+  if (nnodes <= 1 || nelem == 0) return;
+#if defined(__linux__) && defined(SYS_mbind)
+  // constants from linux/mempolicy.h
+  const int MPOL_PREFERRED_ = 1;
+  const unsigned MPOL_MF_MOVE_ = (1 << 1);
+  const topology& topo = get_topology();
+  const size_t nbytes = nelem * elemsize;
+  static bool warned = false;
+  for (size_t i = 0;i < nnodes; ++i) {
+    size_t elem_begin, elem_end;
+    if (offsets) {
+      const size_t key_begin = node_range_begin(i, nkeys);
+      const size_t key_end = node_range_begin(i + 1, nkeys);
+      elem_begin = key_begin < nkeys ? offsets[key_begin] : nelem;
+      elem_end = key_end < nkeys ? offsets[key_end] : nelem;
+    } else {
+      elem_begin = node_range_begin(i, nelem);
+      elem_end = node_range_begin(i + 1, nelem);
+    }
+    char *begin, *end;
+    node_byte_range((char*)ptr, nbytes, i, elem_begin, elem_end, elemsize,
+                    begin, end);
+    if (begin >= end) continue;
+    unsigned long mask[16];
+    memset(mask, 0, sizeof(mask));
+    const size_t id = topo.node_ids[i];
+    if (id >= sizeof(mask) * 8) continue;
+    mask[id / (8 * sizeof(unsigned long))] |=
+        1UL << (id % (8 * sizeof(unsigned long)));
+    if (syscall(SYS_mbind, begin, end - begin, MPOL_PREFERRED_,
+                mask, sizeof(mask) * 8, MPOL_MF_MOVE_) != 0 && !warned) {
+      warned = true;
+      logstream(LOG_WARNING) << "Unable to migrate pages across NUMA nodes: "
+                             << strerror(errno) << std::endl;
+    }
+  }
+#endif
+}
+
+} // namespace numa
+
+
+void numa_block_counter::reset(size_t n, size_t blocksize) {
+  this->n = n;
+  this->blocksize = blocksize;
+  const size_t nnodes = numa::num_nodes();
+  ranges.resize(nnodes);
+  for (size_t i = 0;i < nnodes; ++i) {
+    ranges[i].next = numa::node_range_begin(i, n, blocksize);
+    ranges[i].end = numa::node_range_begin(i + 1, n, blocksize);
+  }
+}
+
+} // namespace graphlab
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_NUMA_TOOLS_HPP
+#define GRAPHLAB_NUMA_TOOLS_HPP
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <limits>
+#include <graphlab/parallel/atomic.hpp>
+
+namespace graphlab {
+
+/**
+ * \internal
+ *
+ * Minimal NUMA support which does not depend on libnuma.
+ *
+ * The topology is read from /sys/devices/system/node. Nodes without
+ * CPUs are ignored and the remaining nodes are numbered 0 .. num_nodes()-1.
+ * On machines with a single node (or if the topology cannot be read),
+ * all functions degrade to no-ops.
+ *
+ * An index range [0, n) (typically the local vertex ids) is split into one
+ * contiguous range per node, proportionally to the number of CPUs of the
+ * node (see node_range_begin()). Threads placed with worker_cpu() are spread
+ * across the nodes in the same proportion, so that the workers of a
+ * node can process the indices of its range out of node-local memory.
+ */
+namespace numa {
+
+  /// Returns the number of NUMA nodes with at least one CPU
+  size_t num_nodes();
+
+  /// Returns the node of a CPU. Unknown CPUs are on node 0.
+  size_t node_of_cpu(size_t cpu);
+
+  /// Returns the CPUs of a node
+  const std::vector<size_t>& node_cpus(size_t node);
+
+  /**
+   * Returns the CPU worker thread "worker" out of "nworkers" should be
+   * pinned to. Workers are split among the nodes proportionally to the
+   * number of CPUs of each node, with consecutive workers on the same node.
+   * On a single node machine this is affinity_base + worker.
+   */
+  size_t worker_cpu(size_t worker, size_t nworkers, size_t affinity_base = 0);
+
+  /**
+   * Returns the first index of the range of [0, n) owned by the node.
+   * Boundaries are rounded up to a multiple of align.
+   * node_range_begin(num_nodes(), n, align) == n.
+   */
+  size_t node_range_begin(size_t node, size_t n, size_t align = 64);
+
+  /**
+   * Maps an array of nelem elements of size elemsize and places the pages
+   * of each node's range (see node_range_begin()) on that node by touching
+   * them from a thread pinned to the node.
+   * Must be freed with free_partitioned().
+   */
+  void* alloc_partitioned(size_t nelem, size_t elemsize);
+
+  /// Frees an array allocated by alloc_partitioned()
+  void free_partitioned(void* ptr, size_t nelem, size_t elemsize);
+
+  /**
+   * Migrates the pages of an existing array such that the elements of each
+   * node's range reside on that node. If offsets is not NULL, the array is
+   * the value array of a CSR structure with nkeys keys, and the range of
+   * a node is the values of its range of keys
+   * (offsets[node_range_begin(node, nkeys)] onwards).
+   * Pages straddling two ranges are placed on the higher node.
+   */
+  void distribute(void* ptr, size_t nelem, size_t elemsize,
+                  const size_t* offsets = NULL, size_t nkeys = 0);
+
+  /**
+   * Convenience wrapper around distribute() for a vector.
+   */
+  template <typename T, typename Alloc>
+  void distribute(std::vector<T, Alloc>& vec) {
+    if (!vec.empty()) distribute(&(vec[0]), vec.size(), sizeof(T));
+  }
+
+  /**
+   * Convenience wrapper around distribute() for the value array
+   * of a CSR structure over nkeys keys. offsets[k] is the position of the
+   * first value of key k. offsets may be shorter than nkeys, in which case
+   * the missing keys have no values.
+   */
+  template <typename T, typename Alloc, typename SizeType>
+  void distribute(std::vector<T, Alloc>& vec,
+                  const std::vector<SizeType>& offsets, size_t nkeys) {
+    if (vec.empty() || nkeys == 0 || num_nodes() <= 1) return;
+    std::vector<size_t> off(offsets.begin(), offsets.end());
+    off.resize(nkeys, vec.size());
+    distribute(&(vec[0]), vec.size(), sizeof(T), &(off[0]), nkeys);
+  }
+
+  /// std::vector<bool> is not an array. Left in place.
+  template <typename Alloc>
+  void distribute(std::vector<bool, Alloc>&) { }
+
+  template <typename Alloc, typename SizeType>
+  void distribute(std::vector<bool, Alloc>&,
+                  const std::vector<SizeType>&, size_t) { }
+
+  /**
+   * Arrays smaller than this (in bytes) are allocated normally by
+   * numa_allocator.
+   */
+  static const size_t PARTITION_THRESHOLD = 4 * 1024 * 1024;
+
+} // namespace numa
+
+
+/**
+ * \internal
+ *
+ * An STL allocator which places large arrays across the NUMA nodes
+ * using numa::alloc_partitioned(): element i is placed on the node whose
+ * range contains i. Small arrays, and all arrays on single node machines
+ * are allocated with operator new.
+ */
+template <typename T>
+class numa_allocator {
+ public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+  template <typename U> struct rebind { typedef numa_allocator<U> other; };
+
+  numa_allocator() { }
+  template <typename U> numa_allocator(const numa_allocator<U>&) { }
+
+  pointer address(reference x) const { return &x; }
+  const_pointer address(const_reference x) const { return &x; }
+
+  size_type max_size() const {
+    return std::numeric_limits<size_type>::max() / sizeof(T);
+  }
+
+  pointer allocate(size_type n, const void* = 0) {
+    if (use_partitioned(n)) {
+      return static_cast<pointer>(numa::alloc_partitioned(n, sizeof(T)));
+    }
+    return static_cast<pointer>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(pointer p, size_type n) {
+    if (use_partitioned(n)) numa::free_partitioned(p, n, sizeof(T));
+    else ::operator delete(p);
+  }
+
+  void construct(pointer p, const T& val) { new(p) T(val); }
+  void destroy(pointer p) { p->~T(); }
+
+  bool operator==(const numa_allocator&) const { return true; }
+  bool operator!=(const numa_allocator&) const { return false; }
+
+ private:
+  static bool use_partitioned(size_type n) {
+    return n * sizeof(T) >= numa::PARTITION_THRESHOLD &&
+        numa::num_nodes() > 1;
+  }
+};
+
+
+/**
+ * \internal
+ *
+ * Hands out blocks of an index range [0, n) to threads, giving each
+ * thread the blocks of its own node's range (see numa::node_range_begin())
+ * first. Once the range of its node is exhausted, a thread steals blocks
+ * from the ranges of the other nodes.
+ *
+ * \code
+ * counter.reset(n, 64);
+ * // in every thread
+ * while(1) {
+ *   size_t begin = counter.next(node);
+ *   if (begin >= n) break;
+ *   ...
+ * }
+ * \endcode
+ */
+class numa_block_counter {
+  struct range_type {
+    atomic<size_t> next;
+    size_t end;
+    char pad[64 - sizeof(atomic<size_t>) - sizeof(size_t)];
+  };
+  std::vector<range_type> ranges;
+  size_t blocksize;
+  size_t n;
+
+ public:
+  numa_block_counter(): blocksize(1), n(0) { }
+
+  /**
+   * Resets the counter to hand out blocks of size blocksize over [0, n).
+   * Must not be called concurrently with next().
+   */
+  void reset(size_t n, size_t blocksize);
+
+  /**
+   * Returns the start of the next block, or a value >= n if all blocks have
+   * been handed out.
+   */
+  inline size_t next(size_t node) {
+    const size_t nranges = ranges.size();
+    if (node >= nranges) node = 0;
+    for (size_t i = 0;i < nranges; ++i) {
+      range_type& r = ranges[node];
+      if (r.next.value < r.end) {
+        size_t ret = r.next.inc_ret_last(blocksize);
+        if (ret < r.end) return ret;
+      }
+      if (++node == nranges) node = 0;
+    }
+    return n;
+  }
+};
+
+} // namespace graphlab
+#endif
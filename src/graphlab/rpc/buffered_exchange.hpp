@@ -24,10 +24,14 @@
 #ifndef GRAPHLAB_BUFFERED_EXCHANGE_HPP
 #define GRAPHLAB_BUFFERED_EXCHANGE_HPP
 
+#include <cstring>
+#include <boost/type_traits/alignment_of.hpp>
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/parallel/fiber_control.hpp>
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/rpc/dc_dist_object.hpp>
+#include <graphlab/rpc/exchange_compression.hpp>
+#include <graphlab/serialization/array_ref.hpp>
 #include <graphlab/util/mpi_tools.hpp>
 
 
@@ -63,6 +67,18 @@ namespace graphlab {
    * \note The buffered exchange sends data in the background, so recv can be
    * called even before the flush calls.
    *
+   * Buffers can be compressed before they are sent, by passing an
+   * \ref exchange_compression_type to the constructor or to
+   * set_compression(). This pays off for large exchanges of vertex ids and
+   * small POD payloads on bandwidth bound clusters.
+   *
+   * Buffers of POD values are kept in the RPC receive buffer they arrived
+   * in, and can be received without copying as an \ref array_ref:
+   * \code
+   *    graphlab::array_ref<int> values;
+   *    while(exchange.recv(proc, values)) { ... }
+   * \endcode
+   *
    * \see graphlab::fiber_buffered_exchange
    */
   template<typename T>
@@ -74,7 +90,11 @@ namespace graphlab {
     struct buffer_record {
       procid_t proc;
       buffer_type buffer;
-      buffer_record() : proc(-1)  { }
+      /// if is_view, the values are in view rather than in buffer
+      array_ref<T> view;
+      bool is_view;
+      buffer_record() : proc(-1), is_view(false)  { }
+      size_t size() const { return is_view ? view.size() : buffer.size(); }
     }; // end of buffer record
 
 
@@ -96,6 +116,10 @@ namespace graphlab {
     const size_t num_threads;
     const size_t max_buffer_size;
 
+    dc_impl::exchange_compressor compressor;
+    /// the offset of the first value in every send buffer
+    size_t payload_offset;
+
 
     // typedef boost::function<void (const T& tref)> handler_type;
     // handler_type recv_handler;
@@ -111,15 +135,19 @@ namespace graphlab {
      *                  the exchange process, but there are performance / contention
      *                  advantages if this matches.
      * \ref max_buffer_size The size of the per thread and per target send buffer.
+     * \ref compression The compression applied to the send buffers.
      */
     buffered_exchange(distributed_control& dc,
                       const size_t num_threads = 1,
-                      const size_t max_buffer_size = DEFAULT_BUFFERED_EXCHANGE_SIZE) :
+                      const size_t max_buffer_size = DEFAULT_BUFFERED_EXCHANGE_SIZE,
+                      exchange_compression_type compression =
+                          EXCHANGE_COMPRESSION_NONE) :
       rpc(dc, this),
       send_buffers(num_threads *  dc.numprocs()),
       send_locks(num_threads *  dc.numprocs()),
       num_threads(num_threads),
-      max_buffer_size(max_buffer_size) {
+      max_buffer_size(max_buffer_size),
+      compressor(compression) {
        //
        for (size_t i = 0;i < send_buffers.size(); ++i) {
          // initialize the split call
@@ -127,6 +155,7 @@ namespace graphlab {
          send_buffers[i].numinserts = 0;
          // begin by writing the src proc.
          (*(send_buffers[i].oarc)) << rpc.procid();
+         payload_offset = send_buffers[i].oarc->off;
        }
        rpc.barrier();
       }
@@ -155,14 +184,18 @@ namespace graphlab {
       ASSERT_LT(index, send_locks.size());
       send_locks[index].lock();
 
-      (*(send_buffers[index].oarc)) << value;
+      oarchive& oarc = *(send_buffers[index].oarc);
+      // POD values are written as is, so that they can be received in place
+      if (gl_is_pod_or_scaler<T>::value) serialize(oarc, &value, sizeof(T));
+      else oarc << value;
       ++send_buffers[index].numinserts;
 
       if(send_buffers[index].oarc->off >= max_buffer_size) {
-        oarchive* prevarc = swap_buffer(index);
+        size_t numinserts = 0;
+        oarchive* prevarc = swap_buffer(index, numinserts);
         send_locks[index].unlock();
         // complete the send
-        rpc.split_call_end(proc, prevarc);
+        send_buffer(proc, prevarc, numinserts);
       } else {
         send_locks[index].unlock();
       }
@@ -176,11 +209,12 @@ namespace graphlab {
         const size_t index = thread_id * rpc.numprocs() + proc;
         ASSERT_LT(proc, rpc.numprocs());
         if (send_buffers[index].numinserts > 0) {
+          size_t numinserts = 0;
           send_locks[index].lock();
-          oarchive* prevarc = swap_buffer(index);
+          oarchive* prevarc = swap_buffer(index, numinserts);
           send_locks[index].unlock();
           // complete the send
-          rpc.split_call_end(proc, prevarc);
+          send_buffer(proc, prevarc, numinserts);
           rpc.dc().flush_soon(proc);
         }
       }
@@ -196,9 +230,10 @@ namespace graphlab {
         ASSERT_LT(proc, rpc.numprocs());
         send_locks[i].lock();
         if (send_buffers[i].numinserts > 0) {
-          oarchive* prevarc = swap_buffer(i);
+          size_t numinserts = 0;
+          oarchive* prevarc = swap_buffer(i, numinserts);
           // complete the send
-          rpc.split_call_end(proc, prevarc);
+          send_buffer(proc, prevarc, numinserts);
         }
         send_locks[i].unlock();
       }
@@ -240,7 +275,8 @@ namespace graphlab {
           buffer_record& rec =  recv_buffers.front();
           // read the record
           ret_proc = rec.proc;
-          ret_buffer.swap(rec.buffer);
+          if (rec.is_view) rec.view.assign_to(ret_buffer);
+          else ret_buffer.swap(rec.buffer);
           ASSERT_LT(ret_proc, rpc.numprocs());
           recv_buffers.pop_front();
         }
@@ -251,6 +287,40 @@ namespace graphlab {
     } // end of recv
 
 
+    /**
+     * Returns a collection of T sent by ret_proc, without copying the
+     * values if possible. The values remain valid for as long as ret_values,
+     * or a copy of it, exists. Otherwise identical to
+     * recv(procid_t&, buffer_type&, bool).
+     */
+    bool recv(procid_t& ret_proc, array_ref<T>& ret_values,
+              const bool try_lock = false) {
+      fiber_control::fast_yield();
+      bool has_lock = false;
+      if(try_lock) {
+        if (recv_buffers.empty()) return false;
+        has_lock = recv_lock.try_lock();
+      } else {
+        recv_lock.lock();
+        has_lock = true;
+      }
+      bool success = false;
+      if(has_lock) {
+        if(!recv_buffers.empty()) {
+          success = true;
+          buffer_record& rec =  recv_buffers.front();
+          ret_proc = rec.proc;
+          if (rec.is_view) ret_values = rec.view;
+          else ret_values = array_ref<T>::adopt(rec.buffer);
+          ASSERT_LT(ret_proc, rpc.numprocs());
+          recv_buffers.pop_front();
+        }
+        recv_lock.unlock();
+      }
+      return success;
+    } // end of recv
+
+
 
     /**
      * Returns the number of elements available for receiving.
@@ -260,7 +330,7 @@ namespace graphlab {
       recv_lock.lock();
       size_t count = 0;
       foreach(const buffer_record& rec, recv_buffers) {
-        count += rec.buffer.size();
+        count += rec.size();
       }
       recv_lock.unlock();
       return count;
@@ -274,9 +344,29 @@ namespace graphlab {
     void clear() { }
 
     void barrier() { rpc.barrier(); }
+
+    /**
+     * Changes the compression of the buffers sent from now on.
+     * Need not be called on all machines.
+     */
+    void set_compression(exchange_compression_type compression) {
+      compressor.set_type(compression);
+    }
+
+    /// The number of payload bytes sent by this machine before compression
+    size_t bytes_before_compression() const {
+      return compressor.bytes_before();
+    }
+
+    /**
+     * The number of payload bytes sent by this machine after compression.
+     * Only counts buffers sent while compression was enabled.
+     */
+    size_t bytes_after_compression() const {
+      return compressor.bytes_after();
+    }
   private:
     void rpc_recv(size_t len, wild_pointer w) {
-      buffer_type tmp;
       iarchive iarc(reinterpret_cast<const char*>(w.ptr), len);
       // first desrialize the source process
       procid_t src_proc; iarc >> src_proc;
@@ -288,9 +378,62 @@ namespace graphlab {
       size_t numel = 0; 
       numel_iarc.read(reinterpret_cast<char*>(&numel), sizeof(size_t));
       //std::cout << "Receiving: " << numel << "\n";
+      if (gl_is_pod_or_scaler<T>::value && numel > 0) {
+        // keep POD values in the receive buffer
+        boost::shared_ptr<void> block = distributed_control::retain_call_buffer();
+        if (block) {
+          // The values are preceded by the call header, which has been
+          // consumed, so misaligned values can be moved back over it.
+          char* values = const_cast<char*>(iarc.buf + iarc.off);
+          const size_t misalign = reinterpret_cast<size_t>(values) %
+                                  boost::alignment_of<T>::value;
+          if (misalign > 0) {
+            memmove(values - misalign, values, sizeof(T) * numel);
+            values -= misalign;
+          }
+          receive_view(src_proc, array_ref<T>(reinterpret_cast<const T*>(values),
+                                              numel, block));
+          return;
+        }
+      }
+      receive_values(src_proc, numel, iarc);
+    } // end of rpc rcv
+
+    void rpc_recv_compressed(size_t len, wild_pointer w) {
+      iarchive iarc(reinterpret_cast<const char*>(w.ptr), len);
+      procid_t src_proc; size_t numel;
+      iarc >> src_proc >> numel;
+      ASSERT_LT(src_proc, rpc.numprocs());
+      std::vector<char> payload;
+      const bool success =
+          dc_impl::exchange_compressor::decompress(iarc.buf + iarc.off,
+                                                   len - iarc.off, payload);
+      ASSERT_TRUE(success);
+      if (gl_is_pod_or_scaler<T>::value && numel > 0) {
+        // the decompressed values are used in place
+        ASSERT_EQ(payload.size(), sizeof(T) * numel);
+        boost::shared_ptr<std::vector<char> >
+            owned(new std::vector<char>());
+        owned->swap(payload);
+        receive_view(src_proc,
+                     array_ref<T>(reinterpret_cast<const T*>(&((*owned)[0])),
+                                  numel, owned));
+        return;
+      }
+      iarchive payload_iarc(payload.empty() ? NULL : &(payload[0]),
+                            payload.size());
+      receive_values(src_proc, numel, payload_iarc);
+    }
+
+    void receive_values(procid_t src_proc, size_t numel, iarchive& iarc) {
+      buffer_type tmp;
       tmp.resize(numel);
-      for (size_t i = 0;i < numel; ++i) {
-        iarc >> tmp[i];
+      if (gl_is_pod_or_scaler<T>::value) {
+        if (numel > 0) deserialize(iarc, &(tmp[0]), sizeof(T) * numel);
+      } else {
+        for (size_t i = 0;i < numel; ++i) {
+          iarc >> tmp[i];
+        }
       }
 
       recv_lock.lock();
@@ -299,16 +442,25 @@ namespace graphlab {
       rec.proc = src_proc;
       rec.buffer.swap(tmp);
       recv_lock.unlock();
-    } // end of rpc rcv
+    }
+
+    void receive_view(procid_t src_proc, const array_ref<T>& view) {
+      recv_lock.lock();
+      recv_buffers.push_back(buffer_record());
+      buffer_record& rec = recv_buffers.back();
+      rec.proc = src_proc;
+      rec.view = view;
+      rec.is_view = true;
+      recv_lock.unlock();
+    }
 
 
     // create a new buffer for send_buffer[index], returning the old buffer
-    oarchive* swap_buffer(size_t index) {
+    // and the number of values in it
+    oarchive* swap_buffer(size_t index, size_t& numinserts) {
       oarchive* swaparc = rpc.split_call_begin(&buffered_exchange::rpc_recv);
       std::swap(send_buffers[index].oarc, swaparc);
-      // write the length at the end of the buffere are returning
-      (*swaparc).write(reinterpret_cast<char*>(&send_buffers[index].numinserts), sizeof(size_t));
-
+      numinserts = send_buffers[index].numinserts;
       //std::cout << "Sending : " << (send_buffers[index].numinserts)<< "\n";
       // reset the insertion count
       send_buffers[index].numinserts = 0;
@@ -317,6 +469,27 @@ namespace graphlab {
       return swaparc;
     }
 
+    // sends a buffer returned by swap_buffer, compressing the values if
+    // enabled and worthwhile
+    void send_buffer(procid_t proc, oarchive* arc, size_t numinserts) {
+      if (compressor.enabled()) {
+        const size_t len = arc->off - payload_offset;
+        // the records are likely of fixed size if the length divides evenly
+        const size_t stride = len % numinserts == 0 ? len / numinserts : 0;
+        oarchive* carc = rpc.split_call_begin(&buffered_exchange::rpc_recv_compressed);
+        (*carc) << rpc.procid() << numinserts;
+        if (compressor.compress(arc->buf + payload_offset, len, stride, *carc)) {
+          rpc.split_call_cancel(arc);
+          rpc.split_call_end(proc, carc);
+          return;
+        }
+        rpc.split_call_cancel(carc);
+      }
+      // write the length at the end of the buffer
+      arc->write(reinterpret_cast<char*>(&numinserts), sizeof(size_t));
+      rpc.split_call_end(proc, arc);
+    }
+
 
   }; // end of buffered exchange
 
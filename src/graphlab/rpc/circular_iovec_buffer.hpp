@@ -159,6 +159,26 @@ struct circular_iovec_buffer {
     }
   }
 
+  /**
+   * Advances the head as if some amount of data was sent, but instead of
+   * freeing the completely sent pointers, appends them to unfreed.
+   * Used when the data may still be referenced after the send
+   * call returns (MSG_ZEROCOPY).
+   */
+  void sent(size_t len, std::vector<void*>& unfreed) {
+    while(len > 0) {
+      size_t curv_sent_len = std::min(len, parallel_v[head].iov_len);
+      parallel_v[head].iov_len -= curv_sent_len;
+      parallel_v[head].iov_base = (char*)(parallel_v[head].iov_base) + curv_sent_len;
+      len -= curv_sent_len;
+      if (parallel_v[head].iov_len == 0) {
+        unfreed.push_back(v[head].iov_base);
+        head = (head + 1) & (v.size() - 1);
+        --numel;
+      }
+    }
+  }
+
   std::vector<struct iovec> v;
   std::vector<struct iovec> parallel_v;
   size_t head;
@@ -51,6 +51,8 @@
 #include <graphlab/rpc/dc_init_from_env.hpp>
 #include <graphlab/rpc/dc_init_from_mpi.hpp>
 #include <graphlab/rpc/dc_init_from_zookeeper.hpp>
+#include <graphlab/rpc/rpc_profile.hpp>
+#include <graphlab/ui/metrics_server.hpp>
 
 
 namespace graphlab {
@@ -73,6 +75,32 @@ void thrlocal_send_buffer_key_deleter(void* p) {
   }
 }
 
+bool thrlocal_receive_block_key_initialized = false;
+pthread_key_t thrlocal_receive_block_key;
+
+/**
+ * The receive buffer holding the call being executed by a handler thread.
+ * refctr counts the references to the buffer. If the buffer is not already
+ * reference counted, refctr is created when the buffer is first retained,
+ * with one reference held by process_fcall_block.
+ */
+struct receive_block {
+  char* chunk;
+  atomic<size_t>* refctr;
+};
+
+/// Releases a reference to a retained receive buffer
+struct receive_block_releaser {
+  atomic<size_t>* refctr;
+  receive_block_releaser(atomic<size_t>* refctr): refctr(refctr) { }
+  void operator()(void* chunk) {
+    if (refctr->dec() == 0) {
+      delete refctr;
+      free(chunk);
+    }
+  }
+};
+
 } // namespace dc_impl
 
 
@@ -113,6 +141,19 @@ unsigned char distributed_control::get_sequentialization_key() {
   return (unsigned char)oldval;
 }
 
+boost::shared_ptr<void> distributed_control::retain_call_buffer() {
+  if (dc_impl::thrlocal_receive_block_key_initialized == false) {
+    return boost::shared_ptr<void>();
+  }
+  dc_impl::receive_block* block = reinterpret_cast<dc_impl::receive_block*>(
+      pthread_getspecific(dc_impl::thrlocal_receive_block_key));
+  if (block == NULL) return boost::shared_ptr<void>();
+  if (block->refctr == NULL) block->refctr = new atomic<size_t>(1);
+  block->refctr->inc();
+  return boost::shared_ptr<void>(block->chunk,
+                                 dc_impl::receive_block_releaser(block->refctr));
+}
+
 
 distributed_control::distributed_control() {
   dc_init_param initparam;
@@ -185,6 +226,8 @@ distributed_control::~distributed_control() {
 
   pthread_key_delete(dc_impl::thrlocal_sequentialization_key);
   pthread_key_delete(dc_impl::thrlocal_send_buffer_key);
+  pthread_key_delete(dc_impl::thrlocal_receive_block_key);
+  dc_impl::thrlocal_receive_block_key_initialized = false;
 
   size_t bytesreceived = bytes_received();
   for (size_t i = 0;i < receivers.size(); ++i) {
@@ -200,6 +243,11 @@ distributed_control::~distributed_control() {
   logstream(LOG_INFO) << "Network Sent: " << network_bytes_sent() << std::endl;
   logstream(LOG_INFO) << "Bytes Received: " << bytesreceived << std::endl;
   logstream(LOG_INFO) << "Calls Received: " << calls_received() << std::endl;
+  if (rpc_profiling()) {
+    logstream(LOG_EMPH) << "RPC profile of machine " << localprocid << ":\n"
+                        << dc_impl::rpc_profile_report(rpc_profile())
+                        << std::endl;
+  }
 
   delete comm;
 
@@ -209,7 +257,8 @@ distributed_control::~distributed_control() {
 void distributed_control::exec_function_call(procid_t source,
                                             unsigned char packet_type_mask,
                                             const char* data,
-                                            const size_t len) {
+                                            const size_t len,
+                                            uint64_t enqueue_time) {
   BEGIN_TRACEPOINT(dc_call_dispatch);
   // extract the dispatch function
   iarchive arc(data, len);
@@ -217,7 +266,14 @@ void distributed_control::exec_function_call(procid_t source,
   arc >> f;
   // a regular funcion call
   dc_impl::dispatch_type dispatch = (dc_impl::dispatch_type)f;
-  dispatch(*this, source, packet_type_mask, data + arc.off, len - arc.off);
+  if (dc_impl::rpc_profile_enabled) {
+    uint64_t handler_start = dc_impl::rpc_profile_now();
+    dispatch(*this, source, packet_type_mask, data + arc.off, len - arc.off);
+    dc_impl::rpc_profile_receive(data, len, enqueue_time,
+                                 handler_start, dc_impl::rpc_profile_now());
+  } else {
+    dispatch(*this, source, packet_type_mask, data + arc.off, len - arc.off);
+  }
   if ((packet_type_mask & CONTROL_PACKET) == 0) inc_calls_received(source);
   END_TRACEPOINT(dc_call_dispatch);
 }
@@ -249,6 +305,7 @@ void distributed_control::deferred_function_call_chunk(char* buf, size_t len, pr
   fc->chunk_ref_counter = NULL;
   fc->is_chunk = true;
   fc->source = src;
+  fc->enqueue_time = dc_impl::rpc_profile_enabled ? dc_impl::rpc_profile_now() : 0;
   fcallqueue_length.inc();
 
 #ifdef RPC_BLOCK_STRIPING
@@ -285,11 +342,22 @@ void distributed_control::deferred_function_call_chunk(char* buf, size_t len, pr
 
 
 void distributed_control::process_fcall_block(fcallqueue_entry &fcallblock) {
+  // Lets retain_call_buffer() find the buffer of the executing call.
+  // The handler may yield and resume on another thread, so this is only
+  // valid until it first blocks.
+  dc_impl::receive_block block;
+  block.chunk = fcallblock.chunk_src;
+  block.refctr = fcallblock.chunk_ref_counter;
   if (fcallblock.is_chunk == false) {
     for (size_t i = 0;i < fcallblock.calls.size(); ++i) {
       fcallqueue_length.dec();
+      if (block.refctr != NULL) {
+        pthread_setspecific(dc_impl::thrlocal_receive_block_key, &block);
+      }
       exec_function_call(fcallblock.source, fcallblock.calls[i].packet_mask,
-                        fcallblock.calls[i].data, fcallblock.calls[i].len);
+                        fcallblock.calls[i].data, fcallblock.calls[i].len,
+                        fcallblock.enqueue_time);
+      pthread_setspecific(dc_impl::thrlocal_receive_block_key, NULL);
     }
     if (fcallblock.chunk_ref_counter != NULL) {
       if (fcallblock.chunk_ref_counter->dec(fcallblock.calls.size()) == 0) {
@@ -315,13 +383,21 @@ void distributed_control::process_fcall_block(fcallqueue_entry &fcallblock) {
         global_bytes_received[hdr.src].inc(hdr.len);
       }
 
+      pthread_setspecific(dc_impl::thrlocal_receive_block_key, &block);
       exec_function_call(fcallblock.source, hdr.packet_type_mask,
                          data + sizeof(dc_impl::packet_hdr),
-                         hdr.len);
+                         hdr.len, fcallblock.enqueue_time);
+      pthread_setspecific(dc_impl::thrlocal_receive_block_key, NULL);
       data += sizeof(dc_impl::packet_hdr) + hdr.len;
       remaininglen -= sizeof(dc_impl::packet_hdr) + hdr.len;
     }
-    free(fcallblock.chunk_src);
+    // a retained buffer is freed by its last holder
+    if (block.refctr == NULL) {
+      free(fcallblock.chunk_src);
+    } else if (block.refctr->dec() == 0) {
+      delete block.refctr;
+      free(fcallblock.chunk_src);
+    }
   }
 #else
   else {
@@ -337,6 +413,7 @@ void distributed_control::process_fcall_block(fcallqueue_entry &fcallblock) {
     immediate_queue.chunk_len = 0;
     immediate_queue.source = fcallblock.source;
     immediate_queue.is_chunk = false;
+    immediate_queue.enqueue_time = fcallblock.enqueue_time;
 
     for (size_t i = 0;i < fcallqueue.size(); ++i) {
       queuebufs[i] = new fcallqueue_entry;
@@ -345,6 +422,7 @@ void distributed_control::process_fcall_block(fcallqueue_entry &fcallblock) {
       queuebufs[i]->chunk_len = 0;
       queuebufs[i]->source = fcallblock.source;
       queuebufs[i]->is_chunk = false;
+      queuebufs[i]->enqueue_time = fcallblock.enqueue_time;
     }
 
     //parse the data in fcallblock.data
@@ -511,6 +589,12 @@ void distributed_control::init(const std::vector<std::string> &machines,
     ASSERT_EQ(err, 0);
   }
 
+  if (dc_impl::thrlocal_receive_block_key_initialized == false) {
+    dc_impl::thrlocal_receive_block_key_initialized = true;
+    int err = pthread_key_create(&dc_impl::thrlocal_receive_block_key, NULL);
+    ASSERT_EQ(err, 0);
+  }
+
   //-------- Initialize the full barrier ---------
   full_barrier_in_effect = false;
   procs_complete.resize(machines.size());
@@ -528,14 +612,20 @@ void distributed_control::init(const std::vector<std::string> &machines,
 
   // parse the initstring
   std::map<std::string,std::string> options = parse_options(initstring);
+  send_policy.set_options(options);
 
   if (commtype == TCP_COMM) {
     comm = new dc_impl::dc_tcp_comm();
   } else {
     ASSERT_MSG(false, "Unexpected value for comm type");
   }
+  const size_t nstreams = comm->streams_per_machine(options);
+  for (size_t s = 0; s < nstreams; ++s) {
+    for (procid_t i = 0; i < machines.size(); ++i) {
+      receivers.push_back(new dc_impl::dc_stream_receive(this, i));
+    }
+  }
   for (procid_t i = 0; i < machines.size(); ++i) {
-    receivers.push_back(new dc_impl::dc_stream_receive(this, i));
     senders.push_back(new dc_impl::dc_buffered_stream_send2(this, comm, i));
   }
   // create the handler threads
@@ -604,6 +694,12 @@ void distributed_control::init(const std::vector<std::string> &machines,
   // set the static variable for the get_instance_procid() function
   last_dc_procid = localprocid;
 
+  // enabled before the barrier so that no machine misses the calls of another
+  if (options.count("rpc_profile")) {
+    const std::string& val = options["rpc_profile"];
+    if (!(val == "0" || val == "false")) set_rpc_profiling(true);
+  }
+
   barrier();
   // initialize the empty stream
   nullstrm.open(boost::iostreams::null_sink());
@@ -617,6 +713,14 @@ void distributed_control::init(const std::vector<std::string> &machines,
       "Calls", boost::bind(&distributed_control::calls_sent, this));
 }
 
+void distributed_control::set_rpc_profiling(bool enabled) {
+  if (enabled && !rpc_profiling()) {
+    add_metric_server_callback("rpc_profile.json",
+                               dc_impl::rpc_profile_json_page);
+  }
+  dc_impl::rpc_profile_set_enabled(enabled);
+}
+
 
 
 void distributed_control::barrier() {
@@ -643,6 +747,11 @@ void distributed_control::flush_soon() {
 void distributed_control::flush_soon(procid_t p) {
   senders[p]->flush_soon();
 }
+
+void distributed_control::flush_urgent(procid_t p) {
+  if (send_policy.send_urgent_immediately()) senders[p]->flush();
+  else senders[p]->flush_soon();
+}
 /*****************************************************************************
                       Implementation of Full Barrier
 *****************************************************************************/
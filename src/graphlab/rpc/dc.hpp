@@ -26,6 +26,7 @@
 #include <iostream>
 #include <boost/iostreams/stream.hpp>
 #include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/parallel/fiber_group.hpp>
 #include <graphlab/parallel/fiber_conditional.hpp>
@@ -52,6 +53,8 @@
 #include <graphlab/rpc/thread_local_send_buffer.hpp>
 #include <graphlab/util/tracepoint.hpp>
 #include <graphlab/rpc/distributed_event_log.hpp>
+#include <graphlab/rpc/rpc_profile.hpp>
+#include <graphlab/rpc/dc_flush_policy.hpp>
 #include <boost/preprocessor.hpp>
 #include <graphlab/rpc/function_arg_types_def.hpp>
 
@@ -85,7 +88,35 @@ struct dc_init_param{
   /** Additional construction options of the form
     "key1=value1,key2=value2".
 
-    There are no available options at this time.
+    \li \b shm=BOOL Whether processes on the same host communicate through
+                  shared memory rings instead of TCP. Defaults to true.
+    \li \b shm_ring_size=NUMBER The size in bytes of each shared memory
+                  ring. Defaults to \ref SHM_RING_SIZE.
+    \li \b zerocopy_threshold=NUMBER Send batches of at least this many
+                  bytes with MSG_ZEROCOPY where supported. Defaults to 0
+                  (disabled).
+    \li \b tcp_connections=NUMBER The number of TCP connections to open to
+                  every other machine. Each connection has its own event
+                  loop threads. Defaults to 1.
+    \li \b flush_buffer_size=NUMBER The size in bytes at which a thread's
+                  send buffer to a machine is queued for sending. Defaults
+                  to \ref FULL_BUFFER_SIZE_LIMIT.
+    \li \b flush_queue_length=NUMBER The number of queued send buffers to a
+                  machine at which the send thread is woken up. With the
+                  adaptive policy, the largest such number. Defaults to
+                  \ref NUM_FULL_BUFFER_LIMIT.
+    \li \b adaptive_flush=BOOL Tune the queue length from the observed
+                  request round trip time and throughput. Defaults to true.
+    \li \b urgent_send=immediate|soon Whether requests, replies and
+                  urgent calls are sent by the calling thread, or by the
+                  send thread which is woken up. Defaults to immediate.
+    \li \b send_poll_timeout=NUMBER The number of microseconds between
+                  the polls of the send buffers. Defaults to
+                  \ref SEND_POLL_TIMEOUT.
+    \li \b rpc_profile=BOOL Profile the calls, bytes, queueing time and
+                  handler time of every remote function. The profile is
+                  printed at exit and served by the metrics server as
+                  rpc_profile.json. Defaults to false.
 
     Internal options which should not be used
     \li \b __socket__=NUMBER Forces TCP comm to use this socket number for its
@@ -180,9 +211,16 @@ namespace dc_impl {
  * \li distributed_control::broadcast()
  * \li distributed_control::all_reduce()
  * \li distributed_control::all_reduce2()
+ * \li distributed_control::all_reduce_array()
+ * \li distributed_control::all_reduce_array2()
  * \li distributed_control::gather()
  * \li distributed_control::all_gather()
  *
+ * The non-blocking collectives distributed_control::ibarrier(),
+ * distributed_control::iall_reduce() and distributed_control::iall_gather()
+ * return immediately with a \ref request_future which holds the result once
+ * all machines have made the same call.
+ *
  * \note These synchronous operations are modeled after some MPI collective
  * operations. However, these operations here are not particularly optimized
  * and will generally be slower than their MPI counterparts. However, the
@@ -239,6 +277,8 @@ class distributed_control{
     atomic<size_t>* chunk_ref_counter;
     procid_t source;
     bool is_chunk;
+    /// When the block was received, if RPC profiling is enabled. Else 0.
+    uint64_t enqueue_time;
   };
   /// a queue of functions to be executed
   std::vector<fiber_blocking_queue<fcallqueue_entry*> > fcallqueue;
@@ -353,6 +393,14 @@ class distributed_control{
 
   bool use_fast_track_requests;
 
+  /// decides when the send buffers are flushed
+  dc_impl::flush_policy send_policy;
+
+  /// \internal The flush policy of the send buffers
+  inline dc_impl::flush_policy& get_flush_policy() {
+    return send_policy;
+  }
+
   /// Sets the fast track status, returning the previous value
   bool set_fast_track_requests(bool val) {
     bool ret = use_fast_track_requests;
@@ -425,6 +473,28 @@ class distributed_control{
    */
   static unsigned char get_sequentialization_key();
 
+  /**
+   * \brief Keeps the receive buffer holding the arguments of the RPC call
+   * being executed alive.
+   *
+   * Must be called from within an RPC handler, before the handler blocks
+   * or yields. The buffer, and therefore every \ref array_ref deserialized
+   * from the arguments of the call, remains valid for as long as the
+   * returned pointer, or a copy of it, exists. Typically the pointer is
+   * stored as the owner of the array_ref:
+   * \code
+   * void handler(graphlab::array_ref<size_t> values) {
+   *   // values which were copied on deserialization already have an owner
+   *   if (!values.owner()) {
+   *     values.set_owner(graphlab::distributed_control::retain_call_buffer());
+   *   }
+   *   // values may now be queued and read after the handler returns
+   * }
+   * \endcode
+   * Returns an empty pointer if not called from an RPC handler.
+   */
+  static boost::shared_ptr<void> retain_call_buffer();
+
 
 
 
@@ -744,7 +814,9 @@ class distributed_control{
   Immediately calls the function described by the data
   inside the buffer. This should not be called directly.
   */
-  void exec_function_call(procid_t source, unsigned char packet_type_mask, const char* data, const size_t len);
+  void exec_function_call(procid_t source, unsigned char packet_type_mask,
+                          const char* data, const size_t len,
+                          uint64_t enqueue_time = 0);
 
 
 
@@ -942,6 +1014,31 @@ class distributed_control{
     return ret;
   }
 
+  /**
+   * \brief Starts or stops profiling the RPC calls of this machine.
+   *
+   * While enabled, the calls sent and received, the bytes serialized, the
+   * time spent in the receive queue and the time spent in the handler are
+   * recorded for every remote function. See rpc_profile(). Also enabled
+   * by the rpc_profile=true initstring option.
+   */
+  void set_rpc_profiling(bool enabled);
+
+  /// \brief Returns true if RPC calls are being profiled
+  inline bool rpc_profiling() const {
+    return dc_impl::rpc_profile_enabled;
+  }
+
+  /**
+   * \brief Returns the RPC profile of this machine, one entry for each
+   * remote function called since profiling was first enabled.
+   * Combine the profiles of several machines with
+   * dc_impl::rpc_profile_merge().
+   */
+  inline std::vector<rpc_function_profile> rpc_profile() const {
+    return dc_impl::rpc_profile_snapshot();
+  }
+
   /// \cond GRAPHLAB_INTERNAL
 
   /// \internal
@@ -1006,11 +1103,19 @@ class distributed_control{
    */
   void flush_soon(procid_t p);
 
+  /**
+   * \brief Sends the buffers to one machine as required for urgent calls:
+   * immediately, or soon, depending on the urgent_send option.
+   */
+  void flush_urgent(procid_t p);
+
   /**
    * \brief Writes a string to the send buffer and flushes
    */
-  inline void write_to_buffer(procid_t target, char* c, size_t len) {
-    senders[target]->write_to_buffer(c, len);
+  inline void write_to_buffer(procid_t target,
+                              dc_impl::thread_local_buffer* source,
+                              char* c, size_t len) {
+    senders[target]->write_to_buffer(source, c, len);
   }
 
 
@@ -1298,6 +1403,115 @@ class distributed_control{
   template <typename U, typename PlusEqual>
   inline void all_reduce2(U& data, PlusEqual plusequal, bool control = false);
 
+  /**
+   * \brief Adds up a vector contributed by each machine elementwise,
+   * making the result available to all machines.
+   *
+   * This is a faster all_reduce() for large vectors of a POD type, such as
+   * the dense count or center vectors of many toolkits. The vector must
+   * have the same length on all machines. Large vectors are reduced with a
+   * pipelined ring algorithm (a reduce-scatter followed by an all-gather):
+   * each machine sends about twice the size of the vector, regardless of
+   * the number of machines, and the elements are copied directly into the
+   * communication buffers without serialization. Vectors shorter than
+   * \ref RING_ALL_REDUCE_THRESHOLD bytes fall back to all_reduce2().
+   *
+   * Example:
+   * \code
+   * std::vector<double> counts(1000000, 1.0);
+   * dc.all_reduce_array(counts);
+   * // all machines will have counts[i] = numprocs() here.
+   * \endcode
+   *
+   * \param data  The vector to reduce.
+   * \param control Optional parameter. Defaults to false. If set to true,
+   *                this will marked as control plane communication and will
+   *                not register in bytes_received() or bytes_sent(). This must
+   *                be the same on all machines.
+   */
+  template <typename U>
+  inline void all_reduce_array(std::vector<U>& data, bool control = false);
+
+  /**
+   * \brief Adds up an array of numel elements contributed by each machine
+   * elementwise. See all_reduce_array(std::vector<U>&, bool).
+   */
+  template <typename U>
+  inline void all_reduce_array(U* data, size_t numel, bool control = false);
+
+  /**
+   * \brief Combines an array contributed by each machine elementwise with
+   * an externally defined PlusEqual function.
+   *
+   * This function is equivalent to all_reduce_array(), but with a
+   * plusequal function of the form
+   * \code
+   * void plusequal(U& left, const U& right);
+   * \endcode
+   * which is applied to every element.
+   */
+  template <typename U, typename PlusEqual>
+  inline void all_reduce_array2(U* data, size_t numel, PlusEqual plusequal,
+                                bool control = false);
+
+  /**
+   * \brief A non-blocking all_reduce().
+   *
+   * Contributes data to a reduction over all machines and returns
+   * immediately. The returned future holds the sum of the values
+   * contributed by all machines once they have all called iall_reduce().
+   *
+   * Example:
+   * \code
+   * request_future<size_t> total = dc.iall_reduce(local_count);
+   * // ... overlap some computation with the reduction ...
+   * if (total() == 0) {
+   *   // ...
+   * }
+   * \endcode
+   *
+   * Unlike the blocking collectives, the non-blocking collectives
+   * may be issued from any thread and several may be in flight at once.
+   * However, all machines must issue them in the same order. The future
+   * must be waited on before it is destroyed.
+   *
+   * \param data  The value contributed by this machine.
+   * \param control Optional parameter. Defaults to false. If set to true,
+   *                this will marked as control plane communication and will
+   *                not register in bytes_received() or bytes_sent(). This must
+   *                be the same on all machines.
+   */
+  template <typename U>
+  inline request_future<U> iall_reduce(const U& data, bool control = false);
+
+  /**
+   * \brief A non-blocking all_reduce2(). See iall_reduce().
+   */
+  template <typename U, typename PlusEqual>
+  inline request_future<U> iall_reduce2(const U& data, PlusEqual plusequal,
+                                        bool control = false);
+
+  /**
+   * \brief A non-blocking all_gather().
+   *
+   * Returns immediately. Once all machines have called iall_gather(),
+   * the future holds a vector of numprocs() entries, entry i being the
+   * value contributed by machine i. See iall_reduce() for the rules
+   * governing the non-blocking collectives.
+   */
+  template <typename U>
+  inline request_future<std::vector<U> > iall_gather(const U& data,
+                                                     bool control = false);
+
+  /**
+   * \brief A non-blocking barrier().
+   *
+   * Returns immediately. The future becomes ready once all machines have
+   * called ibarrier(). See iall_reduce() for the rules governing the
+   * non-blocking collectives.
+   */
+  inline request_future<void> ibarrier();
+
 
    /**
     \brief A distributed barrier which waits for all machines to call the
@@ -1448,6 +1662,48 @@ inline void distributed_control::all_reduce2(U& data, PlusEqual plusequal, bool
   distributed_services->all_reduce2(data, plusequal, control);
 }
 
+template <typename U>
+inline void distributed_control::all_reduce_array(std::vector<U>& data,
+                                                  bool control) {
+  distributed_services->all_reduce_array(data, control);
+}
+
+template <typename U>
+inline void distributed_control::all_reduce_array(U* data, size_t numel,
+                                                  bool control) {
+  distributed_services->all_reduce_array(data, numel, control);
+}
+
+template <typename U, typename PlusEqual>
+inline void distributed_control::all_reduce_array2(U* data, size_t numel,
+                                                   PlusEqual plusequal,
+                                                   bool control) {
+  distributed_services->all_reduce_array2(data, numel, plusequal, control);
+}
+
+template <typename U>
+inline request_future<U> distributed_control::iall_reduce(const U& data,
+                                                          bool control) {
+  return distributed_services->iall_reduce(data, control);
+}
+
+template <typename U, typename PlusEqual>
+inline request_future<U> distributed_control::iall_reduce2(const U& data,
+                                                           PlusEqual plusequal,
+                                                           bool control) {
+  return distributed_services->iall_reduce2(data, plusequal, control);
+}
+
+template <typename U>
+inline request_future<std::vector<U> >
+distributed_control::iall_gather(const U& data, bool control) {
+  return distributed_services->iall_gather(data, control);
+}
+
+inline request_future<void> distributed_control::ibarrier() {
+  return distributed_services->ibarrier();
+}
+
 
 
 
@@ -50,15 +50,25 @@ namespace dc_impl {
     return ret;
   }
 
-  void dc_buffered_stream_send2::write_to_buffer(char* c, size_t len)  {
+  void dc_buffered_stream_send2::write_to_buffer(thread_local_buffer* source,
+                                                 char* c, size_t len)  {
     lock.lock();
+    size_t stripe = 0;
+    for (size_t i = 0;i < send_buffers.size(); ++i) {
+      if (send_buffers[i] == source) {
+        stripe = send_buffer_stripe[i];
+        break;
+      }
+    }
     additional_flush_buffers.push_back(std::make_pair(c, len));
+    additional_flush_stripe.push_back(stripe);
     lock.unlock();
   }
 
   void dc_buffered_stream_send2::register_send_buffer(thread_local_buffer* buffer) {
     lock.lock();
     send_buffers.push_back(buffer);
+    send_buffer_stripe.push_back(next_stripe++);
     to_send.resize(send_buffers.size());
     lock.unlock();
   }
@@ -69,6 +79,7 @@ namespace dc_impl {
       if (send_buffers[i] == buffer) {
         total_bytes_sent.inc(send_buffers[i]->get_bytes_sent(target));
         send_buffers.erase(send_buffers.begin() + i);
+        send_buffer_stripe.erase(send_buffer_stripe.begin() + i);
         break;
       }
     }
@@ -84,10 +95,13 @@ namespace dc_impl {
     }
   }
 
-  size_t dc_buffered_stream_send2::get_outgoing_data(circular_iovec_buffer& outdata) {
+  size_t dc_buffered_stream_send2::get_outgoing_data(circular_iovec_buffer& outdata,
+                                                     size_t stripe,
+                                                     size_t nstripes) {
     lock.lock();
     size_t sendlen = 0;
     for (size_t i = 0;i < send_buffers.size(); ++i) {
+      if (send_buffer_stripe[i] % nstripes != stripe) continue;
       std::pair<buffer_elem*, buffer_elem*> bufs = send_buffers[i]->extract(target);
       if (bufs.first != NULL) {
         while(bufs.first != bufs.second) {
@@ -107,13 +121,24 @@ namespace dc_impl {
         }
       }
     }
+    // the slow path buffers go to the stripe of the buffer they came from
+    size_t keep = 0;
     for (size_t i = 0;i < additional_flush_buffers.size(); ++i) {
+      if (additional_flush_stripe[i] % nstripes != stripe) {
+        additional_flush_buffers[keep] = additional_flush_buffers[i];
+        additional_flush_stripe[keep] = additional_flush_stripe[i];
+        ++keep;
+        continue;
+      }
       iovec sendvec;
       sendvec.iov_base = additional_flush_buffers[i].first;
       sendvec.iov_len = additional_flush_buffers[i].second;
       sendlen += sendvec.iov_len;
+      // outdata now owns the buffer
       outdata.write(sendvec);
     }
+    additional_flush_buffers.resize(keep);
+    additional_flush_stripe.resize(keep);
     lock.unlock();
     return sendlen;
   }
@@ -66,7 +66,7 @@ class dc_buffered_stream_send2: public dc_send{
   dc_buffered_stream_send2(distributed_control* dc,
                                    dc_comm_base *comm,
                                    procid_t target) :
-                  dc(dc),  comm(comm), target(target) { }
+                  dc(dc),  comm(comm), target(target), next_stripe(0) { }
 
   ~dc_buffered_stream_send2();
 
@@ -74,11 +74,12 @@ class dc_buffered_stream_send2: public dc_send{
 
   void unregister_send_buffer(thread_local_buffer* buffer);
 
-  size_t get_outgoing_data(circular_iovec_buffer& outdata);
+  size_t get_outgoing_data(circular_iovec_buffer& outdata,
+                           size_t stripe = 0, size_t nstripes = 1);
 
   inline size_t bytes_sent();
 
-  void write_to_buffer(char* c, size_t len);
+  void write_to_buffer(thread_local_buffer* source, char* c, size_t len);
 
   void flush();
 
@@ -94,12 +95,17 @@ class dc_buffered_stream_send2: public dc_send{
 
 
   std::vector<thread_local_buffer*> send_buffers;
+  /// stripe of each entry of send_buffers. Assigned round robin.
+  std::vector<size_t> send_buffer_stripe;
+  size_t next_stripe;
   // temporary array matched to the same length as send_buffers
   // to avoid repeated reallocation of this array when 
   // get_outgoing_data is called
   std::vector<std::vector<std::pair<char*, size_t> > > to_send;
 
   std::vector<std::pair<char*, size_t> > additional_flush_buffers;
+  /// stripe of each entry of additional_flush_buffers
+  std::vector<size_t> additional_flush_stripe;
   mutex lock;
 };
 
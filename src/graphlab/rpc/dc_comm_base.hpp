@@ -67,7 +67,9 @@ class dc_comm_base {
    curmachineid: The ID of the current machine. Will be size_t(-1) if this is not available.
                  (Some comm protocols will negotiate this itself.)
    
-   receiver: the receiving object
+   receiver: the receiving objects. There are streams_per_machine()
+             receivers for each machine: receiver[s * machines.size() + i]
+             receives stream s from machine i.
   */
   virtual void init(const std::vector<std::string> &machines,
             const std::map<std::string,std::string> &initopts,
@@ -75,6 +77,16 @@ class dc_comm_base {
             std::vector<dc_receive*> receiver,
             std::vector<dc_send*> sender) = 0;
 
+  /**
+   * The number of independent byte streams from each machine, given
+   * the initialization parameters. Called before init().
+   * Each stream needs its own receiver.
+   */
+  virtual size_t streams_per_machine(
+      const std::map<std::string,std::string> &initopts) const {
+    return 1;
+  }
+
   /// Must close all connections when this function is called
   virtual void close() = 0;
   
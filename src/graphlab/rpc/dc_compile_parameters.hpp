@@ -46,6 +46,15 @@
  */
 #define RECEIVE_BUFFER_SIZE 131072
 
+/**
+ * \ingroup RPC
+ * \def SHM_RING_SIZE
+ * The default size of the shared memory ring from each process to
+ * every other process on the same host.
+ * Can be changed with the "shm_ring_size" option in the initstring.
+ */
+#define SHM_RING_SIZE (4 * 1024 * 1024)
+
 /**************************************************************************/
 /*                                                                        */
 /*                      Send Buffer Behavior Control                      */
@@ -68,6 +77,7 @@
  * The TCP sender polls the queues every so often to ensure
  * progress; This is the timeout value for the number of microseconds
  * between each poll.
+ * Can be changed with the "send_poll_timeout" option in the initstring.
  */
 #define SEND_POLL_TIMEOUT 10000
 
@@ -84,6 +94,7 @@
  * \ingroup rpc
  * \def FULL_BUFFER_SIZE_LIMIT
  * Once the buffer contents exceeds this, it becomes a full buffer.
+ * Can be changed with the "flush_buffer_size" option in the initstring.
  */
 #define FULL_BUFFER_SIZE_LIMIT 63000
 
@@ -91,9 +102,27 @@
  * \ingroup RPC
  * \def NUM_FULL_BUFFER_LIMIT 
  * Number of full buffers in the send queue before a flush is explicitly called.
+ * Can be changed with the "flush_queue_length" option in the initstring.
+ * With the adaptive flush policy, this is the largest number used.
  */
 #define NUM_FULL_BUFFER_LIMIT 32 
 
+/**
+ * \ingroup RPC
+ * \def ADAPTIVE_FLUSH_INTERVAL
+ * The adaptive flush policy retunes the number of full buffers at which
+ * a flush is called at most once every this many microseconds.
+ */
+#define ADAPTIVE_FLUSH_INTERVAL 10000
+
+/**
+ * \ingroup RPC
+ * \def ADAPTIVE_FLUSH_DEFAULT_RTT
+ * The round trip time in microseconds assumed by the adaptive flush policy
+ * before any request has completed.
+ */
+#define ADAPTIVE_FLUSH_DEFAULT_RTT 200
+
 /**************************************************************************/
 /*                                                                        */
 /*                          RPC Handling Control                          */
@@ -145,5 +174,30 @@
  */
 #define DEFAULT_BUFFERED_EXCHANGE_SIZE FULL_BUFFER_SIZE_LIMIT
 
+/**
+ * \ingroup RPC
+ * \def EXCHANGE_COMPRESSION_BANDWIDTH
+ * The network bandwidth in bytes per second assumed by the adaptive
+ * compression of the buffered exchanges. A codec is only used if the time
+ * it saves on the wire exceeds the time spent compressing.
+ */
+#define EXCHANGE_COMPRESSION_BANDWIDTH (125 * 1024 * 1024)
+
+/**
+ * \ingroup RPC
+ * \def RING_ALL_REDUCE_THRESHOLD
+ * dc_dist_object::all_reduce_array() uses the ring algorithm for arrays of
+ * at least this many bytes, and the tree used by all_reduce() otherwise.
+ */
+#define RING_ALL_REDUCE_THRESHOLD (256 * 1024)
+
+/**
+ * \ingroup RPC
+ * \def RING_ALL_REDUCE_SEGMENT_SIZE
+ * The ring all reduce splits every chunk into segments of at most this
+ * many bytes, which travel around the ring independently.
+ */
+#define RING_ALL_REDUCE_SEGMENT_SIZE (256 * 1024)
+
 
 #endif
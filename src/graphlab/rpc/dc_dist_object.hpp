@@ -28,6 +28,7 @@
 #include <vector>
 #include <string>
 #include <set>
+#include <map>
 #include <graphlab/parallel/atomic.hpp>
 #include <graphlab/parallel/fiber_conditional.hpp>
 #include <graphlab/rpc/dc_internal_types.hpp>
@@ -39,6 +40,7 @@
 #include <graphlab/rpc/mem_function_arg_types_def.hpp>
 #include <graphlab/util/charstream.hpp>
 #include <boost/preprocessor.hpp>
+#include <boost/function.hpp>
 #include <graphlab/util/tracepoint.hpp>
 #include <graphlab/rpc/request_reply_handler.hpp>
 #include <graphlab/macros_def.hpp>
@@ -235,6 +237,9 @@ class dc_dist_object : public dc_impl::dc_dist_object_base{
     ab_barrier_sense = 1;
     ab_barrier_release = -1;
 
+    //-------- Initialize the non-blocking collectives --------------
+    icoll_next_seq = 0;
+
 
     //-------- Initialize the full barrier ---------
 
@@ -365,6 +370,7 @@ class dc_dist_object : public dc_impl::dc_dist_object_base{
   */
   BOOST_PP_REPEAT(7, RPC_INTERFACE_GENERATOR, (remote_call, dc_impl::object_call_issue, STANDARD_CALL) )
   BOOST_PP_REPEAT(7, RPC_INTERFACE_GENERATOR, (control_call,dc_impl::object_call_issue, (STANDARD_CALL | CONTROL_PACKET)) )
+  BOOST_PP_REPEAT(7, RPC_INTERFACE_GENERATOR, (urgent_call,dc_impl::object_call_issue, (STANDARD_CALL | FLUSH_PACKET)) )
 
   /**
    * This generates a "split call". Where the header of the call message
@@ -434,6 +440,7 @@ class dc_dist_object : public dc_impl::dc_dist_object_base{
   }
 
   BOOST_PP_REPEAT(7, BROADCAST_INTERFACE_GENERATOR, (remote_call, dc_impl::object_broadcast_issue, STANDARD_CALL) )
+  BOOST_PP_REPEAT(7, BROADCAST_INTERFACE_GENERATOR, (urgent_call, dc_impl::object_broadcast_issue, (STANDARD_CALL | FLUSH_PACKET)) )
 
   /*
   The generation procedure for requests are the same. The only
@@ -664,6 +671,32 @@ class dc_dist_object : public dc_impl::dc_dist_object_base{
   void remote_call(Iterator machine_begin, Iterator machine_end, Fn fn, ...);
 
 
+/**
+ * \brief Performs a non-blocking RPC call which is sent without waiting
+ * for the send buffers to fill up.
+ *
+ * urgent_call() behaves like remote_call(), but belongs to the latency
+ * class of calls, like requests and their replies: the call, and anything
+ * written before it to the same machine, is sent right away. Use it
+ * for calls which another machine is waiting for, such as lock
+ * acquisitions, and remote_call() for bulk data. See the urgent_send
+ * option of dc_init_param::initstring.
+ *
+ * \param targetmachine The ID of the machine to run the function on
+ * \param fn The function to run on the target machine. Must be a pointer to
+ *            member function in the owning object.
+ * \param ... The arguments to send to Fn. Arguments must be serializable.
+ *            and must be castable to the target types.
+ */
+  void urgent_call(procid_t targetmachine, Fn fn, ...);
+
+/**
+ * \brief Performs a non-blocking urgent RPC call to a collection of
+ * machines. See urgent_call() and the broadcast remote_call().
+ */
+  void urgent_call(Iterator machine_begin, Iterator machine_end, Fn fn, ...);
+
+
 /**
  * \brief Performs a blocking RPC call to the target machine
  * to run the provided function pointer.
@@ -1296,6 +1329,478 @@ private:
     all_reduce2(data, default_plus_equal<U>(), control);
   }
 
+
+/*****************************************************************************
+                      Implementation of the ring all reduce
+ *****************************************************************************/
+
+ private:
+  /**
+   * The state of the all_reduce_array2() in progress. The array is split
+   * into numprocs() chunks, and every chunk into nsegments segments.
+   * Chunk c starts on machine c, and is passed down the ring, every machine
+   * adding its own contribution, until it is complete on machine c - 1.
+   * From there, the complete chunk is passed down the ring once more
+   * and copied into every machine's array.
+   */
+  struct ring_reduce_state {
+    char* data;
+    size_t elemsize;
+    size_t numel;
+    size_t nsegments;
+    bool control;
+    /// adds numel elements at src (possibly unaligned) to the array at dest
+    boost::function<void(char* dest, const char* src, size_t numel)> accumulate;
+    /// number of completed segments. Protected by ring_mut
+    size_t completed;
+  };
+  ring_reduce_state ring;
+  mutex ring_mut;
+  fiber_conditional ring_cond;
+
+  template <typename U, typename PlusEqual>
+  struct ring_accumulator {
+    PlusEqual plusequal;
+    ring_accumulator(PlusEqual plusequal): plusequal(plusequal) { }
+    void operator()(char* dest, const char* src, size_t numel) {
+      U* d = reinterpret_cast<U*>(dest);
+      for (size_t i = 0;i < numel; ++i) {
+        U val;
+        memcpy(&val, src + i * sizeof(U), sizeof(U));
+        plusequal(d[i], val);
+      }
+    }
+  };
+
+  template <typename U, typename PlusEqual>
+  struct elementwise_plus_equal {
+    PlusEqual plusequal;
+    elementwise_plus_equal(PlusEqual plusequal): plusequal(plusequal) { }
+    void operator()(std::vector<U>& u, const std::vector<U>& v) {
+      for (size_t i = 0;i < u.size(); ++i) plusequal(u[i], v[i]);
+    }
+  };
+
+  /// The range of elements [begin, end) of a segment
+  void ring_segment_range(size_t chunk, size_t segment,
+                          size_t& begin, size_t& end) const {
+    const size_t chunk_begin = ring.numel * chunk / numprocs();
+    const size_t chunk_len = ring.numel * (chunk + 1) / numprocs() - chunk_begin;
+    begin = chunk_begin + chunk_len * segment / ring.nsegments;
+    end = chunk_begin + chunk_len * (segment + 1) / ring.nsegments;
+  }
+
+  /**
+   * Sends a segment of the array to the next machine in the ring.
+   * The elements are copied straight into the send buffer.
+   */
+  void ring_send(bool complete, size_t chunk, size_t segment) {
+    typedef void (dc_dist_object<T>::*recv_fn_type)(size_t, wild_pointer);
+    typedef dc_impl::object_split_call<dc_dist_object<T>, recv_fn_type>
+        split_call_type;
+    size_t begin, end;
+    ring_segment_range(chunk, segment, begin, end);
+    const procid_t next = (procid() + 1) % numprocs();
+    oarchive* oarc = split_call_type::split_call_begin(
+        this, control_obj_id, &dc_dist_object<T>::__ring_reduce_recv);
+    (*oarc) << complete << chunk << segment;
+    oarc->write(ring.data + begin * ring.elemsize,
+                (end - begin) * ring.elemsize);
+    unsigned char flags = STANDARD_CALL | FLUSH_PACKET;
+    if (ring.control) flags |= CONTROL_PACKET;
+    else inc_calls_sent(next);
+    split_call_type::split_call_end(this, oarc, dc_.senders[next],
+                                    next, flags);
+  }
+
+  /**
+   * Receives a segment from the previous machine in the ring, and
+   * forwards it if it has further to go.
+   */
+  void __ring_reduce_recv(size_t len, wild_pointer w) {
+    iarchive iarc(reinterpret_cast<const char*>(w.ptr), len);
+    bool complete; size_t chunk, segment;
+    iarc >> complete >> chunk >> segment;
+    size_t begin, end;
+    ring_segment_range(chunk, segment, begin, end);
+    ASSERT_EQ(len - iarc.off, (end - begin) * ring.elemsize);
+    char* dest = ring.data + begin * ring.elemsize;
+    // the machine on which the reduction of this chunk completes
+    const procid_t last = (procid_t)((chunk + numprocs() - 1) % numprocs());
+    const procid_t next = (procid() + 1) % numprocs();
+    if (!complete) {
+      ring.accumulate(dest, iarc.buf + iarc.off, end - begin);
+      // if I am the last machine, this segment is complete and
+      // can be passed around once more
+      ring_send(procid() == last, chunk, segment);
+      if (procid() != last) return;
+    } else {
+      memcpy(dest, iarc.buf + iarc.off, (end - begin) * ring.elemsize);
+      if (next != last) ring_send(true, chunk, segment);
+    }
+    ring_mut.lock();
+    ++ring.completed;
+    if (ring.completed == numprocs() * ring.nsegments) ring_cond.signal();
+    ring_mut.unlock();
+  }
+
+ public:
+  /**
+   * \brief Combines an array contributed by each machine elementwise,
+   * making the result available to all machines.
+   *
+   * This is all_reduce2() for a contiguous array of a POD type U.
+   * Large arrays are reduced with a pipelined ring algorithm
+   * (a reduce-scatter followed by an all-gather), in which each machine
+   * sends and receives about 2 * numel * sizeof(U) bytes, however many
+   * machines there are. The elements are copied directly between the array
+   * and the communication buffers, without intermediate serialization.
+   * Arrays smaller than \ref RING_ALL_REDUCE_THRESHOLD bytes use the tree
+   * of all_reduce2(), which has a lower latency.
+   *
+   * \param data The array to reduce.
+   * \param numel The number of elements in the array. Must be the same on
+   *              all machines.
+   * \param plusequal A plusequal function on the elements. Must have the
+   *                  prototype void plusequal(U&, const U&)
+   * \param control If set to true, this will be marked as control plane
+   *                communication. Must be the same on all machines.
+   */
+  template <typename U, typename PlusEqual>
+  void all_reduce_array2(U* data, size_t numel, PlusEqual plusequal,
+                         bool control = false) {
+    if (numprocs() == 1) return;
+    if (numel * sizeof(U) < RING_ALL_REDUCE_THRESHOLD) {
+      std::vector<U> vec(data, data + numel);
+      all_reduce2(vec, elementwise_plus_equal<U, PlusEqual>(plusequal),
+                  control);
+      std::copy(vec.begin(), vec.end(), data);
+      return;
+    }
+    ring.data = reinterpret_cast<char*>(data);
+    ring.elemsize = sizeof(U);
+    ring.numel = numel;
+    const size_t chunk_bytes = (numel / numprocs() + 1) * sizeof(U);
+    ring.nsegments = (chunk_bytes + RING_ALL_REDUCE_SEGMENT_SIZE - 1) /
+                     RING_ALL_REDUCE_SEGMENT_SIZE;
+    ring.control = control;
+    ring.accumulate = ring_accumulator<U, PlusEqual>(plusequal);
+    ring.completed = 0;
+    // every machine must be ready to receive before the first segment is
+    // sent. This also ensures that the previous reduction has completed
+    // everywhere.
+    barrier();
+    for (size_t i = 0;i < ring.nsegments; ++i) {
+      ring_send(false, procid(), i);
+    }
+    ring_mut.lock();
+    while (ring.completed < numprocs() * ring.nsegments) {
+      ring_cond.wait(ring_mut);
+    }
+    ring_mut.unlock();
+  }
+
+  /**
+   * \brief Adds up an array contributed by each machine elementwise,
+   * making the result available to all machines.
+   * See all_reduce_array2().
+   */
+  template <typename U>
+  void all_reduce_array(U* data, size_t numel, bool control = false) {
+    all_reduce_array2(data, numel, default_plus_equal<U>(), control);
+  }
+
+  /**
+   * \brief Adds up a vector contributed by each machine elementwise,
+   * making the result available to all machines. The vector must have the
+   * same length on all machines. See all_reduce_array2().
+   */
+  template <typename U>
+  void all_reduce_array(std::vector<U>& data, bool control = false) {
+    if (data.empty()) return;
+    all_reduce_array2(&(data[0]), data.size(), default_plus_equal<U>(),
+                      control);
+  }
+
+
+/*****************************************************************************
+                 Implementation of the non-blocking collectives
+ *****************************************************************************/
+
+ private:
+  /**
+   * The state of one non-blocking collective on this machine.
+   * The collectives are numbered in the order in which they are issued,
+   * which must be the same on all machines. Every machine waits for its
+   * own contribution and the contributions of its children in the
+   * barrier tree, combines them, and passes the result to its parent.
+   * The root finalizes the result and sends it back down the tree.
+   */
+  struct icollective_state {
+    bool has_local;
+    std::string local;
+    procid_t nchildren_received;
+    std::string children[BARRIER_BRANCH_FACTOR];
+    /// combines a child's contribution into the accumulated one
+    boost::function<void(std::string&, const std::string&)> combine;
+    /// turns the complete contribution into the serialized result
+    boost::function<void(std::string&)> finalize;
+    dc_impl::ireply_container* reply;
+    bool control;
+    icollective_state(): has_local(false), nchildren_received(0),
+                         reply(NULL), control(false) { }
+  };
+  std::map<size_t, icollective_state> icoll_states;
+  size_t icoll_next_seq;
+  mutex icoll_mut;
+
+  template <typename U, typename PlusEqual>
+  struct icoll_reduce_combine {
+    PlusEqual plusequal;
+    icoll_reduce_combine(PlusEqual plusequal): plusequal(plusequal) { }
+    void operator()(std::string& acc, const std::string& child) {
+      U left, right;
+      std::stringstream lstrm(acc);
+      iarchive liarc(lstrm);
+      liarc >> left;
+      std::stringstream rstrm(child);
+      iarchive riarc(rstrm);
+      riarc >> right;
+      plusequal(left, right);
+      charstream ostrm(128);
+      oarchive oarc(ostrm);
+      oarc << left;
+      ostrm.flush();
+      acc.assign(ostrm->c_str(), ostrm->size());
+    }
+  };
+
+  /// gather contributions are (procid, value) records, concatenated
+  static void icoll_gather_combine(std::string& acc, const std::string& child) {
+    acc.append(child);
+  }
+
+  template <typename U>
+  struct icoll_gather_finalize {
+    size_t nprocs;
+    icoll_gather_finalize(size_t nprocs): nprocs(nprocs) { }
+    void operator()(std::string& acc) {
+      std::vector<U> result(nprocs);
+      std::stringstream istrm(acc);
+      iarchive iarc(istrm);
+      for (size_t i = 0;i < nprocs; ++i) {
+        procid_t source;
+        iarc >> source;
+        iarc >> result[source];
+      }
+      charstream ostrm(128);
+      oarchive oarc(ostrm);
+      oarc << result;
+      ostrm.flush();
+      acc.assign(ostrm->c_str(), ostrm->size());
+    }
+  };
+
+  static void icoll_no_finalize(std::string& acc) { }
+
+  static void icoll_barrier_combine(std::string& acc, const std::string& child) { }
+
+  static void icoll_barrier_finalize(std::string& acc) {
+    // the value read by request_future<void>
+    charstream ostrm(128);
+    oarchive oarc(ostrm);
+    oarc << size_t(0);
+    ostrm.flush();
+    acc.assign(ostrm->c_str(), ostrm->size());
+  }
+
+  /**
+   * Sends the contribution of collective seq upwards if this machine and
+   * all its children have contributed. Must be called with icoll_mut held.
+   * Releases icoll_mut.
+   */
+  void icoll_try_advance(size_t seq) {
+    icollective_state& state = icoll_states[seq];
+    if (!state.has_local || state.nchildren_received < numchild) {
+      icoll_mut.unlock();
+      return;
+    }
+    std::string acc;
+    acc.swap(state.local);
+    for (procid_t i = 0;i < numchild; ++i) {
+      state.combine(acc, state.children[i]);
+      state.children[i].clear();
+    }
+    const bool control = state.control;
+    if (procid() != 0) {
+      icoll_mut.unlock();
+      if (control) {
+        internal_control_call(parent,
+                              &dc_dist_object<T>::__icoll_child_to_parent,
+                              seq, procid(), acc);
+      } else {
+        internal_call(parent, &dc_dist_object<T>::__icoll_child_to_parent,
+                      seq, procid(), acc);
+      }
+    } else {
+      state.finalize(acc);
+      icoll_mut.unlock();
+      __icoll_parent_to_child(seq, acc, control);
+    }
+  }
+
+  /// A child passes its combined contribution to collective seq upwards
+  void __icoll_child_to_parent(size_t seq, procid_t source, std::string data) {
+    ASSERT_GE(source, childbase);
+    ASSERT_LT(source, childbase + BARRIER_BRANCH_FACTOR);
+    icoll_mut.lock();
+    icollective_state& state = icoll_states[seq];
+    state.children[source - childbase].swap(data);
+    ++state.nchildren_received;
+    icoll_try_advance(seq);
+  }
+
+  /// The parent passes the result of collective seq downwards
+  void __icoll_parent_to_child(size_t seq, std::string result, bool control) {
+    for (procid_t i = 0;i < numchild; ++i) {
+      if (control) {
+        internal_control_call((procid_t)(childbase + i),
+                              &dc_dist_object<T>::__icoll_parent_to_child,
+                              seq, result, control);
+      } else {
+        internal_call((procid_t)(childbase + i),
+                      &dc_dist_object<T>::__icoll_parent_to_child,
+                      seq, result, control);
+      }
+    }
+    icoll_mut.lock();
+    typename std::map<size_t, icollective_state>::iterator iter =
+        icoll_states.find(seq);
+    ASSERT_TRUE(iter != icoll_states.end());
+    dc_impl::ireply_container* reply = iter->second.reply;
+    icoll_states.erase(iter);
+    icoll_mut.unlock();
+    char* buf = (char*)malloc(result.length());
+    memcpy(buf, result.c_str(), result.length());
+    reply->receive(procid(), dc_impl::blob(buf, result.length()));
+  }
+
+  /**
+   * Issues this machine's contribution to the next non-blocking collective,
+   * returning the container which will receive the result.
+   */
+  dc_impl::ireply_container* icoll_begin(
+      const std::string& local,
+      boost::function<void(std::string&, const std::string&)> combine,
+      boost::function<void(std::string&)> finalize,
+      bool control) {
+    dc_impl::ireply_container* reply = new dc_impl::basic_reply_container;
+    icoll_mut.lock();
+    size_t seq = icoll_next_seq++;
+    icollective_state& state = icoll_states[seq];
+    state.has_local = true;
+    state.local = local;
+    state.combine = combine;
+    state.finalize = finalize;
+    state.reply = reply;
+    state.control = control;
+    icoll_try_advance(seq);
+    return reply;
+  }
+
+  template <typename U>
+  static std::string icoll_serialize(const U& data) {
+    charstream strm(128);
+    oarchive oarc(strm);
+    oarc << data;
+    strm.flush();
+    return std::string(strm->c_str(), strm->size());
+  }
+
+ public:
+  /**
+   * \brief A non-blocking all_reduce2().
+   *
+   * Contributes data to a reduction over all machines and returns
+   * immediately. The returned future holds the reduced value once all
+   * machines have contributed:
+   * \code
+   * request_future<size_t> total = rmi.iall_reduce(num_active);
+   * // ... do something else ...
+   * if (total() == 0) { ... }
+   * \endcode
+   *
+   * The non-blocking collectives may be called from any thread and
+   * several may be in flight at once, but all machines must issue the
+   * non-blocking collectives of an object in the same order. They are
+   * independent of the blocking collectives. The future must be waited on
+   * before it is destroyed.
+   *
+   * \param data The value contributed by this machine.
+   * \param plusequal A plusequal function on the data. Must have the
+   *                  prototype void plusequal(U&, const U&)
+   * \param control If set to true, this will be marked as control plane
+   *                communication. Must be the same on all machines.
+   */
+  template <typename U, typename PlusEqual>
+  request_future<U> iall_reduce2(const U& data, PlusEqual plusequal,
+                                 bool control = false) {
+    if (numprocs() == 1) return request_future<U>(data);
+    return request_future<U>(
+        icoll_begin(icoll_serialize(data),
+                    icoll_reduce_combine<U, PlusEqual>(plusequal),
+                    boost::function<void(std::string&)>(
+                        &dc_dist_object<T>::icoll_no_finalize),
+                    control));
+  }
+
+  /// \brief A non-blocking all_reduce(). See iall_reduce2().
+  template <typename U>
+  request_future<U> iall_reduce(const U& data, bool control = false) {
+    return iall_reduce2(data, default_plus_equal<U>(), control);
+  }
+
+  /**
+   * \brief A non-blocking all_gather().
+   *
+   * Contributes data to a gather over all machines and returns
+   * immediately. Once all machines have contributed, the future holds
+   * a vector of numprocs() entries, entry i being the value contributed
+   * by machine i. See iall_reduce2() for the rules governing the
+   * non-blocking collectives.
+   */
+  template <typename U>
+  request_future<std::vector<U> > iall_gather(const U& data,
+                                              bool control = false) {
+    if (numprocs() == 1) return request_future<std::vector<U> >(
+        std::vector<U>(1, data));
+    charstream strm(128);
+    oarchive oarc(strm);
+    oarc << procid() << data;
+    strm.flush();
+    return request_future<std::vector<U> >(
+        icoll_begin(std::string(strm->c_str(), strm->size()),
+                    &dc_dist_object<T>::icoll_gather_combine,
+                    icoll_gather_finalize<U>(numprocs()),
+                    control));
+  }
+
+  /**
+   * \brief A non-blocking barrier().
+   *
+   * The returned future becomes ready once all machines have called
+   * ibarrier(). See iall_reduce2() for the rules governing the
+   * non-blocking collectives.
+   */
+  request_future<void> ibarrier() {
+    if (numprocs() == 1) return request_future<void>(0);
+    return request_future<void>(
+        icoll_begin(std::string(),
+                    &dc_dist_object<T>::icoll_barrier_combine,
+                    &dc_dist_object<T>::icoll_barrier_finalize,
+                    true));
+  }
+
 ////////////////////////////////////////////////////////////////////////////
 
 
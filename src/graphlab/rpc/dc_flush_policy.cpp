@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <time.h>
+#include <algorithm>
+#include <boost/lexical_cast.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/rpc/dc_compile_parameters.hpp>
+#include <graphlab/rpc/dc_flush_policy.hpp>
+
+namespace graphlab {
+namespace dc_impl {
+
+flush_policy::flush_policy()
+    : buffer_size(FULL_BUFFER_SIZE_LIMIT),
+      max_queue_length(NUM_FULL_BUFFER_LIMIT),
+      queue_length(NUM_FULL_BUFFER_LIMIT),
+      urgent_immediate(true), is_adaptive(true),
+      window_min_rtt(UINT64_MAX), next_update(0), last_update(0),
+      last_queued_bytes(0),
+      rtt_measured(false), rtt_estimate(ADAPTIVE_FLUSH_DEFAULT_RTT / 1e6),
+      throughput_estimate(0) { }
+
+void flush_policy::set_options(const std::map<std::string, std::string>& options) {
+  std::map<std::string, std::string>::const_iterator iter;
+  iter = options.find("flush_buffer_size");
+  if (iter != options.end()) {
+    buffer_size = std::max<size_t>(boost::lexical_cast<size_t>(iter->second), 1);
+  }
+  iter = options.find("flush_queue_length");
+  if (iter != options.end()) {
+    max_queue_length = std::max<size_t>(boost::lexical_cast<size_t>(iter->second), 1);
+  }
+  iter = options.find("adaptive_flush");
+  if (iter != options.end()) {
+    is_adaptive = !(iter->second == "0" || iter->second == "false");
+  }
+  iter = options.find("urgent_send");
+  if (iter != options.end()) {
+    if (iter->second == "immediate") urgent_immediate = true;
+    else if (iter->second == "soon") urgent_immediate = false;
+    else logstream(LOG_FATAL) << "Unknown urgent_send policy " << iter->second
+                              << ". Expecting immediate or soon." << std::endl;
+  }
+  queue_length = max_queue_length;
+  if (is_adaptive) retune(0, rtt_estimate);
+}
+
+uint64_t flush_policy::now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+void flush_policy::observe_queued(size_t bytes) {
+  queued_bytes.inc(bytes);
+  if (!is_adaptive) return;
+  uint64_t t = now();
+  if (t < next_update || !update_lock.try_lock()) return;
+  if (t >= next_update) {
+    if (last_update > 0) {
+      size_t total = queued_bytes.value;
+      double elapsed = double(t - last_update) / 1e9;
+      uint64_t minrtt = __sync_lock_test_and_set(&window_min_rtt, UINT64_MAX);
+      double rtt = rtt_estimate;
+      if (minrtt != UINT64_MAX) {
+        // the first measurement replaces the default
+        if (rtt_measured) rtt = 0.75 * rtt + 0.25 * (double(minrtt) / 1e9);
+        else rtt = double(minrtt) / 1e9;
+        rtt_measured = true;
+      }
+      retune(double(total - last_queued_bytes) / elapsed, rtt);
+      last_queued_bytes = total;
+    } else {
+      last_queued_bytes = queued_bytes.value;
+    }
+    last_update = t;
+    next_update = t + ADAPTIVE_FLUSH_INTERVAL * 1000ULL;
+  }
+  update_lock.unlock();
+}
+
+void flush_policy::observe_rtt(uint64_t ns) {
+  uint64_t cur = window_min_rtt;
+  while (ns < cur) {
+    if (__sync_bool_compare_and_swap(&window_min_rtt, cur, ns)) break;
+    cur = window_min_rtt;
+  }
+}
+
+void flush_policy::retune(double bytes_per_second, double rtt_seconds) {
+  throughput_estimate = bytes_per_second;
+  rtt_estimate = rtt_seconds;
+  // the number of full buffers which are in flight in one round trip
+  double bdp = bytes_per_second * rtt_seconds / buffer_size;
+  size_t length = size_t(std::min<double>(bdp, max_queue_length)) + 1;
+  queue_length = std::min(length, max_queue_length);
+}
+
+} // namespace dc_impl
+} // namespace graphlab
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_RPC_DC_FLUSH_POLICY_HPP
+#define GRAPHLAB_RPC_DC_FLUSH_POLICY_HPP
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+
+namespace graphlab {
+namespace dc_impl {
+
+/**
+ * \ingroup rpc
+ * \internal
+ * Decides when the thread local send buffers are handed to the sender.
+ *
+ * Calls belong to one of two classes:
+ * \li Urgent calls (remote requests, their replies, and
+ *     dc_dist_object::urgent_call()) are sent as soon as they are written.
+ *     With "urgent_send=immediate" (the default) the calling thread sends
+ *     them itself if the connection is idle; with "urgent_send=soon" the
+ *     send thread is woken up instead.
+ * \li Bulk calls are coalesced: a thread's buffer to a machine is queued
+ *     once it holds buffer_size_limit() bytes, and the send thread is woken
+ *     up once queue_limit() buffers are queued. Anything left is sent by
+ *     the periodic poll of the send thread.
+ *
+ * With "adaptive_flush=true" (the default), queue_limit() follows the
+ * bandwidth-delay product: the rate at which bulk data is queued times
+ * the smallest recently observed request round trip time. Slow traffic is
+ * therefore sent almost immediately, while fast traffic is coalesced into
+ * frames which are large enough to keep the connection busy.
+ */
+class flush_policy {
+ public:
+  flush_policy();
+
+  /**
+   * Reads the flush_buffer_size, flush_queue_length, adaptive_flush and
+   * urgent_send options. See dc_init_param::initstring.
+   */
+  void set_options(const std::map<std::string, std::string>& options);
+
+  /// A thread's buffer to a machine is queued once it holds this many bytes
+  inline size_t buffer_size_limit() const {
+    return buffer_size;
+  }
+
+  /// The sender is woken up once this many buffers to a machine are queued
+  inline size_t queue_limit() const {
+    return queue_length;
+  }
+
+  /// True if urgent calls are sent by the calling thread
+  inline bool send_urgent_immediately() const {
+    return urgent_immediate;
+  }
+
+  inline bool adaptive() const {
+    return is_adaptive;
+  }
+
+  /// Records a buffer of bulk calls queued for sending
+  void observe_queued(size_t bytes);
+
+  /// Records the round trip time of a request in nanoseconds
+  void observe_rtt(uint64_t ns);
+
+  /**
+   * Sets queue_limit() from a throughput in bytes per second and a round
+   * trip time in seconds. Called periodically by observe_queued().
+   */
+  void retune(double bytes_per_second, double rtt_seconds);
+
+  /// The current round trip time estimate in seconds
+  inline double rtt() const {
+    return rtt_estimate;
+  }
+
+  /// The bulk throughput measured in the last period, in bytes per second
+  inline double throughput() const {
+    return throughput_estimate;
+  }
+
+  /// A monotonic timestamp in nanoseconds
+  static uint64_t now();
+
+ private:
+  size_t buffer_size;
+  size_t max_queue_length;
+  volatile size_t queue_length;
+  bool urgent_immediate;
+  bool is_adaptive;
+
+  atomic<size_t> queued_bytes;
+  /// smallest round trip time since the last retune. UINT64_MAX if none
+  volatile uint64_t window_min_rtt;
+
+  mutex update_lock;
+  volatile uint64_t next_update;
+  uint64_t last_update;
+  size_t last_queued_bytes;
+  bool rtt_measured;
+  double rtt_estimate;
+  double throughput_estimate;
+};
+
+} // namespace dc_impl
+} // namespace graphlab
+#endif
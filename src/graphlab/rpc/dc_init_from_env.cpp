@@ -43,9 +43,14 @@ bool init_param_from_env(dc_init_param& param) {
     return false;
   }
 
+  // machine i listens on port SPAWNPORT + i
+  size_t portbase = 10000;
+  char* port = getenv("SPAWNPORT");
+  if (port != NULL) portbase = atoi(port);
+
   param.machines = strsplit(nodesstr, ",");
   for (size_t i = 0;i < param.machines.size(); ++i) {
-    param.machines[i] = param.machines[i] + ":" + tostr(10000 + i);
+    param.machines[i] = param.machines[i] + ":" + tostr(portbase + i);
   }
   // set defaults
   param.numhandlerthreads = RPC_DEFAULT_NUMHANDLERTHREADS;
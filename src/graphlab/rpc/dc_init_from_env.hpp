@@ -27,7 +27,12 @@
 namespace graphlab {
   /** 
    * \ingroup rpc
-   * initializes parameters from environment. Returns true on success */
+   * initializes parameters from environment. Returns true on success.
+   *
+   * SPAWNID is the id of this machine, and SPAWNNODES the comma separated
+   * host names of all machines. Machine i listens on port SPAWNPORT + i,
+   * where SPAWNPORT defaults to 10000.
+   */
   bool init_param_from_env(dc_init_param& param);
 }
 
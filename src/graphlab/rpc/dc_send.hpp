@@ -74,8 +74,12 @@ class dc_send{
    * Writes a string to an internal buffer to be flushed later.
    * This is a "slow path" to be used only when the thread local buffer
    * is not available.
+   * source is the thread local buffer the data was taken from, if any.
+   * The data is sent over the same connection as the rest of the data of
+   * that buffer, so that it does not overtake it.
    */
-  virtual void write_to_buffer(char* c, size_t len) = 0;
+  virtual void write_to_buffer(thread_local_buffer* source,
+                               char* c, size_t len) = 0;
 
   virtual size_t set_option(std::string opt, size_t val) {
     return 0;
@@ -84,9 +88,16 @@ class dc_send{
   /**
    * Returns length if there is data, 0 otherwise. This function
    * must be reentrant, but it is guaranteed that only one thread will
-   * call this function at anytime.
+   * call this function at anytime for each stripe.
+   *
+   * The outgoing data is divided into nstripes stripes, one for each
+   * connection to the target, and only the data of the given stripe is
+   * returned. All data written by one thread is in the same stripe, so
+   * the messages of a thread are transmitted in order.
    */
-  virtual size_t get_outgoing_data(circular_iovec_buffer& outdata) = 0;
+  virtual size_t get_outgoing_data(circular_iovec_buffer& outdata,
+                                   size_t stripe = 0,
+                                   size_t nstripes = 1) = 0;
 
 
   /**
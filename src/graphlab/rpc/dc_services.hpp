@@ -113,6 +113,50 @@ namespace graphlab {
       rmi.all_reduce2(data, plusequal, control);
     }
 
+    /// \copydoc distributed_control::all_reduce_array(std::vector<U>&, bool)
+    template <typename U>
+    inline void all_reduce_array(std::vector<U>& data, bool control = false) {
+      rmi.all_reduce_array(data, control);
+    }
+
+    /// \copydoc distributed_control::all_reduce_array(U*, size_t, bool)
+    template <typename U>
+    inline void all_reduce_array(U* data, size_t numel, bool control = false) {
+      rmi.all_reduce_array(data, numel, control);
+    }
+
+    /// \copydoc distributed_control::all_reduce_array2()
+    template <typename U, typename PlusEqual>
+    void all_reduce_array2(U* data, size_t numel, PlusEqual plusequal,
+                           bool control = false) {
+      rmi.all_reduce_array2(data, numel, plusequal, control);
+    }
+
+    /// \copydoc distributed_control::iall_reduce()
+    template <typename U>
+    inline request_future<U> iall_reduce(const U& data, bool control = false) {
+      return rmi.iall_reduce(data, control);
+    }
+
+    /// \copydoc distributed_control::iall_reduce2()
+    template <typename U, typename PlusEqual>
+    request_future<U> iall_reduce2(const U& data, PlusEqual plusequal,
+                                   bool control = false) {
+      return rmi.iall_reduce2(data, plusequal, control);
+    }
+
+    /// \copydoc distributed_control::iall_gather()
+    template <typename U>
+    inline request_future<std::vector<U> > iall_gather(const U& data,
+                                                       bool control = false) {
+      return rmi.iall_gather(data, control);
+    }
+
+    /// \copydoc distributed_control::ibarrier()
+    inline request_future<void> ibarrier() {
+      return rmi.ibarrier();
+    }
+
     /// \copydoc distributed_control::barrier()
     inline void barrier() {
       rmi.barrier();
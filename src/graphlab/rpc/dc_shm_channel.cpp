@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/rpc/dc_shm_channel.hpp>
+
+namespace graphlab {
+namespace dc_impl {
+
+namespace {
+
+const uint64_t SHM_MAGIC = 0x67726c6273686d31ULL;  // "grlbshm1"
+const size_t SHM_ALIGN = 4096;
+
+/**
+ * The start of every segment. The ring offset table
+ * (nprocs uint64_t entries, 0 if the process has no ring) follows it.
+ */
+struct shm_segment_header {
+  volatile uint64_t magic;
+  char hostname[64];
+  uint64_t nprocs;
+  char pad0[64 - sizeof(uint64_t)];
+  /// incremented by senders to wake up the receiver
+  volatile uint32_t doorbell;
+  /// set by the receiver before sleeping on the doorbell
+  volatile uint32_t sleeping;
+  char pad1[64 - 2 * sizeof(uint32_t)];
+
+  inline uint64_t* ring_offset() {
+    return reinterpret_cast<uint64_t*>(this + 1);
+  }
+};
+
+inline size_t round_up(size_t n, size_t align) {
+  return (n + align - 1) / align * align;
+}
+
+std::string get_hostname() {
+  char buf[64];
+  memset(buf, 0, sizeof(buf));
+  gethostname(buf, sizeof(buf) - 1);
+  return std::string(buf);
+}
+
+void wait_doorbell(volatile uint32_t* addr, uint32_t val, size_t timeout_ms) {
+#ifdef __linux__
+  struct timespec ts;
+  ts.tv_sec = timeout_ms / 1000;
+  ts.tv_nsec = (timeout_ms % 1000) * 1000000;
+  // not FUTEX_PRIVATE: the word is shared between processes
+  syscall(SYS_futex, addr, FUTEX_WAIT, val, &ts, NULL, 0);
+#else
+  if (*addr == val) usleep(std::min<size_t>(timeout_ms * 1000, 100));
+#endif
+}
+
+void ring_doorbell(volatile uint32_t* addr) {
+  __sync_fetch_and_add(addr, 1);
+#ifdef __linux__
+  syscall(SYS_futex, addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+} // anonymous namespace
+
+
+
+shm_inbox::shm_inbox(): base(NULL), length(0) { }
+
+bool shm_inbox::create(const std::string& name,
+                       const std::vector<procid_t>& sources,
+                       procid_t nprocs,
+                       size_t ringsize) {
+  destroy();
+  this->name = name;
+  size_t capacity = 4096;
+  while (capacity < ringsize) capacity *= 2;
+  const size_t table_end = round_up(sizeof(shm_segment_header) +
+                                    nprocs * sizeof(uint64_t), SHM_ALIGN);
+  const size_t ring_stride = round_up(sizeof(shm_ring) + capacity, SHM_ALIGN);
+  length = table_end + sources.size() * ring_stride;
+
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0 && errno == EEXIST) {
+    // left behind by a process which did not shut down cleanly
+    shm_unlink(name.c_str());
+    fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  }
+  if (fd < 0) {
+    logstream(LOG_WARNING) << "Unable to create shared memory segment "
+                           << name << ": " << strerror(errno) << std::endl;
+    return false;
+  }
+  if (ftruncate(fd, length) != 0) {
+    logstream(LOG_WARNING) << "Unable to size shared memory segment "
+                           << name << ": " << strerror(errno) << std::endl;
+    ::close(fd);
+    shm_unlink(name.c_str());
+    return false;
+  }
+  void* ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (ptr == MAP_FAILED) {
+    logstream(LOG_WARNING) << "Unable to map shared memory segment "
+                           << name << ": " << strerror(errno) << std::endl;
+    shm_unlink(name.c_str());
+    return false;
+  }
+  base = reinterpret_cast<char*>(ptr);
+  // a fresh segment is zero filled
+  shm_segment_header* header = reinterpret_cast<shm_segment_header*>(base);
+  strncpy(header->hostname, get_hostname().c_str(),
+          sizeof(header->hostname) - 1);
+  header->nprocs = nprocs;
+  rings.clear();
+  for (size_t i = 0;i < sources.size(); ++i) {
+    const size_t offset = table_end + i * ring_stride;
+    shm_ring* ring = reinterpret_cast<shm_ring*>(base + offset);
+    ring->capacity = capacity;
+    header->ring_offset()[sources[i]] = offset;
+    rings.push_back(std::make_pair(sources[i], ring));
+  }
+  __sync_synchronize();
+  header->magic = SHM_MAGIC;
+  return true;
+}
+
+void shm_inbox::unlink() {
+  if (!name.empty()) {
+    shm_unlink(name.c_str());
+    name.clear();
+  }
+}
+
+bool shm_inbox::has_data() const {
+  for (size_t i = 0;i < rings.size(); ++i) {
+    if (rings[i].second->head != rings[i].second->tail) return true;
+  }
+  return false;
+}
+
+size_t shm_inbox::poll(const std::vector<dc_receive*>& receiver) {
+  size_t total = 0;
+  for (size_t i = 0;i < rings.size(); ++i) {
+    shm_ring* ring = rings[i].second;
+    uint64_t tail = ring->tail;
+    uint64_t head = ring->head;
+    if (head == tail) continue;
+    // the data must not be read before the head
+    __sync_synchronize();
+    dc_receive* recv = receiver[rings[i].first];
+    const uint64_t mask = ring->capacity - 1;
+    char* data = ring->data();
+    size_t buflength;
+    char* c = recv->get_buffer(buflength);
+    while (tail != head) {
+      const size_t offset = tail & mask;
+      size_t len = std::min<size_t>(head - tail, ring->capacity - offset);
+      len = std::min(len, buflength);
+      memcpy(c, data + offset, len);
+      tail += len;
+      total += len;
+      // hand the space back before parsing, so the producer can continue
+      __sync_synchronize();
+      ring->tail = tail;
+      c = recv->advance_buffer(c, len, buflength);
+    }
+  }
+  return total;
+}
+
+void shm_inbox::wait(size_t timeout_ms) {
+  if (base == NULL) return;
+  shm_segment_header* header = reinterpret_cast<shm_segment_header*>(base);
+  const uint32_t val = header->doorbell;
+  header->sleeping = 1;
+  // pairs with the fence in shm_outbox::write(): either the sender sees
+  // sleeping, or we see its data.
+  __sync_synchronize();
+  if (!has_data()) wait_doorbell(&header->doorbell, val, timeout_ms);
+  header->sleeping = 0;
+}
+
+void shm_inbox::wake() {
+  if (base == NULL) return;
+  shm_segment_header* header = reinterpret_cast<shm_segment_header*>(base);
+  ring_doorbell(&header->doorbell);
+}
+
+void shm_inbox::destroy() {
+  unlink();
+  if (base != NULL) {
+    munmap(base, length);
+    base = NULL;
+    length = 0;
+  }
+  rings.clear();
+}
+
+
+
+shm_outbox::shm_outbox(): base(NULL), length(0), ring(NULL) { }
+
+bool shm_outbox::open(const std::string& name, procid_t source) {
+  close();
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      size_t(st.st_size) < sizeof(shm_segment_header)) {
+    ::close(fd);
+    return false;
+  }
+  void* ptr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (ptr == MAP_FAILED) return false;
+  base = reinterpret_cast<char*>(ptr);
+  length = st.st_size;
+  shm_segment_header* header = reinterpret_cast<shm_segment_header*>(base);
+  // the segment must be complete, created on this host, and have a ring
+  // for this process
+  if (header->magic != SHM_MAGIC ||
+      std::string(header->hostname) != get_hostname() ||
+      source >= header->nprocs ||
+      sizeof(shm_segment_header) + header->nprocs * sizeof(uint64_t) > length ||
+      header->ring_offset()[source] == 0 ||
+      header->ring_offset()[source] + sizeof(shm_ring) > length) {
+    close();
+    return false;
+  }
+  __sync_synchronize();
+  ring = reinterpret_cast<shm_ring*>(base + header->ring_offset()[source]);
+  return true;
+}
+
+size_t shm_outbox::write(const struct iovec* iov, size_t iovcnt) {
+  const uint64_t capacity = ring->capacity;
+  const uint64_t mask = capacity - 1;
+  uint64_t head = ring->head;
+  const uint64_t tail = ring->tail;
+  // the space must not be overwritten before it has been read
+  __sync_synchronize();
+  size_t space = capacity - (head - tail);
+  if (space == 0) return 0;
+  char* data = ring->data();
+  size_t written = 0;
+  for (size_t i = 0;i < iovcnt && space > 0; ++i) {
+    const char* src = reinterpret_cast<const char*>(iov[i].iov_base);
+    size_t len = std::min<size_t>(iov[i].iov_len, space);
+    while (len > 0) {
+      const size_t offset = head & mask;
+      const size_t chunk = std::min<size_t>(len, capacity - offset);
+      memcpy(data + offset, src, chunk);
+      src += chunk;
+      head += chunk;
+      len -= chunk;
+      space -= chunk;
+      written += chunk;
+    }
+  }
+  if (written > 0) {
+    __sync_synchronize();
+    ring->head = head;
+    // pairs with the fence in shm_inbox::wait()
+    __sync_synchronize();
+    shm_segment_header* header = reinterpret_cast<shm_segment_header*>(base);
+    if (header->sleeping) ring_doorbell(&header->doorbell);
+  }
+  return written;
+}
+
+void shm_outbox::close() {
+  if (base != NULL) {
+    munmap(base, length);
+    base = NULL;
+    length = 0;
+    ring = NULL;
+  }
+}
+
+} // namespace dc_impl
+} // namespace graphlab
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_RPC_DC_SHM_CHANNEL_HPP
+#define GRAPHLAB_RPC_DC_SHM_CHANNEL_HPP
+#include <stdint.h>
+#include <sys/uio.h>
+#include <string>
+#include <vector>
+#include <graphlab/rpc/dc_types.hpp>
+#include <graphlab/rpc/dc_receive.hpp>
+
+namespace graphlab {
+namespace dc_impl {
+
+/**
+ * \ingroup rpc
+ * \internal
+ * A single producer, single consumer byte ring living in shared memory.
+ * head and tail only ever increase; the position in the data array is
+ * taken modulo the capacity, which is a power of 2.
+ * The data array follows the structure.
+ */
+struct shm_ring {
+  /// total number of bytes written. Only modified by the producer
+  volatile uint64_t head;
+  char pad0[64 - sizeof(uint64_t)];
+  /// total number of bytes read. Only modified by the consumer
+  volatile uint64_t tail;
+  char pad1[64 - sizeof(uint64_t)];
+  uint64_t capacity;
+  char pad2[64 - sizeof(uint64_t)];
+
+  inline char* data() {
+    return reinterpret_cast<char*>(this) + sizeof(shm_ring);
+  }
+};
+
+
+/**
+ * \ingroup rpc
+ * \internal
+ * The receiving side of the shared memory transport.
+ *
+ * Every process owns one POSIX shared memory segment holding one
+ * shm_ring per co-located sender. A sender maps the segment with a
+ * shm_outbox and writes its stream into its own ring. The segment also
+ * contains a doorbell: a futex on which the receiving thread sleeps when
+ * all rings are empty.
+ */
+class shm_inbox {
+ public:
+  shm_inbox();
+  ~shm_inbox() { destroy(); }
+
+  /**
+   * Creates the segment with the given name, with one ring of ringsize
+   * bytes (rounded up to a power of 2) for each process in sources.
+   * Returns false on failure, in which case the shared memory transport
+   * cannot be used.
+   */
+  bool create(const std::string& name,
+              const std::vector<procid_t>& sources,
+              procid_t nprocs,
+              size_t ringsize);
+
+  /// True if create() succeeded
+  inline bool active() const { return base != NULL; }
+
+  /**
+   * Removes the name of the segment. Existing mappings remain valid.
+   * Should be called once all senders have opened it.
+   */
+  void unlink();
+
+  /**
+   * Moves all data available in the rings into the receivers, and returns
+   * the number of bytes received. receiver[i] gets the stream of process i.
+   * Must only be called from one thread.
+   */
+  size_t poll(const std::vector<dc_receive*>& receiver);
+
+  /**
+   * Sleeps until a sender rings the doorbell, or timeout_ms expires.
+   * Returns immediately if any ring has data.
+   */
+  void wait(size_t timeout_ms);
+
+  /// Wakes up a thread sleeping in wait()
+  void wake();
+
+  /// Unmaps the segment
+  void destroy();
+
+ private:
+  std::string name;
+  char* base;
+  size_t length;
+  std::vector<std::pair<procid_t, shm_ring*> > rings;
+  bool has_data() const;
+};
+
+
+/**
+ * \ingroup rpc
+ * \internal
+ * The sending side of the shared memory transport: maps the segment
+ * created by the shm_inbox of another process on the same host, and
+ * writes into the ring of this process.
+ */
+class shm_outbox {
+ public:
+  shm_outbox();
+  ~shm_outbox() { close(); }
+
+  /**
+   * Maps the segment with the given name and locates the ring of
+   * process source. Returns false if the segment does not exist,
+   * was created on another host, or has no ring for this process.
+   */
+  bool open(const std::string& name, procid_t source);
+
+  /**
+   * Copies as much of the iovecs as will fit into the ring and
+   * returns the number of bytes written.
+   * Must only be called from one thread at a time.
+   */
+  size_t write(const struct iovec* iov, size_t iovcnt);
+
+  /// Unmaps the segment
+  void close();
+
+ private:
+  char* base;
+  size_t length;
+  shm_ring* ring;
+};
+
+} // namespace dc_impl
+} // namespace graphlab
+#endif
@@ -31,6 +31,25 @@
 #include <netinet/tcp.h>
 #include <ifaddrs.h>
 #include <poll.h>
+#include <sched.h>
+#ifdef __linux__
+#include <linux/errqueue.h>
+// MSG_ZEROCOPY support. Defined here in case the libc headers are older
+// than the kernel.
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+#define HAS_MSG_ZEROCOPY
+#endif
 
 #include <limits>
 #include <vector>
@@ -71,21 +90,32 @@ namespace graphlab {
       receiver = receiver_;
       sender = sender_;
 
+      nstreams = streams_per_machine(initopts);
+      ASSERT_EQ(receiver.size(), nprocs * nstreams);
+
       // insert machines into the address map
       all_addrs.resize(nprocs);
       portnums.resize(nprocs);
-      assert(triggered_timeouts.size() >= nprocs);
-      triggered_timeouts.clear();
+      loops.resize(nstreams);
+      for (size_t i = 0;i < nstreams; ++i) {
+        assert(loops[i].triggered_timeouts.size() >= nprocs);
+        loops[i].triggered_timeouts.clear();
+      }
       // fill all the socks
-      sock.resize(nprocs);
-      for (size_t i = 0;i < nprocs; ++i) {
-        sock[i].id = i;
+      sock.resize(nprocs * nstreams);
+      for (size_t i = 0;i < sock.size(); ++i) {
+        sock[i].id = i % nprocs;
+        sock[i].stream = i / nprocs;
         sock[i].owner = this;
         sock[i].outsock = -1;
         sock[i].insock = -1;
         sock[i].inevent = NULL;
         sock[i].outevent = NULL;
         sock[i].wouldblock = false;
+        sock[i].shm = NULL;
+        sock[i].zerocopy = false;
+        sock[i].zc_next_seq = 0;
+        sock[i].zc_completed = 0;
         sock[i].data.msg_name = NULL;
         sock[i].data.msg_namelen = 0;
         sock[i].data.msg_control = NULL;
@@ -115,9 +145,40 @@ namespace graphlab {
       }
       network_bytessent = 0;
       buffered_len = 0;
+      std::map<std::string, std::string>::const_iterator iter;
+      // shared memory options
+      use_shm = true;
+      shm_ring_size = SHM_RING_SIZE;
+      iter = initopts.find("shm");
+      if (iter != initopts.end()) {
+        use_shm = !(iter->second == "0" || iter->second == "false");
+      }
+      iter = initopts.find("shm_ring_size");
+      if (iter != initopts.end()) {
+        shm_ring_size = boost::lexical_cast<size_t>(iter->second);
+      }
+      zerocopy_threshold = 0;
+      iter = initopts.find("zerocopy_threshold");
+      if (iter != initopts.end()) {
+        zerocopy_threshold = boost::lexical_cast<size_t>(iter->second);
+      }
+      send_poll_timeout = SEND_POLL_TIMEOUT;
+      iter = initopts.find("send_poll_timeout");
+      if (iter != initopts.end()) {
+        send_poll_timeout = boost::lexical_cast<size_t>(iter->second);
+      }
+      // the shared memory segment must exist before anyone
+      // can connect to us
+      if (use_shm) {
+        std::vector<procid_t> local_procs;
+        for (procid_t i = 0;i < nprocs; ++i) {
+          if (is_local(i)) local_procs.push_back(i);
+        }
+        inbox.create(shm_segment_name(curid), local_procs,
+                     nprocs, shm_ring_size);
+      }
       // if sock handle is set
-      std::map<std::string, std::string>::const_iterator iter =
-        initopts.find("__sockhandle__");
+      iter = initopts.find("__sockhandle__");
       if (iter != initopts.end()) {
         open_listening(atoi(iter->second.c_str()));
       } else {
@@ -137,7 +198,7 @@ namespace graphlab {
         // wait for p - 1 incoming connections
         insock_lock.lock();
         while(1) {
-          if (num_in_connected() == sock.size() - 1) break;
+          if (num_in_connected() == sock.size() - nstreams) break;
           insock_cond.wait(insock_lock);
         }
         insock_lock.unlock();
@@ -170,45 +231,73 @@ namespace graphlab {
         // barrier release message
         for(size_t i = 0;i < nprocs; ++i) connect(i);
       }
+      // everyone is connected, and every local machine has opened
+      // its ring into our segment
+      inbox.unlink();
+      size_t num_shm = 0;
+      for (size_t i = 0;i < sock.size(); ++i) num_shm += (sock[i].shm != NULL);
+      if (num_shm > 0) {
+        logstream(LOG_INFO) << "Proc " << procid() << " sends to " << num_shm
+                            << " local machines through shared memory" << std::endl;
+      }
       // everyone is connected.
       // Construct the eventbase
       construct_events();
-      // we reserve the last 2 cores for communication
-      inthreads.launch(boost::bind(&dc_tcp_comm::receive_loop, this, inevbase), thread::cpu_count() - 2);
-      outthreads.launch(boost::bind(&dc_tcp_comm::send_loop, this, outevbase), thread::cpu_count() - 1);
+      // we reserve the last 2 cores for communication,
+      // and 2 more for each additional stream
+      const size_t ncpus = thread::cpu_count();
+      for (size_t i = 0;i < nstreams; ++i) {
+        const size_t incpu = (2 * nstreams * ncpus - 2 * i - 2) % ncpus;
+        const size_t outcpu = (2 * nstreams * ncpus - 2 * i - 1) % ncpus;
+        inthreads.launch(boost::bind(&dc_tcp_comm::receive_loop, this,
+                                     loops[i].inevbase), incpu);
+        outthreads.launch(boost::bind(&dc_tcp_comm::send_loop, this,
+                                      loops[i].outevbase), outcpu);
+      }
+      if (inbox.active()) {
+        shm_closing = false;
+        inthreads.launch(boost::bind(&dc_tcp_comm::shm_receive_loop, this), thread::cpu_count() - 2);
+      }
       is_closed = false;
     }
 
     void dc_tcp_comm::construct_events() {
       int ret = evthread_use_pthreads();
       if (ret < 0) logstream(LOG_FATAL) << "Unable to initialize libevent with pthread support!" << std::endl;
-      // number of evs to create.
-      outevbase = event_base_new();
-      if (!outevbase) logstream(LOG_FATAL) << "Unable to construct libevent base" << std::endl;
-      send_all_timeout.owner = this;
-      send_all_timeout.send_all = true;
-      send_triggered_timeout.owner = this;
-      send_triggered_timeout.send_all = false;
-      send_all_event = event_new(outevbase, -1, EV_TIMEOUT | EV_PERSIST, on_send_event, &(send_all_timeout));
-      assert(send_all_event != NULL);
-      struct timeval t = {SEND_POLL_TIMEOUT / 1000000, SEND_POLL_TIMEOUT %  1000000} ;
-      event_add(send_all_event, &t);
-      send_triggered_event = event_new(outevbase, -1, EV_TIMEOUT | EV_PERSIST, on_send_event, &(send_triggered_timeout));
-      assert(send_triggered_event != NULL);
-
-      inevbase = event_base_new();
-      if (!inevbase) logstream(LOG_FATAL) << "Unable to construct libevent base" << std::endl;
+      // one pair of event bases for each stream
+      for (size_t i = 0;i < nstreams; ++i) {
+        event_loop& loop = loops[i];
+        loop.outevbase = event_base_new();
+        if (!loop.outevbase) logstream(LOG_FATAL) << "Unable to construct libevent base" << std::endl;
+        loop.send_all_timeout.owner = this;
+        loop.send_all_timeout.send_all = true;
+        loop.send_all_timeout.stream = i;
+        loop.send_triggered_timeout.owner = this;
+        loop.send_triggered_timeout.send_all = false;
+        loop.send_triggered_timeout.stream = i;
+        loop.send_all_event = event_new(loop.outevbase, -1, EV_TIMEOUT | EV_PERSIST, on_send_event, &(loop.send_all_timeout));
+        assert(loop.send_all_event != NULL);
+        struct timeval t = {long(send_poll_timeout / 1000000),
+                            long(send_poll_timeout % 1000000)};
+        event_add(loop.send_all_event, &t);
+        loop.send_triggered_event = event_new(loop.outevbase, -1, EV_TIMEOUT | EV_PERSIST, on_send_event, &(loop.send_triggered_timeout));
+        assert(loop.send_triggered_event != NULL);
+
+        loop.inevbase = event_base_new();
+        if (!loop.inevbase) logstream(LOG_FATAL) << "Unable to construct libevent base" << std::endl;
+      }
 
 
       //register all event objects
       for (size_t i = 0;i < sock.size(); ++i) {
-        sock[i].inevent = event_new(inevbase, sock[i].insock, EV_READ | EV_PERSIST | EV_ET,
+        event_loop& loop = loops[sock[i].stream];
+        sock[i].inevent = event_new(loop.inevbase, sock[i].insock, EV_READ | EV_PERSIST | EV_ET,
                                      on_receive_event, &(sock[i]));
         if (sock[i].inevent == NULL) {
           logstream(LOG_FATAL) << "Unable to register socket read event" << std::endl;
         }
 
-        sock[i].outevent = event_new(outevbase, sock[i].outsock, EV_WRITE | EV_PERSIST | EV_ET,
+        sock[i].outevent = event_new(loop.outevbase, sock[i].outsock, EV_WRITE | EV_PERSIST | EV_ET,
                                      on_send_event, &(sock[i]));
         if (sock[i].outevent == NULL) {
           logstream(LOG_FATAL) << "Unable to register socket write event" << std::endl;
@@ -220,6 +309,15 @@ namespace graphlab {
       }
     }
 
+    size_t dc_tcp_comm::streams_per_machine(
+        const std::map<std::string,std::string> &initopts) const {
+      std::map<std::string, std::string>::const_iterator iter =
+        initopts.find("tcp_connections");
+      if (iter == initopts.end()) return 1;
+      size_t n = boost::lexical_cast<size_t>(iter->second);
+      return std::max<size_t>(n, 1);
+    }
+
     size_t dc_tcp_comm::num_in_connected() const {
       size_t connected = 0;
       for (size_t i = 0;i < sock.size(); ++i) {
@@ -229,15 +327,26 @@ namespace graphlab {
     }
 
     void dc_tcp_comm::trigger_send_timeout(procid_t target, bool urgent) {
-      if (!urgent) {
-        if (sock[target].wouldblock == false &&
-            triggered_timeouts.get(target) == false) {
-          triggered_timeouts.set_bit(target);
-          event_active(send_triggered_event, EV_TIMEOUT, 1);
+      const size_t nstripes = num_stripes(target);
+      for (size_t i = 0;i < nstripes; ++i) {
+        socket_info& sockinfo = get_sock(target, i);
+        if (!urgent) {
+          event_loop& loop = loops[i];
+          if (sockinfo.wouldblock == false &&
+              loop.triggered_timeouts.get(target) == false) {
+            loop.triggered_timeouts.set_bit(target);
+            event_active(loop.send_triggered_event, EV_TIMEOUT, 1);
+          }
+        }
+        else if (!process_sock(&sockinfo)) {
+          // another thread is sending on this connection, and may have
+          // collected its data before ours was queued
+          event_loop& loop = loops[i];
+          if (loop.triggered_timeouts.get(target) == false) {
+            loop.triggered_timeouts.set_bit(target);
+            event_active(loop.send_triggered_event, EV_TIMEOUT, 1);
+          }
         }
-      }
-      else {
-        process_sock(&(sock[target]));
       }
     }
 
@@ -253,15 +362,25 @@ namespace graphlab {
       // shutdown the listening thread
       listenthread.join();
 
-      // clear the outevent loop
-      event_base_loopbreak(outevbase);
+      // clear the outevent loops
+      for (size_t i = 0;i < loops.size(); ++i) {
+        event_base_loopbreak(loops[i].outevbase);
+      }
       outthreads.join();
       for (size_t i = 0;i < sock.size(); ++i) {
         event_free(sock[i].outevent);
       }
-      event_free(send_triggered_event);
-      event_free(send_all_event);
-      event_base_free(outevbase);
+      for (size_t i = 0;i < loops.size(); ++i) {
+        event_free(loops[i].send_triggered_event);
+        event_free(loops[i].send_all_event);
+        event_base_free(loops[i].outevbase);
+      }
+      for (size_t i = 0;i < sock.size(); ++i) {
+        if (sock[i].shm != NULL) {
+          delete sock[i].shm;
+          sock[i].shm = NULL;
+        }
+      }
 
 
       logstream(LOG_INFO) << "Closing outgoing sockets" << std::endl;
@@ -271,15 +390,26 @@ namespace graphlab {
           ::close(sock[i].outsock);
           sock[i].outsock = -1;
         }
+        while (!sock[i].zc_buffers.empty()) {
+          free(sock[i].zc_buffers.front().second);
+          sock[i].zc_buffers.pop_front();
+        }
       }
 
-      // clear the inevent loop
-      event_base_loopbreak(inevbase);
+      // clear the inevent loops
+      for (size_t i = 0;i < loops.size(); ++i) {
+        event_base_loopbreak(loops[i].inevbase);
+      }
+      shm_closing = true;
+      inbox.wake();
       inthreads.join();
+      inbox.destroy();
       for (size_t i = 0;i < sock.size(); ++i) {
         event_free(sock[i].inevent);
       }
-      event_base_free(inevbase);
+      for (size_t i = 0;i < loops.size(); ++i) {
+        event_base_free(loops[i].inevbase);
+      }
 
 
       logstream(LOG_INFO) << "Closing incoming sockets" << std::endl;
@@ -296,11 +426,45 @@ namespace graphlab {
 
     bool dc_tcp_comm::send_till_block(socket_info& sockinfo) {
       sockinfo.wouldblock = false;
+      if (sockinfo.shm != NULL) {
+        // local machine. Copy into the ring.
+        // The receiver drains the ring at memory speed, so wait for a
+        // little while if it is full. Otherwise the data is left for the
+        // next send poll.
+        size_t retries = 0;
+        while(!sockinfo.outvec.empty()) {
+          sockinfo.outvec.fill_msghdr(sockinfo.data);
+          size_t ret = sockinfo.shm->write(sockinfo.data.msg_iov,
+                                           sockinfo.data.msg_iovlen);
+          if (ret == 0) {
+            if (++retries > 64) return false;
+            sched_yield();
+            continue;
+          }
+          retries = 0;
+          network_bytessent.inc(ret);
+          sockinfo.outvec.sent(ret);
+        }
+        return true;
+      }
       // while there is still data to be sent
       BEGIN_TRACEPOINT(tcp_send_call);
       while(!sockinfo.outvec.empty()) {
         sockinfo.outvec.fill_msghdr(sockinfo.data);
-        ssize_t ret = sendmsg(sockinfo.outsock, &sockinfo.data, 0);
+        size_t len = 0;
+        for (size_t i = 0;i < sockinfo.data.msg_iovlen; ++i) {
+          len += sockinfo.data.msg_iov[i].iov_len;
+        }
+        int flags = 0;
+#ifdef HAS_MSG_ZEROCOPY
+        if (sockinfo.zerocopy && len >= zerocopy_threshold) flags = MSG_ZEROCOPY;
+#endif
+        ssize_t ret = sendmsg(sockinfo.outsock, &sockinfo.data, flags);
+        if (ret < 0 && flags != 0 && errno == ENOBUFS) {
+          // out of socket option memory for the pinned pages. Copy instead.
+          flags = 0;
+          ret = sendmsg(sockinfo.outsock, &sockinfo.data, 0);
+        }
         if (ret < 0) {
           END_TRACEPOINT(tcp_send_call);
           if (errno == EWOULDBLOCK || errno == EAGAIN) {
@@ -317,12 +481,87 @@ namespace graphlab {
         logstream(LOG_INFO) << ret << " bytes --> " << sockinfo.id << std::endl;
 #endif
         network_bytessent.inc(ret);
-        sockinfo.outvec.sent(ret);
+        if (!sockinfo.zerocopy && sockinfo.zc_buffers.empty()) {
+          sockinfo.outvec.sent(ret);
+        } else {
+          // the kernel may still be reading from buffers of this or
+          // earlier MSG_ZEROCOPY sends. Free them after the last one completes.
+          if (flags != 0) ++sockinfo.zc_next_seq;
+          sockinfo.outvec.sent(ret, sockinfo.zc_released);
+          for (size_t i = 0;i < sockinfo.zc_released.size(); ++i) {
+            if (sockinfo.zc_completed == sockinfo.zc_next_seq) {
+              free(sockinfo.zc_released[i]);
+            } else {
+              sockinfo.zc_buffers.push_back(
+                  std::make_pair(sockinfo.zc_next_seq - 1,
+                                 sockinfo.zc_released[i]));
+            }
+          }
+          sockinfo.zc_released.clear();
+        }
+        // A short write means the socket buffer is full. With edge
+        // triggered events, this is as good as EAGAIN and saves a syscall.
+        if ((size_t)ret < len) {
+          END_TRACEPOINT(tcp_send_call);
+          sockinfo.wouldblock = true;
+          return false;
+        }
       }
       END_TRACEPOINT(tcp_send_call);
       return true;
     }
 
+    void dc_tcp_comm::reap_zerocopy(socket_info& sockinfo) {
+#ifdef HAS_MSG_ZEROCOPY
+      // read the completion notifications from the error queue
+      while (sockinfo.zc_completed != sockinfo.zc_next_seq) {
+        char control[128];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(sockinfo.outsock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) break;
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != NULL;
+             cm = CMSG_NXTHDR(&msg, cm)) {
+          if (cm->cmsg_level != SOL_IP || cm->cmsg_type != IP_RECVERR) continue;
+          struct sock_extended_err* serr =
+              reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cm));
+          if (serr->ee_errno != 0 ||
+              serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+          if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+            // the kernel had to copy anyway (loopback, or a device without
+            // scatter-gather). Pinning the pages is pure overhead.
+            if (sockinfo.zerocopy) {
+              logstream(LOG_INFO) << "MSG_ZEROCOPY to " << sockinfo.id
+                                  << " falls back to copying. Disabled."
+                                  << std::endl;
+            }
+            sockinfo.zerocopy = false;
+          }
+          // sends [ee_info, ee_data] have completed
+          if (serr->ee_info == sockinfo.zc_completed) {
+            sockinfo.zc_completed = serr->ee_data + 1;
+          } else {
+            sockinfo.zc_ranges[serr->ee_info] = serr->ee_data;
+          }
+          std::map<uint32_t, uint32_t>::iterator iter;
+          while ((iter = sockinfo.zc_ranges.find(sockinfo.zc_completed)) !=
+                 sockinfo.zc_ranges.end()) {
+            sockinfo.zc_completed = iter->second + 1;
+            sockinfo.zc_ranges.erase(iter);
+          }
+        }
+      }
+      // sequence numbers wrap around. Compare differences.
+      while (!sockinfo.zc_buffers.empty() &&
+             int32_t(sockinfo.zc_buffers.front().first -
+                     sockinfo.zc_completed) < 0) {
+        free(sockinfo.zc_buffers.front().second);
+        sockinfo.zc_buffers.pop_front();
+      }
+#endif
+    }
+
     int dc_tcp_comm::sendtosock(int sockfd, const char* buf, size_t len) {
       size_t numsent = 0;
       BEGIN_TRACEPOINT(tcp_send_call);
@@ -339,6 +578,22 @@ namespace graphlab {
       return 0;
     }
 
+    bool dc_tcp_comm::is_local(size_t target) const {
+      const unsigned char* a =
+          reinterpret_cast<const unsigned char*>(&(all_addrs[target]));
+      const unsigned char* b =
+          reinterpret_cast<const unsigned char*>(&(all_addrs[curid]));
+      // all of 127.0.0.0/8 is this host
+      return all_addrs[target] == all_addrs[curid] ||
+          (a[0] == 127 && b[0] == 127);
+    }
+
+    std::string dc_tcp_comm::shm_segment_name(size_t target) const {
+      // the listening port distinguishes the processes on a host
+      return "/graphlab-" + program_md5.substr(0, 12) + "-" +
+          boost::lexical_cast<std::string>(portnums[target]);
+    }
+
     void dc_tcp_comm::set_tcp_no_delay(int fd) {
       int flag = 1;
       int result = setsockopt(fd,            /* socket affected */
@@ -368,7 +623,7 @@ namespace graphlab {
 
 
     void dc_tcp_comm::new_socket(int newsock, sockaddr_in* otheraddr,
-                                 procid_t id) {
+                                 procid_t id, size_t stream) {
       // figure out the address of the incoming connection
       uint32_t addr = *reinterpret_cast<uint32_t*>(&(otheraddr->sin_addr));
       // locate the incoming address in the list
@@ -376,13 +631,14 @@ namespace graphlab {
                           << inet_ntoa(otheraddr->sin_addr) << std::endl;
       ASSERT_LT(id, all_addrs.size());
       ASSERT_EQ(all_addrs[id], addr);
+      ASSERT_LT(stream, nstreams);
       insock_lock.lock();
-      ASSERT_EQ(sock[id].insock, -1);
-      sock[id].insock = newsock;
+      ASSERT_EQ(get_sock(id, stream).insock, -1);
+      get_sock(id, stream).insock = newsock;
       insock_cond.signal();
       insock_lock.unlock();
       logstream(LOG_INFO) << "Proc " << procid() << " accepted connection "
-                          << "from machine " << id << std::endl;
+                          << stream << " from machine " << id << std::endl;
     }
 
 
@@ -416,7 +672,12 @@ namespace graphlab {
     } // end of open_listening
 
     void dc_tcp_comm::connect(size_t target) {
-      if (sock[target].outsock != -1) {
+      for (size_t i = 0;i < nstreams; ++i) connect(target, i);
+    }
+
+    void dc_tcp_comm::connect(size_t target, size_t stream) {
+      socket_info& sockinfo = get_sock(target, stream);
+      if (sockinfo.outsock != -1) {
         return;
       } else {
         int newsock = socket(AF_INET, SOCK_STREAM, 0);
@@ -449,12 +710,38 @@ namespace graphlab {
             newsock = socket(AF_INET, SOCK_STREAM, 0);
             set_tcp_no_delay(newsock);
           } else {
+            // map the shared memory ring before the initial message, so
+            // that the target knows it may remove the segment name once
+            // all machines have connected.
+            // Only the first connection to a machine uses it.
+            if (use_shm && stream == 0 && is_local(target)) {
+              sockinfo.shm = new shm_outbox;
+              if (!sockinfo.shm->open(shm_segment_name(target), curid)) {
+                logstream(LOG_INFO) << "Unable to open shared memory to "
+                                    << target << ". Using TCP." << std::endl;
+                delete sockinfo.shm;
+                sockinfo.shm = NULL;
+              }
+            }
             // send the initial message
             initial_message msg; 
             msg.id = curid;
+            msg.stream = stream;
             memcpy(msg.md5, program_md5.c_str(), 32);
             sendtosock(newsock, reinterpret_cast<char*>(&msg), sizeof(initial_message));
             set_non_blocking(newsock);
+#ifdef HAS_MSG_ZEROCOPY
+            if (zerocopy_threshold > 0 && sockinfo.shm == NULL) {
+              int one = 1;
+              if (setsockopt(newsock, SOL_SOCKET, SO_ZEROCOPY,
+                             &one, sizeof(one)) == 0) {
+                sockinfo.zerocopy = true;
+              } else {
+                logstream(LOG_INFO) << "MSG_ZEROCOPY not supported: "
+                                    << strerror(errno) << std::endl;
+              }
+            }
+#endif
             success = true;
             break;
           }
@@ -463,7 +750,7 @@ namespace graphlab {
           logstream(LOG_FATAL) << "Failed to establish connection" << std::endl;
         }
         // remember the socket
-        sock[target].outsock = newsock;
+        sockinfo.outsock = newsock;
         logstream(LOG_INFO) << "connection from " << curid << " to " << target
                             << " established." << std::endl;
       }
@@ -536,7 +823,8 @@ namespace graphlab {
             }
             // register the new socket
             set_non_blocking(newsock);
-            new_socket(newsock, &their_addr, remote_message.id);
+            new_socket(newsock, &their_addr, remote_message.id,
+                       remote_message.stream);
             ++numsocks_connected;
           }
         }
@@ -555,7 +843,8 @@ namespace graphlab {
       dc_tcp_comm* comm = sockinfo->owner;
       if (ev & EV_READ) {
         // get a direct pointer to my receiver
-        dc_receive* receiver = comm->receiver[sockinfo->id];
+        dc_receive* receiver =
+            comm->receiver[sockinfo->stream * comm->nprocs + sockinfo->id];
 
         size_t buflength;
         char *c = receiver->get_buffer(buflength);
@@ -578,7 +867,11 @@ namespace graphlab {
             logstream(LOG_INFO) << msglen << " bytes <-- "
                                 << sockinfo->id  << std::endl;
     #endif
+            size_t requested = buflength;
             c = receiver->advance_buffer(c, msglen, buflength);
+            // a short read means the socket is drained. With edge
+            // triggered events, this is as good as EAGAIN.
+            if ((size_t)msglen < requested) break;
           }
         }
       }
@@ -597,14 +890,24 @@ namespace graphlab {
 
 
     void dc_tcp_comm::check_for_new_data(dc_tcp_comm::socket_info& sockinfo) {
-      buffered_len.inc(sender[sockinfo.id]->get_outgoing_data(sockinfo.outvec));
+      const size_t nstripes = num_stripes(sockinfo.id);
+      if (sockinfo.stream >= nstripes) return;
+      buffered_len.inc(sender[sockinfo.id]->get_outgoing_data(sockinfo.outvec,
+                                                              sockinfo.stream,
+                                                              nstripes));
     }
 
 
-    inline void process_sock(dc_tcp_comm::socket_info* sockinfo) {
+    /// Sends the pending data of a connection. Returns false if another
+    /// thread is already doing so.
+    inline bool process_sock(dc_tcp_comm::socket_info* sockinfo) {
       if (sockinfo->m.try_lock()) {
         dc_tcp_comm* comm = sockinfo->owner;
         // get a direct pointer to my receiver
+        if (sockinfo->zc_completed != sockinfo->zc_next_seq ||
+            !sockinfo->zc_buffers.empty()) {
+          comm->reap_zerocopy(*sockinfo);
+        }
         if (sockinfo->wouldblock == false) {
           comm->check_for_new_data(*sockinfo);
           if (!sockinfo->outvec.empty()) {
@@ -612,7 +915,9 @@ namespace graphlab {
           }
         }
         sockinfo->m.unlock();
+        return true;
       }
+      return false;
     }
 
     // libevent receive handler
@@ -625,24 +930,45 @@ namespace graphlab {
       else if (ev & EV_TIMEOUT) {
         dc_tcp_comm::timeout_event* te =  (dc_tcp_comm::timeout_event*)(arg);
         dc_tcp_comm* comm = te->owner;
+        fixed_dense_bitset<256>& triggered =
+            comm->loops[te->stream].triggered_timeouts;
         if (te->send_all == false) {
           // this is a triggered event
-          foreach(uint32_t i, comm->triggered_timeouts) {
-            comm->triggered_timeouts.clear_bit(i);
-            dc_tcp_comm::socket_info* sockinfo = &(comm->sock[i]);
-            process_sock(sockinfo);
+          foreach(uint32_t i, triggered) {
+            triggered.clear_bit(i);
+            process_sock(&(comm->get_sock(i, te->stream)));
           }
         } else {
-          // send all event
-          for(uint32_t i = 0;i < comm->sock.size(); ++i) {
-            dc_tcp_comm::socket_info* sockinfo = &(comm->sock[i]);
-            process_sock(sockinfo);
+          // send all event. Only the connections of this stream.
+          for(uint32_t i = 0;i < comm->nprocs; ++i) {
+            process_sock(&(comm->get_sock(i, te->stream)));
           }
         }
       }
     }
 
 
+    void dc_tcp_comm::shm_receive_loop() {
+      logstream(LOG_INFO) << "Shared memory receive loop Started" << std::endl;
+      size_t idle = 0;
+      while(!shm_closing) {
+        size_t len = inbox.poll(receiver);
+        if (len > 0) {
+          network_bytesreceived.inc(len);
+          idle = 0;
+        } else if (++idle < 1000) {
+          asm volatile("pause\n": : :"memory");
+        } else {
+          // nothing for a while. Sleep until a sender rings the doorbell.
+          inbox.wait(100);
+          idle = 0;
+        }
+      }
+      // deliver whatever is left
+      network_bytesreceived.inc(inbox.poll(receiver));
+      logstream(LOG_INFO) << "Shared memory receive loop Stopped" << std::endl;
+    }
+
     void dc_tcp_comm::send_loop(struct event_base* ev) {
       logstream(LOG_INFO) << "Send loop Started" << std::endl;
       int ret = event_base_dispatch(ev);
@@ -30,12 +30,14 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <deque>
 
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/rpc/dc_types.hpp>
 #include <graphlab/rpc/dc_internal_types.hpp>
 #include <graphlab/rpc/dc_comm_base.hpp>
 #include <graphlab/rpc/circular_iovec_buffer.hpp>
+#include <graphlab/rpc/dc_shm_channel.hpp>
 #include <graphlab/util/tracepoint.hpp>
 #include <graphlab/util/dense_bitset.hpp>
 
@@ -57,6 +59,25 @@ void on_send_event(int fd, short ev, void* arg);
 TCP implementation of the communications subsystem.
 Provides a single object interface to sending/receiving data streams to
 a collection of machines.
+
+Processes on the same host (same IP address) exchange their streams
+through lock-free shared memory rings (see shm_inbox and shm_outbox)
+instead of the TCP connections, which are then only used to set up the
+connection. This can be disabled with the "shm=false" option.
+
+All pending buffers to a machine are gathered into a single sendmsg()
+call. With the "zerocopy_threshold=BYTES" option, batches of at least that
+many bytes are sent with MSG_ZEROCOPY (Linux 4.14 and later), and their
+buffers are only freed once the kernel reports the transmission complete.
+The send buffers are polled every "send_poll_timeout=MICROSECONDS"
+(\ref SEND_POLL_TIMEOUT by default), in addition to the sends requested by
+the flush_policy.
+
+With the "tcp_connections=N" option, N connections are opened to every
+remote machine, each with its own send and receive thread.
+The thread local send buffers are striped across the connections (see
+dc_send::get_outgoing_data()), so all messages sent by one thread to a
+machine still travel on the same connection, in order.
 */
 class dc_tcp_comm:public dc_comm_base {
  public:
@@ -65,6 +86,7 @@ class dc_tcp_comm:public dc_comm_base {
 
   inline dc_tcp_comm() {
     is_closed = true;
+    shm_closing = false;
     INITIALIZE_TRACER(tcp_send_call, "dc_tcp_comm: send syscall");
   }
 
@@ -72,6 +94,10 @@ class dc_tcp_comm:public dc_comm_base {
     return COMM_STREAM;
   }
 
+  /// The value of the "tcp_connections" option. Defaults to 1
+  size_t streams_per_machine(
+      const std::map<std::string,std::string> &initopts) const;
+
   /**
    this fuction should pause until all communication has been set up
    and returns the number of systems in the network.
@@ -156,7 +182,8 @@ class dc_tcp_comm:public dc_comm_base {
   void set_non_blocking(int fd);
 
   /// called when listener receives an incoming socket request
-  void new_socket(int newsock, sockaddr_in* otheraddr, procid_t remotemachineid);
+  void new_socket(int newsock, sockaddr_in* otheraddr,
+                  procid_t remotemachineid, size_t stream);
 
 
   /// The number of incoming connections established
@@ -168,9 +195,18 @@ class dc_tcp_comm:public dc_comm_base {
   void open_listening(int sockhandle = 0);
 
 
-  /// constructs a connection to the target machine
+  /// constructs all connections to the target machine
   void connect(size_t target);
 
+  /// constructs one connection to the target machine
+  void connect(size_t target, size_t stream);
+
+  /// True if the target machine runs on the same host as this one
+  bool is_local(size_t target) const;
+
+  /// The name of the shared memory segment of the target machine
+  std::string shm_segment_name(size_t target) const;
+
   /// wrapper around the standard send. but loops till the buffer is all sent
   int sendtosock(int sockfd, const char* buf, size_t len);
 
@@ -194,6 +230,7 @@ class dc_tcp_comm:public dc_comm_base {
 
   struct initial_message {
     procid_t id;
+    uint32_t stream;
     char md5[32];
   };
 
@@ -202,6 +239,7 @@ class dc_tcp_comm:public dc_comm_base {
   /// Passed to the receive handler
   struct socket_info{
     size_t id;    /// which machine this is connected to
+    size_t stream;  /// which of the connections to the machine this is
     dc_tcp_comm* owner; /// this object
     int outsock;  /// FD of the outgoing socket
     int insock;   /// FD of the incoming socket
@@ -209,6 +247,22 @@ class dc_tcp_comm:public dc_comm_base {
     struct event* outevent;  /// event object for outgoing information
     bool wouldblock;
     mutex m;
+    /// shared memory ring to the target. NULL if sending over TCP
+    shm_outbox* shm;
+
+    /// whether MSG_ZEROCOPY is enabled on outsock
+    bool zerocopy;
+    /// sequence number of the next MSG_ZEROCOPY send
+    uint32_t zc_next_seq;
+    /// all MSG_ZEROCOPY sends before this one have completed
+    uint32_t zc_completed;
+    /// completion ranges [first, second] received out of order
+    std::map<uint32_t, uint32_t> zc_ranges;
+    /// sent buffers which can be freed once zc_completed passes the
+    /// sequence number
+    std::deque<std::pair<uint32_t, void*> > zc_buffers;
+    /// scratch space for circular_iovec_buffer::sent()
+    std::vector<void*> zc_released;
 
     circular_iovec_buffer outvec;  /// outgoing data
     struct msghdr data;
@@ -219,11 +273,26 @@ class dc_tcp_comm:public dc_comm_base {
 
   struct timeout_event {
     bool send_all;
+    size_t stream;
     dc_tcp_comm* owner;
   };
 
+  /// number of connections to each machine
+  size_t nstreams;
+
+  /// Connection s to machine i is sock[s * nprocs + i]
   std::vector<socket_info> sock;
 
+  inline socket_info& get_sock(size_t target, size_t stream) {
+    return sock[stream * nprocs + target];
+  }
+
+  /// The number of connections the data to the target is striped across
+  inline size_t num_stripes(size_t target) const {
+    // local machines only use the shared memory ring of the first one
+    return sock[target].shm != NULL ? 1 : nstreams;
+  }
+
   /**
    * Sends as much of the buffer inside the sockinfo as possible
    * until the send call will block or all sends are complete.
@@ -232,6 +301,13 @@ class dc_tcp_comm:public dc_comm_base {
    */
   void send_all(socket_info& sockinfo);
   bool send_till_block(socket_info& sockinfo);
+  /// frees the buffers of completed MSG_ZEROCOPY sends
+  void reap_zerocopy(socket_info& sockinfo);
+  /// Batches of at least this many bytes are sent with MSG_ZEROCOPY.
+  /// 0 if disabled
+  size_t zerocopy_threshold;
+  /// microseconds between the polls of the send buffers
+  size_t send_poll_timeout;
   void check_for_new_data(socket_info& sockinfo);
   void construct_events();
 
@@ -241,33 +317,44 @@ class dc_tcp_comm:public dc_comm_base {
   atomic<size_t> network_bytessent;
   atomic<size_t> network_bytesreceived;
 
+  /// The event loops serving the connections of one stream
+  struct event_loop {
+    struct event_base* inevbase;
+    struct event_base* outevbase;
+    struct event* send_triggered_event;
+    struct event* send_all_event;
+    timeout_event send_triggered_timeout;
+    timeout_event send_all_timeout;
+    fixed_dense_bitset<256> triggered_timeouts;
+  };
+  std::vector<event_loop> loops;
+
   ////////////       Receiving Sockets      //////////////////////
   thread_group inthreads;
   void receive_loop(struct event_base*);
 
-  friend void process_sock(socket_info* sockinfo);
+  friend bool process_sock(socket_info* sockinfo);
   friend void on_receive_event(int fd, short ev, void* arg);
-  struct event_base* inevbase;
 
 
   ////////////       Sending Sockets      //////////////////////
   thread_group outthreads;
   void send_loop(struct event_base*);
   friend void on_send_event(int fd, short ev, void* arg);
-  struct event_base* outevbase;
-  struct event* send_triggered_event;
-  struct event* send_all_event;
-  timeout_event send_triggered_timeout;
-  timeout_event send_all_timeout;
+  ////////////       Shared Memory       //////////////////////
+  bool use_shm;
+  size_t shm_ring_size;
+  shm_inbox inbox;
+  volatile bool shm_closing;
+  void shm_receive_loop();
 
-  fixed_dense_bitset<256> triggered_timeouts;
   ////////////       Listening Sockets     //////////////////////
   int listensock;
   thread listenthread;
   void accept_handler();
 };
 
-void process_sock(dc_tcp_comm::socket_info* sockinfo);
+bool process_sock(dc_tcp_comm::socket_info* sockinfo);
 
 } // namespace dc_impl
 } // namespace graphlab
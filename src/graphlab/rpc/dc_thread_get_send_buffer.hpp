@@ -84,6 +84,19 @@ inline void pull_flush_soon_thread_local_buffer(procid_t proc) {
 
 
 
+/**
+ * \internal
+ * Sends the buffers to proc as required for urgent calls.
+ * See distributed_control::flush_urgent()
+ */
+inline void pull_flush_urgent_thread_local_buffer(procid_t proc) {
+  void* ptr = pthread_getspecific(thrlocal_send_buffer_key);
+  thread_local_buffer* p = (thread_local_buffer*)(ptr);
+  if (p) p->pull_flush_urgent(proc);
+}
+
+
+
 /**
  * \internal
  */
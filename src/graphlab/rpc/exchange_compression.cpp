@@ -0,0 +1,387 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <cstring>
+#include <algorithm>
+#include <graphlab/util/timer.hpp>
+#include <graphlab/rpc/dc_compile_parameters.hpp>
+#include <graphlab/rpc/exchange_compression.hpp>
+
+namespace graphlab {
+
+bool exchange_compression_from_string(const std::string& str,
+                                      exchange_compression_type& ret) {
+  if (str == "none") ret = EXCHANGE_COMPRESSION_NONE;
+  else if (str == "lz") ret = EXCHANGE_COMPRESSION_LZ;
+  else if (str == "delta") ret = EXCHANGE_COMPRESSION_DELTA;
+  else if (str == "adaptive") ret = EXCHANGE_COMPRESSION_ADAPTIVE;
+  else return false;
+  return true;
+}
+
+namespace dc_impl {
+
+namespace {
+
+const size_t LZ_MIN_MATCH = 4;
+const size_t LZ_HASH_BITS = 14;
+const size_t LZ_MAX_OFFSET = 65535;
+// the last match must end this many bytes before the end of the input,
+// so that the final sequence always carries some literals
+const size_t LZ_LAST_LITERALS = 5;
+
+/// Adaptive mode: every buffer is a trial until this many calls...
+const size_t ADAPTIVE_WARMUP = 8;
+/// ... and every ADAPTIVE_TRIAL_INTERVAL-th buffer afterwards
+const size_t ADAPTIVE_TRIAL_INTERVAL = 32;
+/// weight of a new trial in the running estimates
+const double ADAPTIVE_DECAY = 0.25;
+
+/// compressed blocks start with the codec and the original length
+const size_t BLOCK_HEADER_SIZE = sizeof(unsigned char) + sizeof(uint64_t);
+
+inline uint32_t read32(const unsigned char* p) {
+  uint32_t ret;
+  memcpy(&ret, p, sizeof(uint32_t));
+  return ret;
+}
+
+inline size_t lz_hash(uint32_t seq) {
+  return (seq * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+/// writes a length continuation (runs of 255). Returns false on overflow
+inline bool lz_write_length(unsigned char* dest, size_t& op, size_t destlen,
+                            size_t len) {
+  while (len >= 255) {
+    if (op >= destlen) return false;
+    dest[op++] = 255;
+    len -= 255;
+  }
+  if (op >= destlen) return false;
+  dest[op++] = (unsigned char)len;
+  return true;
+}
+
+/// reads a length continuation. Returns false on truncated input
+inline bool lz_read_length(const unsigned char* src, size_t& ip, size_t len,
+                           size_t& ret) {
+  unsigned char c;
+  do {
+    if (ip >= len) return false;
+    c = src[ip++];
+    ret += c;
+  } while (c == 255);
+  return true;
+}
+
+/**
+ * Writes one sequence: a token, the literals and, unless this is the
+ * last sequence, the match.
+ */
+inline bool lz_write_sequence(unsigned char* dest, size_t& op, size_t destlen,
+                              const unsigned char* literals, size_t nliterals,
+                              size_t offset, size_t matchlen, bool last) {
+  if (op >= destlen) return false;
+  const size_t token_pos = op++;
+  unsigned char token = 0;
+  if (nliterals >= 15) {
+    token = 15 << 4;
+    if (!lz_write_length(dest, op, destlen, nliterals - 15)) return false;
+  } else {
+    token = (unsigned char)(nliterals << 4);
+  }
+  if (op + nliterals > destlen) return false;
+  memcpy(dest + op, literals, nliterals);
+  op += nliterals;
+  if (!last) {
+    if (op + 2 > destlen) return false;
+    dest[op++] = (unsigned char)(offset & 0xff);
+    dest[op++] = (unsigned char)(offset >> 8);
+    const size_t m = matchlen - LZ_MIN_MATCH;
+    if (m >= 15) {
+      token |= 15;
+      if (!lz_write_length(dest, op, destlen, m - 15)) return false;
+    } else {
+      token |= (unsigned char)m;
+    }
+  }
+  dest[token_pos] = token;
+  return true;
+}
+
+inline bool write_varint(unsigned char* dest, size_t& op, size_t destlen,
+                         uint32_t v) {
+  while (v >= 0x80) {
+    if (op >= destlen) return false;
+    dest[op++] = (unsigned char)(v | 0x80);
+    v >>= 7;
+  }
+  if (op >= destlen) return false;
+  dest[op++] = (unsigned char)v;
+  return true;
+}
+
+inline bool read_varint(const unsigned char* src, size_t& ip, size_t len,
+                        uint32_t& v) {
+  v = 0;
+  for (size_t shift = 0; shift < 35; shift += 7) {
+    if (ip >= len) return false;
+    const unsigned char c = src[ip++];
+    v |= uint32_t(c & 0x7f) << shift;
+    if ((c & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+} // anonymous namespace
+
+
+size_t lz_compress(const char* src, size_t len, char* dest, size_t destlen) {
+  const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+  unsigned char* out = reinterpret_cast<unsigned char*>(dest);
+  std::vector<uint32_t> table(size_t(1) << LZ_HASH_BITS, 0);
+  size_t op = 0, ip = 0, anchor = 0;
+  // the hash table only keeps 32 bit positions
+  const size_t limit = len < LZ_LAST_LITERALS + LZ_MIN_MATCH ? 0 :
+      std::min<size_t>(len - LZ_LAST_LITERALS - LZ_MIN_MATCH, uint32_t(-1));
+  size_t misses = 0;
+  while (ip < limit) {
+    const uint32_t seq = read32(in + ip);
+    const size_t h = lz_hash(seq);
+    const size_t ref = table[h];
+    table[h] = (uint32_t)ip;
+    if (ref < ip && ip - ref <= LZ_MAX_OFFSET && read32(in + ref) == seq) {
+      size_t matchlen = LZ_MIN_MATCH;
+      const size_t matchlimit = len - LZ_LAST_LITERALS;
+      while (ip + matchlen < matchlimit &&
+             in[ref + matchlen] == in[ip + matchlen]) ++matchlen;
+      if (!lz_write_sequence(out, op, destlen, in + anchor, ip - anchor,
+                             ip - ref, matchlen, false)) return 0;
+      ip += matchlen;
+      anchor = ip;
+      misses = 0;
+    } else {
+      // skip faster through data which does not compress
+      ip += 1 + (misses++ >> 5);
+    }
+  }
+  if (!lz_write_sequence(out, op, destlen, in + anchor, len - anchor,
+                         0, 0, true)) return 0;
+  return op;
+}
+
+
+bool lz_decompress(const char* src, size_t len, char* dest, size_t destlen) {
+  const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+  unsigned char* out = reinterpret_cast<unsigned char*>(dest);
+  size_t ip = 0, op = 0;
+  while (ip < len) {
+    const unsigned char token = in[ip++];
+    size_t nliterals = token >> 4;
+    if (nliterals == 15 && !lz_read_length(in, ip, len, nliterals)) {
+      return false;
+    }
+    if (nliterals > len - ip || nliterals > destlen - op) return false;
+    memcpy(out + op, in + ip, nliterals);
+    ip += nliterals;
+    op += nliterals;
+    if (ip == len) break;
+    if (ip + 2 > len) return false;
+    const size_t offset = size_t(in[ip]) | (size_t(in[ip + 1]) << 8);
+    ip += 2;
+    size_t matchlen = token & 15;
+    if (matchlen == 15 && !lz_read_length(in, ip, len, matchlen)) {
+      return false;
+    }
+    matchlen += LZ_MIN_MATCH;
+    if (offset == 0 || offset > op || matchlen > destlen - op) return false;
+    // the match may overlap the output, so copy byte by byte
+    const unsigned char* ref = out + op - offset;
+    for (size_t i = 0;i < matchlen; ++i) out[op + i] = ref[i];
+    op += matchlen;
+  }
+  return op == destlen;
+}
+
+
+size_t delta_compress(const char* src, size_t len, size_t stride,
+                      char* dest, size_t destlen) {
+  const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+  unsigned char* out = reinterpret_cast<unsigned char*>(dest);
+  const size_t sw = std::max<size_t>(stride / sizeof(uint32_t), 1);
+  size_t op = 0;
+  if (!write_varint(out, op, destlen, (uint32_t)sw)) return 0;
+  const size_t nwords = len / sizeof(uint32_t);
+  for (size_t i = 0;i < nwords; ++i) {
+    const uint32_t w = read32(in + i * sizeof(uint32_t));
+    const uint32_t prev = i >= sw ? read32(in + (i - sw) * sizeof(uint32_t)) : 0;
+    const int32_t d = (int32_t)(w - prev);
+    // zigzag, so that small negative deltas stay small
+    const uint32_t z = (uint32_t(d) << 1) ^ uint32_t(d >> 31);
+    if (!write_varint(out, op, destlen, z)) return 0;
+  }
+  const size_t tail = len - nwords * sizeof(uint32_t);
+  if (op + tail > destlen) return 0;
+  memcpy(out + op, in + nwords * sizeof(uint32_t), tail);
+  return op + tail;
+}
+
+
+bool delta_decompress(const char* src, size_t len, char* dest, size_t destlen) {
+  const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+  unsigned char* out = reinterpret_cast<unsigned char*>(dest);
+  size_t ip = 0;
+  uint32_t sw;
+  if (!read_varint(in, ip, len, sw) || sw == 0) return false;
+  const size_t nwords = destlen / sizeof(uint32_t);
+  for (size_t i = 0;i < nwords; ++i) {
+    uint32_t z;
+    if (!read_varint(in, ip, len, z)) return false;
+    const uint32_t d = (z >> 1) ^ (0 - (z & 1));
+    const uint32_t prev = i >= sw ? read32(out + (i - sw) * sizeof(uint32_t)) : 0;
+    const uint32_t w = prev + d;
+    memcpy(out + i * sizeof(uint32_t), &w, sizeof(uint32_t));
+  }
+  const size_t tail = destlen - nwords * sizeof(uint32_t);
+  if (len - ip != tail) return false;
+  memcpy(out + nwords * sizeof(uint32_t), in + ip, tail);
+  return true;
+}
+
+
+
+exchange_compressor::exchange_compressor(exchange_compression_type type)
+    : ctype(type) { }
+
+void exchange_compressor::set_type(exchange_compression_type type) {
+  ctype = type;
+}
+
+size_t exchange_compressor::compress_with(exchange_compression_type codec,
+                                          const char* src, size_t len,
+                                          size_t stride,
+                                          char* dest, size_t destlen) {
+  switch(codec) {
+   case EXCHANGE_COMPRESSION_LZ:
+     return lz_compress(src, len, dest, destlen);
+   case EXCHANGE_COMPRESSION_DELTA:
+     return delta_compress(src, len, stride, dest, destlen);
+   default:
+     return 0;
+  }
+}
+
+exchange_compression_type
+exchange_compressor::choose_codec(const char* src, size_t len, size_t stride) {
+  const size_t call = ncalls.inc();
+  if (call <= ADAPTIVE_WARMUP || call % ADAPTIVE_TRIAL_INTERVAL == 0) {
+    // measure both codecs on this buffer
+    std::vector<char> scratch(len);
+    codec_estimate trial[2];
+    for (size_t i = 0;i < 2; ++i) {
+      timer ti;
+      ti.start();
+      size_t clen = compress_with(exchange_compression_type(i + 1),
+                                  src, len, stride, &(scratch[0]), len);
+      trial[i].seconds_per_byte = ti.current_time() / len;
+      trial[i].ratio = clen == 0 ? 1.0 : double(clen) / len;
+    }
+    estimate_lock.lock();
+    for (size_t i = 0;i < 2; ++i) {
+      if (call == 1) {
+        estimate[i] = trial[i];
+      } else {
+        estimate[i].ratio += ADAPTIVE_DECAY * (trial[i].ratio - estimate[i].ratio);
+        estimate[i].seconds_per_byte += ADAPTIVE_DECAY *
+            (trial[i].seconds_per_byte - estimate[i].seconds_per_byte);
+      }
+    }
+    estimate_lock.unlock();
+  }
+  // the cost per byte of sending without compression
+  const double bandwidth = EXCHANGE_COMPRESSION_BANDWIDTH;
+  double best_cost = 1.0 / bandwidth;
+  exchange_compression_type best = EXCHANGE_COMPRESSION_NONE;
+  estimate_lock.lock();
+  for (size_t i = 0;i < 2; ++i) {
+    const double cost = estimate[i].seconds_per_byte +
+                        estimate[i].ratio / bandwidth;
+    if (cost < best_cost) {
+      best_cost = cost;
+      best = exchange_compression_type(i + 1);
+    }
+  }
+  estimate_lock.unlock();
+  return best;
+}
+
+bool exchange_compressor::compress(const char* src, size_t len,
+                                   size_t stride, oarchive& out) {
+  nbytes_before.inc(len);
+  exchange_compression_type codec = ctype;
+  if (codec == EXCHANGE_COMPRESSION_ADAPTIVE && len > 0) {
+    codec = choose_codec(src, len, stride);
+  }
+  size_t clen = 0;
+  if (codec != EXCHANGE_COMPRESSION_NONE && len > 0) {
+    // leave room for the header, and give up if the output is not smaller
+    out.expand_buf(BLOCK_HEADER_SIZE + len);
+    clen = compress_with(codec, src, len, stride,
+                         out.buf + out.off + BLOCK_HEADER_SIZE, len - 1);
+  }
+  if (clen == 0) {
+    nbytes_after.inc(len);
+    return false;
+  }
+  out.buf[out.off] = (char)codec;
+  const uint64_t origlen = len;
+  memcpy(out.buf + out.off + 1, &origlen, sizeof(uint64_t));
+  out.off += BLOCK_HEADER_SIZE + clen;
+  nbytes_after.inc(BLOCK_HEADER_SIZE + clen);
+  return true;
+}
+
+bool exchange_compressor::decompress(const char* src, size_t len,
+                                     std::vector<char>& out) {
+  if (len < BLOCK_HEADER_SIZE) return false;
+  const exchange_compression_type codec =
+      exchange_compression_type((unsigned char)src[0]);
+  uint64_t origlen;
+  memcpy(&origlen, src + 1, sizeof(uint64_t));
+  out.resize(origlen);
+  if (origlen == 0) return true;
+  src += BLOCK_HEADER_SIZE;
+  len -= BLOCK_HEADER_SIZE;
+  switch(codec) {
+   case EXCHANGE_COMPRESSION_LZ:
+     return lz_decompress(src, len, &(out[0]), origlen);
+   case EXCHANGE_COMPRESSION_DELTA:
+     return delta_decompress(src, len, &(out[0]), origlen);
+   default:
+     return false;
+  }
+}
+
+} // namespace dc_impl
+} // namespace graphlab
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_RPC_EXCHANGE_COMPRESSION_HPP
+#define GRAPHLAB_RPC_EXCHANGE_COMPRESSION_HPP
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <graphlab/serialization/oarchive.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/atomic.hpp>
+
+namespace graphlab {
+
+/**
+ * \ingroup rpc
+ * The compression applied to the buffers of a \ref buffered_exchange or a
+ * \ref fiber_buffered_exchange before they are sent.
+ */
+enum exchange_compression_type {
+  /// Buffers are sent as is
+  EXCHANGE_COMPRESSION_NONE = 0,
+  /// A fast LZ77 block compressor in the style of LZ4
+  EXCHANGE_COMPRESSION_LZ = 1,
+  /**
+   * Every 32 bit word is replaced by its difference to the word one record
+   * earlier, and written as a zigzag varint. Works very well on sorted or
+   * clustered vertex ids, and on small integer payloads.
+   */
+  EXCHANGE_COMPRESSION_DELTA = 2,
+  /**
+   * Periodically tries all codecs on a buffer and uses the one with the
+   * lowest estimated cost (compression time plus transmission time at
+   * \ref EXCHANGE_COMPRESSION_BANDWIDTH), which may be no compression.
+   */
+  EXCHANGE_COMPRESSION_ADAPTIVE = 3
+};
+
+/**
+ * \ingroup rpc
+ * Parses "none", "lz", "delta" or "adaptive". Returns false if the string
+ * is not recognized.
+ */
+bool exchange_compression_from_string(const std::string& str,
+                                      exchange_compression_type& ret);
+
+namespace dc_impl {
+
+/**
+ * \internal
+ * Compresses len bytes at src into dest, which has room for destlen bytes.
+ * Returns the compressed length, or 0 if the output does not fit.
+ */
+size_t lz_compress(const char* src, size_t len, char* dest, size_t destlen);
+
+/**
+ * \internal
+ * Decompresses the output of lz_compress(). destlen must be the exact
+ * original length. Returns false if the input is corrupt.
+ */
+bool lz_decompress(const char* src, size_t len, char* dest, size_t destlen);
+
+/**
+ * \internal
+ * Delta + varint encodes len bytes at src into dest, which has room for
+ * destlen bytes. Each 32 bit word is encoded relative to the word stride
+ * bytes earlier. stride is rounded to a multiple of 4.
+ * Returns the compressed length, or 0 if the output does not fit.
+ */
+size_t delta_compress(const char* src, size_t len, size_t stride,
+                      char* dest, size_t destlen);
+
+/**
+ * \internal
+ * Decompresses the output of delta_compress(). destlen must be the exact
+ * original length. Returns false if the input is corrupt.
+ */
+bool delta_decompress(const char* src, size_t len, char* dest, size_t destlen);
+
+
+/**
+ * \internal
+ * \ingroup rpc
+ * Compresses the buffers of one exchange, and keeps track of the bytes
+ * before and after compression. With EXCHANGE_COMPRESSION_ADAPTIVE, it
+ * also keeps a running estimate of the ratio and speed of every codec.
+ * compress() may be called from several threads at once.
+ */
+class exchange_compressor {
+ public:
+  explicit exchange_compressor(exchange_compression_type type =
+                                   EXCHANGE_COMPRESSION_NONE);
+
+  void set_type(exchange_compression_type type);
+
+  inline exchange_compression_type type() const { return ctype; }
+
+  inline bool enabled() const { return ctype != EXCHANGE_COMPRESSION_NONE; }
+
+  /**
+   * Compresses the len bytes at src, which hold records of stride bytes
+   * each (0 if unknown), and appends the compressed block to out.
+   * Returns false, leaving out unchanged, if the data does not compress
+   * or the adaptive policy decides it is not worth it. The caller should
+   * then send the data uncompressed.
+   */
+  bool compress(const char* src, size_t len, size_t stride, oarchive& out);
+
+  /**
+   * Decompresses a block written by compress() into out.
+   * Returns false if the block is corrupt.
+   */
+  static bool decompress(const char* src, size_t len, std::vector<char>& out);
+
+  /// The number of bytes passed to compress()
+  inline size_t bytes_before() const { return nbytes_before.value; }
+
+  /// The number of bytes sent, counting data which was not compressed
+  inline size_t bytes_after() const { return nbytes_after.value; }
+
+ private:
+  struct codec_estimate {
+    /// compressed length / original length
+    double ratio;
+    /// compression time per byte
+    double seconds_per_byte;
+    codec_estimate(): ratio(1.0), seconds_per_byte(0.0) { }
+  };
+
+  exchange_compression_type ctype;
+  atomic<size_t> nbytes_before, nbytes_after;
+  atomic<size_t> ncalls;
+  simple_spinlock estimate_lock;
+  codec_estimate estimate[2];
+
+  static size_t compress_with(exchange_compression_type codec,
+                              const char* src, size_t len, size_t stride,
+                              char* dest, size_t destlen);
+  exchange_compression_type choose_codec(const char* src, size_t len,
+                                         size_t stride);
+};
+
+} // namespace dc_impl
+} // namespace graphlab
+#endif
@@ -21,8 +21,11 @@
  */
 
 
+#include <algorithm>
+#include <boost/bind.hpp>
 #include <graphlab/rpc/fiber_async_consensus.hpp>
 #include <graphlab/parallel/fiber_control.hpp>
+#include <graphlab/macros_def.hpp>
 namespace graphlab {
   fiber_async_consensus::fiber_async_consensus(distributed_control &dc,
                                    size_t required_fibers_in_done,
@@ -36,11 +39,63 @@ namespace graphlab {
      critical(ncpus, 0),
      sleeping(ncpus, 0),
      hastoken(dc.procid() == 0),
-     cond(ncpus, 0){
+     cond(ncpus, 0),
+     protocol(TREE) {
 
     cur_token.total_calls_sent = 0;
     cur_token.total_calls_received = 0;
     cur_token.last_change = (procid_t)(rmi.numprocs() - 1);
+    init_tree();
+  }
+
+  fiber_async_consensus::fiber_async_consensus(distributed_control &dc,
+                                   size_t required_fibers_in_done,
+                                   const dc_impl::dc_dist_object_base *attach,
+                                   protocol_type protocol)
+    :rmi(dc, this), attachedobj(attach),
+     last_calls_sent(0), last_calls_received(0),
+     numactive(required_fibers_in_done),
+     ncpus(required_fibers_in_done),
+     done(false),
+     trying_to_sleep(0),
+     critical(ncpus, 0),
+     sleeping(ncpus, 0),
+     hastoken(dc.procid() == 0),
+     cond(ncpus, 0),
+     protocol(protocol) {
+
+    cur_token.total_calls_sent = 0;
+    cur_token.total_calls_received = 0;
+    cur_token.last_change = (procid_t)(rmi.numprocs() - 1);
+    init_tree();
+  }
+
+  void fiber_async_consensus::init_tree() {
+    for (size_t i = 1; i <= TREE_FANOUT; ++i) {
+      size_t child = TREE_FANOUT * rmi.procid() + i;
+      if (child < rmi.numprocs()) children.push_back((procid_t)child);
+    }
+    wave_pending = false;
+    children_pending = 0;
+    failed_waves = 0;
+    waves_started = 0;
+    backoff_thread = NULL;
+    backoff_armed = false;
+    backoff_stop = false;
+    backoff_deadline = 0;
+    max_backoff = 0.01;
+    clock.start();
+  }
+
+  fiber_async_consensus::~fiber_async_consensus() {
+    if (backoff_thread != NULL) {
+      m.lock();
+      backoff_stop = true;
+      backoff_cond.signal();
+      m.unlock();
+      backoff_thread->join();
+      delete backoff_thread;
+    }
   }
 
   void fiber_async_consensus::reset() {
@@ -55,6 +110,14 @@ namespace graphlab {
     cur_token.total_calls_sent = 0;
     cur_token.total_calls_received = 0;
     cur_token.last_change = (procid_t)(rmi.numprocs() - 1);
+    m.lock();
+    wave_pending = false;
+    children_pending = 0;
+    wave_acc = wave_report();
+    failed_waves = 0;
+    waves_started = 0;
+    backoff_armed = false;
+    m.unlock();
   }
 
   void fiber_async_consensus::force_done() {
@@ -103,7 +166,12 @@ namespace graphlab {
     */
     if (numactive == 0) {
       logstream(LOG_INFO) << rmi.procid() << ": Termination Possible" << std::endl;
-      if (hastoken) pass_the_token();
+      if (protocol == TOKEN_RING) {
+        if (hastoken) pass_the_token();
+      } else {
+        try_answer_wave();
+        maybe_start_wave();
+      }
     }
     sleeping[cpuid] = true;
     while(1) {
@@ -219,39 +287,14 @@ namespace graphlab {
                            &fiber_async_consensus::force_done);
         }
       }
-      // set the complete flag
-      // we can't call consensus() since it will deadlock
-      done = true;
-      // this is the same code as cancel(), but we can't call cancel 
-      // since we are holding on to a lock
-      if (numactive < ncpus) {
-        // this is safe. Note that it is done from within 
-        // the critical section.
-        for (size_t i = 0;i < ncpus; ++i) {
-          numactive += sleeping[i];
-          if (sleeping[i]) {
-            sleeping[i] = 0;
-            // this here is basically cond[i].signal();
-            size_t ch = cond[i];
-            if (ch != 0) fiber_control::schedule_tid(ch);
-          }
-        }
-      }
-
+      set_done_and_wake();
     }
     else {
       // update the token
       size_t callsrecv;
       size_t callssent;
     
-      if (attachedobj) {
-        callsrecv = attachedobj->calls_received();
-        callssent = attachedobj->calls_sent();
-      }
-      else {
-        callsrecv = rmi.dc().calls_received();
-        callssent = rmi.dc().calls_sent();
-      }
+      get_calls(callssent, callsrecv);
 
       if (callssent != last_calls_sent ||
           callsrecv != last_calls_received) {
@@ -276,6 +319,168 @@ namespace graphlab {
                        cur_token);
     }
   }
-}
 
+  void fiber_async_consensus::get_calls(size_t& sent, size_t& received) {
+    if (attachedobj) {
+      received = attachedobj->calls_received();
+      sent = attachedobj->calls_sent();
+    }
+    else {
+      received = rmi.dc().calls_received();
+      sent = rmi.dc().calls_sent();
+    }
+  }
+
+  void fiber_async_consensus::set_done_and_wake() {
+    // the caller must hold the lock.
+    // set the complete flag
+    // we can't call consensus() since it will deadlock
+    done = true;
+    // this is the same code as cancel(), but we can't call cancel 
+    // since we are holding on to a lock
+    if (numactive < ncpus) {
+      // this is safe. Note that it is done from within 
+      // the critical section.
+      for (size_t i = 0;i < ncpus; ++i) {
+        numactive += sleeping[i];
+        if (sleeping[i]) {
+          sleeping[i] = 0;
+          // this here is basically cond[i].signal();
+          size_t ch = cond[i];
+          if (ch != 0) fiber_control::schedule_tid(ch);
+        }
+      }
+    }
+  }
+
+
+  /*
+   * TREE protocol. 
+   * Machine 0 starts a wave when it is idle. The wave is forwarded down the
+   * tree immediately so that all subtrees work in parallel. Each machine
+   * answers its parent once it is idle and all its children have answered.
+   *
+   * If no machine's call counts changed between its answers to two 
+   * consecutive waves, every machine was idle and silent from the end of the
+   * first wave on. If the totals also match, no calls are in flight and we
+   * are done.
+   */
+  void fiber_async_consensus::maybe_start_wave() {
+    // the caller must hold the lock.
+    if (rmi.procid() != 0 || done || wave_pending || 
+        backoff_armed || numactive != 0) return;
+    wave_pending = true;
+    ++waves_started;
+    children_pending = children.size();
+    wave_acc = wave_report();
+    foreach(procid_t child, children) {
+      rmi.control_call(child, &fiber_async_consensus::receive_wave);
+    }
+    try_answer_wave();
+  }
+
+  void fiber_async_consensus::receive_wave() {
+    m.lock();
+    wave_pending = true;
+    children_pending = children.size();
+    wave_acc = wave_report();
+    foreach(procid_t child, children) {
+      rmi.control_call(child, &fiber_async_consensus::receive_wave);
+    }
+    try_answer_wave();
+    m.unlock();
+  }
 
+  void fiber_async_consensus::receive_report(const wave_report& report) {
+    m.lock();
+    wave_acc.calls_sent += report.calls_sent;
+    wave_acc.calls_received += report.calls_received;
+    wave_acc.changed |= report.changed;
+    --children_pending;
+    try_answer_wave();
+    m.unlock();
+  }
+
+  void fiber_async_consensus::try_answer_wave() {
+    // the caller must hold the lock.
+    if (!wave_pending || children_pending > 0 || numactive != 0 || done) {
+      return;
+    }
+    size_t callssent, callsrecv;
+    get_calls(callssent, callsrecv);
+    wave_acc.calls_sent += callssent;
+    wave_acc.calls_received += callsrecv;
+    wave_acc.changed |= (callssent != last_calls_sent ||
+                         callsrecv != last_calls_received);
+    last_calls_sent = callssent;
+    last_calls_received = callsrecv;
+    wave_pending = false;
+    if (rmi.procid() == 0) {
+      wave_complete(wave_acc);
+    } else {
+      rmi.control_call((procid_t)((rmi.procid() - 1) / TREE_FANOUT),
+                       &fiber_async_consensus::receive_report, wave_acc);
+    }
+  }
+
+  void fiber_async_consensus::wave_complete(const wave_report& report) {
+    // the caller must hold the lock.
+    if (!report.changed && report.calls_sent == report.calls_received) {
+      logstream(LOG_INFO) << "Completed Wave: " 
+                          << report.calls_received << " " 
+                          << report.calls_sent << std::endl;
+      foreach(procid_t child, children) {
+        rmi.control_call(child, &fiber_async_consensus::receive_done);
+      }
+      set_done_and_wake();
+      return;
+    }
+    // calls in flight mean work is still moving around. Back off.
+    // Otherwise the next wave will most likely succeed. Start it now.
+    if (report.calls_sent == report.calls_received) failed_waves = 0;
+    else ++failed_waves;
+    if (failed_waves <= 1) {
+      maybe_start_wave();
+      return;
+    }
+    double delay = std::min(0.0001 * (1 << std::min(failed_waves - 2,
+                                                    size_t(20))),
+                            max_backoff);
+    backoff_deadline = clock.current_time() + delay;
+    backoff_armed = true;
+    if (backoff_thread == NULL) {
+      backoff_thread = new thread();
+      backoff_thread->launch(boost::bind(&fiber_async_consensus::backoff_loop,
+                                         this));
+    }
+    backoff_cond.signal();
+  }
+
+  void fiber_async_consensus::backoff_loop() {
+    m.lock();
+    while(!backoff_stop) {
+      if (!backoff_armed) {
+        backoff_cond.wait(m);
+        continue;
+      }
+      double remaining = backoff_deadline - clock.current_time();
+      if (remaining > 0) {
+        backoff_cond.timedwait_ns(m, size_t(remaining * 1e9) + 1);
+        continue;
+      }
+      backoff_armed = false;
+      maybe_start_wave();
+    }
+    m.unlock();
+  }
+
+  void fiber_async_consensus::receive_done() {
+    m.lock();
+    foreach(procid_t child, children) {
+      rmi.control_call(child, &fiber_async_consensus::receive_done);
+    }
+    set_done_and_wake();
+    m.unlock();
+  }
+}
+#include <graphlab/macros_undef.hpp>
@@ -24,7 +24,9 @@
 #ifndef FIBER_ASYNC_TERMINATOR_HPP
 #define FIBER_ASYNC_TERMINATOR_HPP
 
+#include <vector>
 #include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/util/timer.hpp>
 
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/rpc/dc_dist_object_base.hpp>
@@ -89,6 +91,20 @@ namespace graphlab {
    * This class works with fibers. For a version which works with regular 
    * kernel threads see \ref graphlab::async_consensus .
    *
+   * Two protocols are available to combine the machines:
+   * \li \c TOKEN_RING Misra's token is passed around the ring of machines.
+   *     A round takes numprocs() sequential hops.
+   * \li \c TREE (default) The fibers of a machine are combined locally
+   *     as before. Machine 0 then sends waves down a tree of the
+   *     machines; each machine answers its parent once it is idle and its
+   *     children have answered, reporting the total calls sent and received
+   *     and whether these changed since its previous answer. Termination
+   *     is detected once a wave sees no change and all calls received. A
+   *     wave takes O(log(numprocs())) sequential hops. If waves keep failing
+   *     while calls are in flight (long tails of sparse activity), the
+   *     next wave is delayed by an exponential back-off, capped at
+   *     max_backoff_ms.
+   *
    * \see graphlab::async_consensus
    */
   class fiber_async_consensus {
@@ -110,6 +126,19 @@ namespace graphlab {
     fiber_async_consensus(distributed_control &dc, size_t required_fibers_in_done = 1,
                     const dc_impl::dc_dist_object_base* attach = NULL);
 
+    /// The protocol used to detect termination across machines
+    enum protocol_type { TOKEN_RING, TREE };
+
+    /** \brief Constructs an asynchronous consensus object using a
+     * particular protocol. See the constructor above.
+     */
+    fiber_async_consensus(distributed_control &dc, 
+                          size_t required_fibers_in_done,
+                          const dc_impl::dc_dist_object_base* attach,
+                          protocol_type protocol);
+
+    ~fiber_async_consensus();
+
 
     /**
      * \brief A thread enters the critical section by calling
@@ -165,6 +194,19 @@ namespace graphlab {
      * This function is not safe to call while consensus is being achieved.
      */
     void reset();
+
+    /**
+     * \brief Sets the maximum delay between two termination waves of the
+     * TREE protocol. Defaults to 10ms. Must be called on all machines.
+     */
+    void set_max_backoff_ms(double ms) {
+      max_backoff = ms / 1000;
+    }
+
+    /// \brief Returns the number of termination waves started by this machine
+    size_t num_waves() const {
+      return waves_started;
+    }
  
   private:
 
@@ -245,6 +287,58 @@ namespace graphlab {
 
     void receive_the_token(token &tok);
     void pass_the_token();
+
+    /*
+     * TREE protocol state. Machine p has children
+     * TREE_FANOUT * p + 1 ... TREE_FANOUT * p + TREE_FANOUT.
+     */
+    static const size_t TREE_FANOUT = 4;
+
+    /// The answer of a subtree of machines to a wave
+    struct wave_report {
+      size_t calls_sent;
+      size_t calls_received;
+      bool changed;
+      wave_report(): calls_sent(0), calls_received(0), changed(false) { }
+      void save(oarchive &oarc) const {
+        oarc << calls_sent << calls_received << changed;
+      }
+      void load(iarchive &iarc) {
+        iarc >> calls_sent >> calls_received >> changed;
+      }
+    };
+
+    protocol_type protocol;
+    std::vector<procid_t> children;
+    /// set if this machine is part of a wave it has not answered yet
+    bool wave_pending;
+    /// the number of children which have not answered the current wave
+    size_t children_pending;
+    /// the combined answers of the children
+    wave_report wave_acc;
+    /// number of consecutive waves which failed with calls in flight
+    size_t failed_waves;
+    size_t waves_started;
+
+    /// back-off timer of machine 0. Protected by the mutex.
+    thread* backoff_thread;
+    conditional backoff_cond;
+    bool backoff_armed;
+    bool backoff_stop;
+    double backoff_deadline;
+    double max_backoff;
+    timer clock;
+
+    void init_tree();
+    void receive_wave();
+    void receive_report(const wave_report& report);
+    void try_answer_wave();
+    void maybe_start_wave();
+    void wave_complete(const wave_report& report);
+    void backoff_loop();
+    void receive_done();
+    void set_done_and_wake();
+    void get_calls(size_t& sent, size_t& received);
   };
 
 }
@@ -24,10 +24,14 @@
 #ifndef GRAPHLAB_FIBER_BUFFERED_EXCHANGE_HPP
 #define GRAPHLAB_FIBER_BUFFERED_EXCHANGE_HPP
 
+#include <cstring>
+#include <boost/type_traits/alignment_of.hpp>
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/parallel/fiber_control.hpp>
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/rpc/dc_dist_object.hpp>
+#include <graphlab/rpc/exchange_compression.hpp>
+#include <graphlab/serialization/array_ref.hpp>
 #include <graphlab/util/mpi_tools.hpp>
 
 
@@ -81,6 +85,11 @@ namespace graphlab {
    * \note The last single threaded receive is not necessary if worker-affinity
    * is set correctly so that every worker is active in the parallel receiving
    * block.
+   * \note Like the \ref graphlab::buffered_exchange, the send buffers can be
+   * compressed. See \ref exchange_compression_type.
+   * \note If set_receive_views() is enabled, buffers of POD values are kept
+   * in the RPC receive buffer they arrived in and are not copied. They must
+   * then be read through buffer_record::values().
    *
    * \see graphlab::buffered_exchange
    */
@@ -92,7 +101,14 @@ namespace graphlab {
     struct buffer_record {
       procid_t proc;
       buffer_type buffer;
-      buffer_record() : proc(-1)  { }
+      /// if is_view, the values are in view rather than in buffer
+      array_ref<T> view;
+      bool is_view;
+      buffer_record() : proc(-1), is_view(false)  { }
+      /// The values in the record, wherever they are stored
+      array_ref<T> values() const {
+        return is_view ? view : array_ref<T>(buffer);
+      }
     }; // end of buffer record
     typedef std::vector<buffer_record> recv_buffer_type;
     mutex lock;
@@ -114,15 +130,40 @@ namespace graphlab {
     std::vector<std::vector<send_record> > send_buffers;
     const size_t max_buffer_size;
 
+    dc_impl::exchange_compressor compressor;
+    /// the offset of the first value in every send buffer
+    size_t payload_offset;
+    /// whether POD values are received as views
+    bool receive_views;
+
 
     /**
      * Flushes the send buffer local to worker id "wid" and going to process proc
      */
     void flush_buffer(size_t wid, procid_t proc) {
       if(send_buffers[wid][proc].oarc) {
-        // write the length at the end of the buffere are returning
-        send_buffers[wid][proc].oarc->write(reinterpret_cast<char*>(&send_buffers[wid][proc].numinserts), sizeof(size_t));
-        rpc.split_call_end(proc, send_buffers[wid][proc].oarc);
+        oarchive* arc = send_buffers[wid][proc].oarc;
+        size_t numinserts = send_buffers[wid][proc].numinserts;
+        bool sent = false;
+        if (compressor.enabled()) {
+          const size_t len = arc->off - payload_offset;
+          // the records are likely of fixed size if the length divides evenly
+          const size_t stride = len % numinserts == 0 ? len / numinserts : 0;
+          oarchive* carc = rpc.split_call_begin(&fiber_buffered_exchange::rpc_recv_compressed);
+          (*carc) << rpc.procid() << numinserts;
+          if (compressor.compress(arc->buf + payload_offset, len, stride, *carc)) {
+            rpc.split_call_cancel(arc);
+            rpc.split_call_end(proc, carc);
+            sent = true;
+          } else {
+            rpc.split_call_cancel(carc);
+          }
+        }
+        if (!sent) {
+          // write the length at the end of the buffere are returning
+          arc->write(reinterpret_cast<char*>(&numinserts), sizeof(size_t));
+          rpc.split_call_end(proc, arc);
+        }
 //         logstream(LOG_DEBUG) << rpc.procid() << ": Sending exchange of length " 
 //                              << send_buffers[wid][proc].oarc->off << " to " 
 //                              << proc << std::endl;
@@ -137,11 +178,21 @@ namespace graphlab {
      *
      * \ref dc The master distributed_control object
      * \ref max_buffer_size The size of the per thread and per target send buffer.
+     * \ref compression The compression applied to the send buffers.
      */
     fiber_buffered_exchange(distributed_control& dc,
-                      const size_t max_buffer_size = DEFAULT_BUFFERED_EXCHANGE_SIZE) :
+                      const size_t max_buffer_size = DEFAULT_BUFFERED_EXCHANGE_SIZE,
+                      exchange_compression_type compression =
+                          EXCHANGE_COMPRESSION_NONE) :
       rpc(dc, this),
-      max_buffer_size(max_buffer_size) {
+      max_buffer_size(max_buffer_size),
+      compressor(compression), receive_views(false) {
+       // every send buffer starts with the same header
+       oarchive* arc = rpc.split_call_begin(&fiber_buffered_exchange::rpc_recv);
+       (*arc) << rpc.procid();
+       payload_offset = arc->off;
+       rpc.split_call_cancel(arc);
+
        send_buffers.resize(fiber_control::get_instance().num_workers());
        recv_buffers.resize(fiber_control::get_instance().num_workers());
        for (size_t i = 0;i < send_buffers.size(); ++i) {
@@ -182,7 +233,10 @@ namespace graphlab {
         send_buffers[wid][proc].numinserts = 0;
       }
 
-      (*(send_buffers[wid][proc].oarc)) << value;
+      oarchive& oarc = *(send_buffers[wid][proc].oarc);
+      // POD values are written as is, so that they can be received in place
+      if (gl_is_pod_or_scaler<T>::value) serialize(oarc, &value, sizeof(T));
+      else oarc << value;
       ++send_buffers[wid][proc].numinserts;
 
 
@@ -283,9 +337,38 @@ namespace graphlab {
     void clear() { }
 
     void barrier() { rpc.barrier(); }
+
+    /**
+     * Changes the compression of the buffers sent from now on.
+     * Need not be called on all machines.
+     */
+    void set_compression(exchange_compression_type compression) {
+      compressor.set_type(compression);
+    }
+
+    /**
+     * If enabled, buffers of POD values are received as views into the RPC
+     * receive buffers (see buffer_record::values()) rather than copied into
+     * buffer_record::buffer. Has no effect if T is not a POD.
+     */
+    void set_receive_views(bool enabled) {
+      receive_views = enabled;
+    }
+
+    /// The number of payload bytes sent by this machine before compression
+    size_t bytes_before_compression() const {
+      return compressor.bytes_before();
+    }
+
+    /**
+     * The number of payload bytes sent by this machine after compression.
+     * Only counts buffers sent while compression was enabled.
+     */
+    size_t bytes_after_compression() const {
+      return compressor.bytes_after();
+    }
   private:
     void rpc_recv(size_t len, wild_pointer w) {
-      buffer_type tmp;
       iarchive iarc(reinterpret_cast<const char*>(w.ptr), len);
       // first desrialize the source process
       procid_t src_proc; iarc >> src_proc;
@@ -298,9 +381,60 @@ namespace graphlab {
       size_t numel = 0; 
       numel_iarc.read(reinterpret_cast<char*>(&numel), sizeof(size_t));
       //std::cout << "Receiving: " << numel << "\n";
+      if (receive_views && gl_is_pod_or_scaler<T>::value && numel > 0) {
+        boost::shared_ptr<void> block = distributed_control::retain_call_buffer();
+        if (block) {
+          // The values are preceded by the call header, which has been
+          // consumed, so misaligned values can be moved back over it.
+          char* values = const_cast<char*>(iarc.buf + iarc.off);
+          const size_t misalign = reinterpret_cast<size_t>(values) %
+                                  boost::alignment_of<T>::value;
+          if (misalign > 0) {
+            memmove(values - misalign, values, sizeof(T) * numel);
+            values -= misalign;
+          }
+          receive_view(src_proc, array_ref<T>(reinterpret_cast<const T*>(values),
+                                              numel, block));
+          return;
+        }
+      }
+      receive_values(src_proc, numel, iarc);
+    } // end of rpc rcv
+
+    void rpc_recv_compressed(size_t len, wild_pointer w) {
+      iarchive iarc(reinterpret_cast<const char*>(w.ptr), len);
+      procid_t src_proc; size_t numel;
+      iarc >> src_proc >> numel;
+      std::vector<char> payload;
+      const bool success =
+          dc_impl::exchange_compressor::decompress(iarc.buf + iarc.off,
+                                                   len - iarc.off, payload);
+      ASSERT_TRUE(success);
+      if (receive_views && gl_is_pod_or_scaler<T>::value && numel > 0) {
+        // the decompressed values are used in place
+        ASSERT_EQ(payload.size(), sizeof(T) * numel);
+        boost::shared_ptr<std::vector<char> >
+            owned(new std::vector<char>());
+        owned->swap(payload);
+        receive_view(src_proc,
+                     array_ref<T>(reinterpret_cast<const T*>(&((*owned)[0])),
+                                  numel, owned));
+        return;
+      }
+      iarchive payload_iarc(payload.empty() ? NULL : &(payload[0]),
+                            payload.size());
+      receive_values(src_proc, numel, payload_iarc);
+    }
+
+    void receive_values(procid_t src_proc, size_t numel, iarchive& iarc) {
+      buffer_type tmp;
       tmp.resize(numel);
-      for (size_t i = 0;i < numel; ++i) {
-        iarc >> tmp[i];
+      if (gl_is_pod_or_scaler<T>::value) {
+        if (numel > 0) deserialize(iarc, &(tmp[0]), sizeof(T) * numel);
+      } else {
+        for (size_t i = 0;i < numel; ++i) {
+          iarc >> tmp[i];
+        }
       }
 
       size_t wid = fiber_control::get_worker_id();
@@ -310,7 +444,18 @@ namespace graphlab {
       rec.proc = src_proc;
       rec.buffer.swap(tmp);
       lock.unlock();
-    } // end of rpc rcv
+    }
+
+    void receive_view(procid_t src_proc, const array_ref<T>& view) {
+      size_t wid = fiber_control::get_worker_id();
+      lock.lock();
+      recv_buffers[wid].push_back(buffer_record());
+      buffer_record& rec = recv_buffers[wid].back();
+      rec.proc = src_proc;
+      rec.view = view;
+      rec.is_view = true;
+      lock.unlock();
+    }
 
 
 
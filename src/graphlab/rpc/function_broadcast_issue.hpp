@@ -116,10 +116,10 @@ class  BOOST_PP_CAT(FNAME_AND_CALL, N) { \
       oarchive* buf = get_thread_local_buffer(*iter);  \
       buf->write(arc.buf, arc.off);  \
       release_thread_local_buffer(*iter, flags & CONTROL_PACKET); \
+      if (flags & FLUSH_PACKET) pull_flush_urgent_thread_local_buffer(*iter); \
       ++iter;    \
     } \
     free(arc.buf); \
-    if (flags & FLUSH_PACKET) pull_flush_soon_thread_local_buffer(); \
   }\
 };
 
@@ -124,10 +124,10 @@ class  BOOST_PP_CAT(BOOST_PP_TUPLE_ELEM(2,0,FNAME_AND_CALL), N) { \
       if ((flags & CONTROL_PACKET) == 0) {                                 \
         rmi->inc_bytes_sent((*iter), curlen); \
       } \
+      if (flags & FLUSH_PACKET) pull_flush_urgent_thread_local_buffer(*iter); \
       ++iter; \
     } \
     free(arc.buf); \
-    if (flags & FLUSH_PACKET) pull_flush_soon_thread_local_buffer(); \
   }  \
 };
 
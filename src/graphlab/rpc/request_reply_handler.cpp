@@ -30,6 +30,8 @@ namespace graphlab {
 void request_reply_handler(distributed_control &dc, procid_t src, 
                            size_t ptr, dc_impl::blob ret) {
   dc_impl::ireply_container* a = reinterpret_cast<dc_impl::ireply_container*>(ptr);
+  // the container may be destroyed as soon as it receives the reply
+  dc.get_flush_policy().observe_rtt(dc_impl::flush_policy::now() - a->issue_time);
   a->receive(src, ret);
 }
 
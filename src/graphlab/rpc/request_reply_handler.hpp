@@ -27,6 +27,7 @@
 #include <graphlab/parallel/atomic.hpp>
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/rpc/dc_internal_types.hpp>
+#include <graphlab/rpc/dc_flush_policy.hpp>
 namespace graphlab {
 
 class distributed_control;
@@ -81,7 +82,9 @@ struct blob {
  * Abstract class for where the result of a request go into.
  */
 struct ireply_container {
-  ireply_container() { }
+  /// When the request was issued. Used to measure round trip times
+  uint64_t issue_time;
+  ireply_container(): issue_time(flush_policy::now()) { }
   virtual ~ireply_container() { }
   virtual void wait() = 0;
   virtual void receive(procid_t source, blob b) = 0;
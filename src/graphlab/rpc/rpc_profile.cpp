@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <time.h>
+#include <execinfo.h>
+#include <cxxabi.h>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <graphlab/rpc/rpc_profile.hpp>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+
+namespace graphlab {
+
+rpc_function_profile::rpc_function_profile()
+    : dispatch(0), calls_sent(0), bytes_sent(0),
+      calls_received(0), bytes_received(0),
+      queue_seconds(0), handler_seconds(0),
+      queue_histogram(RPC_PROFILE_HISTOGRAM_SIZE, 0),
+      handler_histogram(RPC_PROFILE_HISTOGRAM_SIZE, 0) { }
+
+rpc_function_profile&
+rpc_function_profile::operator+=(const rpc_function_profile& other) {
+  if (name.empty()) name = other.name;
+  calls_sent += other.calls_sent;
+  bytes_sent += other.bytes_sent;
+  calls_received += other.calls_received;
+  bytes_received += other.bytes_received;
+  queue_seconds += other.queue_seconds;
+  handler_seconds += other.handler_seconds;
+  for (size_t i = 0;i < RPC_PROFILE_HISTOGRAM_SIZE; ++i) {
+    queue_histogram[i] += other.queue_histogram[i];
+    handler_histogram[i] += other.handler_histogram[i];
+  }
+  return *this;
+}
+
+void rpc_function_profile::save(oarchive& oarc) const {
+  oarc << dispatch << name << calls_sent << bytes_sent
+       << calls_received << bytes_received
+       << queue_seconds << handler_seconds
+       << queue_histogram << handler_histogram;
+}
+
+void rpc_function_profile::load(iarchive& iarc) {
+  iarc >> dispatch >> name >> calls_sent >> bytes_sent
+       >> calls_received >> bytes_received
+       >> queue_seconds >> handler_seconds
+       >> queue_histogram >> handler_histogram;
+}
+
+namespace dc_impl {
+
+volatile bool rpc_profile_enabled = false;
+
+namespace {
+
+/// The counters of one dispatch function. dispatch is 0 if unused.
+struct profile_entry {
+  volatile size_t dispatch;
+  atomic<size_t> calls_sent, bytes_sent;
+  atomic<size_t> calls_received, bytes_received;
+  atomic<size_t> queue_ns, handler_ns;
+  atomic<size_t> queue_histogram[RPC_PROFILE_HISTOGRAM_SIZE];
+  atomic<size_t> handler_histogram[RPC_PROFILE_HISTOGRAM_SIZE];
+  profile_entry(): dispatch(0) { }
+};
+
+/// Must be a power of 2. Functions beyond this many are not profiled.
+const size_t PROFILE_TABLE_SIZE = 4096;
+
+/// Open addressed table of profile_entry, allocated on first use
+profile_entry* profile_table = NULL;
+mutex profile_table_lock;
+
+/// Finds or inserts the entry of a dispatch function. Lock free.
+profile_entry* find_entry(size_t dispatch) {
+  size_t idx = (dispatch >> 4) * 0x9E3779B97F4A7C15ULL;
+  for (size_t i = 0;i < PROFILE_TABLE_SIZE; ++i) {
+    profile_entry& entry = profile_table[(idx + i) & (PROFILE_TABLE_SIZE - 1)];
+    if (entry.dispatch == dispatch) return &entry;
+    if (entry.dispatch == 0 &&
+        __sync_bool_compare_and_swap(&entry.dispatch, 0, dispatch)) {
+      return &entry;
+    }
+    // lost the race for an empty slot, possibly to the same function
+    if (entry.dispatch == dispatch) return &entry;
+  }
+  return NULL;
+}
+
+size_t read_dispatch(const char* data, size_t len) {
+  iarchive arc(data, len);
+  size_t dispatch;
+  arc >> dispatch;
+  return dispatch;
+}
+
+size_t histogram_bucket(uint64_t ns) {
+  const uint64_t us = ns / 1000;
+  if (us == 0) return 0;
+  const size_t bucket = 64 - __builtin_clzll(us);
+  return std::min(bucket, RPC_PROFILE_HISTOGRAM_SIZE - 1);
+}
+
+/// The demangled name of a function, or its address if it has no symbol
+std::string function_name(size_t address) {
+  void* ptr = reinterpret_cast<void*>(address);
+  std::string name;
+  char** symbols = backtrace_symbols(&ptr, 1);
+  if (symbols != NULL) {
+    // of the form binary(mangled+offset) [address]
+    std::string symbol(symbols[0]);
+    free(symbols);
+    size_t begin = symbol.find('(');
+    size_t end = symbol.find_first_of("+)", begin);
+    if (begin != std::string::npos && end != std::string::npos &&
+        end > begin + 1) {
+      std::string mangled = symbol.substr(begin + 1, end - begin - 1);
+      int status = 0;
+      char* demangled = abi::__cxa_demangle(mangled.c_str(), NULL, NULL, &status);
+      if (demangled != NULL) {
+        name = demangled;
+        free(demangled);
+      } else {
+        name = mangled;
+      }
+    }
+  }
+  if (name.empty()) {
+    std::stringstream strm;
+    strm << "0x" << std::hex << address;
+    name = strm.str();
+  }
+  return name;
+}
+
+bool more_expensive(const rpc_function_profile& a,
+                    const rpc_function_profile& b) {
+  if (a.handler_seconds != b.handler_seconds) {
+    return a.handler_seconds > b.handler_seconds;
+  }
+  return a.bytes_sent + a.bytes_received > b.bytes_sent + b.bytes_received;
+}
+
+std::string json_escape(const std::string& str) {
+  std::string ret;
+  for (size_t i = 0;i < str.length(); ++i) {
+    if (str[i] == '"' || str[i] == '\\') ret += '\\';
+    ret += str[i];
+  }
+  return ret;
+}
+
+void json_array(std::ostream& strm, const std::vector<size_t>& values) {
+  strm << "[";
+  for (size_t i = 0;i < values.size(); ++i) {
+    if (i > 0) strm << ", ";
+    strm << values[i];
+  }
+  strm << "]";
+}
+
+} // anonymous namespace
+
+
+void rpc_profile_set_enabled(bool enabled) {
+  if (enabled) {
+    profile_table_lock.lock();
+    if (profile_table == NULL) profile_table = new profile_entry[PROFILE_TABLE_SIZE];
+    profile_table_lock.unlock();
+    // the table must be visible before the flag
+    __sync_synchronize();
+  }
+  rpc_profile_enabled = enabled;
+}
+
+uint64_t rpc_profile_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+void rpc_profile_send(const char* data, size_t len) {
+  profile_entry* entry = find_entry(read_dispatch(data, len));
+  if (entry == NULL) return;
+  entry->calls_sent.inc();
+  entry->bytes_sent.inc(len);
+}
+
+void rpc_profile_receive(const char* data, size_t len,
+                         uint64_t enqueue_time,
+                         uint64_t handler_start, uint64_t handler_end) {
+  profile_entry* entry = find_entry(read_dispatch(data, len));
+  if (entry == NULL) return;
+  entry->calls_received.inc();
+  entry->bytes_received.inc(len);
+  if (enqueue_time > 0 && handler_start >= enqueue_time) {
+    const uint64_t queued = handler_start - enqueue_time;
+    entry->queue_ns.inc(queued);
+    entry->queue_histogram[histogram_bucket(queued)].inc();
+  }
+  const uint64_t handled = handler_end - handler_start;
+  entry->handler_ns.inc(handled);
+  entry->handler_histogram[histogram_bucket(handled)].inc();
+}
+
+std::vector<rpc_function_profile> rpc_profile_snapshot() {
+  std::vector<rpc_function_profile> ret;
+  if (profile_table == NULL) return ret;
+  for (size_t i = 0;i < PROFILE_TABLE_SIZE; ++i) {
+    const profile_entry& entry = profile_table[i];
+    if (entry.dispatch == 0) continue;
+    rpc_function_profile prof;
+    prof.dispatch = entry.dispatch;
+    prof.name = function_name(entry.dispatch);
+    prof.calls_sent = entry.calls_sent.value;
+    prof.bytes_sent = entry.bytes_sent.value;
+    prof.calls_received = entry.calls_received.value;
+    prof.bytes_received = entry.bytes_received.value;
+    prof.queue_seconds = double(entry.queue_ns.value) / 1e9;
+    prof.handler_seconds = double(entry.handler_ns.value) / 1e9;
+    for (size_t j = 0;j < RPC_PROFILE_HISTOGRAM_SIZE; ++j) {
+      prof.queue_histogram[j] = entry.queue_histogram[j].value;
+      prof.handler_histogram[j] = entry.handler_histogram[j].value;
+    }
+    ret.push_back(prof);
+  }
+  return ret;
+}
+
+std::vector<rpc_function_profile>
+rpc_profile_merge(const std::vector<std::vector<rpc_function_profile> >& profiles) {
+  std::map<size_t, rpc_function_profile> merged;
+  for (size_t i = 0;i < profiles.size(); ++i) {
+    for (size_t j = 0;j < profiles[i].size(); ++j) {
+      rpc_function_profile& prof = merged[profiles[i][j].dispatch];
+      prof.dispatch = profiles[i][j].dispatch;
+      prof += profiles[i][j];
+    }
+  }
+  std::vector<rpc_function_profile> ret;
+  std::map<size_t, rpc_function_profile>::const_iterator iter = merged.begin();
+  for (; iter != merged.end(); ++iter) ret.push_back(iter->second);
+  return ret;
+}
+
+std::string rpc_profile_report(std::vector<rpc_function_profile> profiles) {
+  std::sort(profiles.begin(), profiles.end(), more_expensive);
+  std::stringstream strm;
+  strm << std::setw(10) << "calls_sent" << std::setw(12) << "MB_sent"
+       << std::setw(12) << "calls_recv" << std::setw(12) << "MB_recv"
+       << std::setw(12) << "queue_us" << std::setw(12) << "handler_us"
+       << std::setw(12) << "handler_s" << "  function\n";
+  strm << std::fixed;
+  for (size_t i = 0;i < profiles.size(); ++i) {
+    const rpc_function_profile& prof = profiles[i];
+    const double ncalls = std::max<double>(prof.calls_received, 1);
+    strm << std::setw(10) << prof.calls_sent
+         << std::setw(12) << std::setprecision(2)
+         << double(prof.bytes_sent) / (1024 * 1024)
+         << std::setw(12) << prof.calls_received
+         << std::setw(12) << double(prof.bytes_received) / (1024 * 1024)
+         << std::setw(12) << std::setprecision(1)
+         << 1e6 * prof.queue_seconds / ncalls
+         << std::setw(12) << 1e6 * prof.handler_seconds / ncalls
+         << std::setw(12) << std::setprecision(3) << prof.handler_seconds
+         << "  " << prof.name << "\n";
+  }
+  return strm.str();
+}
+
+std::string rpc_profile_json(std::vector<rpc_function_profile> profiles) {
+  std::sort(profiles.begin(), profiles.end(), more_expensive);
+  std::stringstream strm;
+  strm << "[\n";
+  for (size_t i = 0;i < profiles.size(); ++i) {
+    const rpc_function_profile& prof = profiles[i];
+    strm << "    {\n"
+         << "      \"name\": \"" << json_escape(prof.name) << "\",\n"
+         << "      \"dispatch\": " << prof.dispatch << ",\n"
+         << "      \"calls_sent\": " << prof.calls_sent << ",\n"
+         << "      \"bytes_sent\": " << prof.bytes_sent << ",\n"
+         << "      \"calls_received\": " << prof.calls_received << ",\n"
+         << "      \"bytes_received\": " << prof.bytes_received << ",\n"
+         << "      \"queue_seconds\": " << prof.queue_seconds << ",\n"
+         << "      \"handler_seconds\": " << prof.handler_seconds << ",\n"
+         << "      \"queue_histogram\": ";
+    json_array(strm, prof.queue_histogram);
+    strm << ",\n      \"handler_histogram\": ";
+    json_array(strm, prof.handler_histogram);
+    strm << "\n    }" << (i + 1 < profiles.size() ? "," : "") << "\n";
+  }
+  strm << "]\n";
+  return strm.str();
+}
+
+std::pair<std::string, std::string>
+rpc_profile_json_page(std::map<std::string, std::string>& vars) {
+  distributed_control* dc = distributed_control::get_instance();
+  std::vector<std::vector<rpc_function_profile> > profiles;
+  if (dc != NULL) {
+    procid_t begin = 0, end = dc->numprocs();
+    if (vars.count("machine")) {
+      begin = atoi(vars["machine"].c_str());
+      end = std::min<procid_t>(begin + 1, dc->numprocs());
+    }
+    for (procid_t p = begin; p < end; ++p) {
+      if (p == dc->procid()) profiles.push_back(rpc_profile_snapshot());
+      else profiles.push_back(dc->remote_request(p, rpc_profile_snapshot));
+    }
+  }
+  return std::make_pair(std::string("text/plain"),
+                        rpc_profile_json(rpc_profile_merge(profiles)));
+}
+
+} // namespace dc_impl
+} // namespace graphlab
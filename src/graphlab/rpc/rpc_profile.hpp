@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_RPC_RPC_PROFILE_HPP
+#define GRAPHLAB_RPC_RPC_PROFILE_HPP
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <graphlab/serialization/iarchive.hpp>
+#include <graphlab/serialization/oarchive.hpp>
+
+namespace graphlab {
+
+/**
+ * \ingroup rpc
+ * The number of buckets of the latency histograms of an
+ * \ref rpc_function_profile. Bucket 0 counts calls which took less than
+ * 1 microsecond, bucket i > 0 calls which took [2^(i-1), 2^i) microseconds,
+ * and the last bucket all longer calls.
+ */
+const size_t RPC_PROFILE_HISTOGRAM_SIZE = 24;
+
+/**
+ * \ingroup rpc
+ * The RPC traffic caused by one dispatch function, as collected when RPC
+ * profiling is enabled (see
+ * \ref distributed_control::set_rpc_profiling()).
+ *
+ * There is one dispatch function for every remote function type and
+ * target class, so the calls of the different exchanges of an engine
+ * (vertex data, gathers, messages...) and of the aggregators are told
+ * apart.
+ */
+struct rpc_function_profile {
+  /// The address of the dispatch function
+  size_t dispatch;
+  /**
+   * The demangled name of the dispatch function, or its address if the
+   * program was not linked with -rdynamic
+   */
+  std::string name;
+  size_t calls_sent;
+  /// Bytes serialized, excluding packet headers
+  size_t bytes_sent;
+  size_t calls_received;
+  size_t bytes_received;
+  /// Total time the received calls waited in the receive queue
+  double queue_seconds;
+  /**
+   * Total time spent in the handlers of the received calls. A handler
+   * which blocks is charged for the time it is blocked.
+   */
+  double handler_seconds;
+  /// Histogram of the time spent in the receive queue
+  std::vector<size_t> queue_histogram;
+  /// Histogram of the time spent in the handler
+  std::vector<size_t> handler_histogram;
+
+  rpc_function_profile();
+
+  /// Adds the counts of another profile of the same function
+  rpc_function_profile& operator+=(const rpc_function_profile& other);
+
+  void save(oarchive& oarc) const;
+  void load(iarchive& iarc);
+};
+
+namespace dc_impl {
+
+/// \internal True while RPC calls are being profiled
+extern volatile bool rpc_profile_enabled;
+
+/// \internal Starts or stops profiling
+void rpc_profile_set_enabled(bool enabled);
+
+/// \internal A monotonic timestamp in nanoseconds
+uint64_t rpc_profile_now();
+
+/**
+ * \internal
+ * Records a sent call. data points to the call after the packet header.
+ */
+void rpc_profile_send(const char* data, size_t len);
+
+/**
+ * \internal
+ * Records a received call. data points to the call after the packet
+ * header. enqueue_time is the rpc_profile_now() at which the call was
+ * received, or 0 if unknown.
+ */
+void rpc_profile_receive(const char* data, size_t len,
+                         uint64_t enqueue_time,
+                         uint64_t handler_start, uint64_t handler_end);
+
+/**
+ * \internal
+ * Returns the profile of every function which was called on this machine.
+ * Remotely callable.
+ */
+std::vector<rpc_function_profile> rpc_profile_snapshot();
+
+/// \internal Merges the profiles of several machines
+std::vector<rpc_function_profile>
+rpc_profile_merge(const std::vector<std::vector<rpc_function_profile> >& profiles);
+
+/// \internal Formats profiles as a text table, most expensive first
+std::string rpc_profile_report(std::vector<rpc_function_profile> profiles);
+
+/// \internal Formats profiles as a JSON array, most expensive first
+std::string rpc_profile_json(std::vector<rpc_function_profile> profiles);
+
+/**
+ * \internal
+ * The metrics server callback for rpc_profile.json. Reports the profile
+ * of all machines, merged, or of the machine given by the "machine"
+ * variable.
+ */
+std::pair<std::string, std::string>
+rpc_profile_json_page(std::map<std::string, std::string>& vars);
+
+} // namespace dc_impl
+} // namespace graphlab
+#endif
@@ -1,5 +1,6 @@
 #include <graphlab/rpc/thread_local_send_buffer.hpp>
 #include <graphlab/rpc/dc.hpp>
+#include <graphlab/rpc/rpc_profile.hpp>
 namespace graphlab {
 namespace dc_impl {
 
@@ -23,8 +24,10 @@ thread_local_buffer::thread_local_buffer() {
 
 
 thread_local_buffer::~thread_local_buffer() {
-  dc->unregister_send_buffer(this);
+  // flush while still registered, so that the remaining data is sent over
+  // the same connection as the rest of the data of this thread
   push_flush();
+  dc->unregister_send_buffer(this);
   // deallocate the buffers
   for (size_t i = 0; i < current_archive.size(); ++i) {
     if (current_archive[i].buf) {
@@ -50,7 +53,7 @@ void thread_local_buffer::push_flush() {
     if (bufs.first != NULL) {
       while(bufs.first != bufs.second) {
         buffer_elem* prev = bufs.first;
-        dc->write_to_buffer(i, bufs.first->buf, bufs.second->len);
+        dc->write_to_buffer(i, this, bufs.first->buf, bufs.first->len);
         buffer_elem** next = &bufs.first->next;
         volatile buffer_elem** n = (volatile buffer_elem**)(next);
         while(__unlikely__((*n) == NULL)) {
@@ -83,6 +86,11 @@ void thread_local_buffer::pull_flush_soon(procid_t p) {
   dc->flush_soon(p);
 }
 
+
+void thread_local_buffer::pull_flush_urgent(procid_t p) {
+  dc->flush_urgent(p);
+}
+
 oarchive* thread_local_buffer::acquire(procid_t target) {
   archive_locks[target].lock();
   // need a new archive, or existing one at risk of being resized
@@ -103,7 +111,9 @@ void thread_local_buffer::add_to_queue(procid_t target, char* ptr, size_t len) {
   elem->len = len;
   elem->next = NULL;
   outbuf[target]->enqueue(elem);
-  if (outbuf[target]->approx_size() > NUM_FULL_BUFFER_LIMIT) {
+  flush_policy& policy = dc->get_flush_policy();
+  policy.observe_queued(len);
+  if (outbuf[target]->approx_size() >= policy.queue_limit()) {
     pull_flush_soon(target);
   }
 }
@@ -113,8 +123,13 @@ void thread_local_buffer::release(procid_t target, bool do_not_count_bytes_sent)
     bytes_sent[target] += current_archive[target].off - prev_acquire_archive_size - sizeof(packet_hdr);
     inc_calls_sent(target);
   }
+  if (dc_impl::rpc_profile_enabled) {
+    size_t callstart = prev_acquire_archive_size + sizeof(packet_hdr);
+    dc_impl::rpc_profile_send(current_archive[target].buf + callstart,
+                              current_archive[target].off - callstart);
+  }
 
-  if (current_archive[target].off >= FULL_BUFFER_SIZE_LIMIT) {
+  if (current_archive[target].off >= dc->get_flush_policy().buffer_size_limit()) {
     // shift the buffer into outbuf
     char* ptr = current_archive[target].buf;
     size_t len = current_archive[target].off;
@@ -136,6 +151,9 @@ void thread_local_buffer::write(procid_t target, char* c, size_t len,
     bytes_sent[target] += len;
     inc_calls_sent(target);
   }
+  if (dc_impl::rpc_profile_enabled) {
+    dc_impl::rpc_profile_send(c + sizeof(packet_hdr), len - sizeof(packet_hdr));
+  }
   // make sure that messsages sent before this write are sent before this write
   if (current_archive[target].off) {
     archive_locks[target].lock();
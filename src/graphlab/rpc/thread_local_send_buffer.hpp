@@ -81,6 +81,13 @@ struct thread_local_buffer {
    */
   void pull_flush_soon(procid_t p);
 
+  /**
+   * Can be called anywhere.
+   * Flushes the buffer to the sender immediately or soon, as required for
+   * urgent calls. Equivalent to calling distributed_control::flush_urgent()
+   */
+  void pull_flush_urgent(procid_t p);
+
   /**
    * Extracts the buffer going to a given target.
    * The first element of the pair points to the head of the linked list
@@ -34,6 +34,7 @@
 #define GRAPHLAB_ISCHEDULER_HPP
 
 #include <vector>
+#include <string>
 #include <sstream>
 #include <ostream>
 
@@ -101,6 +102,25 @@ namespace graphlab {
     /// returns true if the scheduler is empty. Need not be consistent.
     virtual bool empty() = 0;
 
+    /**
+     * Returns the name of a graph dependent vertex ordering
+     * (see vertex_ordering.hpp) the scheduler would like to be given through
+     * set_ordering(), or an empty string if the scheduler does not need
+     * one. The engine computes the ordering after constructing the
+     * scheduler.
+     */
+    virtual std::string get_ordering_request() const {
+      return std::string();
+    }
+
+    /**
+     * Provides a hint on the order in which vertices should be
+     * visited. order is a permutation of [0, num_vertices).
+     * Schedulers which do not sweep over the vertices ignore it.
+     * Like set_num_vertices(), this need not be thread-safe.
+     */
+    virtual void set_ordering(const std::vector<lvid_type>& order) { }
+
     /**
      * Print a help string describing the options that this scheduler
      * accepts.
@@ -30,4 +30,5 @@
 #include <graphlab/scheduler/scheduler_factory.hpp>
 #include <graphlab/scheduler/scheduler_list.hpp>
 #include <graphlab/scheduler/sweep_scheduler.hpp>
+#include <graphlab/scheduler/vertex_ordering.hpp>
 #endif
@@ -35,7 +35,9 @@
     "Useful for debugging and testing."))                               \
   (("sweep", sweep_scheduler,                                           \
     "very fast dynamic scheduler. Scans all vertices in sequence, "     \
-    "running all update tasks on each vertex evaluated."))              \
+    "running all update tasks on each vertex evaluated. The sequence "  \
+    "can follow the vertex degree, a topological order or a coloring "  \
+    "of the graph."))                                                   \
   (("priority", priority_scheduler,                                     \
     "Standard Priority queue, poor parallelism, but task evaluation "   \
     "sequence is highly predictable. Useful for debugging"))            \
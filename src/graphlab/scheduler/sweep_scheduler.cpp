@@ -21,7 +21,9 @@
  */
 
 
+#include <algorithm>
 #include <graphlab/scheduler/sweep_scheduler.hpp>
+#include <graphlab/util/integer_mix.hpp>
 #include <graphlab/macros_def.hpp>
 namespace graphlab {
 
@@ -31,7 +33,9 @@ void sweep_scheduler::set_options(const graphlab_options& opts) {
   foreach(std::string opt, keys) {
     if (opt == "order") {
       opts.get_scheduler_args().get_option("order", ordering);
-      ASSERT_TRUE(ordering == "random" || ordering == "ascending");
+      ASSERT_TRUE(ordering == "random" || ordering == "ascending" ||
+                  ordering == "degree" || ordering == "topological" ||
+                  ordering == "color");
     } else if (opt == "strict") {
       opts.get_scheduler_args().get_option("strict", strict_round_robin);
     } else if (opt == "max_iterations") {
@@ -60,11 +64,7 @@ sweep_scheduler::sweep_scheduler(size_t num_vertices,
   ordering = "random";
   set_options(opts);
 
-  if (ordering == "ascending") {
-    randomizer = 1;
-  } else if(ordering == "random") {
-    randomizer = 1500450271;
-  }
+  if(ordering == "random") make_random_ordering();
 
   if(strict_round_robin) {
     logstream(LOG_INFO)
@@ -76,48 +76,163 @@ sweep_scheduler::sweep_scheduler(size_t num_vertices,
     }
     rr_index = 0;
   } else {
-    // each cpu is responsible for its own subset of vertices
-    // Initialize the cpu2index counters
+    // each cpu is responsible for its own stripe of positions
     cpu2index.resize(ncpus);
-    for(size_t i = 0; i < cpu2index.size(); ++i) cpu2index[i] = i;
+    for(size_t i = 0; i < cpu2index.size(); ++i) {
+      cpu2index[i] = stripe_begin(i);
+    }
   }
-  vertex_is_scheduled.resize(num_vertices);
 } // end of constructor
 
 
+void sweep_scheduler::make_random_ordering() {
+  // a fixed pseudo-random permutation: sort the vertices by a hash
+  std::vector<std::pair<uint32_t, lvid_type> > keys(num_vertices);
+  for (size_t i = 0; i < num_vertices; ++i) {
+    keys[i] = std::make_pair(integer_mix(uint32_t(i)), lvid_type(i));
+  }
+  std::sort(keys.begin(), keys.end());
+  position2vid.resize(num_vertices);
+  vid2position.resize(num_vertices);
+  for (size_t i = 0; i < num_vertices; ++i) {
+    position2vid[i] = keys[i].second;
+    vid2position[keys[i].second] = i;
+  }
+}
+
+
+void sweep_scheduler::set_ordering(const std::vector<lvid_type>& order) {
+  ASSERT_EQ(order.size(), num_vertices);
+  std::vector<lvid_type> scheduled;
+  foreach(size_t pos, vertex_is_scheduled) scheduled.push_back(vid_at(pos));
+
+  position2vid = order;
+  vid2position.resize(num_vertices);
+  for (size_t i = 0; i < num_vertices; ++i) {
+    ASSERT_LT(position2vid[i], num_vertices);
+    vid2position[position2vid[i]] = i;
+  }
+  vertex_is_scheduled.clear();
+  foreach(lvid_type vid, scheduled) {
+    vertex_is_scheduled.set_bit_unsync(position_of(vid));
+  }
+}
+
+
+std::string sweep_scheduler::get_ordering_request() const {
+  if (ordering == "degree" || ordering == "topological" ||
+      ordering == "color") {
+    return ordering;
+  }
+  return std::string();
+}
+
+
 void sweep_scheduler::set_num_vertices(const lvid_type numv) {
+  if (position2vid.empty()) {
+    vertex_is_scheduled.resize(numv);
+  } else {
+    // keep the existing order. New vertices are appended to the sweep.
+    std::vector<lvid_type> scheduled;
+    foreach(size_t pos, vertex_is_scheduled) {
+      if (vid_at(pos) < numv) scheduled.push_back(vid_at(pos));
+    }
+    std::vector<lvid_type> order;
+    order.reserve(numv);
+    foreach(lvid_type vid, position2vid) {
+      if (vid < numv) order.push_back(vid);
+    }
+    for (size_t vid = num_vertices; vid < numv; ++vid) order.push_back(vid);
+    position2vid.swap(order);
+    vid2position.resize(numv);
+    for (size_t i = 0; i < numv; ++i) vid2position[position2vid[i]] = i;
+    vertex_is_scheduled.resize(numv);
+    vertex_is_scheduled.clear();
+    foreach(lvid_type vid, scheduled) {
+      vertex_is_scheduled.set_bit_unsync(position_of(vid));
+    }
+  }
   num_vertices = numv;
-  vertex_is_scheduled.resize(numv);
+  for(size_t i = 0; i < cpu2index.size(); ++i) {
+    cpu2index[i] = stripe_begin(i);
+  }
 }
 
 void sweep_scheduler::schedule(const lvid_type vid, double priority) {      
-  if (vid < num_vertices) vertex_is_scheduled.set_bit(vid);
+  if (vid < num_vertices) vertex_is_scheduled.set_bit(position_of(vid));
 } 
 
 
+bool sweep_scheduler::take_in_range(size_t begin, size_t end,
+                                    size_t& ret_pos) {
+  const size_t WORD_BITS = 8 * sizeof(size_t);
+  size_t pos = begin;
+  while (pos < end) {
+    const size_t word_start = pos - (pos % WORD_BITS);
+    // ignore the bits before pos
+    size_t word = vertex_is_scheduled.containing_word(pos) &
+        (size_t(-1) << (pos % WORD_BITS));
+    while (word) {
+      const size_t p = word_start + __builtin_ctzl(word);
+      if (p >= end) return false;
+      if (vertex_is_scheduled.clear_bit(p)) {
+        ret_pos = p;
+        return true;
+      }
+      // lost the race for this bit. try the next one.
+      word &= word - 1;
+    }
+    pos = word_start + WORD_BITS;
+  }
+  return false;
+}
+
+
 sched_status::status_enum sweep_scheduler::get_next(const size_t cpuid,
                                                     lvid_type& ret_vid) {         
-  const size_t max_fails = (num_vertices/ncpus) + 1;
-  // Check to see if max iterations have been achieved 
-  if(strict_round_robin && (rr_index / num_vertices) >= max_iterations) 
-    return sched_status::EMPTY;
-  // Loop through all vertices that are associated with this
-  // processor searching for a vertex with an active task
-  for(size_t idx = get_and_inc_index(cpuid), fails = 0; 
-      fails <= max_fails; // 
-      idx = get_and_inc_index(cpuid), ++fails) {
-    // It is possible that the get_and_inc_index could return an
-    // invalid index if the number of cpus exceeds the number of
-    // vertices.  In This case we alwasy return empty
-    if(__builtin_expect(idx >= num_vertices, false)) return sched_status::EMPTY;
-    const lvid_type vid = (idx * randomizer) % num_vertices;
-    bool success = vertex_is_scheduled.clear_bit(vid);
-    while(success) { // Job found now decide whether to keep it
-      ret_vid = vid; 
-      return sched_status::NEW_TASK;
+  if (num_vertices == 0) return sched_status::EMPTY;
+  size_t pos = 0;
+  if (strict_round_robin) {
+    // Check to see if max iterations have been achieved 
+    const size_t start = rr_index;
+    if (start / num_vertices >= max_iterations) return sched_status::EMPTY;
+    // sweep forward from the current position, wrapping around once
+    const size_t offset = start % num_vertices;
+    size_t next_index;
+    if (take_in_range(offset, num_vertices, pos)) {
+      next_index = start - offset + pos + 1;
+    } else if (take_in_range(0, offset, pos)) {
+      next_index = start - offset + num_vertices + pos + 1;
+    } else {
+      return sched_status::EMPTY;
+    }
+    if ((next_index - 1) / num_vertices >= max_iterations) {
+      // the vertex belongs to an iteration past the limit
+      vertex_is_scheduled.set_bit(pos);
+      return sched_status::EMPTY;
     }
-  } // end of for loop
-  return sched_status::EMPTY;
+    // advance the shared sweep past the position taken
+    size_t cur = rr_index;
+    while(cur < next_index &&
+          !atomic_compare_and_swap(rr_index.value, cur, next_index)) {
+      cur = rr_index;
+    }
+  } else {
+    // sweep this thread's stripe starting at its position, then
+    // help with the other stripes
+    const size_t cpu = cpuid % ncpus;
+    const size_t b = stripe_begin(cpu), e = stripe_begin(cpu + 1);
+    size_t cursor = cpu2index[cpu].value;
+    if (cursor < b || cursor >= e) cursor = b;
+    if (take_in_range(cursor, e, pos) || take_in_range(b, cursor, pos)) {
+      cpu2index[cpu] = pos + 1;
+    } else if (!take_in_range(e, num_vertices, pos) &&
+               !take_in_range(0, b, pos)) {
+      return sched_status::EMPTY;
+    }
+  }
+  ret_vid = vid_at(pos);
+  return sched_status::NEW_TASK;
 } // end of get_next
 
 
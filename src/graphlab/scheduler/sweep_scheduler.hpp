@@ -31,6 +31,7 @@
 #include <graphlab/scheduler/ischeduler.hpp>
 #include <graphlab/util/dense_bitset.hpp>
 #include <graphlab/parallel/atomic.hpp>
+#include <graphlab/parallel/cache_line_pad.hpp>
 #include <graphlab/options/graphlab_options.hpp>
 
 #include <graphlab/macros_def.hpp>
@@ -38,6 +39,21 @@
 namespace graphlab {
 
    /** \ingroup group_schedulers
+    *
+    * The sweep scheduler visits the vertices in a fixed order,
+    * running every scheduled vertex it passes.
+    *
+    * The schedule is a bitset indexed by the position of each vertex in
+    * the sweep order, so that finding the next scheduled vertex tests 64
+    * positions at a time. The order is either ascending lvid, a
+    * pseudo-random permutation, or any permutation supplied through
+    * set_ordering(). The engines compute the "degree", "topological"
+    * and "color" orderings (see vertex_ordering.hpp) and pass them in.
+    *
+    * With strict=true all threads share a single sweep. Otherwise, the
+    * positions are split into one contiguous stripe per thread. A thread
+    * sweeps its own stripe and only looks at the other stripes once its
+    * stripe is empty.
     */
   class sweep_scheduler: public ischeduler {
   private:
@@ -46,17 +62,48 @@ namespace graphlab {
 
     size_t num_vertices;
     bool strict_round_robin;
+    /// absolute sweep position. The iteration is rr_index / num_vertices
     atomic<size_t> rr_index;
     size_t max_iterations;
-    size_t randomizer;
 
-    std::vector<lvid_type>             cpu2index;
+    /// The position each thread resumes scanning its stripe at
+    std::vector<cache_line_pad<size_t> > cpu2index;
 
+    /// The schedule, indexed by sweep position
     dense_bitset vertex_is_scheduled;
     std::string                             ordering;
 
+    /// The vertex at each position. Empty for the ascending order.
+    std::vector<lvid_type> position2vid;
+    /// The position of each vertex. Empty for the ascending order.
+    std::vector<lvid_type> vid2position;
+
     void set_options(const graphlab_options& opts);
 
+    /// Fills in the pseudo-random order over num_vertices vertices
+    void make_random_ordering();
+
+    /**
+     * Tries to take (unschedule) the first scheduled position in
+     * [begin, end), returning it in ret_pos. Positions are scanned a word
+     * at a time.
+     */
+    bool take_in_range(size_t begin, size_t end, size_t& ret_pos);
+
+    /// Returns the first position of the stripe of a thread
+    inline size_t stripe_begin(size_t cpuid) const {
+      const size_t nwords = (num_vertices + 63) / 64;
+      return std::min(nwords * cpuid / ncpus * 64, num_vertices);
+    }
+
+    inline lvid_type vid_at(size_t pos) const {
+      return position2vid.empty() ? lvid_type(pos) : position2vid[pos];
+    }
+
+    inline size_t position_of(lvid_type vid) const {
+      return vid2position.empty() ? size_t(vid) : size_t(vid2position[vid]);
+    }
+
   public:
     sweep_scheduler(size_t num_vertices,
                     const graphlab_options& opts);
@@ -68,10 +115,24 @@ namespace graphlab {
 
     
     sched_status::status_enum get_next(const size_t cpuid, lvid_type& ret_vid);
+
+    /**
+     * Returns the graph dependent ordering requested through the
+     * "order" option ("degree", "topological" or "color"), or an empty
+     * string.
+     */
+    std::string get_ordering_request() const;
+
+    /**
+     * Sets the sweep order. order must be a permutation of
+     * [0, num_vertices). Vertices which are scheduled remain scheduled.
+     */
+    void set_ordering(const std::vector<lvid_type>& order);
     
     
     static void print_options_help(std::ostream &out) {
-      out << "order = [string: {random, ascending} default=random]\n"
+      out << "order = [string: {random, ascending, degree, topological, "
+          << "color} default=random]\n"
           << "strict = [bool, use strict round robin schedule, default=true]\n"
           << "max_iterations = [integer, maximum number of iterations "
           << " (requires strict=true) \n"
@@ -80,23 +141,8 @@ namespace graphlab {
 
 
     bool empty() {
-      return (vertex_is_scheduled.popcount() == 0);
+      return vertex_is_scheduled.empty();
     }
-
-  private:
-    inline size_t get_and_inc_index(const size_t cpuid) {
-      if (strict_round_robin) { 
-        return rr_index++ % num_vertices; 
-      } else {
-        const size_t index = cpu2index[cpuid];
-        cpu2index[cpuid] += ncpus;
-        // Address loop around
-        if (__builtin_expect(cpu2index[cpuid] >= num_vertices, false)) 
-          cpu2index[cpuid] = cpuid;
-        return index;
-      }
-    }// end of next index
-
   };
 
 
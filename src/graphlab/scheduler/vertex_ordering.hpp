@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_VERTEX_ORDERING_HPP
+#define GRAPHLAB_VERTEX_ORDERING_HPP
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/macros_def.hpp>
+namespace graphlab {
+
+/**
+ * \internal
+ * Orderings of the local vertices of a distributed_graph which can be
+ * passed to ischeduler::set_ordering(). Each function returns a
+ * permutation of [0, graph.num_local_vertices()). The orderings only look
+ * at the local vertices and edges and require no communication.
+ */
+namespace vertex_ordering {
+
+  namespace vertex_ordering_impl {
+    struct degree_greater {
+      const std::vector<size_t>& degree;
+      degree_greater(const std::vector<size_t>& degree): degree(degree) { }
+      bool operator()(lvid_type a, lvid_type b) const {
+        return degree[a] > degree[b] || (degree[a] == degree[b] && a < b);
+      }
+    };
+  } // namespace vertex_ordering_impl
+
+  /**
+   * Orders the vertices by decreasing (global) degree, so that every sweep
+   * visits the high degree vertices first.
+   */
+  template <typename GraphType>
+  std::vector<lvid_type> degree(GraphType& graph) {
+    const lvid_type nlocal = graph.num_local_vertices();
+    std::vector<size_t> deg(nlocal);
+    std::vector<lvid_type> order(nlocal);
+    for (lvid_type lvid = 0; lvid < nlocal; ++lvid) {
+      const typename GraphType::vertex_record& rec =
+          graph.l_get_vertex_record(lvid);
+      deg[lvid] = rec.num_in_edges + rec.num_out_edges;
+      order[lvid] = lvid;
+    }
+    std::sort(order.begin(), order.end(),
+              vertex_ordering_impl::degree_greater(deg));
+    return order;
+  }
+
+  /**
+   * Orders the vertices such that the source of every local edge comes
+   * before its target. Cycles are broken by taking the unvisited vertex
+   * with the lowest id.
+   */
+  template <typename GraphType>
+  std::vector<lvid_type> topological(GraphType& graph) {
+    typedef typename GraphType::local_vertex_type local_vertex_type;
+    typedef typename GraphType::local_edge_type local_edge_type;
+    const lvid_type nlocal = graph.num_local_vertices();
+    std::vector<size_t> indegree(nlocal);
+    for (lvid_type lvid = 0; lvid < nlocal; ++lvid) {
+      indegree[lvid] = graph.l_vertex(lvid).num_in_edges();
+    }
+    std::vector<lvid_type> order;
+    order.reserve(nlocal);
+    std::vector<bool> visited(nlocal, false);
+    // vertices whose in degree drops to zero are queued immediately,
+    // so both scans only need to move forward.
+    lvid_type next_source = 0, next_root = 0;
+    // order doubles as the queue of the Kahn traversal
+    size_t head = 0;
+    while (order.size() < nlocal) {
+      if (head == order.size()) {
+        // everything reachable is done. Take the next vertex without
+        // in edges, or else any unvisited vertex on a cycle.
+        while (next_source < nlocal &&
+               (visited[next_source] || indegree[next_source] > 0)) {
+          ++next_source;
+        }
+        lvid_type root = next_source;
+        if (root == nlocal) {
+          while (visited[next_root]) ++next_root;
+          root = next_root;
+        }
+        visited[root] = true;
+        order.push_back(root);
+      }
+      local_vertex_type lvertex(graph.l_vertex(order[head++]));
+      foreach(local_edge_type edge, lvertex.out_edges()) {
+        const lvid_type target = edge.target().id();
+        if (indegree[target] > 0) --indegree[target];
+        if (!visited[target] && indegree[target] == 0) {
+          visited[target] = true;
+          order.push_back(target);
+        }
+      }
+    }
+    return order;
+  }
+
+  /**
+   * Greedily colors the local vertices (in increasing lvid order) and
+   * orders them by color, so that each color class is swept in one go.
+   * Within a color class, the vertices are in increasing lvid order.
+   */
+  template <typename GraphType>
+  std::vector<lvid_type> color(GraphType& graph) {
+    typedef typename GraphType::local_vertex_type local_vertex_type;
+    typedef typename GraphType::local_edge_type local_edge_type;
+    const lvid_type nlocal = graph.num_local_vertices();
+    const size_t UNCOLORED = size_t(-1);
+    std::vector<size_t> colors(nlocal, UNCOLORED);
+    // used_by[c] == lvid if color c is used by a neighbor of lvid
+    std::vector<lvid_type> used_by;
+    size_t ncolors = 0;
+    for (lvid_type lvid = 0; lvid < nlocal; ++lvid) {
+      local_vertex_type lvertex(graph.l_vertex(lvid));
+      foreach(local_edge_type edge, lvertex.in_edges()) {
+        const size_t c = colors[edge.source().id()];
+        if (c != UNCOLORED) used_by[c] = lvid;
+      }
+      foreach(local_edge_type edge, lvertex.out_edges()) {
+        const size_t c = colors[edge.target().id()];
+        if (c != UNCOLORED) used_by[c] = lvid;
+      }
+      size_t c = 0;
+      while (c < ncolors && used_by[c] == lvid) ++c;
+      if (c == ncolors) {
+        ++ncolors;
+        used_by.push_back(lvid_type(-1));
+      }
+      colors[lvid] = c;
+    }
+    // counting sort by color
+    std::vector<size_t> start(ncolors + 1, 0);
+    for (lvid_type lvid = 0; lvid < nlocal; ++lvid) ++start[colors[lvid] + 1];
+    for (size_t c = 0; c < ncolors; ++c) start[c + 1] += start[c];
+    std::vector<lvid_type> order(nlocal);
+    for (lvid_type lvid = 0; lvid < nlocal; ++lvid) {
+      order[start[colors[lvid]]++] = lvid;
+    }
+    return order;
+  }
+
+  /**
+   * Computes the ordering with the given name: "degree", "topological"
+   * or "color".
+   */
+  template <typename GraphType>
+  std::vector<lvid_type> compute(GraphType& graph, const std::string& name) {
+    if (name == "degree") return degree(graph);
+    else if (name == "topological") return topological(graph);
+    else if (name == "color") return color(graph);
+    logstream(LOG_FATAL) << "Unknown vertex ordering: " << name << std::endl;
+    return std::vector<lvid_type>();
+  }
+
+} // namespace vertex_ordering
+} // namespace graphlab
+
+#include <graphlab/macros_undef.hpp>
+#endif
@@ -0,0 +1,173 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_SERIALIZE_ARRAY_REF_HPP
+#define GRAPHLAB_SERIALIZE_ARRAY_REF_HPP
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+#include <graphlab/serialization/is_pod.hpp>
+#include <graphlab/serialization/iarchive.hpp>
+#include <graphlab/serialization/oarchive.hpp>
+
+
+namespace graphlab {
+
+  /**
+   * \ingroup group_serialization
+   * \brief A read only view of an array of POD values which can be
+   * deserialized without copying.
+   *
+   * array_ref<T> has the same serialized representation as a
+   * std::vector<T>: a vector can be sent and received as an array_ref,
+   * and the other way around. When an array_ref is deserialized from an
+   * archive over a memory buffer (as are the arguments of a remote call),
+   * and the values happen to be suitably aligned in the buffer (always the
+   * case for single byte types), the array_ref points directly into the
+   * buffer instead of copying the values. Otherwise the values are copied
+   * into storage owned by the array_ref. The \ref buffered_exchange
+   * realigns POD values in place, and never copies them.
+   *
+   * The view is therefore only valid while the buffer it was deserialized
+   * from is. For the arguments of a remote call, this is until the call
+   * returns, unless the buffer is retained with
+   * \ref graphlab::distributed_control::retain_call_buffer() and stored as
+   * the owner() of the array_ref.
+   *
+   * \code
+   * void add_all(graphlab::array_ref<double> values) {
+   *   for (size_t i = 0;i < values.size(); ++i) total += values[i];
+   * }
+   * ...
+   * std::vector<double> values;
+   * rmi.remote_call(1, add_all, graphlab::array_ref<double>(values));
+   * \endcode
+   *
+   * \tparam T A POD type.
+   */
+  template <typename T>
+  class array_ref {
+   public:
+    typedef T value_type;
+    typedef const T* iterator;
+    typedef const T* const_iterator;
+    typedef const T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+
+    /// Constructs an empty view
+    array_ref(): ptr(NULL), len(0) { }
+
+    /**
+     * Constructs a view of the len values at ptr. owner, if set, is held
+     * for as long as this view, or a copy of it, exists.
+     */
+    array_ref(const T* ptr, size_t len,
+              const boost::shared_ptr<const void>& owner =
+                  boost::shared_ptr<const void>())
+        : ptr(ptr), len(len), storage(owner) { }
+
+    /**
+     * Constructs a view of the contents of a vector. The vector must not
+     * be modified or destroyed while the view is in use.
+     */
+    array_ref(const std::vector<T>& vec)
+        : ptr(vec.empty() ? NULL : &(vec[0])), len(vec.size()) { }
+
+    /**
+     * Moves the contents of vec into storage owned by the returned view.
+     * vec is left empty.
+     */
+    static array_ref adopt(std::vector<T>& vec) {
+      boost::shared_ptr<std::vector<T> > owned(new std::vector<T>());
+      owned->swap(vec);
+      return array_ref(owned->empty() ? NULL : &((*owned)[0]),
+                       owned->size(), owned);
+    }
+
+    inline const_iterator begin() const { return ptr; }
+    inline const_iterator end() const { return ptr + len; }
+    inline size_t size() const { return len; }
+    inline bool empty() const { return len == 0; }
+    inline const T* data() const { return ptr; }
+    inline const T& operator[](size_t i) const { return ptr[i]; }
+    inline const T& front() const { return ptr[0]; }
+    inline const T& back() const { return ptr[len - 1]; }
+
+    /// The object keeping the values alive. May be empty.
+    inline const boost::shared_ptr<const void>& owner() const {
+      return storage;
+    }
+
+    /**
+     * Sets the object keeping the values alive. The values must be owned
+     * by the new owner, so this is normally only done for a view without
+     * an owner.
+     */
+    inline void set_owner(const boost::shared_ptr<const void>& owner) {
+      storage = owner;
+    }
+
+    /// Copies the values into a vector
+    inline void assign_to(std::vector<T>& vec) const {
+      vec.assign(begin(), end());
+    }
+
+    void save(oarchive& oarc) const {
+      BOOST_STATIC_ASSERT(gl_is_pod_or_scaler<T>::value);
+      oarc << len;
+      if (len > 0) serialize(oarc, ptr, sizeof(T) * len);
+    }
+
+    void load(iarchive& iarc) {
+      BOOST_STATIC_ASSERT(gl_is_pod_or_scaler<T>::value);
+      size_t n;
+      iarc >> n;
+      storage.reset();
+      len = n;
+      if (n == 0) {
+        ptr = NULL;
+      } else if (iarc.buf != NULL &&
+                 reinterpret_cast<size_t>(iarc.buf + iarc.off) %
+                     boost::alignment_of<T>::value == 0) {
+        ptr = reinterpret_cast<const T*>(iarc.buf + iarc.off);
+        iarc.off += sizeof(T) * n;
+      } else {
+        // streams and misaligned values are copied
+        boost::shared_ptr<std::vector<T> > owned(new std::vector<T>(n));
+        deserialize(iarc, &((*owned)[0]), sizeof(T) * n);
+        ptr = &((*owned)[0]);
+        storage = owned;
+      }
+    }
+
+   private:
+    const T* ptr;
+    size_t len;
+    boost::shared_ptr<const void> storage;
+  };
+
+} // namespace graphlab
+
+#endif
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+#ifndef GRAPHLAB_DIRECT_INDEX_MAP_HPP
+#define GRAPHLAB_DIRECT_INDEX_MAP_HPP
+
+#include <vector>
+#include <algorithm>
+#include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/logger/assertions.hpp>
+
+namespace graphlab {
+
+  /**
+   * \ingroup util
+   * Maps the integer ids of the elements of an array back to their
+   * positions, without hashing, when the ids are dense enough:
+   * \li DIRECT: an array indexed by the id. Used when the largest id is
+   *     at most max_fill times the number of elements.
+   * \li PAGED: a two-level radix table of pages of 2^PAGE_BITS ids.
+   *     Pages without any element share one empty page, so ids clustered
+   *     in a few ranges cost little memory.
+   * \li DISABLED: the ids are too sparse. find() must not be called and
+   *     the caller uses its hash map instead.
+   *
+   * \code
+   * direct_index_map<vertex_id_type, lvid_type> index;
+   * index.build(lvid2record.size(), record_gvid(lvid2record));
+   * if (index.enabled()) lvid = index.find(gvid);
+   * \endcode
+   */
+  template <typename IdType, typename IndexType>
+  class direct_index_map {
+   public:
+    enum layout_type { DISABLED, DIRECT, PAGED };
+
+    /// Returned by find() for ids which are not in the map
+    static const IndexType NONE = IndexType(-1);
+
+    static const size_t PAGE_BITS = 12;
+    static const size_t PAGE_SIZE = size_t(1) << PAGE_BITS;
+
+    direct_index_map() : layout_(DISABLED) { }
+
+    /**
+     * Builds the map of the n elements whose ids are key_of(0) ...
+     * key_of(n - 1), which must be distinct. Picks the smallest layout
+     * using at most max_fill slots per element, or DISABLED.
+     */
+    template <typename KeyOf>
+    layout_type build(size_t n, const KeyOf& key_of, size_t max_fill = 4) {
+      clear();
+      if (n == 0 || n >= size_t(NONE)) return layout_;
+      IdType maxid = 0;
+      for (size_t i = 0;i < n; ++i) maxid = std::max<IdType>(maxid, key_of(i));
+      const size_t max_slots = max_fill * n;
+      if (size_t(maxid) < max_slots) {
+        slots.resize(size_t(maxid) + 1, NONE);
+        fill(n, key_of, DIRECT);
+        return layout_;
+      }
+      // the top level of the radix table is not allowed to be larger
+      // than the elements either
+      const size_t npages = (size_t(maxid) >> PAGE_BITS) + 1;
+      if (npages > n) return layout_;
+      dense_bitset used(npages);
+      for (size_t i = 0;i < n; ++i) used.set_bit(size_t(key_of(i)) >> PAGE_BITS);
+      const size_t nused = used.popcount();
+      if ((nused + 1) * PAGE_SIZE > max_slots) return layout_;
+      // page 0 of the slots is the shared empty page
+      page_offset.resize(npages, 0);
+      size_t next = PAGE_SIZE;
+      size_t page = 0;
+      bool has_page = used.first_bit(page);
+      while (has_page) {
+        page_offset[page] = next;
+        next += PAGE_SIZE;
+        has_page = used.next_bit(page);
+      }
+      slots.resize(next, NONE);
+      fill(n, key_of, PAGED);
+      return layout_;
+    }
+
+    /// The layout chosen by the last build()
+    inline layout_type layout() const { return layout_; }
+
+    /// True if find() can be used
+    inline bool enabled() const { return layout_ != DISABLED; }
+
+    /// The position of the element with the given id, or NONE
+    inline IndexType find(IdType id) const {
+      if (layout_ == DIRECT) {
+        return size_t(id) < slots.size() ? slots[size_t(id)] : NONE;
+      }
+      const size_t page = size_t(id) >> PAGE_BITS;
+      return page < page_offset.size() ?
+          slots[page_offset[page] + (size_t(id) & (PAGE_SIZE - 1))] : NONE;
+    }
+
+    void clear() {
+      std::vector<IndexType>().swap(slots);
+      std::vector<size_t>().swap(page_offset);
+      layout_ = DISABLED;
+    }
+
+    void swap(direct_index_map& other) {
+      slots.swap(other.slots);
+      page_offset.swap(other.page_offset);
+      std::swap(layout_, other.layout_);
+    }
+
+    size_t estimate_sizeof() const {
+      return sizeof(*this) + sizeof(IndexType) * slots.capacity() +
+          sizeof(size_t) * page_offset.capacity();
+    }
+
+   private:
+    /// The slot of an id in the given layout
+    inline size_t slot(IdType id, layout_type layout) const {
+      return layout == DIRECT ? size_t(id) :
+          page_offset[size_t(id) >> PAGE_BITS] + (size_t(id) & (PAGE_SIZE - 1));
+    }
+
+    template <typename KeyOf>
+    void fill(size_t n, const KeyOf& key_of, layout_type layout) {
+      // the ids are distinct, so every iteration writes a different slot
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t i = 0;i < ssize_t(n); ++i) {
+        slots[slot(key_of(i), layout)] = IndexType(i);
+      }
+      layout_ = layout;
+    }
+
+    std::vector<IndexType> slots;
+    /// PAGED: the offset of every page in slots, 0 for the empty page
+    std::vector<size_t> page_offset;
+    layout_type layout_;
+  }; // end of direct_index_map
+
+  template <typename IdType, typename IndexType>
+  const IndexType direct_index_map<IdType, IndexType>::NONE;
+
+  template <typename IdType, typename IndexType>
+  const size_t direct_index_map<IdType, IndexType>::PAGE_BITS;
+
+  template <typename IdType, typename IndexType>
+  const size_t direct_index_map<IdType, IndexType>::PAGE_SIZE;
+
+} // end of graphlab
+#endif
@@ -28,6 +28,7 @@
 #include <graphlab/util/generics/counting_sort.hpp>
 #include <graphlab/serialization/iarchive.hpp>
 #include <graphlab/serialization/oarchive.hpp>
+#include <graphlab/util/mmap_snapshot.hpp>
 
 namespace graphlab {
   /**
@@ -116,6 +117,18 @@ namespace graphlab {
        values.swap(value_vec);
      }
 
+     /**
+      * The inverse of wrap(): moves the index vector and value vector
+      * out of the storage, which is left empty.
+      */
+     void unwrap(std::vector<sizetype>& valueptr_vec,
+                 std::vector<valuetype>& value_vec) {
+       valueptr_vec.clear();
+       value_vec.clear();
+       value_ptrs.swap(valueptr_vec);
+       values.swap(value_vec);
+     }
+
      /// Number of keys in the storage.
      inline size_t num_keys() const { return value_ptrs.size(); }
 
@@ -179,6 +192,20 @@ namespace graphlab {
             << values;
      }
 
+     /// Writes the index and the values as the sections name.index and name.values
+     void save_snapshot(mmap_snapshot_writer& writer,
+                        const std::string& name) const {
+       save_snapshot_vector(writer, name + ".index", value_ptrs);
+       save_snapshot_vector(writer, name + ".values", values);
+     }
+
+     void load_snapshot(const mmap_snapshot_reader& reader,
+                        const std::string& name) {
+       clear();
+       load_snapshot_vector(reader, name + ".index", value_ptrs);
+       load_snapshot_vector(reader, name + ".values", values);
+     }
+
      size_t estimate_sizeof() const {
        return sizeof(value_ptrs) + sizeof(values) + sizeof(sizetype)*value_ptrs.capacity() + sizeof(valuetype) * values.capacity();
      }
@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+#ifndef GRAPHLAB_DELTA_VARINT_CSR_HPP
+#define GRAPHLAB_DELTA_VARINT_CSR_HPP
+
+#include <stdint.h>
+#include <vector>
+#include <boost/iterator/iterator_facade.hpp>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/serialization/iarchive.hpp>
+#include <graphlab/serialization/oarchive.hpp>
+#include <graphlab/util/mmap_snapshot.hpp>
+
+namespace graphlab {
+
+  /**
+   * A compressed alternative to csr_storage for integer values.
+   *
+   * Every value is a tuple of Width unsigned integers. The values of a key
+   * are stored as the differences to the previous value of the same key,
+   * component by component, zigzag and varint (LEB128) encoded. Sorted
+   * lists of nearby integers (such as the neighbors of a vertex) therefore
+   * take one or two bytes per component.
+   *
+   * Like csr_storage, value_ptrs[k] is the index of the first value of key
+   * k in the whole storage, so a value also has a global position (see
+   * const_iterator::position()). The values are decoded sequentially:
+   * iterating over a key is as fast as with csr_storage, but random access
+   * into the middle of a list costs a scan from its beginning.
+   */
+  template <size_t Width, typename sizetype = size_t>
+  class delta_varint_csr {
+   public:
+    /// One decoded value
+    struct value_type {
+      uint64_t v[Width];
+    };
+
+    class const_iterator :
+        public boost::iterator_facade<const_iterator,
+                                      value_type,
+                                      boost::random_access_traversal_tag,
+                                      value_type> {
+     public:
+      const_iterator() : list_begin(NULL), next(NULL),
+                         list_begin_pos(0), pos(0), end_pos(0) { }
+
+      /// The global position of the current value
+      sizetype position() const { return pos; }
+
+     private:
+      friend class delta_varint_csr;
+      friend class boost::iterator_core_access;
+
+      const_iterator(const unsigned char* list_begin,
+                     sizetype list_begin_pos, sizetype end_pos)
+          : list_begin(list_begin), next(list_begin),
+            list_begin_pos(list_begin_pos), pos(list_begin_pos),
+            end_pos(end_pos) {
+        for (size_t j = 0;j < Width; ++j) cur.v[j] = 0;
+        if (pos < end_pos) decode();
+      }
+
+      /// Decodes the value at next into cur
+      void decode() {
+        for (size_t j = 0;j < Width; ++j) {
+          uint64_t zz = 0;
+          int shift = 0;
+          while (*next & 0x80) {
+            zz |= uint64_t(*next & 0x7f) << shift;
+            shift += 7;
+            ++next;
+          }
+          zz |= uint64_t(*next) << shift;
+          ++next;
+          cur.v[j] += (zz >> 1) ^ (-(int64_t)(zz & 1));
+        }
+      }
+
+      void increment() {
+        ++pos;
+        if (pos < end_pos) decode();
+      }
+
+      void decrement() {
+        advance(-1);
+      }
+
+      void advance(ptrdiff_t n) {
+        if (n < 0) {
+          // the deltas can only be decoded forwards: restart the list
+          sizetype target = pos + n;
+          ASSERT_GE(target, list_begin_pos);
+          *this = const_iterator(list_begin, list_begin_pos, end_pos);
+          n = target - list_begin_pos;
+        }
+        for (ptrdiff_t i = 0;i < n; ++i) increment();
+      }
+
+      bool equal(const const_iterator& other) const {
+        return pos == other.pos;
+      }
+
+      ptrdiff_t distance_to(const const_iterator& other) const {
+        return ptrdiff_t(other.pos) - ptrdiff_t(pos);
+      }
+
+      value_type dereference() const {
+        return cur;
+      }
+
+      const unsigned char* list_begin;
+      const unsigned char* next;
+      sizetype list_begin_pos;
+      sizetype pos;
+      sizetype end_pos;
+      value_type cur;
+    };
+
+    delta_varint_csr() : nvalues(0) { }
+
+    /**
+     * Encodes the values of a csr_storage layout: value_ptrs[k] is the
+     * first value of key k, and get(i, j) returns component j of value i.
+     * Keys are encoded in parallel.
+     */
+    template <typename Getter>
+    void init(const std::vector<sizetype>& ptrs, size_t num_values,
+              const Getter& get) {
+      clear();
+      value_ptrs = ptrs;
+      nvalues = num_values;
+      const ssize_t nkeys = value_ptrs.size();
+      byte_ptrs.resize(nkeys + 1);
+      byte_ptrs[0] = 0;
+      // first pass: the encoded length of every key
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t k = 0; k < nkeys; ++k) {
+        size_t len = 0;
+        uint64_t prev[Width] = {0};
+        for (sizetype i = value_ptrs[k]; i < value_end(k); ++i) {
+          for (size_t j = 0;j < Width; ++j) {
+            uint64_t val = get(i, j);
+            len += varint_length(zigzag(val - prev[j]));
+            prev[j] = val;
+          }
+        }
+        byte_ptrs[k + 1] = len;
+      }
+      for (ssize_t k = 0; k < nkeys; ++k) byte_ptrs[k + 1] += byte_ptrs[k];
+      bytes.resize(byte_ptrs[nkeys]);
+      // second pass: encode
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t k = 0; k < nkeys; ++k) {
+        unsigned char* out = bytes.empty() ? NULL : &bytes[byte_ptrs[k]];
+        uint64_t prev[Width] = {0};
+        for (sizetype i = value_ptrs[k]; i < value_end(k); ++i) {
+          for (size_t j = 0;j < Width; ++j) {
+            uint64_t val = get(i, j);
+            uint64_t zz = zigzag(val - prev[j]);
+            while (zz >= 0x80) {
+              *out++ = (unsigned char)(zz | 0x80);
+              zz >>= 7;
+            }
+            *out++ = (unsigned char)zz;
+            prev[j] = val;
+          }
+        }
+      }
+    }
+
+    /// Number of keys in the storage.
+    inline size_t num_keys() const { return value_ptrs.size(); }
+
+    /// Number of values in the storage.
+    inline size_t num_values() const { return nvalues; }
+
+    /// Number of values with key == id
+    inline size_t num_values(size_t id) const {
+      return id < num_keys() ? value_end(id) - value_ptrs[id] : 0;
+    }
+
+    /// value_ptrs[k] is the index of the first value of key k
+    inline const std::vector<sizetype>& get_index() const {
+      return value_ptrs;
+    }
+
+    /// Number of bytes used by the encoded values
+    inline size_t num_bytes() const { return bytes.size(); }
+
+    /// Return iterator to the begining value with key == id
+    inline const_iterator begin(size_t id) const {
+      if (id >= num_keys()) return const_iterator(NULL, nvalues, nvalues);
+      return const_iterator(byte_data() + byte_ptrs[id], value_ptrs[id],
+                            value_end(id));
+    }
+
+    /// Return iterator to the ending+1 value with key == id
+    inline const_iterator end(size_t id) const {
+      if (id >= num_keys()) return const_iterator(NULL, nvalues, nvalues);
+      return const_iterator(byte_data() + byte_ptrs[id + 1], value_end(id),
+                            value_end(id));
+    }
+
+    void swap(delta_varint_csr& other) {
+      value_ptrs.swap(other.value_ptrs);
+      byte_ptrs.swap(other.byte_ptrs);
+      bytes.swap(other.bytes);
+      std::swap(nvalues, other.nvalues);
+    }
+
+    void clear() {
+      std::vector<sizetype>().swap(value_ptrs);
+      std::vector<size_t>().swap(byte_ptrs);
+      std::vector<unsigned char>().swap(bytes);
+      nvalues = 0;
+    }
+
+    void load(iarchive& iarc) {
+      clear();
+      iarc >> value_ptrs >> byte_ptrs >> bytes >> nvalues;
+    }
+
+    void save(oarchive& oarc) const {
+      oarc << value_ptrs << byte_ptrs << bytes << nvalues;
+    }
+
+    /**
+     * Writes the storage as the sections name.index, name.bytes_index,
+     * name.bytes and name.size
+     */
+    void save_snapshot(mmap_snapshot_writer& writer,
+                       const std::string& name) const {
+      save_snapshot_vector(writer, name + ".index", value_ptrs);
+      save_snapshot_vector(writer, name + ".bytes_index", byte_ptrs);
+      save_snapshot_vector(writer, name + ".bytes", bytes);
+      save_snapshot_vector(writer, name + ".size",
+                           std::vector<size_t>(1, nvalues));
+    }
+
+    void load_snapshot(const mmap_snapshot_reader& reader,
+                       const std::string& name) {
+      clear();
+      load_snapshot_vector(reader, name + ".index", value_ptrs);
+      load_snapshot_vector(reader, name + ".bytes_index", byte_ptrs);
+      load_snapshot_vector(reader, name + ".bytes", bytes);
+      std::vector<size_t> size;
+      load_snapshot_vector(reader, name + ".size", size);
+      ASSERT_EQ(size.size(), 1);
+      nvalues = size[0];
+    }
+
+    size_t estimate_sizeof() const {
+      return sizeof(*this) + sizeof(sizetype) * value_ptrs.capacity() +
+          sizeof(size_t) * byte_ptrs.capacity() + bytes.capacity();
+    }
+
+   private:
+    /// The index of the value following the last value of key k
+    inline sizetype value_end(size_t k) const {
+      return k + 1 < value_ptrs.size() ? value_ptrs[k + 1] : nvalues;
+    }
+
+    inline const unsigned char* byte_data() const {
+      return bytes.empty() ? NULL : &bytes[0];
+    }
+
+    static inline uint64_t zigzag(uint64_t delta) {
+      return (delta << 1) ^ (uint64_t)((int64_t)delta >> 63);
+    }
+
+    static inline size_t varint_length(uint64_t x) {
+      size_t len = 1;
+      while (x >= 0x80) { x >>= 7; ++len; }
+      return len;
+    }
+
+    std::vector<sizetype> value_ptrs;
+    /// byte_ptrs[k] is the offset of the encoding of key k. num_keys() + 1 entries
+    std::vector<size_t> byte_ptrs;
+    std::vector<unsigned char> bytes;
+    size_t nvalues;
+  }; // end of class
+} // end of graphlab
+#endif
@@ -173,6 +173,11 @@ namespace graphlab {
        }
      }
 
+     /// Repack the values of one key, e.g. after inserting into it
+     void repack(size_t key) {
+       if (key < num_keys()) values.repack(begin(key), end(key));
+     }
+
      /////////////////////////// I/O API ////////////////////////
      /// Debug print out the content of the storage;
      void print(std::ostream& out) const {
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <graphlab/util/mmap_snapshot.hpp>
+#include <graphlab/logger/logger.hpp>
+
+namespace graphlab {
+
+const char SNAPSHOT_MAGIC[8] = {'G', 'L', 'S', 'N', 'A', 'P', '\0', '\1'};
+
+namespace {
+  const uint64_t SNAPSHOT_VERSION = 1;
+
+  struct snapshot_header {
+    char magic[8];
+    uint64_t version;
+    uint64_t num_sections;
+    uint64_t table_offset;
+  };
+} // anonymous namespace
+
+
+mmap_snapshot_writer::mmap_snapshot_writer()
+    : fout(NULL), offset(0), failed(false) { }
+
+mmap_snapshot_writer::~mmap_snapshot_writer() {
+  if (fout != NULL) fclose(fout);
+}
+
+bool mmap_snapshot_writer::open(const std::string& fname) {
+  this->fname = fname;
+  fout = fopen(fname.c_str(), "wb");
+  if (fout == NULL) {
+    logstream(LOG_ERROR) << "Unable to create " << fname << ": "
+                         << strerror(errno) << std::endl;
+    return false;
+  }
+  sections.clear();
+  failed = false;
+  // the header is written by close()
+  offset = 0;
+  pad_to_alignment();
+  return !failed;
+}
+
+void mmap_snapshot_writer::pad_to_alignment() {
+  static const char zeros[SNAPSHOT_ALIGNMENT] = {0};
+  size_t padding = (SNAPSHOT_ALIGNMENT - offset % SNAPSHOT_ALIGNMENT) %
+                   SNAPSHOT_ALIGNMENT;
+  if (offset == 0) padding = SNAPSHOT_ALIGNMENT;
+  if (padding > 0 && fwrite(zeros, 1, padding, fout) != padding) failed = true;
+  offset += padding;
+}
+
+void mmap_snapshot_writer::write(const std::string& name, const void* data,
+                                 size_t len, size_t element_size) {
+  ASSERT_TRUE(fout != NULL);
+  ASSERT_LT(name.length(), sizeof(mmap_snapshot_section::name));
+  mmap_snapshot_section sec;
+  memset(&sec, 0, sizeof(sec));
+  strncpy(sec.name, name.c_str(), sizeof(sec.name) - 1);
+  sec.offset = offset;
+  sec.length = len;
+  sec.element_size = element_size;
+  sections.push_back(sec);
+  if (len > 0 && fwrite(data, 1, len, fout) != len) failed = true;
+  offset += len;
+  pad_to_alignment();
+}
+
+bool mmap_snapshot_writer::close() {
+  ASSERT_TRUE(fout != NULL);
+  snapshot_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  header.version = SNAPSHOT_VERSION;
+  header.num_sections = sections.size();
+  header.table_offset = offset;
+  if (!sections.empty() &&
+      fwrite(&sections[0], sizeof(mmap_snapshot_section), sections.size(),
+             fout) != sections.size()) {
+    failed = true;
+  }
+  // the header goes last, so an interrupted write is not a valid snapshot
+  if (fseek(fout, 0, SEEK_SET) != 0 ||
+      fwrite(&header, sizeof(header), 1, fout) != 1) {
+    failed = true;
+  }
+  if (fclose(fout) != 0) failed = true;
+  fout = NULL;
+  if (failed) {
+    logstream(LOG_ERROR) << "Error writing " << fname << std::endl;
+  }
+  return !failed;
+}
+
+
+mmap_snapshot_reader::mmap_snapshot_reader()
+    : fd(-1), base(NULL), length(0) { }
+
+mmap_snapshot_reader::~mmap_snapshot_reader() {
+  close();
+}
+
+bool mmap_snapshot_reader::is_snapshot(const std::string& fname) {
+  char magic[sizeof(SNAPSHOT_MAGIC)];
+  FILE* fin = fopen(fname.c_str(), "rb");
+  if (fin == NULL) return false;
+  bool ret = fread(magic, 1, sizeof(magic), fin) == sizeof(magic) &&
+             memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+  fclose(fin);
+  return ret;
+}
+
+bool mmap_snapshot_reader::open(const std::string& fname) {
+  close();
+  fd = ::open(fname.c_str(), O_RDONLY);
+  if (fd < 0) {
+    logstream(LOG_ERROR) << "Unable to open " << fname << ": "
+                         << strerror(errno) << std::endl;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || size_t(st.st_size) < SNAPSHOT_ALIGNMENT) {
+    logstream(LOG_ERROR) << fname << " is not a graph snapshot" << std::endl;
+    close();
+    return false;
+  }
+  length = st.st_size;
+  void* ptr = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+  if (ptr == MAP_FAILED) {
+    logstream(LOG_ERROR) << "Unable to map " << fname << ": "
+                         << strerror(errno) << std::endl;
+    close();
+    return false;
+  }
+  base = reinterpret_cast<char*>(ptr);
+
+  snapshot_header header;
+  memcpy(&header, base, sizeof(header));
+  if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+      header.version != SNAPSHOT_VERSION ||
+      header.table_offset + header.num_sections *
+          sizeof(mmap_snapshot_section) > length) {
+    logstream(LOG_ERROR) << fname << " is not a valid graph snapshot"
+                         << std::endl;
+    close();
+    return false;
+  }
+  sections.resize(header.num_sections);
+  if (!sections.empty()) {
+    memcpy(&sections[0], base + header.table_offset,
+           sections.size() * sizeof(mmap_snapshot_section));
+  }
+  for (size_t i = 0;i < sections.size(); ++i) {
+    if (sections[i].offset + sections[i].length > length) {
+      logstream(LOG_ERROR) << fname << " is truncated" << std::endl;
+      close();
+      return false;
+    }
+  }
+  return true;
+}
+
+void mmap_snapshot_reader::close() {
+  if (base != NULL) munmap(base, length);
+  if (fd >= 0) ::close(fd);
+  base = NULL;
+  fd = -1;
+  length = 0;
+  sections.clear();
+}
+
+const mmap_snapshot_section*
+mmap_snapshot_reader::find(const std::string& name) const {
+  for (size_t i = 0;i < sections.size(); ++i) {
+    if (strncmp(sections[i].name, name.c_str(),
+                sizeof(sections[i].name)) == 0) {
+      return &sections[i];
+    }
+  }
+  return NULL;
+}
+
+const mmap_snapshot_section&
+mmap_snapshot_reader::section(const std::string& name) const {
+  const mmap_snapshot_section* sec = find(name);
+  if (sec == NULL) {
+    logstream(LOG_FATAL) << "Snapshot has no section " << name << std::endl;
+  }
+  return *sec;
+}
+
+void mmap_snapshot_reader::copy(const mmap_snapshot_section& sec,
+                                void* dest) const {
+  const size_t CHUNK = 16 * 1024 * 1024;
+  const char* src = data(sec);
+  char* dst = reinterpret_cast<char*>(dest);
+  const ssize_t nchunks = (sec.length + CHUNK - 1) / CHUNK;
+  if (nchunks > 1) madvise(base + sec.offset, sec.length, MADV_SEQUENTIAL);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (ssize_t i = 0;i < nchunks; ++i) {
+    size_t begin = i * CHUNK;
+    size_t len = std::min<size_t>(CHUNK, sec.length - begin);
+    memcpy(dst + begin, src + begin, len);
+  }
+}
+
+} // namespace graphlab
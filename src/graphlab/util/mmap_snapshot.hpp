@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_UTIL_MMAP_SNAPSHOT_HPP
+#define GRAPHLAB_UTIL_MMAP_SNAPSHOT_HPP
+#include <stdint.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <utility>
+#include <graphlab/serialization/iarchive.hpp>
+#include <graphlab/serialization/oarchive.hpp>
+#include <graphlab/serialization/is_pod.hpp>
+#include <graphlab/logger/assertions.hpp>
+
+namespace graphlab {
+
+  /**
+   * \ingroup util
+   * The layout of a snapshot file written by mmap_snapshot_writer:
+   * \li A header of SNAPSHOT_ALIGNMENT bytes: the magic string, the
+   *     format version, the number of sections and the offset of the
+   *     section table.
+   * \li The sections, each starting at a multiple of SNAPSHOT_ALIGNMENT.
+   * \li The section table: one mmap_snapshot_section per section.
+   *
+   * All integers are in the byte order of the machine which wrote the file.
+   */
+  const size_t SNAPSHOT_ALIGNMENT = 4096;
+
+  /// The first 8 bytes of every snapshot file
+  extern const char SNAPSHOT_MAGIC[8];
+
+  /// \ingroup util
+  struct mmap_snapshot_section {
+    char name[48];
+    uint64_t offset;
+    uint64_t length;
+    /**
+     * The size of one element if the section is an array copied as is,
+     * or 0 if the section was serialized with an oarchive.
+     */
+    uint64_t element_size;
+  };
+
+  /**
+   * \ingroup util
+   * Writes a snapshot file section by section. Sections are identified
+   * by a name of at most 47 characters, and are not compressed.
+   *
+   * \code
+   * mmap_snapshot_writer writer;
+   * if (writer.open("graph.bin")) {
+   *   save_snapshot_vector(writer, "vertices", vertices);
+   *   writer.close();
+   * }
+   * \endcode
+   */
+  class mmap_snapshot_writer {
+   public:
+    mmap_snapshot_writer();
+    ~mmap_snapshot_writer();
+
+    /// Creates the file. Returns false on failure
+    bool open(const std::string& fname);
+
+    /// Appends a section of len bytes
+    void write(const std::string& name, const void* data, size_t len,
+               size_t element_size);
+
+    /**
+     * Writes the section table and the header, and closes the file.
+     * Returns false if any write failed.
+     */
+    bool close();
+
+   private:
+    FILE* fout;
+    std::string fname;
+    uint64_t offset;
+    bool failed;
+    std::vector<mmap_snapshot_section> sections;
+
+    void pad_to_alignment();
+  };
+
+
+  /**
+   * \ingroup util
+   * Maps a snapshot file written by mmap_snapshot_writer into memory.
+   * Pages are read from the file when they are first accessed.
+   */
+  class mmap_snapshot_reader {
+   public:
+    mmap_snapshot_reader();
+    ~mmap_snapshot_reader();
+
+    /// True if fname starts with the snapshot magic string
+    static bool is_snapshot(const std::string& fname);
+
+    /// Maps the file. Returns false if it is not a valid snapshot
+    bool open(const std::string& fname);
+
+    /// Unmaps the file. Pointers returned by section() become invalid
+    void close();
+
+    /// Returns the section with the given name, or NULL if there is none
+    const mmap_snapshot_section* find(const std::string& name) const;
+
+    /// Returns the section with the given name. Fails if there is none
+    const mmap_snapshot_section& section(const std::string& name) const;
+
+    /// The address of the contents of a section
+    inline const char* data(const mmap_snapshot_section& sec) const {
+      return base + sec.offset;
+    }
+
+    /**
+     * Copies the contents of a section to dest using all threads, so
+     * that the page faults on the mapping are taken in parallel.
+     */
+    void copy(const mmap_snapshot_section& sec, void* dest) const;
+
+   private:
+    int fd;
+    char* base;
+    size_t length;
+    std::vector<mmap_snapshot_section> sections;
+  };
+
+
+  /**
+   * \ingroup util
+   * True if a std::vector<T> can be written to and read from a snapshot as
+   * raw memory: scalars, types inheriting from IS_POD_TYPE and pairs of
+   * those.
+   */
+  template <typename T>
+  struct snapshot_raw_copy {
+    static const bool value = gl_is_pod<T>::value;
+  };
+
+  template <typename A, typename B>
+  struct snapshot_raw_copy<std::pair<A, B> > {
+    static const bool value = snapshot_raw_copy<A>::value &&
+                              snapshot_raw_copy<B>::value;
+  };
+
+  /// \cond GRAPHLAB_INTERNAL
+  namespace snapshot_impl {
+    template <typename T, bool raw = snapshot_raw_copy<T>::value>
+    struct vector_io {
+      static void save(mmap_snapshot_writer& writer, const std::string& name,
+                       const std::vector<T>& vec) {
+        writer.write(name, vec.empty() ? NULL : &vec[0],
+                     vec.size() * sizeof(T), sizeof(T));
+      }
+      static void load(const mmap_snapshot_reader& reader,
+                       const std::string& name, std::vector<T>& vec) {
+        const mmap_snapshot_section& sec = reader.section(name);
+        ASSERT_MSG(sec.element_size == sizeof(T),
+                   "Snapshot section %s has elements of %d bytes, expected %d",
+                   name.c_str(), (int)sec.element_size, (int)sizeof(T));
+        std::vector<T>(sec.length / sizeof(T)).swap(vec);
+        if (!vec.empty()) reader.copy(sec, &vec[0]);
+      }
+    };
+
+    template <typename T>
+    struct vector_io<T, false> {
+      static void save(mmap_snapshot_writer& writer, const std::string& name,
+                       const std::vector<T>& vec) {
+        oarchive oarc;
+        oarc << vec;
+        writer.write(name, oarc.buf, oarc.off, 0);
+        free(oarc.buf);
+      }
+      static void load(const mmap_snapshot_reader& reader,
+                       const std::string& name, std::vector<T>& vec) {
+        const mmap_snapshot_section& sec = reader.section(name);
+        ASSERT_MSG(sec.element_size == 0,
+                   "Snapshot section %s is not serialized", name.c_str());
+        iarchive iarc(reader.data(sec), sec.length);
+        iarc >> vec;
+      }
+    };
+  } // namespace snapshot_impl
+  /// \endcond
+
+  /**
+   * \ingroup util
+   * Writes a vector as a section. Vectors of snapshot_raw_copy types are
+   * written as is, other vectors are serialized.
+   */
+  template <typename T>
+  void save_snapshot_vector(mmap_snapshot_writer& writer,
+                            const std::string& name,
+                            const std::vector<T>& vec) {
+    snapshot_impl::vector_io<T>::save(writer, name, vec);
+  }
+
+  /// Reads a vector written by save_snapshot_vector()
+  template <typename T>
+  void load_snapshot_vector(const mmap_snapshot_reader& reader,
+                            const std::string& name,
+                            std::vector<T>& vec) {
+    snapshot_impl::vector_io<T>::load(reader, name, vec);
+  }
+
+} // namespace graphlab
+#endif
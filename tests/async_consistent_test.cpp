@@ -150,8 +150,21 @@ void test_all_neighbors(graphlab::distributed_control& dc,
 
 
 
-
-
+void test_coloring_consistency(graphlab::distributed_control& dc,
+                               graphlab::command_line_options& clopts,
+                               graph_type& graph) {
+  std::cout << "Constructing an engine with coloring consistency" << std::endl;
+  graphlab::command_line_options coloring_opts = clopts;
+  coloring_opts.get_engine_args().set_option("consistency", "coloring");
+  typedef graphlab::async_consistent_engine<count_all_neighbors> engine_type;
+  engine_type engine(dc, graph, coloring_opts);
+  std::cout << "Scheduling all vertices to count their neighbors" << std::endl;
+  engine.signal_all(100);
+  std::cout << "Running!" << std::endl;
+  engine.start();
+  ASSERT_EQ(engine.num_updates(), graph.num_vertices());
+  std::cout << "Finished" << std::endl;
+}
 
 
 
@@ -328,6 +341,7 @@ int main(int argc, char** argv) {
   test_in_neighbors(dc, clopts, graph);
   test_out_neighbors(dc, clopts, graph);
   test_all_neighbors(dc, clopts, graph);
+  test_coloring_consistency(dc, clopts, graph);
   test_aggregator(dc, clopts, graph);
   graphlab::mpi_tools::finalize();
 } // end of main
@@ -0,0 +1,97 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/rpc/dc_init_from_mpi.hpp>
+#include <graphlab/util/timer.hpp>
+using namespace graphlab;
+
+
+void int_max_equal(int& a, const int& b) {
+  a = std::max(a, b);
+}
+
+void vector_plus_equal(std::vector<double>& a, const std::vector<double>& b) {
+  for (size_t i = 0;i < a.size(); ++i) a[i] += b[i];
+}
+
+/*
+ * Checks all_reduce_array() against the known sums, for arrays below and
+ * above RING_ALL_REDUCE_THRESHOLD and for lengths which do not divide
+ * evenly between the machines, and compares it with all_reduce2().
+ */
+int main(int argc, char ** argv) {
+  /** Initialization */
+  mpi_tools::init(argc, argv);
+  global_logger().set_log_level(LOG_INFO);
+
+  dc_init_param param;
+  if (init_param_from_mpi(param) == false) {
+    return 0;
+  }
+  distributed_control dc(param);
+  const size_t p = dc.numprocs();
+  const size_t lengths[] = {1, 1000, 1000003, 4 * 1024 * 1024 + 7};
+  for (size_t l = 0;l < sizeof(lengths) / sizeof(size_t); ++l) {
+    const size_t n = lengths[l];
+    // each machine contributes procid + i
+    std::vector<double> vec(n);
+    for (size_t i = 0;i < n; ++i) vec[i] = dc.procid() + i;
+    dc.all_reduce_array(vec);
+    for (size_t i = 0;i < n; ++i) {
+      ASSERT_EQ(vec[i], double(p * (p - 1) / 2 + p * i));
+    }
+    std::vector<int> ivec(n);
+    for (size_t i = 0;i < n; ++i) ivec[i] = (dc.procid() + i) % p;
+    dc.all_reduce_array2(&(ivec[0]), n, int_max_equal);
+    for (size_t i = 0;i < n; ++i) {
+      ASSERT_EQ(ivec[i], int(p - 1));
+    }
+    dc.cout() << n << " elements: OK" << std::endl;
+  }
+
+  // back to back calls must not interfere
+  std::vector<float> fvec(1000000);
+  for (size_t iter = 0;iter < 10; ++iter) {
+    std::fill(fvec.begin(), fvec.end(), float(iter));
+    dc.all_reduce_array(fvec);
+    for (size_t i = 0;i < fvec.size(); ++i) ASSERT_EQ(fvec[i], float(iter * p));
+  }
+  dc.cout() << "Repeated reductions: OK" << std::endl;
+
+  std::vector<double> vec(4 * 1024 * 1024, 1.0);
+  timer ti;
+  ti.start();
+  for (size_t iter = 0;iter < 5; ++iter) dc.all_reduce2(vec, vector_plus_equal);
+  dc.cout() << "all_reduce2: " << ti.current_time() / 5 << "s" << std::endl;
+  ti.start();
+  for (size_t iter = 0;iter < 5; ++iter) dc.all_reduce_array(vec);
+  dc.cout() << "all_reduce_array: " << ti.current_time() / 5 << "s" << std::endl;
+  dc.barrier();
+  mpi_tools::finalize();
+}
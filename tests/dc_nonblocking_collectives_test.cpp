@@ -0,0 +1,79 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/rpc/dc_init_from_mpi.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+using namespace graphlab;
+
+
+void string_max_equal(std::string& a, const std::string& b) {
+  if (b > a) a = b;
+}
+
+/*
+ * Issues several non-blocking collectives at once, waits for them in
+ * reverse order, and checks the results.
+ */
+int main(int argc, char ** argv) {
+  /** Initialization */
+  mpi_tools::init(argc, argv);
+  global_logger().set_log_level(LOG_INFO);
+
+  dc_init_param param;
+  if (init_param_from_mpi(param) == false) {
+    return 0;
+  }
+  distributed_control dc(param);
+  const size_t p = dc.numprocs();
+  for (size_t iter = 0;iter < 100; ++iter) {
+    request_future<size_t> sum = dc.iall_reduce(size_t(dc.procid() + iter));
+    request_future<std::vector<size_t> > gather =
+        dc.iall_gather(size_t(dc.procid() * iter));
+    request_future<std::string> maxstr =
+        dc.iall_reduce2(std::string(dc.procid() + 1, 'a'), string_max_equal);
+    request_future<void> barrier = dc.ibarrier();
+    barrier.wait();
+    ASSERT_EQ(maxstr(), std::string(p, 'a'));
+    ASSERT_EQ(gather().size(), p);
+    for (size_t i = 0;i < p; ++i) ASSERT_EQ(gather()[i], i * iter);
+    ASSERT_EQ(sum(), p * (p - 1) / 2 + p * iter);
+  }
+  dc.cout() << "Non-blocking collectives: OK" << std::endl;
+
+  // overlap a reduction with blocking collectives
+  request_future<size_t> total = dc.iall_reduce(size_t(1));
+  dc.barrier();
+  std::vector<size_t> vec(p);
+  vec[dc.procid()] = dc.procid();
+  dc.all_gather(vec);
+  ASSERT_EQ(total(), p);
+  dc.cout() << "Overlapped collectives: OK" << std::endl;
+  dc.barrier();
+  mpi_tools::finalize();
+}
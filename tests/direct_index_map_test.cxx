@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <vector>
+#include <algorithm>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/util/direct_index_map.hpp>
+using namespace graphlab;
+
+typedef direct_index_map<size_t, uint32_t> index_type;
+
+struct id_at {
+  const std::vector<size_t>& ids;
+  id_at(const std::vector<size_t>& ids) : ids(ids) { }
+  size_t operator()(size_t i) const { return ids[i]; }
+};
+
+class DirectIndexMapTestSuite : public CxxTest::TestSuite {
+ public:
+  /// Checks every id in [0, limit) against a linear search of ids
+  void check(const index_type& index, const std::vector<size_t>& ids,
+             size_t limit) {
+    TS_ASSERT(index.enabled());
+    for (size_t id = 0;id < limit; ++id) {
+      std::vector<size_t>::const_iterator iter =
+          std::find(ids.begin(), ids.end(), id);
+      uint32_t expected = iter == ids.end() ? index_type::NONE :
+                                              uint32_t(iter - ids.begin());
+      TS_ASSERT_EQUALS(index.find(id), expected);
+    }
+  }
+
+  void test_direct(void) {
+    // a shuffled range with a few holes
+    std::vector<size_t> ids;
+    for (size_t i = 0;i < 1000; ++i) {
+      if (i % 7 != 3) ids.push_back((i * 367) % 1000);
+    }
+    index_type index;
+    TS_ASSERT_EQUALS(index.build(ids.size(), id_at(ids)), index_type::DIRECT);
+    check(index, ids, 1200);
+  }
+
+  void test_paged(void) {
+    // two clusters, far apart
+    std::vector<size_t> ids;
+    for (size_t i = 0;i < 5000; ++i) ids.push_back(i);
+    for (size_t i = 0;i < 5000; ++i) ids.push_back(1000000 + 3 * i);
+    index_type index;
+    TS_ASSERT_EQUALS(index.build(ids.size(), id_at(ids)), index_type::PAGED);
+    check(index, ids, 1020000);
+    TS_ASSERT_EQUALS(index.find(size_t(1) << 40), index_type::NONE);
+  }
+
+  void test_sparse(void) {
+    std::vector<size_t> ids;
+    for (size_t i = 0;i < 1000; ++i) ids.push_back(i * 1000003);
+    index_type index;
+    TS_ASSERT_EQUALS(index.build(ids.size(), id_at(ids)), index_type::DISABLED);
+    TS_ASSERT(!index.enabled());
+    // denser ids are accepted with a larger fill
+    TS_ASSERT_EQUALS(index.build(ids.size(), id_at(ids), 2000000),
+                     index_type::DIRECT);
+    check(index, ids, 10000);
+    index.clear();
+    TS_ASSERT(!index.enabled());
+    TS_ASSERT_EQUALS(index.build(0, id_at(ids)), index_type::DISABLED);
+  }
+};
@@ -93,15 +93,14 @@ class distributed_graph_test  {
     * Test adding edges
     */
    void test_dynamic_add_edge() {
-     graphlab::distributed_graph<vertex_data, edge_data> g(*dc);
-     if (g.is_dynamic()) {
-       test_add_edge_impl(g, 10, true);
-       test_add_edge_impl(g, 1000, true);
-       test_add_edge_impl(g, 10000, true);
-       dc->cout() << "\n+ Pass test: graph dynamically add edge. :) \n";
-     } else {
-       dc->cout() << "\n- Graph does not support dynamic. Please compile with -DUSE_DYNAMIC_GRAPH \n";
-     }
+     graphlab::graphlab_options opts;
+     opts.get_graph_args().set_option("dynamic", true);
+     graphlab::distributed_graph<vertex_data, edge_data> g(*dc, opts);
+     ASSERT_TRUE(g.is_dynamic());
+     test_add_edge_impl(g, 10, true);
+     test_add_edge_impl(g, 1000, true);
+     test_add_edge_impl(g, 10000, true);
+     dc->cout() << "\n+ Pass test: graph dynamically add edge. :) \n";
    }
 
    /**
@@ -114,12 +113,14 @@ class distributed_graph_test  {
      }
      g.finalize();
      test_save_load_impl(g);
+     test_save_load_impl(g, "mmap");
      if (g.is_dynamic()) {
        for (size_t i = 0; i < 10; ++i) {
          g.add_edge(i+1, (i), edge_data(i+1, i));
        }
        g.finalize();
        test_save_load_impl(g);
+       test_save_load_impl(g, "mmap");
      }
      dc->cout() << "\n+ Pass test: graph save load binary. :) \n";
    }
@@ -201,7 +202,8 @@ class distributed_graph_test  {
        }
 
    template<typename Graph>
-       void test_save_load_impl(Graph& g) {
+       void test_save_load_impl(Graph& g,
+                                const std::string& format = "gzip") {
          typedef typename Graph::local_edge_type local_edge_type;
 
          using namespace boost::filesystem;
@@ -210,10 +212,10 @@ class distributed_graph_test  {
            path prefix = ph;
            prefix /= "test"; 
            dc->cout() << "Save to path: " << prefix.string() << std::endl;
-           g.save_binary(prefix.string());
+           ASSERT_TRUE(g.save_binary(prefix.string(), format));
 
            Graph g2(*dc);
-           g2.load_binary(prefix.string());
+           ASSERT_TRUE(g2.load_binary(prefix.string()));
            ASSERT_EQ(g.num_vertices(), g2.num_vertices());
            ASSERT_EQ(g.num_edges(), g2.num_edges());
 
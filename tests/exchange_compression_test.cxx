@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/rpc/exchange_compression.hpp>
+using namespace graphlab;
+
+class ExchangeCompressionTestSuite : public CxxTest::TestSuite {
+  // sorted vertex id pairs, like the edges of a sorted edge list
+  std::vector<uint32_t> sorted_edges(size_t n) {
+    std::vector<uint32_t> ret;
+    uint32_t src = 1000;
+    for (size_t i = 0;i < n; ++i) {
+      if (i % 7 == 0) src += 1 + rand() % 3;
+      ret.push_back(src);
+      ret.push_back(rand() % 100000);
+    }
+    return ret;
+  }
+
+  void roundtrip(exchange_compression_type type, const char* data,
+                 size_t len, size_t stride, bool expect_compressed) {
+    dc_impl::exchange_compressor compressor(type);
+    oarchive oarc;
+    bool compressed = compressor.compress(data, len, stride, oarc);
+    TS_ASSERT_EQUALS(compressed, expect_compressed);
+    TS_ASSERT_EQUALS(compressor.bytes_before(), len);
+    if (!compressed) {
+      TS_ASSERT_EQUALS(oarc.off, 0);
+      TS_ASSERT_EQUALS(compressor.bytes_after(), len);
+      free(oarc.buf);
+      return;
+    }
+    TS_ASSERT_LESS_THAN(oarc.off, len);
+    TS_ASSERT_EQUALS(compressor.bytes_after(), oarc.off);
+    std::vector<char> out;
+    TS_ASSERT(dc_impl::exchange_compressor::decompress(oarc.buf, oarc.off, out));
+    TS_ASSERT_EQUALS(out.size(), len);
+    TS_ASSERT(memcmp(&(out[0]), data, len) == 0);
+    // a truncated block must be rejected
+    TS_ASSERT(!dc_impl::exchange_compressor::decompress(oarc.buf, oarc.off - 1,
+                                                        out));
+    free(oarc.buf);
+  }
+
+ public:
+  void test_lz(void) {
+    std::vector<uint32_t> edges = sorted_edges(10000);
+    roundtrip(EXCHANGE_COMPRESSION_LZ,
+              reinterpret_cast<const char*>(&(edges[0])),
+              edges.size() * sizeof(uint32_t), 8, true);
+    std::string text;
+    for (size_t i = 0;i < 1000; ++i) text += "the quick brown fox ";
+    roundtrip(EXCHANGE_COMPRESSION_LZ, text.c_str(), text.length(), 0, true);
+    // short and random inputs do not compress
+    roundtrip(EXCHANGE_COMPRESSION_LZ, "abc", 3, 0, false);
+    std::vector<char> noise(10000);
+    for (size_t i = 0;i < noise.size(); ++i) noise[i] = rand();
+    roundtrip(EXCHANGE_COMPRESSION_LZ, &(noise[0]), noise.size(), 0, false);
+  }
+
+  void test_delta(void) {
+    std::vector<uint32_t> vids;
+    for (size_t i = 0;i < 10000; ++i) vids.push_back(i * 3 + rand() % 3);
+    roundtrip(EXCHANGE_COMPRESSION_DELTA,
+              reinterpret_cast<const char*>(&(vids[0])),
+              vids.size() * sizeof(uint32_t), 4, true);
+    std::vector<uint32_t> edges = sorted_edges(10000);
+    roundtrip(EXCHANGE_COMPRESSION_DELTA,
+              reinterpret_cast<const char*>(&(edges[0])),
+              edges.size() * sizeof(uint32_t), 8, true);
+    // lengths which are not a multiple of the word size
+    std::string text(1001, 'a');
+    roundtrip(EXCHANGE_COMPRESSION_DELTA, text.c_str(), text.length(), 0, true);
+  }
+
+  void test_adaptive(void) {
+    dc_impl::exchange_compressor compressor(EXCHANGE_COMPRESSION_ADAPTIVE);
+    std::vector<uint32_t> vids;
+    for (size_t i = 0;i < 16384; ++i) vids.push_back(i);
+    size_t len = vids.size() * sizeof(uint32_t);
+    for (size_t i = 0;i < 100; ++i) {
+      oarchive oarc;
+      TS_ASSERT(compressor.compress(reinterpret_cast<const char*>(&(vids[0])),
+                                    len, 4, oarc));
+      std::vector<char> out;
+      TS_ASSERT(dc_impl::exchange_compressor::decompress(oarc.buf, oarc.off,
+                                                         out));
+      TS_ASSERT(memcmp(&(out[0]), &(vids[0]), len) == 0);
+      free(oarc.buf);
+    }
+    TS_ASSERT_EQUALS(compressor.bytes_before(), 100 * len);
+    TS_ASSERT_LESS_THAN(compressor.bytes_after() * 3, compressor.bytes_before());
+  }
+};
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+/*
+ * Measures how long fiber_async_consensus takes to detect termination
+ * after the last task has completed.
+ *
+ * A chain of tasks hops from machine to machine, so towards the end of
+ * every trial only one fiber in the whole system has work: the long sparse
+ * tail seen at the end of asynchronous runs. Each machine records the
+ * time its last task completed and the time termination was detected.
+ * The detection latency is max(detected) - max(last task).
+ * All processes should run on the same host so that their clocks agree:
+ *
+ * \code
+ * for n in 1 2 4 8 16 32 64; do
+ *   mpiexec -n $n ./fiber_consensus_bench --protocol=tree
+ *   mpiexec -n $n ./fiber_consensus_bench --protocol=ring
+ * done
+ * \endcode
+ */
+
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/util/timer.hpp>
+#include <graphlab/rpc/dc_init_from_mpi.hpp>
+#include <graphlab/rpc/fiber_async_consensus.hpp>
+#include <graphlab/util/blocking_queue.hpp>
+#include <graphlab/parallel/fiber_group.hpp>
+#include <graphlab/options/command_line_options.hpp>
+using namespace graphlab;
+
+
+class consensus_bench {
+ public:
+  dc_dist_object<consensus_bench> rmi;
+  blocking_queue<size_t> queue;
+  fiber_async_consensus cons;
+  size_t nfibers;
+  size_t work_us;
+  atomic<size_t> numactive;
+  double last_task_time;
+  double detect_time;
+  mutex time_lock;
+
+  consensus_bench(distributed_control &dc, size_t nfibers, size_t work_us,
+                  fiber_async_consensus::protocol_type protocol)
+      : rmi(dc, this), cons(dc, nfibers, NULL, protocol),
+        nfibers(nfibers), work_us(work_us) {
+    numactive.value = nfibers;
+    dc.barrier();
+  }
+
+  void add_task_local(size_t i) {
+    queue.enqueue(i);
+    if (numactive.value < nfibers) cons.cancel();
+  }
+
+  void task(size_t i) {
+    // simulate a little work
+    timer ti; ti.start();
+    while (ti.current_time() * 1e6 < work_us);
+    time_lock.lock();
+    last_task_time = std::max(last_task_time, timer::sec_of_day());
+    time_lock.unlock();
+    if (i > 0) {
+      rmi.remote_call((procid_t)((rmi.procid() + 1) % rmi.numprocs()),
+                      &consensus_bench::add_task_local,
+                      i - 1);
+    }
+  }
+
+  bool try_terminate(size_t cpuid, std::pair<size_t, bool> &job) {
+    job.second = false;
+    numactive.dec();
+    cons.begin_done_critical_section(cpuid);
+    job = queue.try_dequeue();
+    if (job.second == false) {
+      bool ret = cons.end_done_critical_section(cpuid);
+      numactive.inc();
+      return ret;
+    }
+    else {
+      cons.cancel_critical_section(cpuid);
+      numactive.inc();
+      return false;
+    }
+  }
+
+  void thread(size_t cpuid) {
+    while(1) {
+      std::pair<size_t, bool> job = queue.try_dequeue();
+      if (job.second == false) {
+        bool ret = try_terminate(cpuid, job);
+        if (ret == true) break;
+        if (ret == false && job.second == false) continue;
+      }
+      task(job.first);
+    }
+    time_lock.lock();
+    detect_time = std::max(detect_time, timer::sec_of_day());
+    time_lock.unlock();
+  }
+
+  /// Runs one trial. Returns the detection latency in seconds on machine 0
+  double run(size_t ntasks) {
+    cons.reset();
+    last_task_time = 0;
+    detect_time = 0;
+    rmi.barrier();
+    if (rmi.procid() == 0) add_task_local(ntasks);
+    fiber_group thrgrp;
+    for (size_t i = 0;i < nfibers; ++i) {
+      thrgrp.launch(boost::bind(&consensus_bench::thread, this, i));
+    }
+    thrgrp.join();
+    ASSERT_EQ(queue.size(), 0);
+
+    std::vector<std::pair<double, double> > times(rmi.numprocs());
+    times[rmi.procid()] = std::make_pair(last_task_time, detect_time);
+    rmi.all_gather(times);
+    double last_task = 0, last_detect = 0;
+    for (size_t i = 0;i < times.size(); ++i) {
+      last_task = std::max(last_task, times[i].first);
+      last_detect = std::max(last_detect, times[i].second);
+    }
+    return last_detect - last_task;
+  }
+};
+
+
+int main(int argc, char ** argv) {
+  mpi_tools::init(argc, argv);
+  dc_init_param param;
+  if (init_param_from_mpi(param) == false) {
+    return 0;
+  }
+  distributed_control dc(param);
+
+  command_line_options clopts("Termination detection benchmark.", true);
+  std::string protocol = "tree";
+  size_t ntasks = 10000, nfibers = 100, ntrials = 10, work_us = 10;
+  clopts.attach_option("protocol", protocol,
+                       "The termination protocol: {tree, ring}");
+  clopts.attach_option("tasks", ntasks,
+                       "The length of the chain of tasks in every trial.");
+  clopts.attach_option("fibers", nfibers,
+                       "The number of worker fibers on each machine.");
+  clopts.attach_option("trials", ntrials, "The number of trials.");
+  clopts.attach_option("work_us", work_us,
+                       "The duration of each task in microseconds.");
+  if(!clopts.parse(argc, argv)) {
+    std::cout << "Error in parsing command line arguments." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (protocol != "tree" && protocol != "ring") {
+    std::cout << "Unknown protocol " << protocol << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  consensus_bench bench(dc, nfibers, work_us,
+                        protocol == "tree" ? fiber_async_consensus::TREE :
+                                             fiber_async_consensus::TOKEN_RING);
+  double total = 0, worst = 0;
+  for (size_t i = 0;i < ntrials; ++i) {
+    double latency = bench.run(ntasks);
+    total += latency;
+    worst = std::max(worst, latency);
+    if (dc.procid() == 0) {
+      std::cout << "Trial " << i << ": " << latency * 1000 << " ms, "
+                << bench.cons.num_waves() << " waves" << std::endl;
+    }
+  }
+  if (dc.procid() == 0) {
+    std::cout << protocol << " " << dc.numprocs() << " procs: "
+              << "mean time to detect " << total / ntrials * 1000 << " ms, "
+              << "max " << worst * 1000 << " ms" << std::endl;
+  }
+  dc.barrier();
+  mpi_tools::finalize();
+}
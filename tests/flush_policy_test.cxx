@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <map>
+#include <string>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/rpc/dc_compile_parameters.hpp>
+#include <graphlab/rpc/dc_flush_policy.hpp>
+using namespace graphlab;
+
+class FlushPolicyTestSuite : public CxxTest::TestSuite {
+ public:
+  void test_options(void) {
+    dc_impl::flush_policy policy;
+    TS_ASSERT_EQUALS(policy.buffer_size_limit(), FULL_BUFFER_SIZE_LIMIT);
+    TS_ASSERT(policy.send_urgent_immediately());
+    TS_ASSERT(policy.adaptive());
+
+    std::map<std::string, std::string> options;
+    options["flush_buffer_size"] = "1000";
+    options["flush_queue_length"] = "8";
+    options["adaptive_flush"] = "false";
+    options["urgent_send"] = "soon";
+    policy.set_options(options);
+    TS_ASSERT_EQUALS(policy.buffer_size_limit(), 1000);
+    TS_ASSERT_EQUALS(policy.queue_limit(), 8);
+    TS_ASSERT(!policy.send_urgent_immediately());
+    TS_ASSERT(!policy.adaptive());
+    // without adaptation, the queue limit never changes
+    for (size_t i = 0;i < 100; ++i) policy.observe_queued(1000);
+    TS_ASSERT_EQUALS(policy.queue_limit(), 8);
+  }
+
+  void test_retune(void) {
+    dc_impl::flush_policy policy;
+    std::map<std::string, std::string> options;
+    options["flush_buffer_size"] = "1000";
+    options["flush_queue_length"] = "16";
+    policy.set_options(options);
+    // idle connections flush every buffer
+    TS_ASSERT_EQUALS(policy.queue_limit(), 1);
+    // 1MB/s over a 4ms round trip is 4 buffers in flight
+    policy.retune(1e6, 0.004);
+    TS_ASSERT_EQUALS(policy.queue_limit(), 5);
+    // never more than the configured queue length
+    policy.retune(1e9, 0.004);
+    TS_ASSERT_EQUALS(policy.queue_limit(), 16);
+    policy.retune(0, 0.004);
+    TS_ASSERT_EQUALS(policy.queue_limit(), 1);
+  }
+
+  void test_rtt(void) {
+    dc_impl::flush_policy policy;
+    // the smallest round trip time of a period is used
+    policy.observe_rtt(50000);
+    policy.observe_rtt(20000);
+    policy.observe_rtt(90000);
+    policy.observe_queued(1000);
+    uint64_t start = dc_impl::flush_policy::now();
+    while (dc_impl::flush_policy::now() < start + 2 * ADAPTIVE_FLUSH_INTERVAL * 1000ULL);
+    policy.observe_queued(1000);
+    TS_ASSERT_DELTA(policy.rtt(), 20e-6, 1e-9);
+    TS_ASSERT_LESS_THAN(0, policy.throughput());
+  }
+};
@@ -23,6 +23,7 @@
 
 // standard C++ headers
 #include <iostream>
+#include <sstream>
 #include <cxxtest/TestSuite.h>
 
 // includes the entire graphlab framework
@@ -31,6 +32,27 @@
 #include <graphlab/util/random.hpp>
 #include <graphlab/macros_def.hpp>
 
+/// Vertex data stored as a struct of arrays
+struct soa_vertex {
+  double rank;
+  uint32_t nout;
+  float factors[3];
+  soa_vertex() : rank(1), nout(0) {
+    factors[0] = factors[1] = factors[2] = 0;
+  }
+};
+
+namespace graphlab {
+  template <>
+  struct vertex_data_layout<soa_vertex> : public soa_layout<soa_vertex> {
+    static void register_fields(soa_field_list<soa_vertex>& fields) {
+      fields.add(&soa_vertex::rank);
+      fields.add(&soa_vertex::nout);
+      fields.add(&soa_vertex::factors);
+    }
+  };
+}
+
 /**
  * Unit test for graphlab::local_graph.hpp
  */
@@ -131,6 +153,181 @@ public:
     std::cout << "\n+ Pass test: grid dynamic graph test. :) \n";
   }
 
+  void test_compressed_adjacency() {
+    graphlab::local_graph<vertex_data, edge_data> g;
+    g.set_compressed_adjacency(true);
+    test_add_edge_impl(g, 10000);
+    test_powerlaw_graph_impl(g, 10000);
+
+    graphlab::local_graph<vertex_data, edge_data> g2;
+    g2.set_compressed_adjacency(true);
+    test_sparse_graph_impl(g2);
+
+    graphlab::local_graph<vertex_data, edge_data> g3;
+    g3.set_compressed_adjacency(true);
+    test_grid_graph_impl(g3);
+    // converting a finalized graph keeps the edges
+    g3.set_compressed_adjacency(false);
+    check_edge_data(g3);
+    g3.set_compressed_adjacency(true);
+    check_edge_data(g3);
+    std::cout << "\n+ Pass test: compressed adjacency. :) \n";
+  }
+
+  void test_runtime_dynamic() {
+    typedef graphlab::local_graph<vertex_data, edge_data> graph_type;
+    typedef graph_type::vertex_id_type vertex_id_type;
+    graph_type g;
+    g.set_dynamic(true);
+    ASSERT_TRUE(g.is_dynamic());
+    const size_t nverts = 1000;
+    boost::unordered_map<vertex_id_type, std::vector<vertex_id_type> > out_edges;
+    boost::unordered_map<vertex_id_type, std::vector<vertex_id_type> > in_edges;
+    size_t nedges = 0;
+    // one batch per offset, finalized after each
+    for (size_t j = 1; j < 6; ++j) {
+      for (vertex_id_type i = 0; i < nverts; ++i) {
+        vertex_id_type t = (i * 7 + j * 13) % (nverts + 100 * j);
+        if (t == i) continue;
+        g.add_edge(i, t, edge_data(i, t));
+        out_edges[i].push_back(t);
+        in_edges[t].push_back(i);
+        ++nedges;
+      }
+      g.finalize();
+      check_adjacency(g, in_edges, out_edges, nedges);
+      check_edge_data(g);
+    }
+    // round trip through the static layout
+    g.set_dynamic(false);
+    ASSERT_FALSE(g.is_dynamic());
+    check_adjacency(g, in_edges, out_edges, nedges);
+    check_edge_data(g);
+    g.set_dynamic(true);
+    check_adjacency(g, in_edges, out_edges, nedges);
+    check_edge_data(g);
+    // converting back merges the pending edges
+    g.add_edge(0, nverts + 1000, edge_data(0, nverts + 1000));
+    out_edges[0].push_back(nverts + 1000);
+    in_edges[nverts + 1000].push_back(0);
+    ++nedges;
+    g.set_dynamic(false);
+    check_adjacency(g, in_edges, out_edges, nedges);
+    check_edge_data(g);
+    std::cout << "\n+ Pass test: runtime dynamic graph. :) \n";
+  }
+
+  void test_empty_edge_data() {
+    typedef graphlab::local_graph<vertex_data, graphlab::empty> graph_type;
+    typedef graph_type::vertex_id_type vertex_id_type;
+    typedef graph_type::edge_type edge_type;
+    for (size_t compress = 0; compress < 2; ++compress) {
+      graph_type g;
+      g.set_compressed_adjacency(compress);
+      const size_t nverts = 1000;
+      boost::unordered_map<vertex_id_type, std::vector<vertex_id_type> > out_edges;
+      boost::unordered_map<vertex_id_type, std::vector<vertex_id_type> > in_edges;
+      size_t nedges = 0;
+      for (vertex_id_type i = 0; i < nverts; ++i) {
+        for (size_t j = 1; j < 4; ++j) {
+          vertex_id_type t = (i * 7 + j * 13) % nverts;
+          if (t == i) continue;
+          g.add_edge(i, t);
+          out_edges[i].push_back(t);
+          in_edges[t].push_back(i);
+          ++nedges;
+        }
+      }
+      g.finalize();
+      check_adjacency(g, in_edges, out_edges, nedges);
+
+      // the in edges have the ids of the out edges
+      std::map<std::pair<vertex_id_type, vertex_id_type>, size_t> ids;
+      for (vertex_id_type i = 0; i < nverts; ++i) {
+        foreach (const edge_type& e, g.out_edges(i)) {
+          ids[std::make_pair(e.source().id(), e.target().id())] = e.id();
+        }
+      }
+      ASSERT_EQ(ids.size(), nedges);
+      for (vertex_id_type i = 0; i < nverts; ++i) {
+        foreach (const edge_type& e, g.in_edges(i)) {
+          ASSERT_EQ(e.id(),
+                    ids[std::make_pair(e.source().id(), e.target().id())]);
+        }
+      }
+      // the dynamic layout stores the ids of the in edges
+      g.set_dynamic(true);
+      check_adjacency(g, in_edges, out_edges, nedges);
+      for (vertex_id_type i = 0; i < nverts; ++i) {
+        foreach (const edge_type& e, g.in_edges(i)) {
+          ASSERT_EQ(e.id(),
+                    ids[std::make_pair(e.source().id(), e.target().id())]);
+        }
+      }
+    }
+    std::cout << "\n+ Pass test: graph without edge data. :) \n";
+  }
+
+  void test_soa_vertex_data() {
+    typedef graphlab::local_graph<soa_vertex, graphlab::empty> graph_type;
+    typedef float factor_type[3];
+    const size_t nverts = 1000;
+    graph_type g;
+    for (size_t i = 0; i < nverts; ++i) {
+      soa_vertex v;
+      v.rank = i;
+      v.factors[2] = 2 * i;
+      g.add_vertex(i, v);
+    }
+    for (size_t i = 0; i < nverts; ++i) g.add_edge(i, (i + 1) % nverts);
+    g.finalize();
+    for (size_t i = 0; i < nverts; ++i) {
+      graph_type::vertex_type vertex = g.vertex(i);
+      vertex.data().get(&soa_vertex::nout) = vertex.num_out_edges();
+    }
+    // the fields are contiguous and aligned
+    double* rank = g.vertex_column(&soa_vertex::rank);
+    uint32_t* nout = g.vertex_column(&soa_vertex::nout);
+    const factor_type* factors = g.vertex_column(&soa_vertex::factors);
+    TS_ASSERT_EQUALS(size_t(rank) % 64, 0);
+    TS_ASSERT_EQUALS(size_t(nout) % 64, 0);
+    for (size_t i = 0; i < nverts; ++i) {
+      TS_ASSERT_EQUALS(rank[i], i);
+      TS_ASSERT_EQUALS(nout[i], 1);
+      TS_ASSERT_EQUALS(factors[i][2], 2 * i);
+      rank[i] += 0.5;
+    }
+    // whole values are assembled from the fields
+    const graph_type& cg = g;
+    soa_vertex v = cg.vertex_data(10);
+    TS_ASSERT_EQUALS(v.rank, 10.5);
+    TS_ASSERT_EQUALS(v.nout, 1);
+    TS_ASSERT_EQUALS(v.factors[2], 20);
+    g.vertex_data(11) = g.vertex_data(10);
+    TS_ASSERT_EQUALS(rank[11], 10.5);
+    TS_ASSERT_EQUALS(factors[11][2], 20);
+
+    // serialization and swaps keep the fields
+    std::stringstream strm;
+    graphlab::oarchive oarc(strm);
+    oarc << g;
+    strm.flush();
+    graphlab::iarchive iarc(strm);
+    graph_type g2;
+    iarc >> g2;
+    graph_type g3;
+    g3.swap(g2);
+    TS_ASSERT_EQUALS(g2.num_vertices(), 0);
+    TS_ASSERT_EQUALS(g3.num_vertices(), nverts);
+    TS_ASSERT_EQUALS(g3.num_edges(), nverts);
+    for (size_t i = 0; i < nverts; ++i) {
+      soa_vertex v = g3.vertex_data(i);
+      TS_ASSERT_EQUALS(v.rank, i == 11 ? 10.5 : i + 0.5);
+      TS_ASSERT_EQUALS(v.nout, 1);
+    }
+    std::cout << "\n+ Pass test: struct of arrays vertex data. :) \n";
+  }
+
 private: 
   template<typename Graph>
   void test_add_vertex_impl(Graph& g, size_t nverts) {
@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+/*
+ * Loopback benchmark of the RPC layer. Without MPI, it launches each of
+ * the requested process counts on localhost through dc_init_from_env and
+ * measures:
+ * \li remote_call: the aggregate rate of small remote calls
+ * \li remote_request: request/response latency percentiles
+ * \li buffered_exchange: all-to-all bandwidth
+ * \li all_reduce: the time of all_reduce_array() by payload size
+ *
+ * Every measurement is written as one JSON object per line:
+ * \code
+ * ./rpc_benchmark --nprocs=2,4,8 --output=rpc.json
+ * \endcode
+ * \verbatim
+ {"benchmark": "remote_request", "nprocs": 2, "payload_bytes": 8, "metric": "p99_us", "value": 41.2}
+ \endverbatim
+ * The output file is appended to, so runs of different builds can be
+ * collected in the same file.
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/rpc/dc_init_from_env.hpp>
+#include <graphlab/rpc/buffered_exchange.hpp>
+#include <graphlab/util/timer.hpp>
+#include <graphlab/util/stl_util.hpp>
+#include <graphlab/options/command_line_options.hpp>
+using namespace graphlab;
+
+
+class rpc_bench {
+ public:
+  dc_dist_object<rpc_bench> rmi;
+  atomic<size_t> calls_received;
+  std::string output;
+  std::vector<std::string> results;
+
+  rpc_bench(distributed_control& dc, const std::string& output)
+      : rmi(dc, this), output(output) {
+    rmi.barrier();
+  }
+
+  void receive_call(const std::string& s) {
+    calls_received.inc();
+  }
+
+  std::string echo(const std::string& s) {
+    return s;
+  }
+
+  /// The largest value of x over all machines
+  double max_over_machines(double x) {
+    std::vector<double> v(rmi.numprocs());
+    v[rmi.procid()] = x;
+    rmi.all_gather(v);
+    return *std::max_element(v.begin(), v.end());
+  }
+
+  void record(const std::string& benchmark, size_t payload_bytes,
+              const std::string& metric, double value) {
+    if (rmi.procid() != 0) return;
+    std::stringstream strm;
+    strm << "{\"benchmark\": \"" << benchmark << "\", "
+         << "\"nprocs\": " << rmi.numprocs() << ", "
+         << "\"payload_bytes\": " << payload_bytes << ", "
+         << "\"metric\": \"" << metric << "\", "
+         << "\"value\": " << value << "}";
+    results.push_back(strm.str());
+    // progress, when the results go to a file
+    if (!output.empty()) std::cout << strm.str() << std::endl;
+  }
+
+  /// Every machine sends ncalls calls round robin to the other machines
+  void remote_call_rate(size_t payload_bytes, size_t ncalls) {
+    const procid_t p = rmi.numprocs();
+    const size_t nothers = std::max<size_t>(p - 1, 1);
+    std::string payload(payload_bytes, 'a');
+    calls_received.value = 0;
+    rmi.full_barrier();
+    timer ti; ti.start();
+    for (size_t i = 0;i < ncalls; ++i) {
+      procid_t target = (rmi.procid() + 1 + i % nothers) % p;
+      rmi.remote_call(target, &rpc_bench::receive_call, payload);
+    }
+    rmi.full_barrier();
+    double elapsed = max_over_machines(ti.current_time());
+    record("remote_call", payload_bytes, "calls_per_second",
+           double(ncalls) * p / elapsed);
+  }
+
+  /// Every machine times nrequests requests to the next machine
+  void request_latency(size_t payload_bytes, size_t nrequests) {
+    const procid_t target = (rmi.procid() + 1) % rmi.numprocs();
+    std::string payload(payload_bytes, 'a');
+    std::vector<double> latency(nrequests);
+    rmi.full_barrier();
+    for (size_t i = 0;i < nrequests; ++i) {
+      timer ti; ti.start();
+      std::string ret = rmi.remote_request(target, &rpc_bench::echo, payload);
+      latency[i] = ti.current_time() * 1e6;
+      ASSERT_EQ(ret.length(), payload_bytes);
+    }
+    std::vector<std::vector<double> > all(rmi.numprocs());
+    all[rmi.procid()].swap(latency);
+    rmi.gather(all, 0);
+    if (rmi.procid() != 0) return;
+    for (size_t i = 0;i < all.size(); ++i) {
+      std::copy(all[i].begin(), all[i].end(), std::back_inserter(latency));
+    }
+    std::sort(latency.begin(), latency.end());
+    const double q[] = {0.5, 0.9, 0.99};
+    const char* names[] = {"p50_us", "p90_us", "p99_us"};
+    for (size_t i = 0;i < 3; ++i) {
+      record("remote_request", payload_bytes, names[i],
+             latency[size_t(q[i] * (latency.size() - 1))]);
+    }
+    record("remote_request", payload_bytes, "max_us", latency.back());
+  }
+
+  /**
+   * Every machine sends bytes_per_machine bytes of size_t values through
+   * a buffered_exchange, spread evenly over all machines.
+   */
+  void exchange_bandwidth(size_t bytes_per_machine) {
+    typedef buffered_exchange<size_t> exchange_type;
+    const procid_t p = rmi.numprocs();
+    const size_t nvalues = bytes_per_machine / sizeof(size_t);
+    exchange_type exchange(rmi.dc());
+    rmi.full_barrier();
+    timer ti; ti.start();
+    size_t nreceived = 0;
+    procid_t proc;
+    exchange_type::buffer_type buffer;
+    for (size_t i = 0;i < nvalues; ++i) {
+      exchange.send((procid_t)(i % p), i);
+      // drain while sending to bound the memory in flight
+      if (i % 65536 == 0) {
+        while(exchange.recv(proc, buffer, true)) nreceived += buffer.size();
+      }
+    }
+    exchange.flush();
+    while(exchange.recv(proc, buffer)) nreceived += buffer.size();
+    double elapsed = max_over_machines(ti.current_time());
+    rmi.all_reduce(nreceived);
+    ASSERT_EQ(nreceived, nvalues * p);
+    record("buffered_exchange", bytes_per_machine, "mb_per_second",
+           double(bytes_per_machine) * p / elapsed / (1024 * 1024));
+  }
+
+  /// The time of all_reduce_array() on ntrials arrays of length doubles
+  void all_reduce_time(size_t length, size_t ntrials) {
+    std::vector<double> v(length, 1.0);
+    rmi.full_barrier();
+    timer ti; ti.start();
+    for (size_t i = 0;i < ntrials; ++i) {
+      rmi.all_reduce_array(v);
+    }
+    double elapsed = max_over_machines(ti.current_time());
+    record("all_reduce", length * sizeof(double), "ms",
+           elapsed / ntrials * 1000);
+  }
+
+  void write_results() {
+    if (rmi.procid() != 0) return;
+    if (output.empty()) {
+      for (size_t i = 0;i < results.size(); ++i) {
+        std::cout << results[i] << "\n";
+      }
+      std::cout.flush();
+      return;
+    }
+    std::ofstream fout(output.c_str(), std::ios::app);
+    for (size_t i = 0;i < results.size(); ++i) fout << results[i] << "\n";
+    if (!fout.good()) {
+      logstream(LOG_ERROR) << "Unable to write " << output << std::endl;
+    }
+  }
+};
+
+
+/// Runs this program as nprocs processes on localhost and waits for them
+bool spawn(const char* self, size_t nprocs, size_t portbase,
+           int argc, char** argv) {
+  std::string nodes = "127.0.0.1";
+  for (size_t i = 1;i < nprocs; ++i) nodes += ",127.0.0.1";
+  std::vector<pid_t> children;
+  for (size_t i = 0;i < nprocs; ++i) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      setenv("SPAWNID", tostr(i).c_str(), 1);
+      setenv("SPAWNNODES", nodes.c_str(), 1);
+      setenv("SPAWNPORT", tostr(portbase).c_str(), 1);
+      execv(self, argv);
+      perror("execv");
+      _exit(EXIT_FAILURE);
+    }
+    else if (pid < 0) {
+      perror("fork");
+      break;
+    }
+    children.push_back(pid);
+  }
+  bool success = children.size() == nprocs;
+  for (size_t i = 0;i < children.size(); ++i) {
+    int status = 0;
+    waitpid(children[i], &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) success = false;
+  }
+  return success;
+}
+
+
+int main(int argc, char ** argv) {
+  global_logger().set_log_level(LOG_WARNING);
+  command_line_options clopts("Loopback RPC benchmark.", true);
+  std::string nprocs = "2,4";
+  std::string output;
+  size_t scale = 1;
+  size_t portbase = 10000;
+  size_t handler_threads = 0;
+  clopts.attach_option("nprocs", nprocs,
+                       "Comma separated list of the process counts to run.");
+  clopts.attach_option("output", output,
+                       "File the JSON results are appended to. "
+                       "Standard output if empty.");
+  clopts.attach_option("scale", scale,
+                       "Multiplies the number of calls and trials.");
+  clopts.attach_option("port", portbase,
+                       "The first TCP port to listen on.");
+  clopts.attach_option("handler_threads", handler_threads,
+                       "The number of RPC handler threads per process. "
+                       "The default if 0.");
+  if(!clopts.parse(argc, argv)) {
+    std::cout << "Error in parsing command line arguments." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (getenv("SPAWNID") == NULL) {
+    // the launcher: run every process count in turn
+    std::vector<std::string> counts = strsplit(nprocs, ",");
+    bool success = true;
+    for (size_t i = 0;i < counts.size(); ++i) {
+      size_t n = atoi(counts[i].c_str());
+      if (n == 0) continue;
+      // a fresh port range for every run, the last may be in TIME_WAIT
+      if (!spawn("/proc/self/exe", n, portbase + 100 * i, argc, argv)) {
+        std::cerr << "Benchmark failed with " << n << " processes" << std::endl;
+        success = false;
+      }
+    }
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  dc_init_param param;
+  if (init_param_from_env(param) == false) {
+    return EXIT_FAILURE;
+  }
+  if (handler_threads > 0) param.numhandlerthreads = handler_threads;
+  distributed_control dc(param);
+  rpc_bench bench(dc, output);
+
+  const size_t call_sizes[] = {8, 64, 512};
+  for (size_t i = 0;i < 3; ++i) {
+    bench.remote_call_rate(call_sizes[i], 200000 * scale);
+  }
+  const size_t request_sizes[] = {8, 4096};
+  for (size_t i = 0;i < 2; ++i) {
+    bench.request_latency(request_sizes[i], 2000 * scale);
+  }
+  const size_t exchange_sizes[] = {1 << 20, 16 << 20};
+  for (size_t i = 0;i < 2; ++i) {
+    bench.exchange_bandwidth(exchange_sizes[i] * scale);
+  }
+  const size_t reduce_lengths[] = {1, 1024, 65536, 1 << 20, 4 << 20};
+  for (size_t i = 0;i < 5; ++i) {
+    // fewer trials of the large arrays
+    size_t ntrials = std::max<size_t>(scale * (1 << 20) / reduce_lengths[i], 1);
+    bench.all_reduce_time(reduce_lengths[i], std::min<size_t>(ntrials, 100 * scale));
+  }
+  bench.write_results();
+  dc.barrier();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <vector>
+#include <string>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/rpc/rpc_profile.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+using namespace graphlab;
+
+class RPCProfileTestSuite : public CxxTest::TestSuite {
+  // a call to the dispatch function at address dispatch with one argument
+  std::string make_call(size_t dispatch, size_t arg) {
+    oarchive oarc;
+    oarc << dispatch << arg;
+    std::string ret(oarc.buf, oarc.off);
+    free(oarc.buf);
+    return ret;
+  }
+
+  const rpc_function_profile* find(const std::vector<rpc_function_profile>& prof,
+                                   size_t dispatch) {
+    for (size_t i = 0;i < prof.size(); ++i) {
+      if (prof[i].dispatch == dispatch) return &prof[i];
+    }
+    return NULL;
+  }
+
+ public:
+  void test_counts(void) {
+    dc_impl::rpc_profile_set_enabled(true);
+    std::string a = make_call(0x1230, 1);
+    std::string b = make_call(0x4560, 1000000);
+    for (size_t i = 0;i < 10; ++i) dc_impl::rpc_profile_send(a.c_str(), a.length());
+    dc_impl::rpc_profile_send(b.c_str(), b.length());
+    // 3us in the queue and 3us in the handler
+    dc_impl::rpc_profile_receive(a.c_str(), a.length(), 1000, 4000, 7000);
+    // unknown queue time, 100ms in the handler
+    dc_impl::rpc_profile_receive(b.c_str(), b.length(), 0, 0, 100000000);
+    dc_impl::rpc_profile_set_enabled(false);
+
+    std::vector<rpc_function_profile> prof = dc_impl::rpc_profile_snapshot();
+    const rpc_function_profile* pa = find(prof, 0x1230);
+    const rpc_function_profile* pb = find(prof, 0x4560);
+    TS_ASSERT(pa != NULL && pb != NULL);
+    TS_ASSERT_EQUALS(pa->calls_sent, 10);
+    TS_ASSERT_EQUALS(pa->bytes_sent, 10 * a.length());
+    TS_ASSERT_EQUALS(pa->calls_received, 1);
+    TS_ASSERT_EQUALS(pa->queue_histogram[2], 1);
+    TS_ASSERT_EQUALS(pa->handler_histogram[2], 1);
+    TS_ASSERT_DELTA(pa->handler_seconds, 3e-6, 1e-9);
+    TS_ASSERT_EQUALS(pb->queue_seconds, 0);
+    TS_ASSERT_EQUALS(pb->handler_histogram[17], 1);
+    TS_ASSERT(!pa->name.empty());
+
+    // the most expensive function is reported first
+    std::string json = dc_impl::rpc_profile_json(prof);
+    TS_ASSERT_LESS_THAN(json.find("\"dispatch\": 17760"),
+                        json.find("\"dispatch\": 4656"));
+  }
+
+  void test_merge(void) {
+    std::vector<std::vector<rpc_function_profile> > machines(2);
+    rpc_function_profile prof;
+    prof.dispatch = 1;
+    prof.calls_sent = 5;
+    prof.handler_histogram[3] = 2;
+    machines[0].push_back(prof);
+    machines[1].push_back(prof);
+    prof.dispatch = 2;
+    machines[1].push_back(prof);
+
+    // profiles survive serialization
+    oarchive oarc;
+    oarc << machines;
+    iarchive iarc(oarc.buf, oarc.off);
+    std::vector<std::vector<rpc_function_profile> > received;
+    iarc >> received;
+    free(oarc.buf);
+
+    std::vector<rpc_function_profile> merged = dc_impl::rpc_profile_merge(received);
+    TS_ASSERT_EQUALS(merged.size(), 2);
+    TS_ASSERT_EQUALS(find(merged, 1)->calls_sent, 10);
+    TS_ASSERT_EQUALS(find(merged, 1)->handler_histogram[3], 4);
+    TS_ASSERT_EQUALS(find(merged, 2)->calls_sent, 5);
+  }
+};
@@ -414,5 +414,50 @@ public:
         TS_ASSERT_EQUALS(p1[i].x, p2[i].x);
     }
   }
+
+  void test_array_ref(void) {
+    std::vector<double> v;
+    for (size_t i = 0;i < 100; ++i) v.push_back(i * 0.5);
+    const size_t nbytes = v.size() * sizeof(double);
+
+    // arrays which are aligned in a memory buffer are not copied,
+    // misaligned arrays are.
+    size_t naliased = 0, ncopied = 0;
+    array_ref<double> ref;
+    for (size_t pad = 0;pad < sizeof(double); ++pad) {
+      oarchive a;
+      for (size_t i = 0;i < pad; ++i) a << char(0);
+      a << v;
+      iarchive b(a.buf, a.off);
+      char x;
+      for (size_t i = 0;i < pad; ++i) b >> x;
+      b >> ref;
+      TS_ASSERT_EQUALS(b.off, a.off);
+      TS_ASSERT_EQUALS(ref.size(), v.size());
+      for (size_t i = 0;i < v.size(); ++i) TS_ASSERT_EQUALS(ref[i], v[i]);
+      if (ref.owner()) {
+        ++ncopied;
+      } else {
+        ++naliased;
+        TS_ASSERT_EQUALS((const char*)ref.data(), a.buf + a.off - nbytes);
+        TS_ASSERT_EQUALS(size_t(ref.data()) % sizeof(double), 0);
+      }
+      free(a.buf);
+    }
+    TS_ASSERT_EQUALS(naliased, 1);
+    TS_ASSERT_EQUALS(ncopied, sizeof(double) - 1);
+    // the copy outlives the buffer
+    TS_ASSERT_EQUALS(ref.back(), v.back());
+
+    // an array_ref can be read back as a vector
+    oarchive c;
+    c << array_ref<double>(v);
+    std::vector<double> w;
+    iarchive d(c.buf, c.off);
+    d >> w;
+    TS_ASSERT(w == v);
+    free(c.buf);
+  }
+
 };
 
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <vector>
+#include <algorithm>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/scheduler/sweep_scheduler.hpp>
+#include <graphlab/macros_def.hpp>
+using namespace graphlab;
+
+class SweepSchedulerTestSuite : public CxxTest::TestSuite {
+public:
+  void test_ascending(void) {
+    graphlab_options opts;
+    opts.get_scheduler_args().set_option("order", "ascending");
+    sweep_scheduler sched(1000, opts);
+    size_t probes[6] = {999, 3, 64, 65, 128, 500};
+    for (size_t i = 0;i < 6; ++i) sched.schedule(probes[i]);
+    std::sort(probes, probes + 6);
+    lvid_type vid;
+    for (size_t i = 0;i < 6; ++i) {
+      TS_ASSERT_EQUALS(sched.get_next(0, vid), sched_status::NEW_TASK);
+      TS_ASSERT_EQUALS(vid, probes[i]);
+    }
+    TS_ASSERT_EQUALS(sched.get_next(0, vid), sched_status::EMPTY);
+    TS_ASSERT(sched.empty());
+    // the sweep continues from the last position and wraps around
+    sched.schedule(10);
+    sched.schedule(998);
+    TS_ASSERT_EQUALS(sched.get_next(0, vid), sched_status::NEW_TASK);
+    TS_ASSERT_EQUALS(vid, 10);
+    sched.schedule(5);
+    TS_ASSERT_EQUALS(sched.get_next(0, vid), sched_status::NEW_TASK);
+    TS_ASSERT_EQUALS(vid, 998);
+    TS_ASSERT_EQUALS(sched.get_next(0, vid), sched_status::NEW_TASK);
+    TS_ASSERT_EQUALS(vid, 5);
+  }
+
+  void test_ordering(void) {
+    graphlab_options opts;
+    opts.get_scheduler_args().set_option("order", "degree");
+    sweep_scheduler sched(200, opts);
+    TS_ASSERT_EQUALS(sched.get_ordering_request(), std::string("degree"));
+    for (size_t i = 0;i < 200; i += 2) sched.schedule(i);
+    // reverse order. Vertices scheduled before remain scheduled.
+    std::vector<lvid_type> order;
+    for (size_t i = 0;i < 200; ++i) order.push_back(199 - i);
+    sched.set_ordering(order);
+    lvid_type vid;
+    for (size_t i = 0;i < 100; ++i) {
+      TS_ASSERT_EQUALS(sched.get_next(0, vid), sched_status::NEW_TASK);
+      TS_ASSERT_EQUALS(vid, 198 - 2 * i);
+    }
+    TS_ASSERT_EQUALS(sched.get_next(0, vid), sched_status::EMPTY);
+    // new vertices are appended to the order, right where the
+    // sweep left off
+    sched.set_num_vertices(300);
+    sched.schedule(250);
+    sched.schedule(0);
+    TS_ASSERT_EQUALS(sched.get_next(0, vid), sched_status::NEW_TASK);
+    TS_ASSERT_EQUALS(vid, 250);
+    TS_ASSERT_EQUALS(sched.get_next(0, vid), sched_status::NEW_TASK);
+    TS_ASSERT_EQUALS(vid, 0);
+  }
+
+  void test_stripes(void) {
+    graphlab_options opts;
+    opts.set_ncpus(4);
+    opts.get_scheduler_args().set_option("strict", false);
+    sweep_scheduler sched(10000, opts);
+    for (size_t i = 0;i < 10000; i += 3) sched.schedule(i);
+    std::vector<size_t> count(10000, 0);
+    lvid_type vid;
+    size_t cpu = 0;
+    // every vertex is returned once, even if only one thread asks
+    while (sched.get_next(cpu, vid) == sched_status::NEW_TASK) {
+      ++count[vid];
+      if (vid < 5000) cpu = (cpu + 1) % 4;
+    }
+    for (size_t i = 0;i < 10000; ++i) {
+      TS_ASSERT_EQUALS(count[i], (i % 3 == 0) ? 1 : 0);
+    }
+  }
+
+  void test_max_iterations(void) {
+    graphlab_options opts;
+    opts.get_scheduler_args().set_option("order", "ascending");
+    opts.get_scheduler_args().set_option("max_iterations", 2);
+    sweep_scheduler sched(100, opts);
+    lvid_type vid;
+    size_t nupdates = 0;
+    sched.schedule(50);
+    while (sched.get_next(0, vid) == sched_status::NEW_TASK) {
+      ++nupdates;
+      sched.schedule(vid);
+    }
+    TS_ASSERT_EQUALS(nupdates, 2);
+  }
+};
@@ -111,6 +111,21 @@ int main(int argc, char** argv) {
 
   ASSERT_EQ(graph.vertex_set_size(div_6_id), num_div_6);
 
+  // several reductions in one pass
+  std::vector<boost::function<size_t(graph_type::vertex_type)> > counters;
+  counters.push_back(boost::bind(is_divisible, _1, 2));
+  counters.push_back(boost::bind(is_divisible, _1, 3));
+  counters.push_back(boost::bind(is_divisible, _1, 6));
+  std::vector<size_t> counts = graph.map_reduce_vertices<size_t>(counters);
+  ASSERT_EQ(counts.size(), 3);
+  ASSERT_EQ(counts[0], graph.vertex_set_size(even_id));
+  ASSERT_EQ(counts[1], graph.vertex_set_size(div_3_id));
+  ASSERT_EQ(counts[2], num_div_6);
+  counts = graph.map_reduce_vertices<size_t>(counters, div_6_id);
+  ASSERT_EQ(counts[0], num_div_6);
+  ASSERT_EQ(counts[1], num_div_6);
+  ASSERT_EQ(counts[2], num_div_6);
+
 
 
   graphlab::vertex_set out_deg_one = graph.select(boost::bind(select_out_degree_eq, _1, 1));
@@ -122,6 +137,12 @@ int main(int argc, char** argv) {
 
   ASSERT_EQ(num_small_edges, graph.vertex_set_size(out_deg_one));
 
+  std::vector<size_t (*)(graph_type::edge_type)> edge_counters(2, count_edges);
+  counts = graph.map_reduce_edges<size_t>(edge_counters, out_deg_one,
+                                          graphlab::OUT_EDGES);
+  ASSERT_EQ(counts[0], num_small_edges);
+  ASSERT_EQ(counts[1], num_small_edges);
+
   // test transform 
   // set vdata to 1 for the vertices with out degree 1 
   graph.transform_vertices(set_to_one, out_deg_one);
@@ -139,6 +160,40 @@ int main(int argc, char** argv) {
   dc.cout() << graph.vertex_set_size(out_nbrs_in_nbrs) << " nbr nbr size\n";
   // this set must contain the original out_deg_one set
   ASSERT_TRUE(graph.vertex_set_empty((out_deg_one & out_nbrs_in_nbrs) - out_deg_one));
+
+  // a small set is stored as a list of vertices
+  graphlab::vertex_set frontier = graph.select(boost::bind(select_vid_modulo, _1, 1000));
+  ASSERT_TRUE(frontier.sparse);
+  size_t num_frontier = 1 + (graph.num_vertices() - 1) / 1000;
+  ASSERT_EQ(graph.vertex_set_size(frontier), num_frontier);
+  ASSERT_EQ(graph.map_reduce_vertices<size_t>(boost::bind(is_divisible, _1, 1), frontier),
+            num_frontier);
+
+  // mixing lists and bitsets
+  size_t num_div_3000 = 1 + (graph.num_vertices() - 1) / 3000;
+  size_t num_div_3 = graph.vertex_set_size(div_3_id);
+  ASSERT_EQ(graph.vertex_set_size(frontier & div_3_id), num_div_3000);
+  ASSERT_EQ(graph.vertex_set_size(div_3_id & frontier), num_div_3000);
+  ASSERT_EQ(graph.vertex_set_size(frontier - div_3_id), num_frontier - num_div_3000);
+  ASSERT_EQ(graph.vertex_set_size(div_3_id - frontier), num_div_3 - num_div_3000);
+  ASSERT_EQ(graph.vertex_set_size(frontier | div_3_id),
+            num_frontier + num_div_3 - num_div_3000);
+  ASSERT_EQ(graph.vertex_set_size(~frontier), graph.num_vertices() - num_frontier);
+  ASSERT_TRUE(graph.vertex_set_empty(frontier - frontier));
+
+  // the neighbors of a list match the neighbors of the same set as a bitset
+  graphlab::vertex_set dense_frontier = frontier;
+  dense_frontier.get_lvid_bitset(graph);
+  ASSERT_FALSE(dense_frontier.sparse);
+  graphlab::vertex_set frontier_nbrs = graph.neighbors(frontier, graphlab::ALL_EDGES);
+  graphlab::vertex_set dense_frontier_nbrs = graph.neighbors(dense_frontier, graphlab::ALL_EDGES);
+  dc.cout() << graph.vertex_set_size(frontier_nbrs) << " frontier nbr size\n";
+  ASSERT_TRUE(graph.vertex_set_empty(frontier_nbrs - dense_frontier_nbrs));
+  ASSERT_TRUE(graph.vertex_set_empty(dense_frontier_nbrs - frontier_nbrs));
+  ASSERT_EQ(graph.vertex_set_size(frontier_nbrs),
+            graph.vertex_set_size(dense_frontier_nbrs));
+  ASSERT_EQ(graph.map_reduce_edges<size_t>(count_edges, frontier, graphlab::ALL_EDGES),
+            graph.map_reduce_edges<size_t>(count_edges, dense_frontier, graphlab::ALL_EDGES));
   graphlab::mpi_tools::finalize();
 }
 
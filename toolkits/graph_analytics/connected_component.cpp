@@ -33,8 +33,9 @@
 
 struct vdata {
   uint64_t labelid;
+  // vertices added by an update are recognized by the unset label
   vdata() :
-      labelid(0) {
+      labelid(std::numeric_limits<uint64_t>::max()) {
   }
 
   void save(graphlab::oarchive& oarc) const {
@@ -52,6 +53,12 @@ void initialize_vertex(graph_type::vertex_type& v) {
   v.data().labelid = v.id();
 }
 
+//set label id of the vertices which have none
+void initialize_new_vertex(graph_type::vertex_type& v) {
+  if (v.data().labelid == std::numeric_limits<uint64_t>::max())
+    v.data().labelid = v.id();
+}
+
 //message where summation means minimum
 struct min_message {
   uint64_t value;
@@ -167,6 +174,11 @@ int main(int argc, char** argv) {
                        "If set, will save the pairs of a vertex id and "
                        "a component id to a sequence of files with prefix "
                        "saveprefix");
+  std::string updates;
+  clopts.attach_option("updates", updates,
+                       "Comma separated list of graph files, in the same "
+                       "format, with edges added after the first run. The "
+                       "components are updated incrementally after each.");
   if (!clopts.parse(argc, argv)) {
     dc.cout() << "Error in parsing command line arguments." << std::endl;
     return EXIT_FAILURE;
@@ -175,6 +187,8 @@ int main(int argc, char** argv) {
     std::cout << "--graph is not optional\n";
     return EXIT_FAILURE;
   }
+  // edges can only be added to a finalized graph if it is dynamic
+  if (!updates.empty()) clopts.get_graph_args().set_option("dynamic", true);
 
   graph_type graph(dc, clopts);
 
@@ -193,6 +207,22 @@ int main(int argc, char** argv) {
   time(&start);
   engine.start();
 
+  //new edges can only merge components: restart from the endpoints
+  graph.clear_changed_vertices();
+  std::vector<std::string> update_files = graphlab::strsplit(updates, ",", true);
+  for (size_t i = 0; i < update_files.size(); ++i) {
+    dc.cout() << "Adding edges from: " << update_files[i] << std::endl;
+    graph.load_format(update_files[i], format);
+    graph.finalize();
+    graph.transform_vertices(initialize_new_vertex, graph.changed_vertices());
+    graphlab::omni_engine<label_propagation> update_engine(dc, graph,
+                                                           exec_type, clopts);
+    update_engine.signal_changed();
+    update_engine.start();
+    dc.cout() << "Finished update in " << update_engine.elapsed_seconds()
+              << " seconds." << std::endl;
+  }
+
   //write results
   if (saveprefix.size() > 0) {
     graph.save(saveprefix, graph_writer(),
@@ -203,11 +203,18 @@ int main(int argc, char** argv) {
   clopts.attach_option("saveprefix", saveprefix,
                        "If set, will save the resultant pagerank to a "
                        "sequence of files with prefix saveprefix");
+  std::string updates;
+  clopts.attach_option("updates", updates,
+                       "Comma separated list of graph files, in the same "
+                       "format, with edges added after the first run. The "
+                       "pagerank is updated incrementally after each.");
 
   if(!clopts.parse(argc, argv)) {
     dc.cout() << "Error in parsing command line arguments." << std::endl;
     return EXIT_FAILURE;
   }
+  // edges can only be added to a finalized graph if it is dynamic
+  if (!updates.empty()) clopts.get_graph_args().set_option("dynamic", true);
 
 
   // Enable gather caching in the engine
@@ -253,6 +260,25 @@ int main(int argc, char** argv) {
   dc.cout() << "Finished Running engine in " << runtime
             << " seconds." << std::endl;
 
+  // Incremental updates ------------------------------------------------------
+  graph.clear_changed_vertices();
+  std::vector<std::string> update_files = graphlab::strsplit(updates, ",", true);
+  for (size_t i = 0; i < update_files.size(); ++i) {
+    dc.cout() << "Adding edges from: " << update_files[i] << std::endl;
+    graph.load_format(update_files[i], format);
+    graph.finalize();
+    // A new edge changes the out degree of its source, and therefore the
+    // contribution of the source to each of its out neighbors.
+    graphlab::vertex_set affected = graph.changed_vertices();
+    affected |= graph.neighbors(affected, graphlab::OUT_EDGES);
+    graph.clear_changed_vertices();
+    graphlab::omni_engine<pagerank> update_engine(dc, graph, exec_type, clopts);
+    update_engine.signal_vset(affected);
+    update_engine.start();
+    dc.cout() << "Finished update in " << update_engine.elapsed_seconds()
+              << " seconds." << std::endl;
+  }
+
 
   const double total_rank = graph.map_reduce_vertices<double>(map_rank);
   std::cout << "Total rank: " << total_rank << std::endl;
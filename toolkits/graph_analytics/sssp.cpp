@@ -128,7 +128,9 @@ public:
 
 
   /**
-   * \brief If the distance is smaller then update
+   * \brief If the distance is smaller then update. A vertex signaled
+   * without a distance (by signal_changed() after edges were added)
+   * scatters its current distance.
    */
   void apply(icontext_type& context, vertex_type& vertex,
              const graphlab::empty& empty) {
@@ -136,6 +138,8 @@ public:
     if(vertex.data().dist > min_dist) {
       changed = true;
       vertex.data().dist = min_dist;
+    } else if (min_dist == std::numeric_limits<distance_type>::max()) {
+      changed = true;
     }
   }
 
@@ -241,11 +245,18 @@ int main(int argc, char** argv) {
   clopts.attach_option("saveprefix", saveprefix,
                        "If set, will save the resultant pagerank to a "
                        "sequence of files with prefix saveprefix");
+  std::string updates;
+  clopts.attach_option("updates", updates,
+                       "Comma separated list of graph files, in the same "
+                       "format, with edges added after the first run. The "
+                       "distances are updated incrementally after each.");
 
   if(!clopts.parse(argc, argv)) {
     dc.cout() << "Error in parsing command line arguments." << std::endl;
     return EXIT_FAILURE;
   }
+  // edges can only be added to a finalized graph if it is dynamic
+  if (!updates.empty()) clopts.get_graph_args().set_option("dynamic", true);
 
 
   // Build the graph ----------------------------------------------------------
@@ -302,6 +313,22 @@ int main(int argc, char** argv) {
   dc.cout() << "Finished Running engine in " << runtime
             << " seconds." << std::endl;
 
+  // Incremental updates ------------------------------------------------------
+  // New edges can only shorten paths: the endpoints rescatter their
+  // distances.
+  graph.clear_changed_vertices();
+  std::vector<std::string> update_files = graphlab::strsplit(updates, ",", true);
+  for (size_t i = 0; i < update_files.size(); ++i) {
+    dc.cout() << "Adding edges from: " << update_files[i] << std::endl;
+    graph.load_format(update_files[i], format);
+    graph.finalize();
+    graphlab::omni_engine<sssp> update_engine(dc, graph, exec_type, clopts);
+    update_engine.signal_changed();
+    update_engine.start();
+    dc.cout() << "Finished update in " << update_engine.elapsed_seconds()
+              << " seconds." << std::endl;
+  }
+
 
   // Save the final graph -----------------------------------------------------
   if (saveprefix != "") {
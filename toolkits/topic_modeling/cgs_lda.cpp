@@ -915,8 +915,13 @@ bool load_and_initialize_graph(graphlab::distributed_control& dc,
             << timer.current_time() << " seconds." << std::endl;
 
   dc.cout() << "Computing number of words and documents." << std::endl;
-  NWORDS = graph.map_reduce_vertices<size_t>(is_word);
-  NDOCS = graph.map_reduce_vertices<size_t>(is_doc);
+  std::vector<bool (*)(const graph_type::vertex_type&)> counters;
+  counters.push_back(is_word);
+  counters.push_back(is_doc);
+  const std::vector<size_t> counts =
+      graph.map_reduce_vertices<size_t>(counters);
+  NWORDS = counts[0];
+  NDOCS = counts[1];
   NTOKENS = graph.map_reduce_edges<size_t>(count_tokens);
 
 